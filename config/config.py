@@ -102,6 +102,18 @@ DB_QUERIES = {
     "error_stats": "SELECT level, COUNT(*) as count FROM logs GROUP BY level"
 }
 
+# 5. DB_POOL: Connection reuse across :db calls
+#    Connections stay open between queries, so ten quick queries against a remote
+#    Postgres cost one handshake instead of ten. Saved queries (DB_QUERIES) are
+#    kept prepared per connection (Postgres / MySQL; SQLite caches them itself).
+DB_POOL = {
+    "enabled": True,
+    "idle_timeout_s": 300,      # Close connections unused this long (also frees DuckDB file locks)
+    "ping_after_s": 30,         # Health-check a connection idle longer than this before reuse
+    "max_connections": 4,       # Distinct databases kept open at once (least recently used closed)
+    "prepared_statements": 32   # Saved queries kept prepared per connection
+}
+
 # ==================================================================================
 # LS SORTING
 # ==================================================================================
@@ -118,6 +130,143 @@ LS_SORT = {
     "flow": "h"          # "h" (horizontal) or "v" (vertical)
 }
 
+# ==================================================================================
+# LS METADATA CACHE
+# ==================================================================================
+# Reuse the analysis (rows, columns, item counts) of files that have not changed
+# since the previous listing. A file is considered unchanged when its inode,
+# modification time and size are the same, so repeated 'ls' calls in large
+# directories only cost one stat per entry.
+LS_CACHE = {
+    "enabled": True,        # Cache results in memory (also enables the remote agent cache)
+    "persist": True,        # Keep the cache across sessions in ~/.dais/stats_cache.bin
+    "max_entries": 200000   # Upper bound on cached files
+}
+
+# ==================================================================================
+# LS EXACT ROW COUNTS
+# ==================================================================================
+# By default, row counts for files larger than 32KB are extrapolated from the
+# first 32KB (shown with a '~'). Exact mode reads the whole file instead, within
+# a per-listing budget: files that do not fit keep the estimate.
+# Runtime commands:
+#   :ls exact      - Enable exact counting
+#   :ls estimate   - Back to 32KB estimates
+LS_EXACT = {
+    "enabled": False,   # Count rows over the whole file
+    "max_mb": 256,      # Bytes read in full per listing, in MB (0 = unlimited)
+    "max_ms": 500       # Time allowance per listing, in milliseconds (0 = unlimited)
+}
+
+# ==================================================================================
+# LS DIRECTORY ITEM COUNTS
+# ==================================================================================
+# Directories show how many items they contain. Counting stops once a directory
+# holds more than max_items entries and shows e.g. "10k+" instead, so listing the
+# parent of huge trees (node_modules, build caches, Maildir) stays fast.
+# Counts are cached (LS_CACHE) until the directory itself changes.
+LS_DIR_COUNT = {
+    "max_items": 10000          # Stop counting past this many entries (0 = unlimited)
+}
+
+# ==================================================================================
+# LS PROGRESSIVE RENDERING
+# ==================================================================================
+# When analysis is slow (network mounts, huge logs, giant subdirectories), ls first
+# paints names and sizes with rows/cols shown as '...', then redraws the grid in
+# place once analysis finishes. Entries that make no progress within the timeout
+# stay pending so the prompt is never held hostage; their results are cached for
+# the next listing.
+LS_PROGRESSIVE = {
+    "enabled": True,            # Paint a preliminary grid for slow listings
+    "first_paint_ms": 80,       # Analysis time before the preliminary grid appears
+    "entry_timeout_ms": 2000    # Give up waiting once no entry completes for this long
+}
+
+# ==================================================================================
+# LS RECURSIVE TOTALS (ls -R)
+# ==================================================================================
+# `ls -R` lists the target like plain ls, but each directory shows the totals of
+# its whole subtree: size, rows and number of files (LS_FORMATS "tree_directory").
+# The walk runs in parallel and stops at these limits; partial totals are marked
+# with "+". Over SSH the agent walks on the remote host and only sends the totals.
+LS_TREE = {
+    "max_depth": 32,            # Deepest directory level walked
+    "max_entries": 200000       # Stop after visiting this many entries (0 = unlimited)
+}
+
+# ==================================================================================
+# LS GIT ANNOTATIONS
+# ==================================================================================
+# {git} and {git_branch} in LS_FORMATS are computed without running git: the
+# repository's .git/index is read directly (and cached until it changes) and each
+# tracked entry is compared with one stat(), like the first pass of `git status`.
+# A file that was only touched shows as modified until a git command refreshes
+# the index. Remote (SSH) listings show no git annotations.
+LS_GIT = {
+    "enabled": True,
+    "budget_ms": 50,               # Max time per listed directory; a slower one is skipped until the index changes
+    "max_index_entries": 100000    # Repositories with more tracked files get no markers (0 = unlimited)
+}
+
+# ==================================================================================
+# REMOTE AGENT
+# ==================================================================================
+# Over SSH, the deployed agent can stay resident for the session. Each ls is then a
+# single shell builtin (printf into the agent's FIFO) instead of starting a new
+# process, and the agent's metadata cache stays warm in memory. The agent exits on
+# its own when the SSH session ends or after idle_timeout_s without requests.
+REMOTE_AGENT = {
+    "resident": True,           # Keep the agent running between listings
+    "idle_timeout_s": 1800      # Resident agent exits after this long without requests
+}
+
+# ==================================================================================
+# PERF COUNTERS (:perf)
+# ==================================================================================
+# DAIS keeps latency histograms for the stages of ls (enumeration, queueing,
+# analysis, sort, layout), remote round trips and :db (cold/warm query, render).
+# Recording costs a few nanoseconds per stage and is on by default.
+# Runtime commands:
+#   :perf              - Show p50/p90/p99/max per stage
+#   :perf reset        - Start a new measurement window
+#   :perf json [file]  - Print (or save) the counters as JSON
+# dump_on_exit writes the same JSON when DAIS exits, e.g. "~/.dais/perf.json".
+PERF = {
+    "enabled": True,
+    "dump_on_exit": "",
+}
+
+# ==================================================================================
+# PLUGIN HOOKS (src/py_scripts)
+# ==================================================================================
+# Plugin hooks such as on_command(cmd_text) run on a separate Python thread, so
+# typing never waits for them. A plugin that must change the command lists the
+# hook in DAIS_SYNC_HOOKS = ["on_command"]; it then runs before the command is
+# sent, and a returned string replaces the command line.
+# A call slower than slow_ms gets that plugin's hook skipped for cooldown_s.
+# :perf shows calls, times and skips per plugin.
+PLUGIN_HOOKS = {
+    "slow_ms": 250,         # A single call this slow throttles the plugin
+    "cooldown_s": 10,       # How long a throttled plugin is skipped
+    "queue_limit": 1024,    # Pending events kept for the hook thread (oldest dropped)
+}
+
+# ==================================================================================
+# STARTUP
+# ==================================================================================
+# lazy_python: the shell prompt comes up first; plugins and db_handler are imported
+# on the Python thread while the shell starts (a :db typed before that waits).
+# Set False to load every plugin before the shell starts, as older versions did.
+# config_snapshot: the evaluated values of this file are saved to
+# ~/.dais/config_snapshot.bin and reused while this file is unchanged, so startup
+# does not need Python at all. Values computed from other files or environment
+# variables are frozen until this file changes: touch it, or set False.
+STARTUP = {
+    "lazy_python": True,
+    "config_snapshot": True,
+}
+
 # ==================================================================================
 # LS OUTPUT FORMATTING
 # ==================================================================================
@@ -134,6 +283,9 @@ LS_PADDING = 2  # default: 2 spaces (min: 1) (max: depends on terminal width)
 #   {rows}  - row count for text files (e.g., "50", "~1.2k")
 #   {cols}  - max column width for text files
 #   {count} - item count (directories only)
+#   {git}   - git status marker: "*" modified, "?" untracked, "!" ignored
+#             (empty when clean or outside a repository; see LS_GIT)
+#   {git_branch} - " [branch]" for directories that are git repositories
 #
 # Color placeholders (use THEME colors):
 #   {RESET}     - reset to default
@@ -168,11 +320,12 @@ THEME = {
 }
 
 LS_FORMATS = {
-    "directory":   "{TEXT}{name}{STRUCTURE}/ ({VALUE}{count} {UNIT}items{STRUCTURE})",
-    "text_file":   "{TEXT}{name} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})",
-    "data_file":   "{TEXT}{name} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})",
-    "binary_file": "{TEXT}{name} {STRUCTURE}({VALUE}{size}{STRUCTURE})",
+    "directory":   "{TEXT}{name}{git}{STRUCTURE}/{git_branch} ({VALUE}{count} {UNIT}items{STRUCTURE})",
+    "text_file":   "{TEXT}{name}{git} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})",
+    "data_file":   "{TEXT}{name}{git} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})",
+    "binary_file": "{TEXT}{name}{git} {STRUCTURE}({VALUE}{size}{STRUCTURE})",
     "error":       "{TEXT}{name}",  # Shown when file analysis fails
+    "tree_directory": "{TEXT}{name}{git}{STRUCTURE}/{git_branch} ({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{count} {UNIT}files{STRUCTURE})",  # ls -R (subtree totals)
 }
 
 
@@ -0,0 +1,187 @@
+/**
+ * @file agent_wire.hpp
+ * @brief Compact line-oriented wire format between the remote agent and DAIS.
+ * * Shared by agent.cpp (encoder) and render_remote_ls (decoder), so both sides
+ * agree on one definition. Negotiated at deploy time via `agent --caps`; the
+ * JSON output stays the default for older agents and the Python tier.
+ *
+ * Format (version 1), safe to pass through a PTY and the capture sink:
+ *   DW1\n
+ *   <flags>,<size>,<rows>,<cols>,<count>,<name>\n   (one line per entry)
+ * - Numbers are lowercase hex; flags is a bitmask of the WIRE_* bits.
+ * - The name is the last field and is percent-encoded for bytes <= 0x20,
+ *   '%' and 0x7f, so a record never contains whitespace, ESC or newlines
+ *   (ONLCR turning "\n" into "\r\n" is tolerated by the decoder).
+ */
+
+#pragma once
+
+#include "core/file_analyzer.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dais::utils {
+
+    constexpr int AGENT_WIRE_VERSION = 1;
+    constexpr std::string_view AGENT_WIRE_MAGIC = "DW1";
+
+    /// @brief Bits of the per-record flags field.
+    constexpr unsigned WIRE_DIR       = 1;
+    constexpr unsigned WIRE_TEXT      = 2;
+    constexpr unsigned WIRE_DATA      = 4;
+    constexpr unsigned WIRE_ESTIMATED = 8;
+    constexpr unsigned WIRE_CAPPED    = 16;
+
+    namespace wire_detail {
+        inline void append_hex(std::string& out, uint64_t v) {
+            char buf[16];
+            int n = 0;
+            do {
+                buf[n++] = "0123456789abcdef"[v & 0xf];
+                v >>= 4;
+            } while (v);
+            while (n) out.push_back(buf[--n]);
+        }
+
+        inline int hex_value(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        /// @brief Parses hex digits up to `stop`; advances p past the separator.
+        inline bool parse_hex(const char*& p, const char* end, char stop, uint64_t& v) {
+            v = 0;
+            const char* start = p;
+            while (p < end && *p != stop) {
+                int d = hex_value(*p);
+                if (d < 0) return false;
+                v = (v << 4) | static_cast<unsigned>(d);
+                ++p;
+            }
+            if (p == start || p == end) return false;
+            ++p; // Separator
+            return true;
+        }
+    }
+
+    /// @brief Appends one record (including the trailing newline).
+    inline void append_wire_record(std::string& out, std::string_view name, const FileStats& s) {
+        unsigned flags = (s.is_dir ? WIRE_DIR : 0u) | (s.is_text ? WIRE_TEXT : 0u) | (s.is_data ? WIRE_DATA : 0u) |
+                         (s.is_estimated ? WIRE_ESTIMATED : 0u) | (s.count_capped ? WIRE_CAPPED : 0u);
+        wire_detail::append_hex(out, flags);
+        out.push_back(',');
+        wire_detail::append_hex(out, s.size_bytes);
+        out.push_back(',');
+        wire_detail::append_hex(out, s.rows);
+        out.push_back(',');
+        wire_detail::append_hex(out, s.max_cols);
+        out.push_back(',');
+        wire_detail::append_hex(out, s.item_count);
+        out.push_back(',');
+        for (char c : name) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (u <= 0x20 || u == '%' || u == 0x7f) {
+                out.push_back('%');
+                out.push_back("0123456789abcdef"[u >> 4]);
+                out.push_back("0123456789abcdef"[u & 0xf]);
+            } else {
+                out.push_back(c);
+            }
+        }
+        out.push_back('\n');
+    }
+
+    /// @brief Decodes a percent-encoded wire name, appending to out.
+    inline void wire_unescape(std::string_view in, std::string& out) {
+        out.reserve(out.size() + in.size());
+        for (size_t i = 0; i < in.size(); ++i) {
+            if (in[i] == '%' && i + 2 < in.size()) {
+                int hi = wire_detail::hex_value(in[i + 1]);
+                int lo = wire_detail::hex_value(in[i + 2]);
+                if (hi >= 0 && lo >= 0) {
+                    out.push_back(static_cast<char>((hi << 4) | lo));
+                    i += 2;
+                    continue;
+                }
+            }
+            out.push_back(in[i]);
+        }
+    }
+
+    /**
+     * @brief Zero-allocation iterator over a wire payload.
+     * Records are returned as views into the payload; the name stays encoded
+     * until the caller unescapes it into its own storage (wire_unescape).
+     */
+    class WireDecoder {
+    public:
+        /// @param payload Agent output; anything before the magic line is skipped.
+        explicit WireDecoder(std::string_view payload) {
+            size_t pos = payload.find(AGENT_WIRE_MAGIC);
+            // The magic must start a line (the echo line was already removed upstream)
+            while (pos != std::string_view::npos && pos > 0 && payload[pos - 1] != '\n') {
+                pos = payload.find(AGENT_WIRE_MAGIC, pos + 1);
+            }
+            if (pos == std::string_view::npos) return;
+            const char* line_end = next_line(payload.data() + pos, payload.data() + payload.size());
+            valid_ = true;
+            p_ = line_end;
+            end_ = payload.data() + payload.size();
+        }
+
+        /// @brief True if the payload carried the wire header.
+        bool valid() const { return valid_; }
+
+        /// @brief Returns false when the payload is exhausted. Malformed lines are skipped.
+        bool next(std::string_view& encoded_name, FileStats& stats) {
+            while (p_ < end_) {
+                const char* line = p_;
+                const char* eol = line;
+                while (eol < end_ && *eol != '\n') ++eol;
+                p_ = (eol < end_) ? eol + 1 : end_;
+
+                const char* content_end = eol;
+                if (content_end > line && content_end[-1] == '\r') --content_end;
+                if (parse_record(line, content_end, encoded_name, stats)) return true;
+            }
+            return false;
+        }
+
+    private:
+        static const char* next_line(const char* p, const char* end) {
+            while (p < end && *p != '\n') ++p;
+            return p < end ? p + 1 : end;
+        }
+
+        static bool parse_record(const char* p, const char* end, std::string_view& name, FileStats& s) {
+            uint64_t flags, size, rows, cols, count;
+            if (!wire_detail::parse_hex(p, end, ',', flags)) return false;
+            if (!wire_detail::parse_hex(p, end, ',', size)) return false;
+            if (!wire_detail::parse_hex(p, end, ',', rows)) return false;
+            if (!wire_detail::parse_hex(p, end, ',', cols)) return false;
+            if (!wire_detail::parse_hex(p, end, ',', count)) return false;
+            if (p >= end) return false; // Empty name
+            name = std::string_view(p, static_cast<size_t>(end - p));
+
+            s = FileStats{};
+            s.is_valid = true;
+            s.is_dir = flags & WIRE_DIR;
+            s.is_text = flags & WIRE_TEXT;
+            s.is_data = flags & WIRE_DATA;
+            s.is_estimated = flags & WIRE_ESTIMATED;
+            s.count_capped = flags & WIRE_CAPPED;
+            s.size_bytes = size;
+            s.rows = static_cast<size_t>(rows);
+            s.max_cols = static_cast<size_t>(cols);
+            s.item_count = static_cast<size_t>(count);
+            return true;
+        }
+
+        bool valid_ = false;
+        const char* p_ = nullptr;
+        const char* end_ = nullptr;
+    };
+}
@@ -0,0 +1,188 @@
+/**
+ * @file capture_sink.hpp
+ * @brief Streaming parser for captured remote command output.
+ * * execute_remote_command() sends "cmd; echo <sentinel>" and swallows the PTY
+ * output until the sentinel appears. CaptureSink consumes that output as it
+ * arrives and produces the cleaned result in one pass:
+ *   1. Sentinel matching (KMP state carried across reads; bytes that may still be
+ *      the start of the sentinel are held back, everything else flows on).
+ *   2. Command echo removal (the first line is dropped if it carries the echo marker).
+ *   3. Leading whitespace trim.
+ *   4. ANSI escape stripping, remembering where the last non-whitespace input
+ *      byte ended so the trailing trim is a single resize at the end.
+ * The result is moved out by take(); no intermediate copies of the output are made.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dais::core::utils {
+
+    class CaptureSink {
+    public:
+        /**
+         * @brief Starts a new capture.
+         * @param sentinel End marker; capture completes when it appears in the raw stream.
+         * @param echo_marker A first line containing this is treated as the command echo.
+         */
+        void reset(std::string sentinel, std::string echo_marker) {
+            sentinel_ = std::move(sentinel);
+            echo_marker_ = std::move(echo_marker);
+            fail_.assign(sentinel_.size(), 0);
+            for (size_t i = 1, k = 0; i < sentinel_.size(); ++i) {
+                while (k > 0 && sentinel_[i] != sentinel_[k]) k = fail_[k - 1];
+                if (sentinel_[i] == sentinel_[k]) ++k;
+                fail_[i] = static_cast<uint32_t>(k);
+            }
+            matched_ = 0;
+            done_ = sentinel_.empty();
+            first_line_ = true;
+            line_.clear();
+            leading_ = true;
+            esc_ = TEXT;
+            out_.clear();
+            keep_ = 0;
+        }
+
+        /**
+         * @brief Consumes raw PTY bytes. Input after the sentinel is ignored.
+         * @return true once the sentinel has been seen.
+         */
+        bool feed(const char* data, size_t n) {
+            for (size_t i = 0; i < n && !done_; ++i) {
+                // Fast path: plain text that cannot start the sentinel or an escape
+                // sequence is appended as one run
+                if (matched_ == 0 && esc_ == TEXT && !first_line_ && !leading_) {
+                    size_t end = i;
+                    while (end < n && data[end] != sentinel_[0] && data[end] != '\x1b') ++end;
+                    if (end > i) {
+                        size_t base = out_.size();
+                        out_.append(data + i, end - i);
+                        for (size_t k = end; k > i; --k) {
+                            if (!is_space(data[k - 1])) { keep_ = base + (k - i); break; }
+                        }
+                        i = end;
+                        if (i == n) break;
+                    }
+                }
+
+                const char c = data[i];
+                // Bytes currently held back are exactly sentinel_[0, matched_)
+                size_t before = matched_;
+                size_t m = matched_;
+                while (m > 0 && c != sentinel_[m]) m = fail_[m - 1];
+                if (c == sentinel_[m]) ++m;
+                matched_ = m;
+
+                if (m == sentinel_.size()) {
+                    done_ = true; // Held bytes were the sentinel itself: drop them
+                    break;
+                }
+                // Release whatever can no longer belong to a match
+                size_t release = before + 1 - m;
+                for (size_t j = 0; j < release; ++j) {
+                    on_line_byte(j < before ? sentinel_[j] : c);
+                }
+            }
+            return done_;
+        }
+
+        bool feed(std::string_view s) { return feed(s.data(), s.size()); }
+
+        bool done() const { return done_; }
+
+        /// @brief Finishes the capture and moves the cleaned output out.
+        std::string take() {
+            if (first_line_) {
+                // No newline before the sentinel: the whole output is one line, kept as is
+                first_line_ = false;
+                for (char ch : line_) on_text_byte(ch);
+                line_.clear();
+            }
+            out_.resize(keep_);
+            std::string result = std::move(out_);
+            out_.clear();
+            keep_ = 0;
+            return result;
+        }
+
+    private:
+        enum EscState : uint8_t { TEXT, ESC_SEEN, IN_SEQUENCE };
+
+        static bool is_space(char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\x0b' || c == '\x0c';
+        }
+
+        static bool is_letter(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
+
+        // Stage 2: drop the first line if it is the command echo
+        void on_line_byte(char c) {
+            if (!first_line_) {
+                on_text_byte(c);
+                return;
+            }
+            if (c != '\n') {
+                line_.push_back(c);
+                return;
+            }
+            first_line_ = false;
+            if (line_.find(echo_marker_) == std::string::npos) {
+                for (char ch : line_) on_text_byte(ch);
+                on_text_byte('\n');
+            }
+            line_.clear();
+            line_.shrink_to_fit();
+        }
+
+        // Stage 3 + 4: leading trim, ANSI stripping, trailing-trim bookkeeping
+        void on_text_byte(char c) {
+            const bool space = is_space(c);
+            if (leading_) {
+                if (space) return;
+                leading_ = false;
+            }
+            switch (esc_) {
+                case ESC_SEEN:
+                    // CSI "ESC [" and charset "ESC (" sequences run until a letter;
+                    // a lone ESC is dropped and this byte is handled as text
+                    if (c == '[' || c == '(') {
+                        esc_ = IN_SEQUENCE;
+                        break;
+                    }
+                    esc_ = TEXT;
+                    [[fallthrough]];
+                case TEXT:
+                    if (c == '\x1b') esc_ = ESC_SEEN;
+                    else out_.push_back(c);
+                    break;
+                case IN_SEQUENCE:
+                    // An ESC inside a sequence starts over
+                    if (c == '\x1b') esc_ = ESC_SEEN;
+                    else if (is_letter(c)) esc_ = TEXT;
+                    break;
+            }
+            if (!space) keep_ = out_.size();
+        }
+
+        std::string sentinel_;
+        std::string echo_marker_;
+        std::vector<uint32_t> fail_;   ///< KMP failure table for sentinel_
+        size_t matched_ = 0;           ///< Length of the current partial sentinel match
+        bool done_ = false;
+
+        bool first_line_ = true;       ///< Still buffering the first line (possible echo)
+        std::string line_;
+
+        bool leading_ = true;          ///< Still skipping leading whitespace
+        EscState esc_ = TEXT;
+        std::string out_;
+        size_t keep_ = 0;              ///< out_ size after the last non-whitespace input byte
+    };
+}
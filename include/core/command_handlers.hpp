@@ -9,7 +9,14 @@
 #pragma once
 
 #include "core/file_analyzer.hpp"
+#include "core/stats_cache.hpp"
+#include "core/dir_scan.hpp"
+#include "core/tree_scan.hpp"
+#include "core/agent_wire.hpp"
 #include "core/thread_pool.hpp"
+#include "core/perf.hpp"
+#include "core/git_status.hpp"
+#include "core/ls_listing.hpp"
 #include <string>
 #include <string_view>
 #include <vector>
@@ -20,9 +27,21 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <cctype>
+#include <cstring>
+#include <charconv>
 #include <future> // std::async and std::future
-#include <unordered_map>
 #include <regex> 
+#include <functional>
+#include <optional>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <climits> // PATH_MAX
+
+#if defined(__APPLE__)
+#include <sys/param.h> // MAXPATHLEN (F_GETPATH)
+#endif
 
 namespace dais::core::handlers {
 
@@ -68,6 +87,15 @@ namespace dais::core::handlers {
         return w.ws_col;
     }
 
+    /** * @brief Retrieves the current terminal window height.
+     * @return Number of rows. Defaults to 24 on error.
+     */
+    inline int get_terminal_height() {
+        struct winsize w;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == -1 || w.ws_row == 0) return 24;
+        return w.ws_row;
+    }
+
     /** * @brief Calculates the visible length of a string, ignoring ANSI escape codes.
      * * Essential for grid layout calculations. If we counted ANSI codes as length,
      * colored strings would be treated as very long, breaking alignment.
@@ -157,28 +185,203 @@ namespace dais::core::handlers {
     // LS FORMAT TEMPLATES
     // ==================================================================================
 
+    /**
+     * @brief A format template parsed once into literal spans and placeholder ids.
+     * * Rendering is a single append pass over the token list: literals are copied,
+     * color placeholders read the current Theme value (so theme changes need no
+     * recompile) and data placeholders are produced by a caller-supplied appender.
+     * Unknown placeholders are kept verbatim. Substituted values are never
+     * re-scanned, so a filename like "{rows}" is printed as-is.
+     * * uses() tells whether a data placeholder occurs at all, so work that only
+     * feeds it (git annotations) can be skipped.
+     */
+    class CompiledTemplate {
+    public:
+        /// @brief Data placeholders: {name}, {size}, {rows}, {cols}, {count}, {git}, {git_branch}.
+        enum class Field : uint8_t { Name, Size, Rows, Cols, Count, Git, GitBranch };
+
+        CompiledTemplate() = default;
+        explicit CompiledTemplate(std::string_view tmpl) { compile(tmpl); }
+
+        /// @brief Tokenizes `tmpl`, replacing any previous contents.
+        void compile(std::string_view tmpl) {
+            source_.assign(tmpl);
+            tokens_.clear();
+
+            auto add_literal = [this](size_t offset, size_t length) {
+                if (length == 0) return;
+                // Merge with a directly preceding literal
+                if (!tokens_.empty() && tokens_.back().kind == Kind::Literal &&
+                    tokens_.back().offset + tokens_.back().length == offset) {
+                    tokens_.back().length += static_cast<uint32_t>(length);
+                    return;
+                }
+                tokens_.push_back({Kind::Literal, Field::Name, static_cast<uint32_t>(offset),
+                                   static_cast<uint32_t>(length), nullptr});
+            };
+
+            size_t pos = 0;
+            while (pos < source_.size()) {
+                size_t open = source_.find('{', pos);
+                if (open == std::string::npos) break;
+                add_literal(pos, open - pos);
+
+                size_t close = source_.find('}', open + 1);
+                if (close == std::string::npos) {
+                    pos = open;
+                    break;
+                }
+                std::string_view key(source_.data() + open + 1, close - open - 1);
+                if (key.find('{') != std::string_view::npos) {
+                    // "{{name}": the first brace is literal text
+                    add_literal(open, 1);
+                    pos = open + 1;
+                    continue;
+                }
+
+                Token token{Kind::Literal, Field::Name, static_cast<uint32_t>(open),
+                            static_cast<uint32_t>(close - open + 1), nullptr};
+                if (const std::string* color = color_of(key)) {
+                    token.kind = Kind::Color;
+                    token.color = color;
+                    tokens_.push_back(token);
+                } else if (field_of(key, token.field)) {
+                    token.kind = Kind::Field;
+                    tokens_.push_back(token);
+                } else {
+                    add_literal(token.offset, token.length); // Unknown placeholder: keep verbatim
+                }
+                pos = close + 1;
+            }
+            add_literal(pos, source_.size() - pos);
+        }
+
+        /// @brief The template text this token list was built from.
+        const std::string& source() const { return source_; }
+
+        /// @brief True if the data placeholder `field` occurs in the template.
+        bool uses(Field field) const {
+            return std::any_of(tokens_.begin(), tokens_.end(),
+                               [field](const Token& t) { return t.kind == Kind::Field && t.field == field; });
+        }
+
+        /**
+         * @brief Appends the rendered template to `out`.
+         * @param append_field Called as append_field(out, Field) for each data placeholder.
+         */
+        template <class AppendField>
+        void render(std::string& out, AppendField&& append_field) const {
+            for (const Token& token : tokens_) {
+                switch (token.kind) {
+                    case Kind::Literal: out.append(source_, token.offset, token.length); break;
+                    case Kind::Color:   out += *token.color; break;
+                    case Kind::Field:   append_field(out, token.field); break;
+                }
+            }
+        }
+
+    private:
+        enum class Kind : uint8_t { Literal, Color, Field };
+
+        struct Token {
+            Kind kind;
+            Field field;
+            uint32_t offset;            ///< Literal span in source_
+            uint32_t length;
+            const std::string* color;   ///< Theme member for Kind::Color
+        };
+
+        static const std::string* color_of(std::string_view key) {
+            if (key == "RESET") return &Theme::RESET;
+            if (key == "STRUCTURE") return &Theme::STRUCTURE;
+            if (key == "UNIT") return &Theme::UNIT;
+            if (key == "VALUE") return &Theme::VALUE;
+            if (key == "ESTIMATE") return &Theme::ESTIMATE;
+            if (key == "TEXT") return &Theme::TEXT;
+            if (key == "SYMLINK") return &Theme::SYMLINK;
+            return nullptr;
+        }
+
+        static bool field_of(std::string_view key, Field& field) {
+            if (key == "name") field = Field::Name;
+            else if (key == "size") field = Field::Size;
+            else if (key == "rows") field = Field::Rows;
+            else if (key == "cols") field = Field::Cols;
+            else if (key == "count") field = Field::Count;
+            else if (key == "git") field = Field::Git;
+            else if (key == "git_branch") field = Field::GitBranch;
+            else return false;
+            return true;
+        }
+
+        std::string source_;
+        std::vector<Token> tokens_;
+    };
+
     /**
      * @brief Holds format template strings for ls output.
      * Passed to handle_ls() to allow user customization via config.py.
+     * Each template is tokenized once (ensure_compiled()) and rendered per item
+     * in a single append pass.
      * 
      * Available placeholders:
      *   {name}  - filename or directory name
      *   {size}  - formatted size (e.g., "10KB")
      *   {rows}  - row count (e.g., "50" or "~1.2k")
      *   {cols}  - max column width
-     *   {count} - item count (directories only)
+     *   {count} - item count (directories only; files below it in tree_directory)
+     *   {git}   - git marker: "*" modified, "?" untracked, "!" ignored (empty if clean)
+     *   {git_branch} - " [branch]" for directories that are repository roots (empty otherwise)
      * 
+     * tree_directory is used by `ls -R`, where {size} and {rows} are subtree totals.
+     *
      * Color placeholders (replaced with Theme values):
      *   {RESET}, {STRUCTURE}, {UNIT}, {VALUE}, {ESTIMATE}, {TEXT}, {SYMLINK}
      */
     struct LSFormats {
         // Default templates
         // Note: {size} includes VALUE/UNIT coloring, {rows} includes ESTIMATE coloring for ~
-        std::string directory   = "{TEXT}{name}{STRUCTURE}/ ({VALUE}{count} {UNIT}items{STRUCTURE})";
-        std::string text_file   = "{TEXT}{name} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
-        std::string data_file   = "{TEXT}{name} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
-        std::string binary_file = "{TEXT}{name} {STRUCTURE}({VALUE}{size}{STRUCTURE})";
+        std::string directory   = "{TEXT}{name}{git}{STRUCTURE}/{git_branch} ({VALUE}{count} {UNIT}items{STRUCTURE})";
+        std::string text_file   = "{TEXT}{name}{git} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
+        std::string data_file   = "{TEXT}{name}{git} {STRUCTURE}({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
+        std::string binary_file = "{TEXT}{name}{git} {STRUCTURE}({VALUE}{size}{STRUCTURE})";
         std::string error       = "{TEXT}{name}";
+        std::string tree_directory = "{TEXT}{name}{git}{STRUCTURE}/{git_branch} ({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{count} {UNIT}files{STRUCTURE})";
+
+        /// @brief Token lists for the templates above (see ensure_compiled()).
+        struct Compiled {
+            CompiledTemplate directory, text_file, data_file, binary_file, error, tree_directory;
+        } compiled;
+
+        /// @brief True if every token list matches its template string.
+        bool is_compiled() const {
+            return compiled.directory.source() == directory &&
+                   compiled.text_file.source() == text_file &&
+                   compiled.data_file.source() == data_file &&
+                   compiled.binary_file.source() == binary_file &&
+                   compiled.error.source() == error &&
+                   compiled.tree_directory.source() == tree_directory;
+        }
+
+        /// @brief Re-tokenizes templates whose string changed (call after config load).
+        void ensure_compiled() {
+            auto sync = [](CompiledTemplate& tmpl, const std::string& text) {
+                if (tmpl.source() != text) tmpl.compile(text);
+            };
+            sync(compiled.directory, directory);
+            sync(compiled.text_file, text_file);
+            sync(compiled.data_file, data_file);
+            sync(compiled.binary_file, binary_file);
+            sync(compiled.error, error);
+            sync(compiled.tree_directory, tree_directory);
+        }
+
+        /// @brief True if any entry template (compiled) uses the data placeholder `field`.
+        bool uses(CompiledTemplate::Field field) const {
+            return compiled.directory.uses(field) || compiled.text_file.uses(field) ||
+                   compiled.data_file.uses(field) || compiled.binary_file.uses(field) ||
+                   compiled.tree_directory.uses(field);
+        }
     };
 
     /**
@@ -200,86 +403,93 @@ namespace dais::core::handlers {
         std::string flow = "h";      ///< "h" (horizontal) or "v" (vertical)
     };
 
-    /**
-     * @brief Applies placeholder substitution to a format template.
-     * Substitutes both data placeholders ({name}, {size}, etc.) and 
-     * color placeholders ({STRUCTURE}, {VALUE}, etc.).
-     * @param tmpl The template string with {placeholder} syntax.
-     * @param vars Map of placeholder names to their replacement values.
-     * @return The formatted string with all placeholders substituted.
-     */
-    inline std::string apply_template(
-        const std::string& tmpl,
-        const std::unordered_map<std::string, std::string>& vars
-    ) {
-        std::string result = tmpl;
-        
-        // First, substitute color placeholders from Theme
-        const std::unordered_map<std::string, std::string> colors = {
-            {"RESET", Theme::RESET},
-            {"STRUCTURE", Theme::STRUCTURE},
-            {"UNIT", Theme::UNIT},
-            {"VALUE", Theme::VALUE},
-            {"ESTIMATE", Theme::ESTIMATE},
-            {"TEXT", Theme::TEXT},
-            {"SYMLINK", Theme::SYMLINK}
-        };
-        
-        for (const auto& [key, value] : colors) {
-            std::string placeholder = "{" + key + "}";
-            size_t pos;
-            while ((pos = result.find(placeholder)) != std::string::npos) {
-                result.replace(pos, placeholder.length(), value);
-            }
-        }
-        
-        // Then substitute data placeholders
-        for (const auto& [key, value] : vars) {
-            std::string placeholder = "{" + key + "}";
-            size_t pos;
-            while ((pos = result.find(placeholder)) != std::string::npos) {
-                result.replace(pos, placeholder.length(), value);
-            }
-        }
-        return result;
-    }
-
     // ==================================================================================
     // FORMATTERS
     // ==================================================================================
 
+    /// @brief Appends an unsigned integer in decimal (no temporaries).
+    inline void append_uint(std::string& out, uintmax_t value) {
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, res.ptr);
+    }
+
     /** 
-     * @brief Formats byte counts into human-readable strings (e.g., "10B", "1.5KB", "2.3MB", "1.1GB").
+     * @brief Appends a human-readable byte count (e.g., "10B", "1.5KB", "2.3MB", "1.1GB").
      * Includes Theme::VALUE color for the number and Theme::UNIT color for the suffix.
      */
-    inline std::string fmt_size(uintmax_t bytes) {
-        if (bytes < 1024) 
-            return std::format("{}{}{}B", Theme::VALUE, bytes, Theme::UNIT);
+    inline void append_size(std::string& out, uintmax_t bytes) {
+        if (bytes < 1024) {
+            out += Theme::VALUE;
+            append_uint(out, bytes);
+            out += Theme::UNIT;
+            out += 'B';
+            return;
+        }
+        auto it = std::back_inserter(out);
         if (bytes < 1024 * 1024) 
-            return std::format("{}{:.1f}{}KB", Theme::VALUE, bytes/1024.0, Theme::UNIT);
-        if (bytes < 1024 * 1024 * 1024)
-            return std::format("{}{:.1f}{}MB", Theme::VALUE, bytes/(1024.0*1024.0), Theme::UNIT);
-        return std::format("{}{:.1f}{}GB", Theme::VALUE, bytes/(1024.0*1024.0*1024.0), Theme::UNIT);
+            std::format_to(it, "{}{:.1f}{}KB", Theme::VALUE, bytes/1024.0, Theme::UNIT);
+        else if (bytes < 1024 * 1024 * 1024)
+            std::format_to(it, "{}{:.1f}{}MB", Theme::VALUE, bytes/(1024.0*1024.0), Theme::UNIT);
+        else
+            std::format_to(it, "{}{:.1f}{}GB", Theme::VALUE, bytes/(1024.0*1024.0*1024.0), Theme::UNIT);
     }
 
     /** 
-     * @brief Formats row counts (e.g., "50", "~1.2k", "~2.5M").
-     * Returns raw value without "R" suffix - formatting controlled via templates.
+     * @brief Appends a row count (e.g., "50", "~1.2k", "~2.5M").
+     * Raw value without "R" suffix - formatting controlled via templates.
      * Adds colored tilde (~) prefix for estimated values using Theme::ESTIMATE.
      */
-    inline std::string fmt_rows(size_t rows, bool estimated) {
+    inline void append_rows(std::string& out, size_t rows, bool estimated) {
         // Compensation for the observed overestimation (~9-10%)
         if (estimated) {
             rows = static_cast<size_t>(rows * 0.92);
+            // Tilde is colored with ESTIMATE color for visual distinction
+            out += Theme::ESTIMATE;
+            out += '~';
+            out += Theme::VALUE;
         }
-        // Tilde is colored with ESTIMATE color for visual distinction
-        std::string tilde = estimated ? Theme::ESTIMATE + "~" + Theme::VALUE : "";
 
+        auto it = std::back_inserter(out);
         if (rows >= 1000000)
-            return std::format("{}{:.1f}M", tilde, rows / 1000000.0);
-        if (rows >= 1000)
-            return std::format("{}{:.1f}k", tilde, rows / 1000.0);
-        return std::format("{}{}", tilde, rows);
+            std::format_to(it, "{:.1f}M", rows / 1000000.0);
+        else if (rows >= 1000)
+            std::format_to(it, "{:.1f}k", rows / 1000.0);
+        else
+            append_uint(out, rows);
+    }
+
+    /** 
+     * @brief Appends a directory item count (e.g., "42", or "10k+" when counting stopped at the cap).
+     */
+    inline void append_count(std::string& out, size_t count, bool capped) {
+        auto it = std::back_inserter(out);
+        if (!capped) append_uint(out, count);
+        else if (count >= 1000000 && count % 1000000 == 0) std::format_to(it, "{}M+", count / 1000000);
+        else if (count >= 1000 && count % 1000 == 0) std::format_to(it, "{}k+", count / 1000);
+        else std::format_to(it, "{}+", count);
+    }
+
+    /// @brief Appends the {git} marker: "*" modified, "?" untracked, "!" ignored, nothing if clean.
+    inline void append_git_mark(std::string& out, utils::GitMark mark) {
+        switch (mark) {
+            case utils::GitMark::None:      break;
+            case utils::GitMark::Modified:  out += Theme::WARNING; out += '*'; break;
+            case utils::GitMark::Untracked: out += Theme::NOTICE; out += '?'; break;
+            case utils::GitMark::Ignored:   out += Theme::STRUCTURE; out += '!'; break;
+        }
+    }
+
+    /// @brief Appends the {git_branch} annotation (" [main]"), nothing for non-repositories.
+    inline void append_git_branch(std::string& out, std::string_view branch) {
+        if (branch.empty()) return;
+        out += ' ';
+        out += Theme::STRUCTURE;
+        out += '[';
+        out += Theme::UNIT;
+        out += branch;
+        out += Theme::STRUCTURE;
+        out += ']';
     }
 
     // ==================================================================================
@@ -289,11 +499,12 @@ namespace dais::core::handlers {
     /**
      * @brief Parsed arguments for ls command.
      * 
-     * Supports common flags: -a (show hidden), -l (long format - future).
+     * Supports common flags: -a (show hidden), -R (recursive totals), -l (long format - future).
      * Multiple paths can be specified.
      */
     struct LSArgs {
         bool show_hidden = false;   ///< -a or --all flag
+        bool recursive = false;     ///< -R or --recursive: directories show subtree totals
         bool supported = true;      ///< If false, flags are too complex for native ls
         int padding = 4;            ///< Grid padding (spaces between columns)
         std::vector<std::string> paths;  ///< Target directories/files
@@ -302,8 +513,8 @@ namespace dais::core::handlers {
     /**
      * @brief Parses ls command arguments from user input.
      * Identifies if the command can be handled natively.
-     * Only supports: ls, ls -a, ls --all, and paths.
-     * Anything else (e.g., -l, -R, -t) marks supported=false.
+     * Only supports: ls, ls -a, ls --all, ls -R, ls --recursive (or -aR) and paths.
+     * Anything else (e.g., -l, -t) marks supported=false.
      */
     inline LSArgs parse_ls_args(const std::string& input) {
         LSArgs args;
@@ -315,8 +526,13 @@ namespace dais::core::handlers {
         while (iss >> token) {
             if (token == "-a" || token == "--all") {
                 args.show_hidden = true;
+            } else if (token == "-R" || token == "--recursive") {
+                args.recursive = true;
+            } else if (token == "-aR" || token == "-Ra") {
+                args.show_hidden = true;
+                args.recursive = true;
             } else if (token.starts_with("-")) {
-                // Any other flag (-l, -R, -t, etc.) is not supported natively.
+                // Any other flag (-l, -t, etc.) is not supported natively.
                 // We mark it as unsupported so the engine falls back to the shell.
                 args.supported = false;
                 return args; 
@@ -334,165 +550,232 @@ namespace dais::core::handlers {
     }
     
     /**
-     * @brief Lists directory contents using native std::filesystem APIs.
-     * 
-     * This replaces the shell-based ls interception with direct filesystem access.
-     * Benefits:
-     * - No shell compatibility issues (Fish aliases, Zsh colors)
-     * - Faster (no process spawn, no PTY I/O)
-     * - Robust filename handling (no text parsing)
-     * 
-     * @param args Parsed ls arguments (paths, flags)
-     * @param cwd Current working directory for relative path resolution
-     * @param formats Format templates for output styling
-     * @param sort_cfg Sorting configuration
-     * @param pool Thread pool for parallel file analysis
-     * @return Formatted grid string ready for display
+     * @brief Progressive rendering options for native_ls().
+     * * When `emit` is set and analysis is still running after `first_paint`, a
+     * preliminary grid (names and sizes, rows/cols pending) is written through
+     * `emit` and redrawn in place once analysis finishes.
+     * * If no entry completes for `entry_timeout`, the remaining entries are shown
+     * as pending and native_ls() returns. Their analysis keeps running in the
+     * background and lands in the StatsCache, so the next listing is complete.
      */
-    inline std::string native_ls(
-        const LSArgs& args,
-        const std::filesystem::path& cwd,
+    struct LSProgressive {
+        std::function<void(std::string_view)> emit;     ///< Writes straight to the terminal (empty = disabled)
+        std::chrono::milliseconds first_paint{80};      ///< Grace period before the preliminary grid
+        std::chrono::milliseconds entry_timeout{2000};  ///< Max wait without any entry completing
+    };
+
+    /**
+     * @brief Working directory of a listing: the path for messages and prefixes, an fd for lookups.
+     * * With an open fd, relative targets are opened and stat'ed with openat()/fstatat()
+     *   on it, so the cwd path is not resolved again (and a rename mid-listing is harmless).
+     * * Converts from a plain path (fd = AT_FDCWD): lookups then use the joined path string.
+     */
+    struct LSCwd {
+        std::filesystem::path path;
+        int fd = AT_FDCWD;
+
+        LSCwd(const std::filesystem::path& p, int dirfd = AT_FDCWD) : path(p), fd(dirfd >= 0 ? dirfd : AT_FDCWD) {}
+
+        /// @brief A target as (dirfd, name) for the *at() calls, plus its full path for display.
+        struct Target {
+            int dirfd;
+            std::string lookup;
+            std::filesystem::path full;
+        };
+
+        Target resolve(const std::string& target) const {
+            if (!target.empty() && std::filesystem::path(target).is_absolute()) return {AT_FDCWD, target, target};
+            std::filesystem::path full = target.empty() ? path : path / target;
+            if (fd == AT_FDCWD) return {AT_FDCWD, full.string(), full};
+            return {fd, target.empty() ? "." : target, full};
+        }
+
+        /**
+         * @brief Where the fd's directory is now (it may have been renamed since `path` was read).
+         * For path-based walks; falls back to `path`.
+         */
+        std::filesystem::path current_path() const {
+            if (fd == AT_FDCWD) return path;
+#if defined(__linux__)
+            char buf[PATH_MAX];
+            const std::string link = "/proc/self/fd/" + std::to_string(fd);
+            ssize_t len = ::readlink(link.c_str(), buf, sizeof(buf));
+            if (len > 0 && buf[0] == '/') return std::string(buf, static_cast<size_t>(len));
+#elif defined(__APPLE__)
+            char buf[MAXPATHLEN];
+            if (::fcntl(fd, F_GETPATH, buf) == 0) return std::string(buf);
+#endif
+            return path;
+        }
+
+        /// @brief Parent directory of a resolved (non-directory) target, for DirReader(dirfd, name).
+        static std::string parent_lookup(const Target& t) {
+            std::string parent = std::filesystem::path(t.lookup).parent_path().string();
+            return parent.empty() ? "." : parent;
+        }
+    };
+
+    /**
+     * @brief One grid cell. Views into storage owned by the caller.
+     */
+    struct LSCell {
+        std::string_view name;
+        const dais::utils::FileStats* stats = nullptr;
+        std::string_view display;
+        size_t visible_len = 0;
+    };
+
+    /// @brief Appends one data placeholder of an entry.
+    inline void append_ls_field(std::string& buf, CompiledTemplate::Field field, std::string_view name,
+                                const dais::utils::FileStats& stats, const utils::GitAnnotation& git = {}) {
+        using Field = CompiledTemplate::Field;
+        switch (field) {
+            case Field::Name:  buf += name; break;
+            case Field::Size:  append_size(buf, stats.size_bytes); break;
+            case Field::Rows:  append_rows(buf, stats.rows, stats.is_estimated); break;
+            case Field::Cols:  append_uint(buf, stats.max_cols); break;
+            case Field::Count: append_count(buf, stats.item_count, stats.count_capped); break;
+            case Field::Git:   append_git_mark(buf, git.mark); break;
+            case Field::GitBranch: append_git_branch(buf, git.branch); break;
+        }
+    }
+
+    /** 
+     * @brief Renders one entry with the compiled template matching its type.
+     * @param out Output buffer (appended to).
+     * @param formats Templates; must be compiled (LSFormats::ensure_compiled()).
+     * @param pending True while analysis is outstanding: rows/cols/count show a placeholder.
+     * @param size_known False if not even the stat() has completed yet.
+     * @param git Git annotation of the entry (known before analysis, never a placeholder).
+     */
+    inline void append_ls_entry(
+        std::string& out,
         const LSFormats& formats,
-        const LSSortConfig& sort_cfg,
-        utils::ThreadPool& pool
+        std::string_view name,
+        const dais::utils::FileStats& stats,
+        bool pending = false,
+        bool size_known = true,
+        const utils::GitAnnotation& git = {}
     ) {
-        // GridItem structure for collecting file data
-        struct GridItem {
-            std::string name;
-            dais::utils::FileStats stats;
-            std::string display_string;
-            size_t visible_len = 0;
-        };
-        
-        std::vector<std::future<GridItem>> futures;
-        std::vector<GridItem> grid_items;
-        
-        // Process each target path
-        for (const auto& target : args.paths) {
-            std::filesystem::path dir_path = target.empty() ? cwd : cwd / target;
-            
-            // Handle if target is an absolute path
-            if (!target.empty() && std::filesystem::path(target).is_absolute()) {
-                dir_path = target;
-            }
-            
-            try {
-                // Check if path exists
-                if (!std::filesystem::exists(dir_path)) {
-                    // Return error message for non-existent path
-                    return Theme::ERROR + "ls: cannot access '" + target + "': No such file or directory" + Theme::RESET + "\r\n";
-                }
-                
-                // If it's a file, just analyze that file
-                if (!std::filesystem::is_directory(dir_path)) {
-                    futures.push_back(pool.enqueue([dir_path]() -> GridItem {
-                        auto stats = dais::utils::analyze_path(dir_path.string());
-                        return {dir_path.filename().string(), stats, "", 0};
-                    }));
-                    continue;
-                }
-                
-                // Iterate directory
-                for (const auto& entry : std::filesystem::directory_iterator(dir_path)) {
-                    std::string name = entry.path().filename().string();
-                    
-                    // Filter hidden files (starting with .) unless -a flag
-                    if (!args.show_hidden && !name.empty() && name[0] == '.') {
-                        continue;
-                    }
-                    
-                    // Skip . and .. explicitly
-                    if (name == "." || name == "..") {
-                        continue;
-                    }
-                    
-                    // Enqueue parallel file analysis
-                    std::filesystem::path full_path = entry.path();
-                    futures.push_back(pool.enqueue([name, full_path]() -> GridItem {
-                        auto stats = dais::utils::analyze_path(full_path.string());
-                        return {name, stats, "", 0};
-                    }));
-                }
-            } catch (const std::filesystem::filesystem_error& e) {
-                return Theme::ERROR + "ls: " + e.what() + Theme::RESET + "\r\n";
-            }
+        const CompiledTemplate* tmpl;
+        if (stats.is_dir) {
+            tmpl = &formats.compiled.directory;
+        } else if (stats.is_text) {
+            tmpl = &formats.compiled.text_file;
+        } else if (stats.is_data) {
+            tmpl = &formats.compiled.data_file;
+        } else {
+            tmpl = &formats.compiled.binary_file;
         }
-        
-        // Collect results from futures
-        for (auto& f : futures) {
-            try {
-                grid_items.push_back(f.get());
-            } catch (...) {
-                // Ignore failed analysis
+
+        using Field = CompiledTemplate::Field;
+        tmpl->render(out, [&](std::string& buf, Field field) {
+            bool placeholder = (field == Field::Size) ? !size_known
+                             : (pending && (field == Field::Rows || field == Field::Cols || field == Field::Count));
+            if (placeholder) {
+                buf += Theme::ESTIMATE;
+                buf += "...";
+                return;
             }
+            append_ls_field(buf, field, name, stats, git);
+        });
+    }
+
+    /**
+     * @brief Renders one `ls -R` entry: directories use tree_directory (subtree totals),
+     * files render as in a normal listing.
+     */
+    inline void append_tree_entry(
+        std::string& out,
+        const LSFormats& formats,
+        std::string_view name,
+        const dais::utils::FileStats& stats,
+        const utils::GitAnnotation& git = {}
+    ) {
+        if (!stats.is_dir) {
+            append_ls_entry(out, formats, name, stats, false, true, git);
+            return;
         }
-        
-        if (grid_items.empty()) {
-            return ""; // Empty directory
+        formats.compiled.tree_directory.render(out, [&](std::string& buf, CompiledTemplate::Field field) {
+            append_ls_field(buf, field, name, stats, git);
+        });
+    }
+
+    /**
+     * @brief Appends the `ls -R` footer: totals over all cells, plus a note when a limit was hit.
+     * @param truncated True if the walk stopped early somewhere (totals are lower bounds).
+     */
+    inline void append_tree_summary(std::string& out, const std::vector<LSCell>& cells, bool truncated) {
+        uintmax_t size = 0;
+        size_t rows = 0, files = 0;
+        bool estimated = false;
+        for (const auto& cell : cells) {
+            size += cell.stats->size_bytes;
+            rows += cell.stats->rows;
+            files += cell.stats->is_dir ? cell.stats->item_count : 1;
+            estimated |= cell.stats->is_estimated;
+            truncated |= cell.stats->count_capped;
         }
-        
-        // --- SORTING ---
-        // Apply user-configured sorting (same logic as handle_ls)
-        auto get_type_priority = [](const GridItem& item) -> int {
-            if (item.stats.is_dir) return 0;
-            if (item.stats.is_text || item.stats.is_data) return 1;
-            return 2; // binary
-        };
-        
-        std::sort(grid_items.begin(), grid_items.end(), 
-            [&](const GridItem& a, const GridItem& b) {
-                // dirs_first takes priority
-                if (sort_cfg.dirs_first) {
-                    if (a.stats.is_dir != b.stats.is_dir) {
-                        return a.stats.is_dir > b.stats.is_dir;
-                    }
-                }
-                
-                int cmp = 0;
-                if (sort_cfg.by == "name") {
-                    cmp = a.name.compare(b.name);
-                } else if (sort_cfg.by == "size") {
-                    cmp = (a.stats.size_bytes < b.stats.size_bytes) ? -1 : (a.stats.size_bytes > b.stats.size_bytes ? 1 : 0);
-                } else if (sort_cfg.by == "type") {
-                    cmp = get_type_priority(a) - get_type_priority(b);
-                    if (cmp == 0) cmp = a.name.compare(b.name);
-                } else if (sort_cfg.by == "rows") {
-                    cmp = (a.stats.rows < b.stats.rows) ? -1 : (a.stats.rows > b.stats.rows ? 1 : 0);
-                }
-                
-                return (sort_cfg.order == "desc") ? (cmp > 0) : (cmp < 0);
-            }
-        );
-        
-        // --- FORMAT EACH ITEM ---
-        for (auto& item : grid_items) {
-            std::unordered_map<std::string, std::string> vars;
-            vars["name"] = item.name;
-            vars["size"] = fmt_size(item.stats.size_bytes);
-            vars["rows"] = fmt_rows(item.stats.rows, item.stats.is_estimated);
-            vars["cols"] = std::to_string(item.stats.max_cols);
-            vars["count"] = std::to_string(item.stats.item_count);
-            
-            std::string tmpl;
-            if (item.stats.is_dir) {
-                tmpl = formats.directory;
-            } else if (item.stats.is_text) {
-                tmpl = formats.text_file;
-            } else if (item.stats.is_data) {
-                tmpl = formats.data_file;
-            } else {
-                tmpl = formats.binary_file;
-            }
-            
-            item.display_string = apply_template(tmpl, vars);
-            item.visible_len = get_visible_length(item.display_string);
+        out += Theme::STRUCTURE + "[" + Theme::NOTICE + "-" + Theme::STRUCTURE + "]" + Theme::RESET + " Total: ";
+        append_size(out, size);
+        out += Theme::STRUCTURE + ", ";
+        append_rows(out, rows, estimated);
+        out += " " + Theme::UNIT + "R" + Theme::STRUCTURE + ", " + Theme::VALUE;
+        append_uint(out, files);
+        out += " " + Theme::UNIT + "files" + Theme::RESET;
+        if (truncated) out += Theme::WARNING + " (walk limit reached, totals are partial)" + Theme::RESET;
+        out += "\r\n";
+    }
+
+    /**
+     * @brief Sorts a listing by the user-configured criterion and renders its cells.
+     * The criterion is parsed once; see ls_listing.hpp for the sort keys.
+     * @param stats_of `const FileStats*(uint32_t index)`; entries without stats are left out.
+     * @param render `void(std::string& out, uint32_t index)`: appends the entry's display string.
+     * @param pool Optional: large listings are sorted and rendered on it.
+     * @return Cells in display order; they point into `core` and the stats of `stats_of`.
+     */
+    template <class StatsOf, class Render>
+    std::vector<LSCell> sort_ls_listing(utils::ListingCore& core, const LSSortConfig& sort_cfg, StatsOf&& stats_of,
+                                        Render&& render, utils::ThreadPool* pool = nullptr) {
+        {
+            utils::PerfTimer sort_timer(utils::PerfStage::LS_SORT);
+            core.sort(utils::LSOrder::parse(sort_cfg.by, sort_cfg.order, sort_cfg.dirs_first), stats_of, pool);
         }
-        
-        // --- GRID LAYOUT ---
-        int term_width = get_terminal_width();
+        core.render([&](std::string& out, uint32_t index) {
+            const size_t start = out.size();
+            render(out, index);
+            return get_visible_length(std::string_view(out).substr(start));
+        }, pool);
+
+        std::vector<LSCell> cells;
+        cells.reserve(core.sorted_size());
+        for (size_t pos = 0; pos < core.sorted_size(); ++pos) {
+            const uint32_t index = core.index_at(pos);
+            cells.push_back({core.name(index), stats_of(index), core.display(pos), core.visible_len(pos)});
+        }
+        return cells;
+    }
+
+    /**
+     * @brief Lays out sorted cells as a bordered grid that fits the terminal width.
+     * @param cells Sorted cells.
+     * @param padding Requested padding (clamped so the widest cell still fits).
+     * @param flow "h" (row-major) or "v" (column-major).
+     * @param term_width Terminal width in columns (see get_terminal_width()).
+     * @param rows_out Optional: number of terminal lines produced.
+     * @return Grid string, one "\r\n"-terminated line per row.
+     */
+    inline std::string layout_ls_grid(
+        const std::vector<LSCell>& cells,
+        int padding,
+        const std::string& flow,
+        int term_width,
+        size_t* rows_out = nullptr
+    ) {
         size_t max_len = 0;
-        for (const auto& item : grid_items) {
-            max_len = std::max(max_len, item.visible_len);
+        for (const auto& cell : cells) {
+            max_len = std::max(max_len, cell.visible_len);
         }
         
         /**
@@ -517,41 +800,48 @@ namespace dais::core::handlers {
         }
 
         // 2. Clamp padding to valid range [1, max_possible]
-        int effective_padding = std::max(1, args.padding);
+        int effective_padding = std::max(1, padding);
         effective_padding = std::min(effective_padding, static_cast<int>(max_possible_padding));
 
         size_t col_width = max_len + effective_padding;     ///< Content width + user-defined padding
         size_t cell_width = col_width + 3;             ///< Total cell width incl. prefix "| " and suffix "|"
         size_t num_cols = std::max(1ul, (safe_term_width - 4) / cell_width);
         
-        std::string output;
-        
         // Calculate number of rows needed
-        size_t total_items = grid_items.size();
+        size_t total_items = cells.size();
         size_t num_rows = (total_items + num_cols - 1) / num_cols;  // Ceiling division
+        if (rows_out) *rows_out = num_rows;
+
+        // One allocation for the whole grid: content + padding + borders per cell
+        std::string output;
+        size_t estimate = num_rows * (Theme::STRUCTURE.size() + Theme::RESET.size() + 4);
+        for (const auto& cell : cells) {
+            estimate += cell.display.size() + col_width + Theme::STRUCTURE.size() + Theme::RESET.size() + 2;
+        }
+        output.reserve(estimate);
         
         // Helper lambda to render a single cell
-        auto render_cell = [&](size_t item_idx) -> std::string {
-            std::string cell;
-            if (item_idx < grid_items.size()) {
-                const auto& item = grid_items[item_idx];
-                cell += item.display_string;
+        auto render_cell = [&](size_t item_idx) {
+            if (item_idx < cells.size()) {
+                const auto& item = cells[item_idx];
+                output += item.display;
                 size_t pad = (item.visible_len < col_width) ? (col_width - item.visible_len) : 1;
-                cell += std::string(pad, ' ');
+                output.append(pad, ' ');
             } else {
                 // Empty cell for incomplete last row
-                cell += std::string(col_width, ' ');
+                output.append(col_width, ' ');
             }
-            return cell;
         };
         
         // Build output row by row
         for (size_t row = 0; row < num_rows; ++row) {
-            output += Theme::STRUCTURE + "| " + Theme::RESET;
+            output += Theme::STRUCTURE;
+            output += "| ";
+            output += Theme::RESET;
             
             for (size_t col = 0; col < num_cols; ++col) {
                 size_t item_idx;
-                if (sort_cfg.flow == "v") {
+                if (flow == "v") {
                     // Vertical flow: items go down columns first
                     item_idx = col * num_rows + row;
                 } else {
@@ -560,8 +850,10 @@ namespace dais::core::handlers {
                 }
                 
                 if (item_idx < total_items) {
-                    output += render_cell(item_idx);
-                    output += Theme::STRUCTURE + "|" + Theme::RESET;
+                    render_cell(item_idx);
+                    output += Theme::STRUCTURE;
+                    output += '|';
+                    output += Theme::RESET;
                     
                     // Add space between cells except at end of row
                     if (col < num_cols - 1 && (row * num_cols + col + 1) < total_items) {
@@ -574,166 +866,538 @@ namespace dais::core::handlers {
         
         return output;
     }
+    
+    /**
+     * @brief Git annotations for one listed directory, if the templates use them.
+     * @param dir Directory path as listed; made absolute and normalized for GitStatusCache.
+     * @return Empty listing (no annotations) if `git` is null or no template asks for them.
+     */
+    inline utils::GitListing list_git(utils::GitStatusCache* git, const LSFormats& formats, const std::string& dir,
+                                      const std::vector<utils::GitStatusCache::Query>& entries) {
+        const bool marks = git && formats.uses(CompiledTemplate::Field::Git);
+        const bool branches = git && formats.uses(CompiledTemplate::Field::GitBranch);
+        if (!marks && !branches) return {};
+        std::error_code ec;
+        std::string path = std::filesystem::absolute(dir, ec).lexically_normal().string();
+        if (path.size() > 1 && path.back() == '/') path.pop_back();
+        return git->list(path, entries, marks, branches);
+    }
 
     /**
-     * @brief Renders the remote LS JSON output into the standard grid format.
-     * Uses regex to parse the JSON (since it's a simple flat structure) to avoid JSON deps.
+     * @brief Lists directory contents using native std::filesystem APIs.
+     * 
+     * This replaces the shell-based ls interception with direct filesystem access.
+     * Benefits:
+     * - No shell compatibility issues (Fish aliases, Zsh colors)
+     * - Faster (no process spawn, no PTY I/O)
+     * - Robust filename handling (no text parsing)
+     * 
+     * @param args Parsed ls arguments (paths, flags)
+     * @param cwd Current working directory for relative targets (path, or path + open fd)
+     * @param formats Format templates for output styling
+     * @param sort_cfg Sorting configuration
+     * @param pool Thread pool for parallel file analysis
+     * @param cache Optional metadata cache; unchanged files skip content scanning (nullptr disables)
+     * @param analyze_opts Exact row counting options (the budget is copied)
+     * @param progressive Optional preliminary paint + per-entry timeout (see LSProgressive)
+     * @param git Git annotation cache for {git} / {git_branch} (nullptr disables them)
+     * @param cpu_pool Pool for sorting and rendering (nullptr = `pool`); keeps compute off the I/O lane
+     * @return Formatted grid string ready for display. After a preliminary paint it
+     *         starts with the cursor movement that redraws the grid in place.
      */
-    inline std::string render_remote_ls(
-        const std::string& json_output,
+    inline std::string native_ls(
+        const LSArgs& args,
+        const LSCwd& cwd,
         const LSFormats& formats,
         const LSSortConfig& sort_cfg,
-        int padding
+        utils::ThreadPool& pool,
+        dais::utils::StatsCache* cache = nullptr,
+        const dais::utils::AnalyzeOptions& analyze_opts = {},
+        const LSProgressive& progressive = {},
+        utils::GitStatusCache* git = nullptr,
+        utils::ThreadPool* cpu_pool = nullptr
     ) {
-        // GridItem structure 
+        // GridItem structure for collecting file data
+        // Items live in one contiguous vector, parallel to the names in ListingState::core;
+        // workers fill them in place.
         struct GridItem {
-            std::string name;
+            uint32_t dir_index = 0;             ///< Index into dirs (parent fd + path prefix)
+            unsigned char type = DT_UNKNOWN;    ///< dirent d_type
+            bool has_stat = false;              ///< `st` was prefetched by the enumeration (macOS)
+            struct stat st{};
+            dais::utils::FileStats preview;     ///< Type + size from stat(), published before analysis
             dais::utils::FileStats stats;
-            std::string display_string;
-            size_t visible_len = 0;
         };
-        std::vector<GridItem> grid_items;
 
-        // Simple Regex for: {"name":"foo","is_dir":true,"size":123,...}
-        // This is fragile but suffices for our strictly controlled agent output.
-        // Group 1: name, 2: is_dir, 3: size, 4: rows, 5: cols, 6: count, 7: text, 8: data, 9: est
-        std::regex re(R"(\"name\":\"(.*?)\",\"is_dir\":(true|false),\"size\":(\d+),\"rows\":(\d+),\"cols\":(\d+),\"count\":(\d+),\"is_text\":(true|false),\"is_data\":(true|false),\"is_estimated\":(true|false))");
-        
-        auto begin = std::sregex_iterator(json_output.begin(), json_output.end(), re);
-        auto end = std::sregex_iterator();
+        // Parent directory of a group of items. Entries are analyzed relative to the
+        // open fd; standalone file targets have no fd and use prefix + name instead.
+        struct ListedDir {
+            dais::utils::DirReader reader;
+            std::string prefix;
+        };
+
+        // Per-item progress, published with release stores. The caller only reads
+        // `preview` once STATED and `stats` once DONE.
+        enum : uint8_t { QUEUED = 0, STATED = 1, DONE = 2, FAILED = 3 };
 
-        for (std::sregex_iterator i = begin; i != end; ++i) {
-            std::smatch match = *i;
-            GridItem item;
-            item.name = match[1].str();
+        // Everything the workers touch. Shared ownership lets timed-out entries
+        // finish in the background after this call has returned.
+        struct ListingState {
+            std::vector<ListedDir> dirs;
+            utils::ListingCore core;                ///< Names (workers only read them) + sort/render
+            std::vector<GridItem> items;
+            std::unique_ptr<std::atomic<uint8_t>[]> progress;
+            LSFormats formats;
+            std::vector<utils::GitListing> git;     ///< Per dirs entry; empty = no annotations
+            std::optional<dais::utils::ScanBudget> budget;
+            dais::utils::AnalyzeOptions opts;
+            dais::utils::StatsCache* cache = nullptr;
+            std::atomic<bool> cancelled{false};
+            std::atomic<size_t> finished{0};
+            utils::PerfCounters::Clock::time_point dispatched; ///< When the chunks were queued (ls.queue)
+            bool notify = false;
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+
+        auto state = std::make_shared<ListingState>();
+        state->formats = formats;
+        state->formats.ensure_compiled(); // No-op when the caller already compiled them
+        state->opts = analyze_opts;
+        if (analyze_opts.budget) {
+            state->budget.emplace(*analyze_opts.budget);
+            state->opts.budget = &*state->budget;
+        }
+        state->cache = cache;
+        state->notify = static_cast<bool>(progressive.emit);
+
+        auto& dirs = state->dirs;
+        auto& core = state->core;
+        auto& grid_items = state->items;
+        
+        // --- 1. ENUMERATION (serial, cheap: getdents64/getattrlistbulk, names + types only) ---
+        utils::PerfTimer enumerate_timer(utils::PerfStage::LS_ENUMERATE);
+        for (const auto& target : args.paths) {
+            // Relative targets resolve from the cwd fd when there is one; absolute ones as given
+            const LSCwd::Target resolved = cwd.resolve(target);
+            const std::filesystem::path& dir_path = resolved.full;
             
-            // Unescape name (basic backslash handling)
-            // Note: In a full impl we'd handle \uXXXX, here we trust the agent to be mostly sane
-            // or just assume UTF8 pass-through.
+            struct stat target_st;
+            if (::fstatat(resolved.dirfd, resolved.lookup.c_str(), &target_st, 0) != 0) {
+                // Return error message for non-existent path
+                return Theme::ERROR + "ls: cannot access '" + target + "': No such file or directory" + Theme::RESET + "\r\n";
+            }
             
-            item.stats.is_dir = (match[2].str() == "true");
-            item.stats.size_bytes = std::stoull(match[3].str());
-            item.stats.rows = std::stoull(match[4].str());
-            item.stats.max_cols = std::stoull(match[5].str());
-            item.stats.item_count = std::stoull(match[6].str());
-            item.stats.is_text = (match[7].str() == "true");
-            item.stats.is_data = (match[8].str() == "true");
-            item.stats.is_estimated = (match[9].str() == "true");
+            // If it's a file, just analyze that file (relative to its parent's fd when it opens)
+            if (!S_ISDIR(target_st.st_mode)) {
+                dirs.push_back({dais::utils::DirReader(resolved.dirfd, LSCwd::parent_lookup(resolved).c_str()),
+                                dir_path.parent_path().string() + "/"});
+                core.add(dir_path.filename().string());
+                GridItem& item = grid_items.emplace_back();
+                item.has_stat = true;
+                item.st = target_st;
+                item.dir_index = static_cast<uint32_t>(dirs.size() - 1);
+                continue;
+            }
             
-            grid_items.push_back(item);
+            // Names go straight into the arena: no per-entry strings
+            ListedDir dir{dais::utils::DirReader(resolved.dirfd, resolved.lookup.c_str()), dir_path.string() + "/"};
+            const uint32_t dir_index = static_cast<uint32_t>(dirs.size());
+            const bool read = dir.reader.for_each(args.show_hidden, [&](const char* name, unsigned char type,
+                                                                        const struct stat* st) {
+                core.add(name);
+                GridItem& item = grid_items.emplace_back();
+                item.dir_index = dir_index;
+                item.type = type;
+                if (st) {
+                    item.has_stat = true;
+                    item.st = *st;
+                }
+            });
+            if (!read) {
+                return Theme::ERROR + "ls: cannot open directory '" + (target.empty() ? "." : target) + "': " +
+                       std::strerror(errno) + Theme::RESET + "\r\n";
+            }
+            dirs.push_back(std::move(dir));
+        }
+        
+        enumerate_timer.stop();
+        if (grid_items.empty()) {
+            return ""; // Empty directory
+        }
+
+        const size_t total = grid_items.size();
+        state->progress = std::make_unique<std::atomic<uint8_t>[]>(total);
+
+        // --- 1b. GIT ANNOTATIONS (before dispatch: workers render them; see git_status.hpp) ---
+        if (git && (state->formats.uses(CompiledTemplate::Field::Git) ||
+                    state->formats.uses(CompiledTemplate::Field::GitBranch))) {
+            utils::PerfTimer git_timer(utils::PerfStage::LS_GIT);
+            std::vector<std::vector<utils::GitStatusCache::Query>> queries(dirs.size());
+            for (uint32_t i = 0; i < total; ++i) {
+                const GridItem& item = grid_items[i];
+                const ListedDir& dir = dirs[item.dir_index];
+                bool is_dir = false; // Real directories only: git treats symlinks as files
+                if (item.type == DT_DIR) {
+                    is_dir = true;
+                } else if (item.has_stat) {
+                    is_dir = S_ISDIR(item.st.st_mode) && item.type != DT_LNK;
+                } else if (item.type == DT_UNKNOWN && dir.reader.is_open()) {
+                    struct stat st;
+                    is_dir = ::fstatat(dir.reader.fd(), core.c_name(i), &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                             S_ISDIR(st.st_mode);
+                }
+                queries[item.dir_index].push_back({core.name(i), is_dir});
+            }
+            state->git.reserve(dirs.size());
+            for (size_t d = 0; d < dirs.size(); ++d) {
+                state->git.push_back(list_git(git, state->formats, dirs[d].prefix, queries[d]));
+            }
         }
 
-        if (grid_items.empty()) return "";
+        // --- 2. ANALYSIS (parallel, fixed-size chunks in place) ---
+        // Each chunk is one task; no per-entry futures or captures.
+        // Captureless so queued chunks never reference this stack frame.
+        auto process_item = [](ListingState& s, size_t index) {
+            utils::PerfTimer analyze_timer(utils::PerfStage::LS_ANALYZE);
+            GridItem& item = s.items[index];
+            const ListedDir& dir = s.dirs[item.dir_index];
+            std::string standalone_path;
+            int dirfd = AT_FDCWD;
+            const char* lookup_name = s.core.c_name(static_cast<uint32_t>(index));
+            if (dir.reader.is_open()) {
+                dirfd = dir.reader.fd();
+            } else {
+                standalone_path = dir.prefix + lookup_name;
+                lookup_name = standalone_path.c_str();
+            }
+
+            // One fd-relative stat per entry (skipped when enumeration already provided it)
+            struct stat st;
+            bool stated = item.has_stat;
+            if (stated) st = item.st;
+            else stated = dais::utils::stat_at(dirfd, lookup_name, st) == 0;
 
-        // --- SORTING (Copy-Paste from native_ls, can be refactored) ---
-        auto get_type_priority = [](const GridItem& item) -> int {
-            if (item.stats.is_dir) return 0;
-            if (item.stats.is_text || item.stats.is_data) return 1;
-            return 2; // binary
+            if (stated) {
+                item.preview.is_valid = true;
+                item.preview.is_dir = S_ISDIR(st.st_mode);
+                if (S_ISREG(st.st_mode)) item.preview.size_bytes = static_cast<uintmax_t>(st.st_size);
+                s.progress[index].store(STATED, std::memory_order_release);
+
+                item.stats = s.cache ? s.cache->analyze_at(dirfd, lookup_name, st, s.opts)
+                                     : dais::utils::analyze_at(dirfd, lookup_name, st, s.opts);
+            } else {
+                item.stats = dais::utils::FileStats{}; // Broken symlink / vanished entry
+            }
         };
-        
-        std::sort(grid_items.begin(), grid_items.end(), 
-            [&](const GridItem& a, const GridItem& b) {
-                if (sort_cfg.dirs_first) {
-                    if (a.stats.is_dir != b.stats.is_dir) {
-                        return a.stats.is_dir > b.stats.is_dir;
-                    }
+
+        auto run_chunk = [process_item](ListingState& s, size_t lo, size_t hi) {
+            utils::PerfCounters::instance().record(utils::PerfStage::LS_QUEUE,
+                                                   utils::PerfCounters::Clock::now() - s.dispatched);
+            for (size_t i = lo; i < hi; ++i) {
+                if (s.cancelled.load(std::memory_order_relaxed)) break;
+                uint8_t result = DONE;
+                try {
+                    process_item(s, i);
+                } catch (...) {
+                    result = FAILED; // Ignore failed analysis
                 }
-                
-                int cmp = 0;
-                if (sort_cfg.by == "name") {
-                    cmp = a.name.compare(b.name);
-                } else if (sort_cfg.by == "size") {
-                    cmp = (a.stats.size_bytes < b.stats.size_bytes) ? -1 : (a.stats.size_bytes > b.stats.size_bytes ? 1 : 0);
-                } else if (sort_cfg.by == "type") {
-                    cmp = get_type_priority(a) - get_type_priority(b);
-                    if (cmp == 0) cmp = a.name.compare(b.name);
-                } else if (sort_cfg.by == "rows") {
-                    cmp = (a.stats.rows < b.stats.rows) ? -1 : (a.stats.rows > b.stats.rows ? 1 : 0);
+                s.progress[i].store(result, std::memory_order_release);
+                s.finished.fetch_add(1, std::memory_order_acq_rel);
+            }
+            if (s.notify) {
+                { std::lock_guard<std::mutex> lock(s.mutex); }
+                s.cv.notify_all();
+            }
+        };
+
+        // --- 3. SNAPSHOT (finished entries as-is, the rest from their preview) ---
+        // Progress is read once per entry, so sorting and rendering see the same state.
+        std::vector<uint8_t> seen(total);
+        std::vector<dais::utils::FileStats> pending_stats; // Sized on the first pending entry
+        size_t pending_count = 0;
+        auto snapshot = [&]() {
+            pending_count = 0;
+            for (size_t i = 0; i < total; ++i) {
+                const GridItem& item = grid_items[i];
+                seen[i] = state->progress[i].load(std::memory_order_acquire);
+                if (seen[i] == DONE || seen[i] == FAILED) continue;
+
+                if (pending_stats.empty()) pending_stats.resize(total);
+                dais::utils::FileStats& preview = pending_stats[i];
+                if (seen[i] == STATED) {
+                    preview = item.preview;
+                } else {
+                    preview = dais::utils::FileStats{};
+                    preview.is_dir = item.type == DT_DIR;
                 }
-                
-                return (sort_cfg.order == "desc") ? (cmp > 0) : (cmp < 0);
+                if (!preview.is_dir) {
+                    dais::utils::classify_extension(dais::utils::extension_of(core.name(static_cast<uint32_t>(i))), preview);
+                }
+                ++pending_count;
             }
-        );
-
-        // --- FORMAT ---
-        for (auto& item : grid_items) {
-            std::unordered_map<std::string, std::string> vars;
-            vars["name"] = item.name;
-            vars["size"] = fmt_size(item.stats.size_bytes);
-            vars["rows"] = fmt_rows(item.stats.rows, item.stats.is_estimated);
-            vars["cols"] = std::to_string(item.stats.max_cols);
-            vars["count"] = std::to_string(item.stats.item_count);
-            
-            std::string tmpl;
-            if (item.stats.is_dir) {
-                tmpl = formats.directory;
-            } else if (item.stats.is_text) {
-                tmpl = formats.text_file;
-            } else if (item.stats.is_data) {
-                tmpl = formats.data_file;
-            } else {
-                tmpl = formats.binary_file;
+            auto stats_of = [&](uint32_t i) -> const dais::utils::FileStats* {
+                if (seen[i] == FAILED) return nullptr;
+                return seen[i] == DONE ? &grid_items[i].stats : &pending_stats[i];
+            };
+            auto render = [&](std::string& out, uint32_t i) {
+                const utils::GitAnnotation note = state->git.empty() ? utils::GitAnnotation{}
+                                                                    : state->git[grid_items[i].dir_index].annotation(core.name(i));
+                if (seen[i] == DONE) append_ls_entry(out, state->formats, core.name(i), grid_items[i].stats, false, true, note);
+                else append_ls_entry(out, state->formats, core.name(i), pending_stats[i], true, seen[i] == STATED, note);
+            };
+            return sort_ls_listing(core, sort_cfg, stats_of, render, cpu_pool ? cpu_pool : &pool);
+        };
+
+        size_t painted_rows = 0;
+        state->dispatched = utils::PerfCounters::Clock::now();
+        if (!progressive.emit) {
+            // Chunks are sized so every worker gets several (for load balance)
+            // without drowning in tiny tasks.
+            const size_t grain = std::clamp<size_t>(total / (pool.size() * 4 + 1), 16, 512);
+            pool.parallel_for(0, total, grain, [&](size_t lo, size_t hi) { run_chunk(*state, lo, hi); });
+        } else {
+            // Smaller chunks: one slow entry should hold back as few others as possible
+            const size_t grain = std::clamp<size_t>(total / (pool.size() * 16 + 1), 1, 64);
+            for (size_t lo = 0; lo < total; lo += grain) {
+                size_t hi = std::min(total, lo + grain);
+                pool.submit([state, run_chunk, lo, hi]() { run_chunk(*state, lo, hi); });
             }
-            
-            item.display_string = apply_template(tmpl, vars);
-            item.visible_len = get_visible_length(item.display_string);
-        }
 
-        // --- LAYOUT ---
-        // (Simplified copy of native_ls layout logic)
-        int term_width = get_terminal_width();
-        size_t max_len = 0;
-        for (const auto& item : grid_items) max_len = std::max(max_len, item.visible_len);
-        
-        size_t safety_margin = 12;
-        size_t safe_term_width = (static_cast<size_t>(term_width) > safety_margin) ? static_cast<size_t>(term_width) : 80;
-        size_t max_possible_padding = 1;
-        if (safe_term_width > (max_len + safety_margin)) {
-            max_possible_padding = safe_term_width - max_len - safety_margin;
+            auto all_done = [&]() { return state->finished.load(std::memory_order_acquire) == total; };
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (!state->cv.wait_for(lock, progressive.first_paint, all_done)) {
+                // Still running: paint what we have, if it can be redrawn in place
+                // (a grid taller than the screen would have scrolled out of reach).
+                lock.unlock();
+                std::vector<LSCell> cells = snapshot();
+                size_t rows = 0;
+                std::string preliminary = layout_ls_grid(cells, args.padding, sort_cfg.flow, get_terminal_width(), &rows);
+                if (rows + 1 < static_cast<size_t>(get_terminal_height())) {
+                    progressive.emit(preliminary);
+                    painted_rows = rows;
+                }
+                lock.lock();
+
+                // Keep waiting while entries are still completing
+                size_t seen = state->finished.load(std::memory_order_acquire);
+                while (!all_done()) {
+                    bool progressed = state->cv.wait_for(lock, progressive.entry_timeout, [&]() {
+                        return state->finished.load(std::memory_order_acquire) != seen;
+                    });
+                    if (!progressed) break; // Stalled: leave the rest pending
+                    seen = state->finished.load(std::memory_order_acquire);
+                }
+            }
+            // Queued chunks that have not started yet become no-ops
+            state->cancelled.store(true, std::memory_order_relaxed);
         }
 
-        // Use user-configured padding
-        int effective_padding = padding; 
-        effective_padding = std::min(effective_padding, static_cast<int>(max_possible_padding));
-        
-        size_t col_width = max_len + effective_padding;
-        size_t cell_width = col_width + 3;
-        size_t num_cols = std::max(1ul, (safe_term_width - 4) / cell_width);
+        // --- 4. SORTING + GRID LAYOUT ---
+        std::vector<LSCell> cells = snapshot();
+        if (cells.empty()) {
+            return "";
+        }
         
         std::string output;
-        size_t total_items = grid_items.size();
-        size_t num_rows = (total_items + num_cols - 1) / num_cols;
+        if (painted_rows > 0) {
+            // Back to the first preliminary row and clear it (and everything below)
+            output += "\x1b[" + std::to_string(painted_rows) + "A\r\x1b[J";
+        }
+        {
+            utils::PerfTimer layout_timer(utils::PerfStage::LS_LAYOUT);
+            output += layout_ls_grid(cells, args.padding, sort_cfg.flow, get_terminal_width());
+        }
+        if (pending_count > 0) {
+            output += Theme::STRUCTURE + "[" + Theme::WARNING + "-" + Theme::STRUCTURE + "]" + Theme::RESET +
+                      " " + std::to_string(pending_count) + (pending_count == 1 ? " entry" : " entries") +
+                      " still pending (slow filesystem?)\r\n";
+        }
         
-        // Helper lambda to render a single cell
-        auto render_cell = [&](size_t item_idx) -> std::string {
-            std::string cell;
-            if (item_idx < grid_items.size()) {
-                const auto& item = grid_items[item_idx];
-                cell += item.display_string;
-                size_t pad = (item.visible_len < col_width) ? (col_width - item.visible_len) : 1;
-                cell += std::string(pad, ' ');
-            } else {
-                cell += std::string(col_width, ' ');
-            }
-            return cell;
+        return output;
+    }
+
+    /**
+     * @brief Recursive listing (`ls -R`): entries of each target, directories with subtree totals.
+     * * The walk runs on the thread pool (tree_scan.hpp) within the depth/entry limits,
+     * then the entries go through the normal sort + grid path and a total line is appended.
+     * @param limits max_depth / max_entries (the analysis fields are taken from the other params)
+     * @param git Git annotation cache for {git} / {git_branch} (nullptr disables them)
+     * @param cpu_pool Pool for sorting and rendering (nullptr = `pool`, which runs the walk)
+     */
+    inline std::string native_tree_ls(
+        const LSArgs& args,
+        const LSCwd& cwd,
+        const LSFormats& formats,
+        const LSSortConfig& sort_cfg,
+        utils::ThreadPool& pool,
+        dais::utils::StatsCache* cache,
+        const dais::utils::AnalyzeOptions& analyze_opts,
+        const dais::utils::TreeOptions& limits,
+        utils::GitStatusCache* git = nullptr,
+        utils::ThreadPool* cpu_pool = nullptr
+    ) {
+        dais::utils::TreeOptions opts = limits;
+        opts.show_hidden = args.show_hidden;
+        opts.analyze = analyze_opts;
+        opts.cache = cache;
+
+        // One walker per pool thread; the calling thread takes part as well
+        auto run_workers = [&pool](auto& worker) {
+            pool.parallel_for(0, pool.size() + 1, 1, [&worker](size_t, size_t) { worker(); });
         };
 
-        for (size_t row = 0; row < num_rows; ++row) {
-            output += Theme::STRUCTURE + "| " + Theme::RESET;
-            for (size_t col = 0; col < num_cols; ++col) {
-                size_t item_idx;
-                if (sort_cfg.flow == "v") item_idx = col * num_rows + row;
-                else item_idx = row * num_cols + col;
-                
-                if (item_idx < total_items) {
-                    output += render_cell(item_idx);
-                    output += Theme::STRUCTURE + "|" + Theme::RESET;
-                    if (col < num_cols - 1 && (row * num_cols + col + 1) < total_items) output += " ";
+        std::vector<dais::utils::TreeItem> items;
+        std::vector<std::pair<std::string, size_t>> groups; // Listed directory + first item, per target
+        bool truncated = false;
+        utils::PerfTimer walk_timer(utils::PerfStage::LS_ENUMERATE); // The walk includes the analysis here
+        for (const auto& target : args.paths) {
+            const LSCwd::Target resolved = cwd.resolve(target);
+            const std::filesystem::path& path = resolved.full;
+
+            struct stat st;
+            if (::fstatat(resolved.dirfd, resolved.lookup.c_str(), &st, 0) != 0) {
+                return Theme::ERROR + "ls: cannot access '" + target + "': No such file or directory" + Theme::RESET + "\r\n";
+            }
+            if (!S_ISDIR(st.st_mode)) {
+                groups.emplace_back(path.parent_path().string(), items.size());
+                dais::utils::DirReader parent(resolved.dirfd, LSCwd::parent_lookup(resolved).c_str());
+                const std::string name = path.filename().string();
+                const int dirfd = parent.is_open() ? parent.fd() : AT_FDCWD;
+                const std::string lookup = parent.is_open() ? name : path.string();
+                items.push_back({name, cache ? cache->analyze_at(dirfd, lookup.c_str(), st, analyze_opts)
+                                             : dais::utils::analyze_at(dirfd, lookup.c_str(), st, analyze_opts)});
+                continue;
+            }
+            // The walk is path-based (shared with the agent): start from where the cwd is now
+            std::string root = path.string();
+            if (resolved.dirfd != AT_FDCWD) root = (cwd.current_path() / target).lexically_normal().string();
+            dais::utils::TreeResult result = dais::utils::scan_tree(root, opts, run_workers);
+            truncated |= result.truncated;
+            groups.emplace_back(root, items.size());
+            for (auto& item : result.items) items.push_back(std::move(item));
+        }
+        walk_timer.stop();
+        if (items.empty()) return "";
+
+        // Subtree totals are already in; markers aggregate the same way (see git_status.hpp)
+        std::vector<utils::GitListing> listings;
+        std::vector<uint32_t> listing_of(items.size(), 0);
+        if (git) {
+            utils::PerfTimer git_timer(utils::PerfStage::LS_GIT);
+            for (size_t g = 0; g < groups.size(); ++g) {
+                const size_t end = g + 1 < groups.size() ? groups[g + 1].second : items.size();
+                std::vector<utils::GitStatusCache::Query> queries;
+                queries.reserve(end - groups[g].second);
+                for (size_t i = groups[g].second; i < end; ++i) {
+                    queries.push_back({items[i].name, items[i].stats.is_dir});
+                    listing_of[i] = static_cast<uint32_t>(g);
                 }
+                listings.push_back(list_git(git, formats, groups[g].first, queries));
             }
-            output += "\r\n";
         }
+
+        utils::ListingCore core;
+        core.reserve(items.size(), items.size() * 16);
+        for (const auto& item : items) core.add(item.name);
+        std::vector<LSCell> cells = sort_ls_listing(
+            core, sort_cfg, [&](uint32_t i) { return &items[i].stats; },
+            [&](std::string& out, uint32_t i) {
+                const utils::GitAnnotation note = listings.empty() ? utils::GitAnnotation{}
+                                                                   : listings[listing_of[i]].annotation(items[i].name);
+                append_tree_entry(out, formats, items[i].name, items[i].stats, note);
+            }, cpu_pool ? cpu_pool : &pool);
+
+        utils::PerfTimer layout_timer(utils::PerfStage::LS_LAYOUT);
+        std::string output = layout_ls_grid(cells, args.padding, sort_cfg.flow, get_terminal_width());
+        layout_timer.stop();
+        append_tree_summary(output, cells, truncated);
+        return output;
+    }
+
+    /**
+     * @brief Renders the remote LS output into the standard grid format.
+     * Decodes the compact wire format (agent_wire.hpp) when present; otherwise uses
+     * regex to parse the JSON (since it's a simple flat structure) to avoid JSON deps.
+     * @param tree Output of `agent --tree`: directories carry subtree totals, a total line is appended.
+     */
+    inline std::string render_remote_ls(
+        const std::string& json_output,
+        const LSFormats& formats,
+        const LSSortConfig& sort_cfg,
+        int padding,
+        bool tree = false
+    ) {
+        // Names go into one arena, stats into a parallel vector
+        utils::ListingCore core;
+        std::vector<dais::utils::FileStats> stats_list;
+
+        // Compact wire records (agent --wire=1): hand-written decoder, no regex
+        dais::utils::WireDecoder wire(json_output);
+        if (wire.valid()) {
+            core.reserve(json_output.size() / 32, json_output.size() / 2);
+            stats_list.reserve(json_output.size() / 32);
+            std::string_view encoded_name;
+            dais::utils::FileStats stats;
+            while (wire.next(encoded_name, stats)) {
+                core.add_with([&](std::string& arena) { dais::utils::wire_unescape(encoded_name, arena); });
+                stats_list.push_back(stats);
+            }
+        } else {
+            // JSON (older agents, Python tier). Simple Regex for: {"name":"foo","is_dir":true,"size":123,...}
+            // This is fragile but suffices for our strictly controlled agent output.
+            // Group 1: name, 2: is_dir, 3: size, 4: rows, 5: cols, 6: count, 7: text, 8: data, 9: est,
+            // 10: count_capped (optional, older agents omit it)
+            std::regex re(R"(\"name\":\"(.*?)\",\"is_dir\":(true|false),\"size\":(\d+),\"rows\":(\d+),\"cols\":(\d+),\"count\":(\d+),\"is_text\":(true|false),\"is_data\":(true|false),\"is_estimated\":(true|false)(?:,\"count_capped\":(true|false))?)");
+        
+            auto begin = std::sregex_iterator(json_output.begin(), json_output.end(), re);
+            auto end = std::sregex_iterator();
+
+            for (std::sregex_iterator i = begin; i != end; ++i) {
+                const std::smatch& match = *i;
+                // Name taken as-is (basic backslash handling)
+                // Note: In a full impl we'd handle \uXXXX, here we trust the agent to be mostly sane
+                // or just assume UTF8 pass-through.
+                core.add(std::string_view(json_output).substr(static_cast<size_t>(match.position(1)),
+                                                             static_cast<size_t>(match.length(1))));
+
+                dais::utils::FileStats& stats = stats_list.emplace_back();
+                stats.is_dir = (match[2].str() == "true");
+                stats.size_bytes = std::stoull(match[3].str());
+                stats.rows = std::stoull(match[4].str());
+                stats.max_cols = std::stoull(match[5].str());
+                stats.item_count = std::stoull(match[6].str());
+                stats.is_text = (match[7].str() == "true");
+                stats.is_data = (match[8].str() == "true");
+                stats.is_estimated = (match[9].str() == "true");
+                stats.count_capped = (match[10].str() == "true");
+            }
+        }
+
+        if (core.size() == 0) return "";
+
+        // --- SORT + FORMAT (shared with native_ls) ---
+        const LSFormats* compiled_formats = &formats;
+        LSFormats local_formats;
+        if (!formats.is_compiled()) {
+            local_formats = formats;
+            local_formats.ensure_compiled();
+            compiled_formats = &local_formats;
+        }
+        std::vector<LSCell> cells = sort_ls_listing(
+            core, sort_cfg, [&](uint32_t i) { return &stats_list[i]; },
+            [&](std::string& out, uint32_t i) {
+                if (tree) append_tree_entry(out, *compiled_formats, core.name(i), stats_list[i]);
+                else append_ls_entry(out, *compiled_formats, core.name(i), stats_list[i]);
+            });
+
+        // --- LAYOUT ---
+        std::string output;
+        {
+            utils::PerfTimer layout_timer(utils::PerfStage::LS_LAYOUT);
+            output = layout_ls_grid(cells, padding, sort_cfg.flow, get_terminal_width());
+        }
+        if (tree) append_tree_summary(output, cells, false);
         return output;
     }
 }
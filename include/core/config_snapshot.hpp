@@ -0,0 +1,207 @@
+/**
+ * @file config_snapshot.hpp
+ * @brief Binary snapshot of the evaluated config.py, so unchanged configs load without Python.
+ * * The snapshot is keyed by config.py's absolute path, device, inode, size and mtime.
+ *   Any edit (or replacing the file) changes the key and the next start evaluates
+ *   config.py again and rewrites the snapshot.
+ * * Values are written by a field visitor (Engine's visit_config), so the payload is
+ *   just the fields in declaration order: fixed 8-byte integers, length-prefixed
+ *   strings and string lists. A payload that does not decode to exactly its length
+ *   is rejected; bump FORMAT_VERSION when the visited fields change.
+ * * Native endianness: the file is local to one machine, like stats_cache.bin.
+ *
+ * Only config.py itself is tracked; values it computes from other files or the
+ * environment are frozen until config.py changes (see STARTUP in config.py).
+ */
+
+#pragma once
+
+#include "core/stats_cache.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <sys/stat.h>
+#include <type_traits>
+#include <vector>
+
+namespace dais::core::utils {
+
+    /// @brief Appends visited fields to a byte buffer.
+    class SnapshotWriter {
+    public:
+        void field(bool v) { buf_.push_back(v ? 1 : 0); }
+
+        template <class T> requires (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+        void field(T v) {
+            uint64_t raw = static_cast<uint64_t>(v);
+            buf_.append(reinterpret_cast<const char*>(&raw), sizeof(raw));
+        }
+
+        void field(const std::string& s) {
+            field(static_cast<uint64_t>(s.size()));
+            buf_.append(s);
+        }
+
+        void field(const std::vector<std::string>& list) {
+            field(static_cast<uint64_t>(list.size()));
+            for (const auto& s : list) field(s);
+        }
+
+        const std::string& data() const { return buf_; }
+
+    private:
+        std::string buf_;
+    };
+
+    /// @brief Reads fields back in the same order; any overrun marks the reader failed.
+    class SnapshotReader {
+    public:
+        explicit SnapshotReader(const std::string& data) : p_(data.data()), end_(data.data() + data.size()) {}
+
+        void field(bool& v) {
+            if (!take(1)) return;
+            v = p_[-1] != 0;
+        }
+
+        template <class T> requires (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+        void field(T& v) {
+            uint64_t raw = 0;
+            if (!take(sizeof(raw))) return;
+            std::memcpy(&raw, p_ - sizeof(raw), sizeof(raw));
+            v = static_cast<T>(raw);
+        }
+
+        void field(std::string& s) {
+            uint64_t len = 0;
+            field(len);
+            if (!ok_ || len > static_cast<uint64_t>(end_ - p_)) { ok_ = false; return; }
+            s.assign(p_, static_cast<size_t>(len));
+            p_ += len;
+        }
+
+        void field(std::vector<std::string>& list) {
+            uint64_t count = 0;
+            field(count);
+            if (!ok_ || count > static_cast<uint64_t>(end_ - p_) / sizeof(uint64_t)) { ok_ = false; return; }
+            list.assign(static_cast<size_t>(count), std::string());
+            for (auto& s : list) field(s);
+        }
+
+        /// @brief True if every field decoded and the payload was consumed exactly.
+        bool complete() const { return ok_ && p_ == end_; }
+
+    private:
+        bool take(size_t n) {
+            if (!ok_ || static_cast<size_t>(end_ - p_) < n) { ok_ = false; return false; }
+            p_ += n;
+            return true;
+        }
+
+        const char* p_;
+        const char* end_;
+        bool ok_ = true;
+    };
+
+    class ConfigSnapshot {
+    public:
+        /// @brief Identity of the config.py a snapshot was taken from.
+        struct Key {
+            std::string path;       ///< Absolute path of config.py
+            uint64_t dev = 0;
+            uint64_t ino = 0;
+            uint64_t size = 0;
+            int64_t mtime_ns = 0;
+
+            bool operator==(const Key&) const = default;
+        };
+
+        /// @brief Stats `config_py`. @return false if it does not exist.
+        static bool key_of(const std::filesystem::path& config_py, Key& key) {
+            std::error_code ec;
+            std::filesystem::path abs = std::filesystem::absolute(config_py, ec);
+            struct stat st;
+            if (ec || ::stat(abs.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+            key.path = abs.string();
+            key.dev = static_cast<uint64_t>(st.st_dev);
+            key.ino = static_cast<uint64_t>(st.st_ino);
+            key.size = static_cast<uint64_t>(st.st_size);
+            key.mtime_ns = dais::utils::stat_mtime_ns(st);
+            return true;
+        }
+
+        /// @brief Default on-disk location: ~/.dais/config_snapshot.bin (empty if HOME is unset).
+        static std::string default_path() {
+            const char* home = std::getenv("HOME");
+            if (!home || !*home) return "";
+            return std::string(home) + "/.dais/config_snapshot.bin";
+        }
+
+        /**
+         * @brief Reads the payload of `file` if it was taken from `key`.
+         * @return false if missing, from another format or config.py, or truncated.
+         */
+        static bool load(const std::string& file, const Key& key, std::string& payload) {
+            FILE* f = std::fopen(file.c_str(), "rb");
+            if (!f) return false;
+            std::string data;
+            char chunk[16384];
+            size_t n;
+            while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) data.append(chunk, n);
+            std::fclose(f);
+
+            if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) return false;
+            data.erase(0, sizeof(MAGIC));
+            SnapshotReader reader(data);
+            uint32_t version = 0;
+            Key stored;
+            std::string body;
+            reader.field(version);
+            visit_key(reader, stored);
+            reader.field(body);
+            if (!reader.complete() || version != FORMAT_VERSION || !(stored == key)) return false;
+            payload = std::move(body);
+            return true;
+        }
+
+        /// @brief Writes `payload` for `key` atomically (temp file + rename).
+        static bool save(const std::string& file, const Key& key, const std::string& payload) {
+            std::error_code ec;
+            std::filesystem::path target(file);
+            if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), ec);
+
+            SnapshotWriter writer;
+            writer.field(FORMAT_VERSION);
+            Key k = key;
+            visit_key(writer, k);
+            writer.field(payload);
+
+            std::string tmp = file + ".tmp";
+            FILE* f = std::fopen(tmp.c_str(), "wb");
+            if (!f) return false;
+            bool ok = std::fwrite(MAGIC, sizeof(MAGIC), 1, f) == 1 &&
+                      std::fwrite(writer.data().data(), 1, writer.data().size(), f) == writer.data().size();
+            ok = (std::fclose(f) == 0) && ok;
+            if (!ok || std::rename(tmp.c_str(), file.c_str()) != 0) {
+                std::remove(tmp.c_str());
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        static constexpr char MAGIC[8] = {'D', 'A', 'I', 'S', 'C', 'O', 'N', 'F'};
+        static constexpr uint32_t FORMAT_VERSION = 2;
+
+        template <class Io>
+        static void visit_key(Io& io, Key& k) {
+            io.field(k.path);
+            io.field(k.dev);
+            io.field(k.ino);
+            io.field(k.size);
+            io.field(k.mtime_ns);
+        }
+    };
+}
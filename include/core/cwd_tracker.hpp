@@ -0,0 +1,102 @@
+/**
+ * @file cwd_tracker.hpp
+ * @brief Holds an open directory fd for the child shell's working directory.
+ * * The shell's cwd can only change while it runs a command, so the tracker is
+ *   marked stale when a prompt comes back after an Enter that reached the shell
+ *   (not after DAIS-intercepted commands). Until then refresh() is free: no
+ *   /proc readlink or proc_pidinfo per `ls` / `:db`.
+ * * Listings resolve relative targets with openat()/fstatat() on fd(), so a
+ *   directory renamed mid-listing is still the one being listed.
+ *
+ * command_forwarded() is called from the input thread, prompt_returned() from the
+ * output thread; refresh(), fd() and path() belong to the input thread.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <fcntl.h>
+#include <filesystem>
+#include <string>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <libproc.h>
+#include <sys/proc_info.h>
+#endif
+
+namespace dais::core::utils {
+
+    class CwdTracker {
+    public:
+        CwdTracker() = default;
+        CwdTracker(const CwdTracker&) = delete;
+        CwdTracker& operator=(const CwdTracker&) = delete;
+        ~CwdTracker() {
+            if (fd_ >= 0) ::close(fd_);
+        }
+
+        /// @brief Enter was sent to the shell: the command may change directory.
+        void command_forwarded() { pending_.store(true, std::memory_order_relaxed); }
+
+        /// @brief A prompt was detected: if a command ran, the cwd must be re-read.
+        void prompt_returned() {
+            if (pending_.exchange(false, std::memory_order_relaxed)) stale_.store(true, std::memory_order_release);
+        }
+
+        /// @brief Forces the next refresh() to re-read the cwd.
+        void invalidate() { stale_.store(true, std::memory_order_release); }
+
+        /**
+         * @brief Re-reads the cwd of `pid` if stale (or never read).
+         * On failure the previous fd and path are kept.
+         * @return true if fd() refers to the shell's cwd.
+         */
+        bool refresh(pid_t pid) {
+            if (fd_ >= 0 && !stale_.load(std::memory_order_acquire)) return true;
+            if (pid <= 0) return fd_ >= 0;
+            stale_.store(false, std::memory_order_relaxed);
+
+            std::filesystem::path path;
+            int fd = -1;
+#if defined(__linux__)
+            // Opening the magic link gives the directory itself, even if its path changed
+            const std::string link = "/proc/" + std::to_string(pid) + "/cwd";
+            fd = ::open(link.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd >= 0) {
+                char buf[PATH_MAX];
+                ssize_t len = ::readlink(link.c_str(), buf, sizeof(buf));
+                if (len > 0) path.assign(std::string(buf, static_cast<size_t>(len)));
+            }
+#elif defined(__APPLE__)
+            struct proc_vnodepathinfo vpi;
+            if (proc_pidinfo(pid, PROC_PIDVNODEPATHINFO, 0, &vpi, sizeof(vpi)) > 0) {
+                path.assign(vpi.pvi_cdir.vip_path);
+                fd = ::open(vpi.pvi_cdir.vip_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            }
+#endif
+            if (fd < 0 || path.empty()) {
+                if (fd >= 0) ::close(fd);
+                return fd_ >= 0; // Permission denied or process gone; keep the last known cwd
+            }
+            if (fd_ >= 0) ::close(fd_);
+            fd_ = fd;
+            path_ = std::move(path);
+            ++refreshes_;
+            return true;
+        }
+
+        int fd() const { return fd_; }
+        const std::filesystem::path& path() const { return path_; }
+        size_t refreshes() const { return refreshes_; }
+
+    private:
+        int fd_ = -1;
+        std::filesystem::path path_;
+        std::atomic<bool> pending_{false};  ///< Enter reached the shell since the last prompt
+        std::atomic<bool> stale_{true};     ///< Re-read on the next refresh()
+        size_t refreshes_ = 0;
+    };
+}
@@ -0,0 +1,302 @@
+/**
+ * @file db_result_sink.hpp
+ * @brief Streaming receiver for `:db` query results.
+ * * db_handler.py hands row batches to the engine through the embedded `dais`
+ *   module (db_begin / db_rows) instead of serializing the whole result to JSON.
+ *   Cells are stored column by column: one byte arena per column and a vector of
+ *   end offsets, so a batch costs two allocations per column, not one per cell.
+ * * Results that fit the inline view stay in memory. Larger ones are spilled chunk
+ *   by chunk to an anonymous temp file while column widths are tracked, then
+ *   rendered to the pager file (or the --output target) in a second streaming
+ *   pass. Memory stays bounded by one batch regardless of the row count.
+ *
+ * Layout matches _format_table() in db_handler.py (used over SSH):
+ *   header | header
+ *   -------+-------
+ *   cell   | cell
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace dais::core::utils {
+
+    class DbResultSink {
+    public:
+        /// @brief What finish() produced.
+        enum class Outcome { PRINT, PAGE, SAVED, FAILED };
+
+        struct Rendered {
+            Outcome kind = Outcome::FAILED;
+            std::string data; ///< PRINT: table text ("\n" lines); PAGE / SAVED: file path; FAILED: message
+        };
+
+        DbResultSink() = default;
+        DbResultSink(const DbResultSink&) = delete;
+        DbResultSink& operator=(const DbResultSink&) = delete;
+        ~DbResultSink() { reset(); }
+
+        /**
+         * @brief Starts a new result.
+         * @param row_limit Stop accepting rows after this many (0 = unlimited).
+         * @param inline_rows Results with at most this many rows are printed inline.
+         * @param output_path Render to this file instead of printing / paging (empty = none).
+         */
+        void begin(std::vector<std::string> headers, size_t row_limit, size_t inline_rows, std::string output_path) {
+            reset();
+            headers_ = std::move(headers);
+            row_limit_ = row_limit;
+            inline_rows_ = inline_rows;
+            output_path_ = std::move(output_path);
+            widths_.resize(headers_.size());
+            for (size_t c = 0; c < headers_.size(); ++c) widths_[c] = display_width(headers_[c]);
+            chunks_.emplace_back();
+            open_chunk(chunks_.back());
+            active_ = true;
+        }
+
+        /// @brief True between begin() and finish() / reset().
+        bool active() const { return active_; }
+
+        /// @brief Appends a cell to the current row; cells beyond the header count are ignored.
+        void add_cell(const char* data, size_t len) {
+            if (col_ >= headers_.size()) return;
+            Chunk& chunk = chunks_.back();
+            chunk.data[col_].append(data, len);
+            chunk.ends[col_].push_back(static_cast<uint32_t>(chunk.data[col_].size()));
+            size_t w = display_width(std::string_view(data, len));
+            if (w > widths_[col_]) widths_[col_] = w;
+            ++col_;
+        }
+
+        void add_null() { add_cell("NULL", 4); }
+
+        /// @brief Completes the current row. @return false once the row limit is reached.
+        bool end_row() {
+            while (col_ < headers_.size()) add_cell("", 0); // Short rows are padded
+            col_ = 0;
+            ++chunks_.back().rows;
+            ++total_rows_;
+            return row_limit_ == 0 || total_rows_ < row_limit_;
+        }
+
+        /// @brief Called after each batch: spills buffered rows once the result outgrows the inline view.
+        void end_batch() {
+            if (total_rows_ <= inline_rows_ && output_path_.empty()) return;
+            if (!spill_ && !spill_failed_) {
+                spill_ = std::tmpfile();
+                if (!spill_) spill_failed_ = true;
+            }
+            for (const Chunk& chunk : chunks_) {
+                if (!spill_failed_ && !write_chunk(chunk)) spill_failed_ = true;
+            }
+            chunks_.clear();
+            chunks_.emplace_back();
+            open_chunk(chunks_.back());
+        }
+
+        /**
+         * @brief Renders the result and resets the sink.
+         * @param temp_dir Directory for the pager file of large results.
+         */
+        Rendered finish(const std::string& temp_dir) {
+            Rendered r;
+            if (!active_) {
+                r.data = "No result in progress";
+                return r;
+            }
+            end_batch();
+            if (spill_failed_) {
+                r.data = "Could not buffer the result on disk: " + std::string(std::strerror(errno ? errno : EIO));
+                reset();
+                return r;
+            }
+
+            if (!spill_) {
+                // Inline: everything is still in memory
+                std::string text;
+                render([&](const std::string& line) {
+                    text += line;
+                    text += '\n';
+                    return true;
+                });
+                if (!text.empty()) text.pop_back(); // No trailing newline, like the Python formatter
+                r.kind = Outcome::PRINT;
+                r.data = std::move(text);
+                reset();
+                return r;
+            }
+
+            FILE* out = nullptr;
+            if (!output_path_.empty()) {
+                out = std::fopen(output_path_.c_str(), "w");
+                r.data = output_path_;
+            } else {
+                std::string tmpl = temp_dir + "/dais_db_XXXXXX.txt";
+                int fd = ::mkstemps(tmpl.data(), 4);
+                if (fd >= 0) out = ::fdopen(fd, "w");
+                r.data = tmpl;
+            }
+            if (!out) {
+                r.data = "Cannot write '" + r.data + "': " + std::strerror(errno);
+                reset();
+                return r;
+            }
+
+            std::string buffer;
+            bool ok = render([&](const std::string& line) {
+                buffer += line;
+                buffer += '\n';
+                if (buffer.size() < 64 * 1024) return true;
+                bool written = std::fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+                buffer.clear();
+                return written;
+            });
+            if (ok && !buffer.empty()) ok = std::fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+            if (std::fclose(out) != 0) ok = false;
+            if (!ok) {
+                r.data = "Failed writing '" + r.data + "'";
+                reset();
+                return r;
+            }
+            r.kind = output_path_.empty() ? Outcome::PAGE : Outcome::SAVED;
+            reset();
+            return r;
+        }
+
+        /// @brief Drops any partial result (query failed mid-stream).
+        void reset() {
+            if (spill_) std::fclose(spill_);
+            spill_ = nullptr;
+            spill_failed_ = false;
+            chunks_.clear();
+            headers_.clear();
+            widths_.clear();
+            output_path_.clear();
+            total_rows_ = 0;
+            col_ = 0;
+            active_ = false;
+        }
+
+    private:
+        /// @brief Rows of one batch, stored column-wise.
+        struct Chunk {
+            uint32_t rows = 0;
+            std::vector<std::string> data;            ///< Per column: concatenated cell bytes
+            std::vector<std::vector<uint32_t>> ends;  ///< Per column: end offset of each cell in data
+        };
+
+        /// @brief Characters as Python's len() counts them (UTF-8 code points).
+        static size_t display_width(std::string_view s) {
+            size_t n = 0;
+            for (char c : s) n += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+            return n;
+        }
+
+        void open_chunk(Chunk& chunk) const {
+            chunk.data.resize(headers_.size());
+            chunk.ends.resize(headers_.size());
+        }
+
+        // Spill format per chunk: rows, then per column the end offsets and the bytes
+        bool write_chunk(const Chunk& chunk) {
+            if (chunk.rows == 0) return true;
+            if (std::fwrite(&chunk.rows, sizeof(chunk.rows), 1, spill_) != 1) return false;
+            for (size_t c = 0; c < headers_.size(); ++c) {
+                if (std::fwrite(chunk.ends[c].data(), sizeof(uint32_t), chunk.rows, spill_) != chunk.rows) return false;
+                const std::string& bytes = chunk.data[c];
+                if (!bytes.empty() && std::fwrite(bytes.data(), 1, bytes.size(), spill_) != bytes.size()) return false;
+            }
+            return true;
+        }
+
+        bool read_chunk(Chunk& chunk) {
+            if (std::fread(&chunk.rows, sizeof(chunk.rows), 1, spill_) != 1) return false;
+            for (size_t c = 0; c < headers_.size(); ++c) {
+                chunk.ends[c].resize(chunk.rows);
+                if (std::fread(chunk.ends[c].data(), sizeof(uint32_t), chunk.rows, spill_) != chunk.rows) return false;
+                size_t len = chunk.rows ? chunk.ends[c].back() : 0;
+                chunk.data[c].resize(len);
+                if (len && std::fread(chunk.data[c].data(), 1, len, spill_) != len) return false;
+            }
+            return true;
+        }
+
+        void append_padded(std::string& line, std::string_view cell, size_t width) const {
+            line += cell;
+            size_t w = display_width(cell);
+            if (w < width) line.append(width - w, ' ');
+        }
+
+        /// @brief Emits the table line by line; emit returns false to abort.
+        template <class Emit>
+        bool render(Emit&& emit) {
+            std::string line;
+            for (size_t c = 0; c < headers_.size(); ++c) {
+                if (c) line += " | ";
+                append_padded(line, headers_[c], widths_[c]);
+            }
+            if (!emit(line)) return false;
+            line.clear();
+            for (size_t c = 0; c < headers_.size(); ++c) {
+                if (c) line += "-+-";
+                line.append(widths_[c], '-');
+            }
+            if (!emit(line)) return false;
+            if (total_rows_ == 0) {
+                line = "(0 rows returned)";
+                return emit(line);
+            }
+
+            auto emit_chunk = [&](const Chunk& chunk) {
+                for (uint32_t r = 0; r < chunk.rows; ++r) {
+                    line.clear();
+                    for (size_t c = 0; c < headers_.size(); ++c) {
+                        if (c) line += " | ";
+                        uint32_t start = r ? chunk.ends[c][r - 1] : 0;
+                        std::string_view cell(chunk.data[c].data() + start, chunk.ends[c][r] - start);
+                        append_padded(line, cell, widths_[c]);
+                    }
+                    if (!emit(line)) return false;
+                }
+                return true;
+            };
+
+            if (!spill_) {
+                for (const Chunk& chunk : chunks_) {
+                    if (!emit_chunk(chunk)) return false;
+                }
+                return true;
+            }
+            std::rewind(spill_);
+            Chunk chunk;
+            open_chunk(chunk);
+            for (size_t done = 0; done < total_rows_; done += chunk.rows) {
+                if (!read_chunk(chunk) || !emit_chunk(chunk)) return false;
+            }
+            return true;
+        }
+
+        std::vector<std::string> headers_;
+        std::vector<size_t> widths_;          ///< Per column: widest cell so far (header included)
+        std::vector<Chunk> chunks_;           ///< Rows not yet spilled (the current batch once spilling)
+        size_t row_limit_ = 0;
+        size_t inline_rows_ = 0;
+        size_t total_rows_ = 0;
+        size_t col_ = 0;                      ///< Next column of the row being added
+        std::string output_path_;
+        FILE* spill_ = nullptr;               ///< Anonymous temp file (tmpfile), gone on close
+        bool spill_failed_ = false;
+        bool active_ = false;
+    };
+}
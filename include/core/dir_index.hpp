@@ -0,0 +1,151 @@
+/**
+ * @file dir_index.hpp
+ * @brief Small LRU cache of directory listings with a case-insensitive prefix index.
+ * * Each listing holds the directory's entry names lowercased and sorted, so every
+ *   entry starting with a given prefix (in any case) forms one contiguous range,
+ *   found by binary search instead of a scan.
+ * * Listings are validated against the directory's (dev, inode, mtime): creating,
+ *   removing or renaming an entry bumps the mtime and forces a re-read, while
+ *   repeated lookups in an unchanged directory cost one stat().
+ *
+ * Used by Engine::resolve_partial_path, which probes many prefixes per directory
+ * while backtracking over split points. Not thread-safe (input thread only).
+ */
+
+#pragma once
+
+#include "core/dir_scan.hpp"
+#include "core/stats_cache.hpp"
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dais::core::utils {
+
+    class DirIndexCache {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 64;
+
+        struct Entry {
+            std::string lower;      ///< ASCII-lowercased name (sort key)
+            std::string name;       ///< Name as on disk
+            bool is_dir = false;    ///< Directory, or symlink to one
+        };
+
+        /// @brief One directory's entries, sorted by `lower`.
+        struct Listing {
+            uint64_t dev = 0;
+            uint64_t ino = 0;
+            int64_t mtime_ns = 0;
+            std::vector<Entry> entries;
+
+            /// @brief Entries whose name starts with `lower_prefix` (already lowercase).
+            std::pair<const Entry*, const Entry*> prefix_range(std::string_view lower_prefix) const {
+                auto first = std::lower_bound(entries.begin(), entries.end(), lower_prefix,
+                    [](const Entry& e, std::string_view p) { return std::string_view(e.lower) < p; });
+                auto last = first;
+                while (last != entries.end() && std::string_view(last->lower).starts_with(lower_prefix)) ++last;
+                return {entries.data() + (first - entries.begin()), entries.data() + (last - entries.begin())};
+            }
+        };
+
+        explicit DirIndexCache(size_t capacity = DEFAULT_CAPACITY) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+        static char lower(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c; }
+
+        static std::string to_lower(std::string_view s) {
+            std::string out(s);
+            for (char& c : out) c = lower(c);
+            return out;
+        }
+
+        /**
+         * @brief Returns the (possibly cached) listing of `path`.
+         * @return nullptr if `path` is not a readable directory.
+         */
+        std::shared_ptr<const Listing> get(const std::string& path) {
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return nullptr;
+            const int64_t mtime = dais::utils::stat_mtime_ns(st);
+
+            auto it = map_.find(path);
+            if (it != map_.end()) {
+                const Listing& cached = *it->second->second;
+                if (cached.dev == static_cast<uint64_t>(st.st_dev) && cached.ino == static_cast<uint64_t>(st.st_ino) &&
+                    cached.mtime_ns == mtime) {
+                    lru_.splice(lru_.begin(), lru_, it->second); // Most recently used
+                    ++hits_;
+                    return it->second->second;
+                }
+                lru_.erase(it->second);
+                map_.erase(it);
+            }
+
+            auto listing = read(path);
+            if (!listing) return nullptr;
+            listing->dev = static_cast<uint64_t>(st.st_dev);
+            listing->ino = static_cast<uint64_t>(st.st_ino);
+            listing->mtime_ns = mtime;
+            ++misses_;
+
+            lru_.emplace_front(path, listing);
+            map_[path] = lru_.begin();
+            if (lru_.size() > capacity_) {
+                map_.erase(lru_.back().first);
+                lru_.pop_back();
+            }
+            return listing;
+        }
+
+        void clear() {
+            lru_.clear();
+            map_.clear();
+        }
+
+        size_t size() const { return lru_.size(); }
+        size_t hits() const { return hits_; }
+        size_t misses() const { return misses_; }
+
+    private:
+        /// @brief Enumerates `path` (getdents64 / bulk attrs) into a sorted listing.
+        static std::shared_ptr<Listing> read(const std::string& path) {
+            dais::utils::DirReader reader(path);
+            if (!reader.is_open()) return nullptr;
+            std::vector<dais::utils::DirEntry> raw;
+            if (!reader.read_all(true, raw)) return nullptr;
+
+            auto listing = std::make_shared<Listing>();
+            listing->entries.reserve(raw.size());
+            for (auto& e : raw) {
+                bool is_dir = false;
+                if (e.has_stat) {
+                    is_dir = S_ISDIR(e.st.st_mode);
+                } else if (e.type == DT_DIR) {
+                    is_dir = true;
+                } else if (e.type == DT_LNK || e.type == DT_UNKNOWN) {
+                    // Follow symlinks like fs::is_directory
+                    struct stat st;
+                    is_dir = dais::utils::stat_at(reader.fd(), e.name.c_str(), st) == 0 && S_ISDIR(st.st_mode);
+                }
+                listing->entries.push_back({to_lower(e.name), std::move(e.name), is_dir});
+            }
+            std::sort(listing->entries.begin(), listing->entries.end(),
+                      [](const Entry& a, const Entry& b) { return a.lower < b.lower; });
+            return listing;
+        }
+
+        using Node = std::pair<std::string, std::shared_ptr<const Listing>>;
+
+        size_t capacity_;
+        std::list<Node> lru_;                                               ///< Front = most recent
+        std::unordered_map<std::string, std::list<Node>::iterator> map_;    ///< Path -> LRU node
+        size_t hits_ = 0;
+        size_t misses_ = 0;
+    };
+}
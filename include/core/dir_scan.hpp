@@ -0,0 +1,340 @@
+/**
+ * @file dir_scan.hpp
+ * @brief Low-syscall directory enumeration and fd-relative metadata lookups.
+ * * Linux: getdents64 on an open directory fd with d_type classification, and
+ *   statx()/fstatat() relative to that fd (no repeated path resolution).
+ * * macOS: getattrlistbulk() returns name, type, inode, size and timestamps for a
+ *   whole batch of entries, so most entries need no per-entry stat at all.
+ * * Elsewhere: POSIX readdir() + fstatat().
+ *
+ * Used by native_ls and the remote agent; analyze_at() in file_analyzer.hpp
+ * consumes the (dirfd, name) pairs produced here.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/sysmacros.h> // makedev
+#endif
+
+#if defined(__APPLE__)
+#include <sys/attr.h>
+#include <sys/vnode.h>
+#endif
+
+namespace dais::utils {
+
+    /// @brief One directory entry as returned by the enumeration fast path.
+    struct DirEntry {
+        std::string name;
+        unsigned char type = DT_UNKNOWN;  ///< dirent d_type (DT_REG, DT_DIR, DT_LNK, ...)
+        bool has_stat = false;            ///< True if `st` was filled by the enumeration (macOS bulk path)
+        struct stat st{};
+    };
+
+    namespace detail {
+#if defined(__linux__) && defined(SYS_getdents64)
+        // Kernel dirent layout for getdents64 (not exported by every libc)
+        struct LinuxDirent64 {
+            uint64_t d_ino;
+            int64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[];
+        };
+
+        constexpr size_t GETDENTS_BUFFER = 64 * 1024;
+
+        /**
+         * @brief Calls fn(name, d_type) for each entry of an open directory fd.
+         * Uses a single 64KB buffer per call; "." and ".." are skipped.
+         */
+        template <class F>
+        inline bool for_each_dirent(int dirfd, F&& fn) {
+            alignas(8) char buffer[GETDENTS_BUFFER];
+            while (true) {
+                long n = ::syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer));
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                if (n == 0) return true;
+                for (long off = 0; off < n;) {
+                    auto* d = reinterpret_cast<LinuxDirent64*>(buffer + off);
+                    off += d->d_reclen;
+                    const char* name = d->d_name;
+                    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+                    if (!fn(name, d->d_type)) return true;
+                }
+            }
+        }
+#else
+        /// @brief readdir() fallback; takes ownership of a dup of dirfd so the caller's fd stays valid.
+        template <class F>
+        inline bool for_each_dirent(int dirfd, F&& fn) {
+            int dup_fd = ::dup(dirfd);
+            if (dup_fd < 0) return false;
+            DIR* dir = ::fdopendir(dup_fd);
+            if (!dir) { ::close(dup_fd); return false; }
+            ::rewinddir(dir);
+            while (struct dirent* d = ::readdir(dir)) {
+                const char* name = d->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+                if (!fn(name, d->d_type)) break;
+            }
+            ::closedir(dir);
+            return true;
+        }
+#endif
+    }
+
+    /**
+     * @brief stat() relative to a directory fd, following symlinks (like fs::status).
+     * On Linux uses statx() with only the fields analysis needs, which lets network
+     * filesystems skip revalidating the rest; falls back to fstatat() if statx is
+     * unavailable (old kernels/libc, seccomp filters).
+     * @return 0 on success, -1 on error (errno set).
+     */
+    inline int stat_at(int dirfd, const char* name, struct stat& st) {
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+        static std::atomic<bool> statx_broken{false};
+        if (!statx_broken.load(std::memory_order_relaxed)) {
+            struct statx sx;
+            constexpr unsigned mask = STATX_TYPE | STATX_MODE | STATX_INO | STATX_SIZE |
+                                      STATX_MTIME | STATX_CTIME | STATX_NLINK;
+            if (::statx(dirfd, name, AT_STATX_SYNC_AS_STAT, mask, &sx) == 0) {
+                std::memset(&st, 0, sizeof(st));
+                st.st_mode = sx.stx_mode;
+                st.st_ino = sx.stx_ino;
+                st.st_dev = makedev(sx.stx_dev_major, sx.stx_dev_minor);
+                st.st_nlink = sx.stx_nlink;
+                st.st_size = static_cast<off_t>(sx.stx_size);
+                st.st_mtim.tv_sec = sx.stx_mtime.tv_sec;
+                st.st_mtim.tv_nsec = sx.stx_mtime.tv_nsec;
+                st.st_ctim.tv_sec = sx.stx_ctime.tv_sec;
+                st.st_ctim.tv_nsec = sx.stx_ctime.tv_nsec;
+                return 0;
+            }
+            if (errno != ENOSYS && errno != EPERM) return -1;
+            statx_broken.store(true, std::memory_order_relaxed);
+        }
+#endif
+        return ::fstatat(dirfd, name, &st, 0);
+    }
+
+    /// @brief Opens a directory for enumeration/fd-relative lookups (-1 on failure).
+    inline int open_dir_at(int dirfd, const char* name) {
+        return ::openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+
+    /**
+     * @brief Counts the entries of a directory (excluding "." and "..") without stat-ing them.
+     * @param cap Stop once more than `cap` entries were seen (0 = count everything).
+     * @param capped Set to true if counting stopped early (the result is then `cap`).
+     * @return Entry count, or 0 if the directory cannot be opened.
+     */
+    inline size_t count_dir_entries_at(int dirfd, const char* name, size_t cap = 0, bool* capped = nullptr) {
+        if (capped) *capped = false;
+        int fd = open_dir_at(dirfd, name);
+        if (fd < 0) return 0;
+        size_t count = 0;
+        detail::for_each_dirent(fd, [&](const char*, unsigned char) {
+            ++count;
+            return cap == 0 || count <= cap;
+        });
+        ::close(fd);
+        if (cap > 0 && count > cap) {
+            count = cap;
+            if (capped) *capped = true;
+        }
+        return count;
+    }
+
+    /**
+     * @brief RAII directory handle that enumerates entries and stays open for fd-relative analysis.
+     */
+    class DirReader {
+    public:
+        DirReader() = default;
+        explicit DirReader(const std::string& path) : fd_(open_dir_at(AT_FDCWD, path.c_str())) {}
+        /// @brief Opens `name` relative to an open directory fd (AT_FDCWD = relative to the process cwd).
+        DirReader(int dirfd, const char* name) : fd_(open_dir_at(dirfd, name)) {}
+        ~DirReader() { if (fd_ >= 0) ::close(fd_); }
+
+        DirReader(DirReader&& o) noexcept : fd_(o.fd_) { o.fd_ = -1; }
+        DirReader& operator=(DirReader&& o) noexcept {
+            if (this != &o) {
+                if (fd_ >= 0) ::close(fd_);
+                fd_ = o.fd_;
+                o.fd_ = -1;
+            }
+            return *this;
+        }
+        DirReader(const DirReader&) = delete;
+        DirReader& operator=(const DirReader&) = delete;
+
+        bool is_open() const { return fd_ >= 0; }
+        int fd() const { return fd_; }
+
+        /**
+         * @brief Calls fn(name, d_type, st) for all entries (except "." / ".." and, unless
+         * show_hidden, dotfiles). `st` is the stat prefilled by the enumeration (macOS bulk
+         * path) or nullptr; `name` and `st` are only valid during the call.
+         * @return false if the directory could not be read.
+         */
+        template <class F>
+        bool for_each(bool show_hidden, F&& fn) const {
+            if (fd_ < 0) return false;
+#if defined(__APPLE__)
+            switch (read_bulk_macos(show_hidden, fn)) {
+                case BulkResult::Done: return true;
+                case BulkResult::Failed: return false;
+                case BulkResult::Unsupported: break;
+            }
+#endif
+            return detail::for_each_dirent(fd_, [&](const char* name, unsigned char type) {
+                if (!show_hidden && name[0] == '.') return true;
+                fn(name, type, static_cast<const struct stat*>(nullptr));
+                return true;
+            });
+        }
+
+        /**
+         * @brief Appends all entries (except "." / ".." and, unless show_hidden, dotfiles).
+         * @return false if the directory could not be read.
+         */
+        bool read_all(bool show_hidden, std::vector<DirEntry>& out) const {
+            return for_each(show_hidden, [&](const char* name, unsigned char type, const struct stat* st) {
+                DirEntry e;
+                e.name = name;
+                e.type = type;
+                if (st) {
+                    e.has_stat = true;
+                    e.st = *st;
+                }
+                out.push_back(std::move(e));
+            });
+        }
+
+    private:
+#if defined(__APPLE__)
+        enum class BulkResult { Done, Failed, Unsupported };
+
+        /**
+         * @brief getattrlistbulk() enumeration: one syscall returns metadata for many entries.
+         * Regular files and directories get a prefilled stat; symlinks are left for
+         * stat_at() so they are followed like everywhere else.
+         * @return Unsupported if the first call fails (nothing was emitted; the readdir
+         *         path can start from scratch), Failed if a later one does.
+         */
+        template <class F>
+        BulkResult read_bulk_macos(bool show_hidden, F& fn) const {
+            struct attrlist al{};
+            al.bitmapcount = ATTR_BIT_MAP_COUNT;
+            al.commonattr = ATTR_CMN_RETURNED_ATTRS | ATTR_CMN_NAME | ATTR_CMN_DEVID |
+                            ATTR_CMN_OBJTYPE | ATTR_CMN_MODTIME | ATTR_CMN_CHGTIME |
+                            ATTR_CMN_ACCESSMASK | ATTR_CMN_FILEID;
+            al.fileattr = ATTR_FILE_DATALENGTH;
+
+            alignas(8) char buffer[64 * 1024];
+            bool emitted = false;
+            while (true) {
+                int n = ::getattrlistbulk(fd_, &al, buffer, sizeof(buffer), 0);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    if (emitted) return BulkResult::Failed;
+                    ::lseek(fd_, 0, SEEK_SET);
+                    return BulkResult::Unsupported;
+                }
+                if (n == 0) return BulkResult::Done;
+                emitted = true;
+
+                const char* entry = buffer;
+                for (int i = 0; i < n; ++i) {
+                    uint32_t length;
+                    std::memcpy(&length, entry, sizeof(length));
+                    const char* field = entry + sizeof(uint32_t);
+
+                    attribute_set_t returned;
+                    std::memcpy(&returned, field, sizeof(returned));
+                    field += sizeof(returned);
+
+                    // Fields appear in attribute-bit order, only if returned
+                    const char* name = "";
+                    if (returned.commonattr & ATTR_CMN_NAME) {
+                        attrreference_t ref;
+                        std::memcpy(&ref, field, sizeof(ref));
+                        name = field + ref.attr_dataoffset;
+                        field += sizeof(ref);
+                    }
+                    struct stat st{};
+                    unsigned char type = DT_UNKNOWN;
+                    bool has_stat = false;
+                    if (returned.commonattr & ATTR_CMN_DEVID) {
+                        dev_t dev; std::memcpy(&dev, field, sizeof(dev)); field += sizeof(dev);
+                        st.st_dev = dev;
+                    }
+                    fsobj_type_t obj = VNON;
+                    if (returned.commonattr & ATTR_CMN_OBJTYPE) {
+                        std::memcpy(&obj, field, sizeof(obj)); field += sizeof(obj);
+                    }
+                    if (returned.commonattr & ATTR_CMN_MODTIME) {
+                        std::memcpy(&st.st_mtimespec, field, sizeof(struct timespec));
+                        field += sizeof(struct timespec);
+                    }
+                    if (returned.commonattr & ATTR_CMN_CHGTIME) {
+                        std::memcpy(&st.st_ctimespec, field, sizeof(struct timespec));
+                        field += sizeof(struct timespec);
+                    }
+                    uint32_t access = 0;
+                    if (returned.commonattr & ATTR_CMN_ACCESSMASK) {
+                        std::memcpy(&access, field, sizeof(access)); field += sizeof(access);
+                    }
+                    if (returned.commonattr & ATTR_CMN_FILEID) {
+                        uint64_t ino; std::memcpy(&ino, field, sizeof(ino)); field += sizeof(ino);
+                        st.st_ino = static_cast<ino_t>(ino);
+                    }
+                    if (returned.fileattr & ATTR_FILE_DATALENGTH) {
+                        off_t len; std::memcpy(&len, field, sizeof(len)); field += sizeof(len);
+                        st.st_size = len;
+                    }
+
+                    entry += length;
+                    if (!show_hidden && name[0] == '.') continue;
+                    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+                    if (obj == VREG) {
+                        type = DT_REG;
+                        st.st_mode = S_IFREG | (access & 07777);
+                        has_stat = true;
+                    } else if (obj == VDIR) {
+                        type = DT_DIR;
+                        st.st_mode = S_IFDIR | (access & 07777);
+                        has_stat = true;
+                    } else {
+                        type = (obj == VLNK) ? DT_LNK : DT_UNKNOWN;
+                        st = {};
+                    }
+                    fn(name, type, has_stat ? &st : static_cast<const struct stat*>(nullptr));
+                }
+            }
+        }
+#endif
+
+        int fd_ = -1;
+    };
+}
@@ -2,6 +2,16 @@
 #include "core/session.hpp"
 #include "core/command_handlers.hpp"
 #include "core/thread_pool.hpp"
+#include "core/tail_buffer.hpp"
+#include "core/prompt_matcher.hpp"
+#include "core/reactor.hpp"
+#include "core/capture_sink.hpp"
+#include "core/perf.hpp"
+#include "core/history_store.hpp"
+#include "core/dir_index.hpp"
+#include "core/cwd_tracker.hpp"
+#include "core/hook_dispatcher.hpp"
+#include "core/config_snapshot.hpp"
 #include "core/dais_agents.hpp"
 #include <pybind11/embed.h>
 #include <condition_variable>
@@ -9,10 +19,10 @@
 #include <string_view>
 #include <string>
 #include <vector>
-#include <deque>
 #include <filesystem>
 #include <mutex>
 #include <chrono>
+#include <thread>
 
 namespace py = pybind11;
 
@@ -37,16 +47,17 @@ namespace dais::core {
         // =====================================================================
         // Configurable templates for 'ls' output formatting.
         // 
-        // Data placeholders: {name}, {size}, {rows}, {cols}, {count}
+        // Data placeholders: {name}, {size}, {rows}, {cols}, {count}, {git}, {git_branch}
         // Color placeholders: {RESET}, {STRUCTURE}, {UNIT}, {VALUE}, {ESTIMATE}, {TEXT}, {SYMLINK}
         // 
         // Note: {size} and {rows} include embedded coloring internally.
         
-        std::string ls_fmt_directory   = "{TEXT}{name}{STRUCTURE}/ ({VALUE}{count} {UNIT}items{STRUCTURE})";
-        std::string ls_fmt_text_file   = "{TEXT}{name} {STRUCTURE}({size}{STRUCTURE}, {rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
-        std::string ls_fmt_data_file   = "{TEXT}{name} {STRUCTURE}({size}{STRUCTURE}, {rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
-        std::string ls_fmt_binary_file = "{TEXT}{name} {STRUCTURE}({size}{STRUCTURE})";
+        std::string ls_fmt_directory   = "{TEXT}{name}{git}{STRUCTURE}/{git_branch} ({VALUE}{count} {UNIT}items{STRUCTURE})";
+        std::string ls_fmt_text_file   = "{TEXT}{name}{git} {STRUCTURE}({size}{STRUCTURE}, {rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
+        std::string ls_fmt_data_file   = "{TEXT}{name}{git} {STRUCTURE}({size}{STRUCTURE}, {rows} {UNIT}R{STRUCTURE}, {VALUE}{cols} {UNIT}C{STRUCTURE})";
+        std::string ls_fmt_binary_file = "{TEXT}{name}{git} {STRUCTURE}({size}{STRUCTURE})";
         std::string ls_fmt_error       = "{TEXT}{name}";
+        std::string ls_fmt_tree_directory = "{TEXT}{name}{git}{STRUCTURE}/{git_branch} ({VALUE}{size}{STRUCTURE}, {VALUE}{rows} {UNIT}R{STRUCTURE}, {VALUE}{count} {UNIT}files{STRUCTURE})";
         
         // =====================================================================
         // LS SORT OPTIONS
@@ -64,6 +75,88 @@ namespace dais::core {
         std::string ls_flow = "h";            ///< "h" (horizontal) or "v" (vertical)
         int ls_padding = 4;                   ///< Grid padding (spaces between columns)
 
+        // =====================================================================
+        // LS METADATA CACHE
+        // =====================================================================
+        // Unchanged files (same inode, mtime, ctime and size) reuse their
+        // previous analysis instead of being re-read. Loaded from LS_CACHE.
+        bool ls_cache = true;                 ///< Enable the in-memory FileStats cache
+        bool ls_cache_persist = true;         ///< Persist the cache to ~/.dais/stats_cache.bin
+        size_t ls_cache_max_entries = dais::utils::StatsCache::DEFAULT_MAX_ENTRIES;
+
+        // =====================================================================
+        // LS EXACT ROW COUNTS
+        // =====================================================================
+        // Count rows over whole files instead of extrapolating from 32KB.
+        // Per-listing budget; files beyond it keep the estimate.
+        // Loaded from LS_EXACT, toggled at runtime via :ls exact / :ls estimate.
+        bool ls_exact = false;                ///< Enable exact counting
+        uint64_t ls_exact_max_mb = 256;       ///< Bytes read in full per listing (MB, 0 = unlimited)
+        int ls_exact_max_ms = 500;            ///< Time allowance per listing (ms, 0 = unlimited)
+
+        // =====================================================================
+        // LS DIRECTORY ITEM COUNTS
+        // =====================================================================
+        // Counting stops past this many entries and shows e.g. "10k+".
+        // Loaded from LS_DIR_COUNT.
+        size_t ls_dir_count_cap = 10000;      ///< Max items counted per directory (0 = unlimited)
+
+        // =====================================================================
+        // LS PROGRESSIVE RENDERING
+        // =====================================================================
+        // Slow listings paint names + sizes first and fill in rows/cols in place.
+        // Entries still running after the timeout are shown as pending.
+        // Loaded from LS_PROGRESSIVE.
+        bool ls_progressive = true;           ///< Enable the preliminary paint
+        int ls_first_paint_ms = 80;           ///< Paint early if analysis takes longer than this
+        int ls_entry_timeout_ms = 2000;       ///< Stop waiting once no entry completes for this long
+
+        // =====================================================================
+        // LS RECURSIVE TOTALS (ls -R)
+        // =====================================================================
+        // Walk limits for subtree totals, locally and in the remote agent.
+        // Loaded from LS_TREE.
+        size_t ls_tree_max_depth = 32;        ///< Deepest directory level walked
+        size_t ls_tree_max_entries = 200000;  ///< Stop after this many entries (0 = unlimited)
+
+        // =====================================================================
+        // LS GIT ANNOTATIONS ({git}, {git_branch})
+        // =====================================================================
+        // Read from .git/index and HEAD directly (no git process). Loaded from LS_GIT.
+        bool ls_git = true;                   ///< Compute annotations for local listings
+        int ls_git_budget_ms = 50;            ///< Max time per listed directory; slower ones are skipped
+        size_t ls_git_max_index_entries = 100000; ///< Larger repositories get no markers (0 = unlimited)
+
+        // =====================================================================
+        // REMOTE AGENT
+        // =====================================================================
+        // Resident agent for SSH sessions (requests over a FIFO, no exec per ls).
+        // Loaded from REMOTE_AGENT.
+        bool remote_agent_resident = true;    ///< Start the agent in --serve mode after deploy
+        int remote_agent_idle_s = 1800;       ///< Resident agent idle exit (seconds)
+
+        // =====================================================================
+        // PERF COUNTERS
+        // =====================================================================
+        // Per-stage latency histograms shown by :perf. Loaded from PERF.
+        bool perf_enabled = true;             ///< Record samples (a few ns per stage)
+        std::string perf_dump_on_exit = "";   ///< Write the counters as JSON here on exit ("" = off)
+
+        // =====================================================================
+        // PLUGIN HOOKS
+        // =====================================================================
+        // Throttling and queueing of Python plugin hooks. Loaded from PLUGIN_HOOKS.
+        int hook_slow_ms = 250;               ///< A hook call slower than this throttles the plugin
+        int hook_cooldown_s = 10;             ///< Throttled plugins are skipped for this long
+        size_t hook_queue_limit = 1024;       ///< Pending events kept for the worker (oldest dropped)
+
+        // =====================================================================
+        // STARTUP
+        // =====================================================================
+        // Loaded from STARTUP (and saved in the config snapshot itself).
+        bool lazy_python = true;              ///< Start the shell before plugins / db_handler are imported
+        bool config_snapshot = true;          ///< Reuse ~/.dais/config_snapshot.bin while config.py is unchanged
+
         // =====================================================================
         // DB CONFIG
         // =====================================================================
@@ -100,13 +193,15 @@ namespace dais::core {
 
         /**
          * @brief Scans a directory for Python scripts and loads them as modules.
+         * Runs on the Python thread; returns at once if STARTUP["lazy_python"] is set.
          * @param path Absolute or relative path to the scripts folder.
          */
         void load_extensions(const std::string& path);
 
         /**
          * @brief Loads runtime configuration from a config.py file.
-         * @param path Absolute path to config.py.
+         * Uses the config snapshot when config.py is unchanged (no interpreter needed).
+         * @param path Directory containing config.py.
          */
         void load_configuration(const std::string& path);
         
@@ -116,11 +211,22 @@ namespace dais::core {
         }
 
     private:
+        // Benchmarks drive private stages (e.g. the output loop) directly (tests/bench)
+        friend struct EngineBench;
+
         PTYSession pty_;
         std::atomic<bool> running_;
+
+        // --- EVENT LOOP (main thread) ---
+        // Stdin readiness, SIGWINCH (self-pipe) and timers. The output thread wakes
+        // it when the shell exits so the session ends without waiting for a key.
+        utils::Reactor reactor_;
+        bool stdin_ready_ = false;             ///< Set by the stdin watch, consumed by process_user_input
+        bool resize_pending_ = false;          ///< A coalesced resize timer is armed
         std::atomic<bool> at_line_start_{true};
         Config config_;
         std::filesystem::path shell_cwd_ = std::filesystem::current_path();
+        utils::CwdTracker cwd_;                ///< Open fd of the shell's cwd (re-read after commands)
 
         // --- SHELL DETECTION (set once in constructor, read-only after) ---
         // These flags control shell-specific compatibility workarounds.
@@ -162,24 +268,56 @@ namespace dais::core {
 
         // --- PASS-THROUGH MODE STATE (only accessed from forward_shell_output thread) ---
         mutable std::mutex prompt_mutex_;      ///< Protects prompt_buffer_
-        std::string prompt_buffer_;            ///< Last ~1024 chars for prompt/command detection
+        utils::TailBuffer<1024> prompt_buffer_; ///< Current line tail for prompt/command detection
+        utils::PromptMatcher prompt_matcher_;   ///< SHELL_PROMPTS + pager markers, built at config load
         int pass_through_esc_state_ = 0;       ///< ANSI escape sequence state machine (0=normal)
         
-        // Singleton thread pool for parallel file analysis (used by ls handler)
+        // ls templates tokenized at config load (see CompiledTemplate)
+        handlers::LSFormats ls_formats_;
+
+        // Metadata cache shared by all native ls calls (thread-safe, sharded).
+        // Declared before the pools so it outlives entries still finishing in the background.
+        dais::utils::StatsCache stats_cache_;
+        std::string stats_cache_file_;         ///< Empty unless persistence is enabled
+
+        // CPU lane: one worker per core for compute-bound work (ls sorting and rendering)
+        utils::ThreadPool thread_pool_{};
+
+        // I/O lane for blocking filesystem calls (stat/open/read in the ls handler)
         // Uses more threads than CPU cores because file analysis is I/O-bound (threads wait for disk)
-        // Rule: max(hardware_concurrency * 4, 128) gives maximum parallelism for high-speed SSDs
-        utils::ThreadPool thread_pool_{std::max(std::thread::hardware_concurrency() * 4, 128u)};
+        // Rule: max(hardware_concurrency * 4, 32) keeps NFS/SSD queues busy without oversubscribing
+        utils::ThreadPool io_pool_{std::max(std::thread::hardware_concurrency() * 4, 32u)};
 
         // python state
-        py::scoped_interpreter guard{}; 
+        // The interpreter lives on python_thread_ (python_main) from the first use of
+        // Python until shutdown; every Python object below is released there too.
         std::vector<py::module_> loaded_plugins_;
+        utils::HookDispatcher hooks_;           ///< Resolved plugin hooks, queue served by python_thread_
+        std::thread python_thread_;
+        std::mutex python_mutex_;
+        std::condition_variable python_cv_;
+        bool python_loaded_ = false;            ///< Plugins + db_handler imported (guarded by python_mutex_)
+
+        void start_python();                    ///< Spawns python_thread_ (once)
+        void python_main();                     ///< Interpreter lifetime: serves hooks_ until stop_python()
+        void stop_python();                     ///< Delivers queued events, finalizes, joins
+
+        /// @brief Blocks until the plugins are imported (first :db in lazy mode). False without Python.
+        bool await_python();
+
+        bool python_requested_ = false;         ///< A task was posted: run() starts the thread
 
+        /// @brief Evaluates config.py into config_ / Theme / FileExtensions (Python thread).
+        bool evaluate_config();
 
+        /// @brief Imports every plugin in `path` and binds db_handler (Python thread).
+        void import_plugins(const std::string& path, bool quiet);
+        std::string config_dir_;                ///< Absolute config directory (on db_handler's sys.path)
 
-        void trigger_python_hook(const std::string& hook_name, const std::string& data);
 
         /** * @brief Queries the OS to get the actual CWD of the child shell process.
          * Essential for handling TAB completion where input buffer doesn't match path.
+         * Only asks the OS after a command has run in the shell (see CwdTracker).
          */
         void sync_child_cwd();
         
@@ -190,6 +328,8 @@ namespace dais::core {
             const std::string& partial, 
             const std::filesystem::path& cwd
         );
+        utils::DirIndexCache dir_index_;            ///< Listings probed by resolve_partial_path
+        utils::GitStatusCache git_status_;          ///< Parsed git indexes for {git} annotations
         
         // =====================================================================
         // SHELL STATE (Prompt-Based Detection)
@@ -208,26 +348,84 @@ namespace dais::core {
         // Arrow keys navigate DAIS history when shell is IDLE.
         // Shows original commands (e.g., 'ls' not 'ls -1').
         
-        std::deque<std::string> command_history_;   ///< In-memory buffer
-        std::filesystem::path history_file_;        ///< ~/.dais_history
-        size_t history_index_ = 0;                  ///< Current position in history
+        utils::HistoryStore history_;               ///< Deduplicated, indexed ~/.dais_history
+        size_t history_index_ = 0;                  ///< Current slot in history (end() = current line)
         std::string history_stash_;                 ///< Stashes current line when navigating
         bool history_navigated_ = false;            ///< True if arrow navigation was used
         bool tab_used_ = false;                      ///< True if Tab was used (accumulator unreliable)
         bool skipping_osc_ = false;                 ///< True if we are in the middle of skipping an OSC sequence
         std::atomic<bool> in_more_pager_{false};    ///< True when "--More--" is detected (for arrow key translation)
-        static constexpr size_t MAX_HISTORY = 1000; ///< Max stored commands (like bash)
+        static constexpr size_t MAX_HISTORY = utils::HistoryStore::DEFAULT_MAX_ENTRIES; ///< Max stored commands
+
+        /// @brief Ctrl-R reverse search state (local shell, at the prompt).
+        struct HistorySearch {
+            bool active = false;
+            bool failed = false;                    ///< Last keystroke found no (older) match
+            std::string query;
+            size_t match = utils::HistoryStore::npos; ///< Slot shown, npos = none yet
+            std::string original;                   ///< Line before Ctrl-R, restored on cancel
+        };
+        HistorySearch history_search_;
         
         void load_history();                        ///< Load from file on startup
         void save_history_entry(const std::string& cmd);  ///< Append to file
         void show_history(const std::string& args); ///< Handle :history command
         void navigate_history(int direction, std::string& current_line); ///< Arrow key nav
+
+        /// @brief Enters Ctrl-R search, taking the current line off the screen (and the shell).
+        void begin_history_search(std::string& current_line);
+        /**
+         * @brief Handles one key while Ctrl-R search is active.
+         * @return true if the key was consumed; false for Enter, which accepts the match
+         *         and should then run as a normal Enter.
+         */
+        bool handle_history_search_key(const char* buf, ssize_t n, ssize_t& i, std::string& current_line);
+        /// @brief Searches `query` from `before` (exclusive) and redraws the search line.
+        void update_history_search(size_t before);
+        /// @brief Leaves search mode showing `line` as a recalled (visual-only) command line.
+        void end_history_search(std::string& current_line, const std::string& line);
+
+        /// @brief Handles :perf (table), :perf reset and :perf json [file].
+        void show_perf(const std::string& args);
+        /// @brief Writes the counters as JSON to `path` ("~/" expanded). @return false on I/O error.
+        bool dump_perf(const std::string& path);
         
         /**
          * @brief Handles the execution of the :db command module.
          * Bridges C++ engine with Python db_handler.
          */
         void handle_db_command(const std::string& query);
+
+        /// @brief Reply of db_handler.handle_command, converted once from the Python dict.
+        struct DbReply {
+            std::string status;   ///< "success", "error" or "missing_pkg"
+            std::string action;   ///< "print", "page" or "stream" (success only)
+            std::string data;     ///< Text to print or file to page
+            std::string pager;    ///< Pager command for "page" ("" = default)
+            std::string message;  ///< Error text
+            std::string package;  ///< Missing package name
+            bool reused = false;   ///< Local only: served by a live pooled connection (no connect)
+        };
+
+        /// @brief Resolves db_handler.handle_command and json.loads once (needs the GIL).
+        bool bind_db_handler();
+
+        /**
+         * @brief Runs a local query through the cached handler; takes the GIL only for the call.
+         * Sets `reused` if it succeeded without the AdapterPool opening a connection.
+         */
+        DbReply run_local_db_query(const std::string& query);
+
+        /// @brief Decodes the JSON printed by the remote db_handler.py.
+        DbReply parse_remote_db_reply(const std::string& json_text);
+
+        /// @brief Copies a reply dict into a DbReply (needs the GIL).
+        static DbReply db_reply_from(const py::handle& obj);
+
+        // Cached Python callables (released by python_main before the interpreter)
+        py::object db_handle_command_;         ///< db_handler.handle_command (None until bound)
+        py::object json_loads_;                ///< json.loads, for remote replies
+        py::object db_pool_;                   ///< db_handler._POOL, for its connect count
         
         // =====================================================================
         // REMOTE SESSION STATE (SSH)
@@ -235,17 +433,27 @@ namespace dais::core {
         bool is_remote_session_ = false;       ///< True if foreground is ssh/scp
         bool remote_agent_deployed_ = false;   ///< True if we successfully injected the agent
         std::string remote_arch_ = "";         ///< Detected remote architecture (uname -m)
+        int remote_agent_wire_ = 0;            ///< Agent output format from --caps (0 = JSON)
+        std::string remote_agent_fifo_;        ///< Request FIFO of the resident agent ("" = none)
+        std::string remote_agent_pid_;         ///< PID of the resident agent (liveness check)
         std::chrono::steady_clock::time_point last_session_check_; /// Throttle remote checks
 
         void check_remote_session();           ///< Updates is_remote_session_ based on FG process
         void deploy_remote_agent();            ///< Injects binary if missing
+        void start_resident_agent(const std::string& agent_path); ///< Launches agent --serve
+
+        /**
+         * @brief Streams a large payload into the PTY, paced by master writability.
+         * @return false if the PTY stopped accepting data (timeout or error).
+         */
+        bool stream_to_pty(std::string_view payload);
 
         // =====================================================================
         // OUTPUT CAPTURING (For Remote Commands)
         // =====================================================================
         // Allows the main thread to capture PTY output temporarily.
         std::atomic<bool> capture_mode_ = false;
-        std::string capture_buffer_;
+        utils::CaptureSink capture_sink_;      ///< Parses captured output as it streams in
         std::mutex capture_mutex_;
         std::condition_variable capture_cv_;
         
@@ -254,6 +462,24 @@ namespace dais::core {
          * Blocks until the end sentinel is found or timeout.
          */
         std::string execute_remote_command(const std::string& cmd, int timeout_ms = 2000);
+
+        /**
+         * @brief Lists paths through the resident agent (one builtin printf, no exec).
+         * @param prefix Shell command run first in the same line (e.g. history injection).
+         * @return The agent payload, or "" if no resident agent answered.
+         */
+        std::string request_resident_agent(const std::string& prefix, const std::vector<std::string>& args,
+                                           int timeout_ms);
+
+        /// @brief Sentinel pair for a captured command: the text to match and its shell expression.
+        struct CaptureSentinel {
+            std::string text;   ///< "DAIS_END_<n>" as it appears in the output
+            std::string expr;   ///< "$(( a + b ))", so the command echo never matches
+        };
+        CaptureSentinel make_capture_sentinel() const;
+
+        /// @brief Sends one complete line to the shell and captures output up to the sentinel.
+        std::string capture_remote(const std::string& line, const std::string& sentinel, int timeout_ms);
         
         /**
          * @brief Handles the complex logic of intercepting and executing 'ls' on a remote host.
@@ -6,7 +6,15 @@
 #include <algorithm>
 #include <vector>
 #include <cstdint>
-#include <cstdio>  // fopen, fread, fclose
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cerrno>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "core/scan_kernels.hpp"
+#include "core/dir_scan.hpp"
 
 namespace dais::utils {
     namespace fs = std::filesystem;
@@ -21,6 +29,7 @@ namespace dais::utils {
         
         // --- Directory Specifics ---
         size_t item_count = 0;      ///< Number of items (files/dirs) immediately inside the directory
+        bool count_capped = false;  ///< Counting stopped at the cap: there are more than item_count items
 
         // --- File Specifics ---
         uintmax_t size_bytes = 0;   ///< File size on disk
@@ -59,101 +68,235 @@ namespace dais::utils {
     // Limit to prevent UI freezes when scanning large files.
     constexpr size_t MAX_SCAN_BYTES = 32 * 1024; // Scan max 32KB
 
+    // Read size for exact (full-file) scans. Large sequential reads keep the
+    // syscall count low while staying cache-friendly for the SIMD kernel.
+    constexpr size_t EXACT_CHUNK_BYTES = 1024 * 1024; // 1MB
+
     /**
-     * @brief Analyzes a path to extract metadata (size, row count, type).
-     * * Uses extension-based heuristics to determine if a file is text or data.
-     * Performs a partial scan to estimate row counts for large files to maintain performance.
-     * * @param filename Relative or absolute path to the target.
+     * @brief Shared byte/time allowance for exact row counting within one listing.
+     * * Workers reserve a file's size before scanning it in full; once the bytes
+     * run out or the deadline passes, remaining files fall back to the estimate.
+     * Thread-safe: one instance is shared by all workers of a listing.
+     */
+    class ScanBudget {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @param max_bytes Total bytes that may be read in full (0 = unlimited).
+         * @param max_time Wall-clock allowance starting now (0 = unlimited).
+         */
+        ScanBudget(uint64_t max_bytes, std::chrono::milliseconds max_time)
+            : bytes_left_(max_bytes ? max_bytes : UINT64_MAX),
+              deadline_(max_time.count() > 0 ? Clock::now() + max_time : Clock::time_point::max()) {}
+
+        /// @brief Snapshot copy, for analysis work that may outlive the caller's budget.
+        ScanBudget(const ScanBudget& other)
+            : bytes_left_(other.bytes_left_.load(std::memory_order_relaxed)), deadline_(other.deadline_) {}
+        ScanBudget& operator=(const ScanBudget&) = delete;
+
+        bool expired() const { return deadline_ != Clock::time_point::max() && Clock::now() >= deadline_; }
+
+        /// @brief True if a file of n bytes could currently be scanned in full.
+        bool affordable(uint64_t n) const {
+            return !expired() && bytes_left_.load(std::memory_order_relaxed) >= n;
+        }
+
+        /// @brief Atomically claims n bytes of the allowance.
+        bool try_reserve(uint64_t n) {
+            if (expired()) return false;
+            uint64_t cur = bytes_left_.load(std::memory_order_relaxed);
+            while (cur >= n) {
+                if (bytes_left_.compare_exchange_weak(cur, cur - n, std::memory_order_relaxed)) return true;
+            }
+            return false;
+        }
+
+    private:
+        std::atomic<uint64_t> bytes_left_;
+        Clock::time_point deadline_;
+    };
+
+    /**
+     * @brief Per-call analysis options.
+     * Default-constructed options reproduce the classic 32KB estimate.
+     */
+    struct AnalyzeOptions {
+        bool exact = false;            ///< Count rows over the whole file when the budget allows
+        ScanBudget* budget = nullptr;  ///< Shared allowance (nullptr = unlimited)
+        size_t dir_count_cap = 0;      ///< Stop counting directory items past this many (0 = unlimited)
+    };
+
+    /// @brief Applies a directory count cap to an (uncapped or more loosely capped) result.
+    inline void apply_count_cap(FileStats& stats, size_t cap) {
+        if (cap > 0 && stats.item_count > cap) {
+            stats.item_count = cap;
+            stats.count_capped = true;
+        }
+    }
+
+    /// @brief Converts a finished scan into FileStats rows/cols (shared by estimate and exact paths).
+    inline void apply_scan(const scan::LineScan& scan_state, bool ends_with_newline, FileStats& stats) {
+        stats.rows = scan_state.newlines;
+        // For data files, columns = delimiters + 1 once the header line is complete.
+        stats.max_cols = stats.is_data
+            ? scan_state.first_delims + (scan_state.first_done ? 1 : 0)
+            : scan_state.max_line;
+        // Handle last line if no trailing newline
+        if (!ends_with_newline) stats.rows++;
+    }
+
+    /**
+     * @brief Counts rows over the entire file with large sequential reads.
+     * * Uses posix_fadvise(SEQUENTIAL) so the kernel reads ahead aggressively.
+     * Plain reads are used instead of mmap so a file truncated mid-scan
+     * cannot raise SIGBUS. Gives up (returns false) if the budget deadline
+     * passes mid-file, in which case the caller falls back to the estimate.
+     * @param fd Open descriptor positioned at the start of the file (not closed here).
+     */
+    inline bool scan_whole_file(int fd, char delimiter, FileStats& stats, const ScanBudget* budget) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_RDAHEAD)
+        ::fcntl(fd, F_RDAHEAD, 1); // macOS equivalent
+#endif
+        // One reusable buffer per worker thread (avoids 1MB on the stack)
+        thread_local std::unique_ptr<char[]> buffer(new char[EXACT_CHUNK_BYTES]);
+
+        scan::LineScan scan_state;
+        scan_state.delimiter = delimiter;
+        scan_state.count_delims = stats.is_data;
+        scan_state.track_width = !stats.is_data;
+
+        uint64_t total = 0;
+        char last = '\n';
+        while (true) {
+            ssize_t n = ::read(fd, buffer.get(), EXACT_CHUNK_BYTES);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (n == 0) break;
+            scan::scan(buffer.get(), static_cast<size_t>(n), scan_state);
+            last = buffer[n - 1];
+            total += static_cast<uint64_t>(n);
+            if (budget && budget->expired()) return false;
+        }
+        if (total == 0) return false;
+
+        apply_scan(scan_state, last == '\n', stats);
+        stats.is_estimated = false;
+        return true;
+    }
+
+    /// @brief Extension of the last path component, with std::filesystem::path::extension() semantics.
+    inline std::string_view extension_of(std::string_view name) {
+        size_t slash = name.rfind('/');
+        if (slash != std::string_view::npos) name.remove_prefix(slash + 1);
+        if (name == "." || name == "..") return {};
+        size_t dot = name.rfind('.');
+        if (dot == std::string_view::npos || dot == 0) return {};
+        return name.substr(dot);
+    }
+
+    /// @brief Sets is_data / is_text from the configurable extension lists (no I/O).
+    inline void classify_extension(std::string_view ext, FileStats& stats) {
+        stats.is_data = std::find(FileExtensions::data.begin(),
+                                  FileExtensions::data.end(), ext) != FileExtensions::data.end();
+        stats.is_text = std::find(FileExtensions::text.begin(),
+                                  FileExtensions::text.end(), ext) != FileExtensions::text.end();
+    }
+
+    /**
+     * @brief Core analysis of an entry relative to an open directory fd.
+     * * All I/O goes through the fd (openat/getdents64), so the parent path is
+     * resolved once per listing instead of once per syscall per entry.
+     * Pass AT_FDCWD and a full path to analyze a standalone path.
+     * @param dirfd Directory fd the name is relative to (or AT_FDCWD).
+     * @param name Entry name (or path when dirfd is AT_FDCWD).
+     * @param st Result of stat_at() on the same entry.
+     * @param opts Exact-mode options (default: 32KB estimate).
      * @return FileStats Struct containing the analysis results.
      */
-    inline FileStats analyze_path(const std::string& filename) {
-        std::error_code ec;
-        fs::path p(filename);
+    inline FileStats analyze_at(int dirfd, const char* name, const struct stat& st, const AnalyzeOptions& opts = {}) {
         FileStats stats;
 
-        // Single Syscall for metadata
-        // fs::status() retrieves type and permissions in one go, avoiding multiple lookups.
-        fs::file_status status = fs::status(p, ec);
-
-        // 1. Validation check
-        if (ec || !fs::exists(status)) return stats; 
+        // 1. Validation check (caller already succeeded in stat-ing the path)
         stats.is_valid = true;
 
         // 2. Directory Analysis
-        if (fs::is_directory(status)) {
+        if (S_ISDIR(st.st_mode)) {
             stats.is_dir = true;
-            try {
-                // std::distance is linear time; acceptable for typical local dev directories.
-                // NOTE: For high-latency network drives, this may need async implementation.
-                auto it = fs::directory_iterator(p, fs::directory_options::skip_permission_denied, ec);
-                stats.item_count = std::distance(fs::begin(it), fs::end(it));
-            } catch (...) { stats.item_count = 0; }
+            const size_t cap = opts.dir_count_cap;
+
+            // Link-count shortcut: on filesystems with Unix link semantics (ext4, XFS,
+            // tmpfs, APFS) st_nlink is at least 2 + subdirectories, a lower bound on the
+            // item count. Btrfs and most network filesystems report 1 and never match.
+            if (cap > 0 && st.st_nlink > 2 && static_cast<uint64_t>(st.st_nlink) - 2 > cap) {
+                stats.item_count = cap;
+                stats.count_capped = true;
+                return stats;
+            }
+
+            // Counts raw dirents (no per-entry stat), stopping early past the cap.
+            stats.item_count = count_dir_entries_at(dirfd, name, cap, &stats.count_capped);
             return stats;
         }
 
         // 3. File Analysis
-        if (fs::is_regular_file(status)) {
-            stats.size_bytes = fs::file_size(p, ec);
+        if (S_ISREG(st.st_mode)) {
+            stats.size_bytes = static_cast<uintmax_t>(st.st_size);
             
-            std::string ext = p.extension().string();
+            std::string_view ext = extension_of(name);
 
-            // Detect Data Files using configurable extension list
-            stats.is_data = std::find(FileExtensions::data.begin(), 
-                                      FileExtensions::data.end(), ext) != FileExtensions::data.end();
-
-            // Detect Text Files using configurable extension list
-            stats.is_text = std::find(FileExtensions::text.begin(), 
-                                      FileExtensions::text.end(), ext) != FileExtensions::text.end();
+            // Detect Data/Text Files using the configurable extension lists
+            classify_extension(ext, stats);
 
             // Skip heavy I/O scanning if empty or binary
             if ((!stats.is_text && !stats.is_data) || stats.size_bytes == 0) return stats;
 
-            // 4. Content Scanning (Optimized Zero-Allocation)
-            // and string allocations for every line.
-            FILE* f = std::fopen(filename.c_str(), "rb");
-            if (!f) return stats;
+            char delimiter = (ext == ".tsv") ? '\t' : ',';
+
+            int fd = ::openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return stats;
 
+            // Exact mode: count the whole file if it fits the listing's budget
+            if (opts.exact && stats.size_bytes > MAX_SCAN_BYTES &&
+                (!opts.budget || opts.budget->try_reserve(stats.size_bytes))) {
+                if (scan_whole_file(fd, delimiter, stats, opts.budget)) {
+                    ::close(fd);
+                    return stats;
+                }
+                // Budget ran out mid-file: rewind and estimate from the first chunk
+                if (::lseek(fd, 0, SEEK_SET) != 0) {
+                    ::close(fd);
+                    return stats;
+                }
+            }
+
+            // 4. Content Scanning (Optimized Zero-Allocation)
             // Use stack buffer for speed (no heap allocation)
             char buffer[MAX_SCAN_BYTES];
-            size_t bytes_read = std::fread(buffer, 1, MAX_SCAN_BYTES, f);
-            std::fclose(f); 
+            size_t bytes_read = 0;
+            while (bytes_read < MAX_SCAN_BYTES) {
+                ssize_t n = ::read(fd, buffer + bytes_read, MAX_SCAN_BYTES - bytes_read);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                bytes_read += static_cast<size_t>(n);
+            }
+            ::close(fd);
 
             if (bytes_read == 0) return stats;
 
-            // --- Row & Column Counting Loop (Byte-level) ---
-            size_t current_line_len = 0;
-            bool first_line_scanned = false;
-            char delimiter = (ext == ".tsv") ? '\t' : ',';
-
-            for (size_t i = 0; i < bytes_read; ++i) {
-                char c = buffer[i];
-                if (c == '\n') {
-                    stats.rows++;                 
-                    // Logic for the very first line (CSV columns or Text width)
-                    if (!first_line_scanned) {
-                        // For data files, columns = delimiters + 1. We counted delimiters below, so add 1 now.
-                        if (stats.is_data) stats.max_cols++; 
-                        // For Text, simply take the length
-                        else if (current_line_len > stats.max_cols) stats.max_cols = current_line_len;
-
-                        first_line_scanned = true;
-                    } 
-                    // Logic for subsequent lines (Text width only)
-                    else if (!stats.is_data) {
-                        if (current_line_len > stats.max_cols) stats.max_cols = current_line_len;
-                    }
-                    current_line_len = 0;
-                } else {
-                    current_line_len++;
-                    // If first line of a data file, count delimiters
-                    if (!first_line_scanned && stats.is_data && c == delimiter) {
-                        stats.max_cols++;
-                    }
-                }
-            }
-
-            // Handle last line if no trailing newline
-            if (bytes_read > 0 && buffer[bytes_read - 1] != '\n') stats.rows++;
+            // --- Row & Column Counting (SIMD kernel, see scan_kernels.hpp) ---
+            // Text files track the longest newline-terminated line;
+            // data files count delimiters on the header line only.
+            scan::LineScan scan_state;
+            scan_state.delimiter = delimiter;
+            scan_state.count_delims = stats.is_data;
+            scan_state.track_width = !stats.is_data;
+            scan::scan(buffer, bytes_read, scan_state);
+            apply_scan(scan_state, buffer[bytes_read - 1] == '\n', stats);
 
             // 5. Estimation Logic
             // If we hit the read limit before EOF, extrapolate total rows based on average byte/row ratio.
@@ -165,4 +308,32 @@ namespace dais::utils {
         }
         return stats;
     }
-}
\ No newline at end of file
+
+    /**
+     * @brief Analyzes a path whose metadata has already been fetched.
+     * * Shares the scanning logic with analyze_path() but skips the stat() call,
+     * letting callers that already hold a `struct stat` (e.g. the StatsCache) avoid a second syscall.
+     * @param filename Relative or absolute path to the target.
+     * @param st Result of stat() on the same path.
+     * @param opts Exact-mode options (default: 32KB estimate).
+     * @return FileStats Struct containing the analysis results.
+     */
+    inline FileStats analyze_path(const std::string& filename, const struct stat& st, const AnalyzeOptions& opts = {}) {
+        return analyze_at(AT_FDCWD, filename.c_str(), st, opts);
+    }
+
+    /**
+     * @brief Analyzes a path to extract metadata (size, row count, type).
+     * * Uses extension-based heuristics to determine if a file is text or data.
+     * Performs a partial scan to estimate row counts for large files to maintain performance.
+     * * @param filename Relative or absolute path to the target.
+     * @param opts Exact-mode options (default: 32KB estimate).
+     * @return FileStats Struct containing the analysis results.
+     */
+    inline FileStats analyze_path(const std::string& filename, const AnalyzeOptions& opts = {}) {
+        // Single Syscall for metadata (follows symlinks, like fs::status)
+        struct stat st;
+        if (::stat(filename.c_str(), &st) != 0) return FileStats{};
+        return analyze_path(filename, st, opts);
+    }
+}
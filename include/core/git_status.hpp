@@ -0,0 +1,591 @@
+/**
+ * @file git_status.hpp
+ * @brief Git annotations for ls ({git}, {git_branch}) without running git.
+ * * The repository is found by walking up from the listed directory to a `.git`
+ *   directory (or a `.git` file pointing at one: worktrees, submodules).
+ * * `.git/index` is mmap'ed and parsed (versions 2-4) into a sorted entry list.
+ *   The parsed index is cached, keyed on the index file's (dev, inode, size,
+ *   mtime), so listings only re-parse it after a git command rewrote it.
+ * * Entries are compared against the work tree with one lstat() each, like the
+ *   first pass of `git status`: size, mtime, file type and exec bit. A file whose
+ *   stat changed but content did not (e.g. `touch`) shows as modified until a git
+ *   command refreshes the index. Staged-but-committed state (index vs HEAD) is
+ *   not compared.
+ * * Untracked entries are checked against .gitignore files from the work tree
+ *   root down to the listed directory, .git/info/exclude and the user's global
+ *   ignore file ($XDG_CONFIG_HOME/git/ignore).
+ * * Limits: repositories with more than max_index_entries index entries get no
+ *   markers, and a directory whose scan exceeds the time budget is skipped until
+ *   the index changes. Branches are still shown in both cases.
+ *
+ * Used from the input thread only (Engine's native ls); not thread-safe.
+ */
+
+#pragma once
+
+#include "core/stats_cache.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fnmatch.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace dais::core::utils {
+
+    /// @brief Status of one listing entry relative to its repository.
+    enum class GitMark : uint8_t {
+        None,       ///< Clean, or not inside a repository
+        Modified,   ///< Tracked and changed (for directories: something tracked below changed)
+        Untracked,  ///< Not in the index and not ignored
+        Ignored     ///< Not in the index and matched by an ignore rule
+    };
+
+    /// @brief What {git} and {git_branch} render for one entry.
+    struct GitAnnotation {
+        GitMark mark = GitMark::None;
+        std::string_view branch;    ///< Checked-out branch if the entry is itself a repository root
+    };
+
+    /// @brief Annotations for the entries of one listed directory.
+    class GitListing {
+    public:
+        /// @brief Annotation of the entry `name` (None / empty if nothing to show).
+        GitAnnotation annotation(std::string_view name) const {
+            auto it = std::lower_bound(entries_.begin(), entries_.end(), name,
+                [](const Entry& e, std::string_view n) { return std::string_view(e.name) < n; });
+            if (it == entries_.end() || it->name != name) return {};
+            return {it->mark, it->branch};
+        }
+
+        /// @brief True if the directory is inside a work tree.
+        bool in_repo() const { return in_repo_; }
+        /// @brief True if markers were computed (not over a limit).
+        bool has_marks() const { return has_marks_; }
+
+    private:
+        friend class GitStatusCache;
+
+        struct Entry {
+            std::string name;
+            GitMark mark = GitMark::None;
+            std::string branch;
+        };
+
+        Entry& at(std::string_view name) {
+            auto it = std::lower_bound(entries_.begin(), entries_.end(), name,
+                [](const Entry& e, std::string_view n) { return std::string_view(e.name) < n; });
+            if (it == entries_.end() || it->name != name) it = entries_.insert(it, Entry{std::string(name), GitMark::None, {}});
+            return *it;
+        }
+
+        std::vector<Entry> entries_;    ///< Sorted by name; only entries with something to show
+        bool in_repo_ = false;
+        bool has_marks_ = false;
+    };
+
+    namespace git_detail {
+
+        inline uint32_t be32(const unsigned char* p) {
+            return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+        inline uint16_t be16(const unsigned char* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+        /// @brief Reads a small file whole ("" if missing).
+        inline std::string read_small_file(const std::string& path, size_t max_bytes = 1 << 20) {
+            std::string data;
+            FILE* f = std::fopen(path.c_str(), "rb");
+            if (!f) return data;
+            char chunk[4096];
+            size_t n;
+            while (data.size() < max_bytes && (n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) data.append(chunk, n);
+            std::fclose(f);
+            return data;
+        }
+
+        /// @brief Stat identity used as cache key for index and ignore files.
+        struct FileKey {
+            uint64_t dev = 0, ino = 0, size = 0;
+            int64_t mtime_ns = 0;
+            bool exists = false;
+
+            bool operator==(const FileKey&) const = default;
+
+            static FileKey of(const std::string& path) {
+                FileKey key;
+                struct stat st;
+                if (::stat(path.c_str(), &st) != 0) return key;
+                key.exists = true;
+                key.dev = static_cast<uint64_t>(st.st_dev);
+                key.ino = static_cast<uint64_t>(st.st_ino);
+                key.size = static_cast<uint64_t>(st.st_size);
+                key.mtime_ns = dais::utils::stat_mtime_ns(st);
+                return key;
+            }
+        };
+
+        /// @brief One stage-0 (or conflicted) entry of .git/index.
+        struct IndexEntry {
+            uint32_t path_offset;   ///< Into Index::paths
+            uint32_t path_length;
+            uint32_t mtime_s;
+            uint32_t mtime_ns;
+            uint32_t size;          ///< Truncated to 32 bits, as git stores it
+            uint32_t mode;
+            bool conflicted;        ///< Unmerged (stage 1-3) or intent-to-add
+            bool skip_worktree;     ///< Sparse checkout: not expected in the work tree
+        };
+
+        /// @brief Parsed .git/index.
+        struct Index {
+            FileKey key;
+            bool too_large = false;
+            std::string paths;                          ///< All entry paths back to back
+            std::vector<IndexEntry> entries;            ///< Index order (sorted by path bytes)
+            std::unordered_set<std::string> slow_dirs;  ///< Directories that ran out of budget
+
+            std::string_view path(const IndexEntry& e) const { return {paths.data() + e.path_offset, e.path_length}; }
+
+            /// @brief First entry whose path is >= `prefix`.
+            size_t lower_bound(std::string_view prefix) const {
+                auto it = std::lower_bound(entries.begin(), entries.end(), prefix,
+                    [this](const IndexEntry& e, std::string_view p) { return path(e) < p; });
+                return static_cast<size_t>(it - entries.begin());
+            }
+        };
+
+        /**
+         * @brief Parses an index file image.
+         * @return false if it is not a supported index (the caller then shows no markers).
+         */
+        inline bool parse_index(const unsigned char* data, size_t size, size_t max_entries, Index& index) {
+            if (size < 12 || std::memcmp(data, "DIRC", 4) != 0) return false;
+            const uint32_t version = be32(data + 4);
+            if (version < 2 || version > 4) return false;
+            const uint32_t count = be32(data + 8);
+            if (max_entries > 0 && count > max_entries) {
+                index.too_large = true;
+                return true;
+            }
+
+            index.entries.reserve(count);
+            std::string previous; // Version 4 paths are prefix-compressed against the previous one
+            size_t off = 12;
+            for (uint32_t i = 0; i < count; ++i) {
+                if (off + 62 > size) return false;
+                const unsigned char* p = data + off;
+                IndexEntry e{};
+                e.mtime_s = be32(p + 8);
+                e.mtime_ns = be32(p + 12);
+                e.mode = be32(p + 24);
+                e.size = be32(p + 36);
+                const uint16_t flags = be16(p + 60);
+                e.conflicted = ((flags >> 12) & 3) != 0;
+
+                size_t pos = off + 62;
+                if (version >= 3 && (flags & 0x4000)) {
+                    if (pos + 2 > size) return false;
+                    const uint16_t extended = be16(data + pos);
+                    e.skip_worktree = (extended & 0x4000) != 0;
+                    e.conflicted |= (extended & 0x2000) != 0; // Intent-to-add: not committed yet
+                    pos += 2;
+                }
+
+                std::string_view suffix;
+                if (version == 4) {
+                    // Offset varint: bytes to strip from the end of the previous path
+                    size_t strip = 0;
+                    if (pos >= size) return false;
+                    unsigned char c = data[pos++];
+                    strip = c & 127;
+                    while (c & 128) {
+                        if (pos >= size) return false;
+                        c = data[pos++];
+                        strip = ((strip + 1) << 7) | (c & 127);
+                    }
+                    const void* nul = std::memchr(data + pos, 0, size - pos);
+                    if (!nul || strip > previous.size()) return false;
+                    suffix = {reinterpret_cast<const char*>(data + pos),
+                              static_cast<size_t>(static_cast<const unsigned char*>(nul) - (data + pos))};
+                    previous.resize(previous.size() - strip);
+                    previous.append(suffix);
+                    off = pos + suffix.size() + 1;
+                } else {
+                    const void* nul = std::memchr(data + pos, 0, size - pos);
+                    if (!nul) return false;
+                    const size_t length = static_cast<size_t>(static_cast<const unsigned char*>(nul) - (data + pos));
+                    previous.assign(reinterpret_cast<const char*>(data + pos), length);
+                    // Entries are NUL-padded to a multiple of 8 bytes
+                    off += ((pos - off) + length + 8) & ~size_t(7);
+                }
+
+                e.path_offset = static_cast<uint32_t>(index.paths.size());
+                e.path_length = static_cast<uint32_t>(previous.size());
+                index.paths += previous;
+                index.entries.push_back(e);
+            }
+            return true;
+        }
+
+        /// @brief One line of a .gitignore / exclude file.
+        struct IgnoreRule {
+            std::string pattern;
+            std::string base;       ///< Directory of the ignore file, relative to the work tree ("" or "a/b/")
+            bool negate = false;
+            bool dir_only = false;
+            bool has_slash = false; ///< Matched against the path below base, not just the basename
+
+            bool matches(std::string_view rel_path, std::string_view name, bool is_dir) const {
+                if (dir_only && !is_dir) return false;
+                if (!rel_path.starts_with(base)) return false;
+                if (!has_slash) return ::fnmatch(pattern.c_str(), std::string(name).c_str(), 0) == 0;
+                const std::string below(rel_path.substr(base.size()));
+                // fnmatch has no "**"; without FNM_PATHNAME '*' crosses '/', which covers it
+                const int flags = pattern.find("**") != std::string::npos ? 0 : FNM_PATHNAME;
+                return ::fnmatch(pattern.c_str(), below.c_str(), flags) == 0;
+            }
+        };
+
+        inline void parse_ignore(std::string_view text, const std::string& base, std::vector<IgnoreRule>& rules) {
+            size_t start = 0;
+            while (start < text.size()) {
+                size_t nl = text.find('\n', start);
+                if (nl == std::string_view::npos) nl = text.size();
+                std::string_view line = text.substr(start, nl - start);
+                start = nl + 1;
+
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                while (!line.empty() && line.back() == ' ' && !(line.size() >= 2 && line[line.size() - 2] == '\\')) {
+                    line.remove_suffix(1);
+                }
+                if (line.empty() || line[0] == '#') continue;
+
+                IgnoreRule rule;
+                rule.base = base;
+                if (line[0] == '!') {
+                    rule.negate = true;
+                    line.remove_prefix(1);
+                } else if (line[0] == '\\') {
+                    line.remove_prefix(1); // "\#" and "\!" are literal
+                }
+                if (!line.empty() && line.back() == '/') {
+                    rule.dir_only = true;
+                    line.remove_suffix(1);
+                }
+                if (line.empty()) continue;
+                rule.has_slash = line.find('/') != std::string_view::npos;
+                if (line[0] == '/') line.remove_prefix(1);
+                if (line.starts_with("**/") && line.find('/', 3) == std::string_view::npos) {
+                    // "**/foo" matches foo at any depth, like a plain "foo"
+                    line.remove_prefix(3);
+                    rule.has_slash = false;
+                }
+                rule.pattern.assign(line);
+                rules.push_back(std::move(rule));
+            }
+        }
+
+        /// @brief Branch (or abbreviated commit for a detached HEAD) from HEAD. "" if unreadable.
+        inline std::string read_head(const std::string& gitdir) {
+            std::string head = read_small_file(gitdir + "/HEAD", 4096);
+            while (!head.empty() && (head.back() == '\n' || head.back() == '\r' || head.back() == ' ')) head.pop_back();
+            if (head.starts_with("ref: ")) {
+                std::string_view ref = std::string_view(head).substr(5);
+                if (ref.starts_with("refs/heads/")) ref.remove_prefix(11);
+                return std::string(ref);
+            }
+            if (head.size() >= 7) return head.substr(0, 7);
+            return "";
+        }
+
+        /**
+         * @brief The git directory of the work tree rooted at `dir`, if it is one.
+         * Follows `.git` files ("gitdir: <path>") used by worktrees and submodules.
+         */
+        inline bool gitdir_of(const std::string& dir, std::string& gitdir) {
+            const std::string dot_git = dir + "/.git";
+            struct stat st;
+            if (::stat(dot_git.c_str(), &st) != 0) return false;
+            if (S_ISDIR(st.st_mode)) {
+                gitdir = dot_git;
+                return true;
+            }
+            if (!S_ISREG(st.st_mode)) return false;
+            std::string text = read_small_file(dot_git, 4096);
+            if (!text.starts_with("gitdir: ")) return false;
+            text.erase(0, 8);
+            while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+            if (text.empty()) return false;
+            gitdir = text[0] == '/' ? text : dir + "/" + text;
+            return true;
+        }
+    }
+
+    /**
+     * @brief Computes GitListing annotations, caching parsed indexes and ignore files.
+     */
+    class GitStatusCache {
+    public:
+        struct Limits {
+            std::chrono::milliseconds budget{50};   ///< Max time spent on one listed directory's markers
+            size_t max_index_entries = 100000;      ///< Larger repositories get no markers (0 = unlimited)
+        };
+
+        /// @brief One entry of the listed directory.
+        struct Query {
+            std::string_view name;
+            bool is_dir;    ///< A real directory (symlinks count as files, like in git)
+        };
+
+        void set_limits(const Limits& limits) { limits_ = limits; }
+
+        /**
+         * @brief Annotates the entries of `dir` (an absolute, normalized path).
+         * @param marks Compute {git} markers.
+         * @param branches Look up the branch of directory entries that are repositories.
+         */
+        GitListing list(const std::string& dir, const std::vector<Query>& entries, bool marks, bool branches) {
+            GitListing listing;
+            if (branches) {
+                for (const auto& q : entries) {
+                    if (!q.is_dir || q.name == ".git") continue;
+                    std::string gitdir;
+                    if (!git_detail::gitdir_of(dir + "/" + std::string(q.name), gitdir)) continue;
+                    std::string branch = git_detail::read_head(gitdir);
+                    if (!branch.empty()) listing.at(q.name).branch = std::move(branch);
+                }
+            }
+            if (!marks) return listing;
+
+            std::string worktree, gitdir;
+            if (!find_repo(dir, worktree, gitdir)) return listing;
+            listing.in_repo_ = true;
+
+            git_detail::Index* index = load_index(gitdir);
+            if (!index || index->too_large) return listing;
+
+            std::string rel = dir.size() > worktree.size() ? dir.substr(worktree.size() + 1) + "/" : "";
+            if (index->slow_dirs.count(rel)) return listing;
+
+            const auto deadline = std::chrono::steady_clock::now() + limits_.budget;
+            if (!compute_marks(*index, worktree, gitdir, rel, entries, deadline, listing)) {
+                index->slow_dirs.insert(rel);
+                // Drop partial markers; branches stay
+                std::erase_if(listing.entries_, [](const GitListing::Entry& e) { return e.branch.empty(); });
+                for (auto& e : listing.entries_) e.mark = GitMark::None;
+                return listing;
+            }
+            listing.has_marks_ = true;
+            return listing;
+        }
+
+        void clear() {
+            indexes_.clear();
+            ignore_files_.clear();
+        }
+
+        size_t index_parses() const { return index_parses_; }
+
+    private:
+        static constexpr size_t MAX_CACHED_INDEXES = 8;
+
+        /// @brief Work tree containing `dir` (walks up). False outside a repository or inside .git.
+        static bool find_repo(const std::string& dir, std::string& worktree, std::string& gitdir) {
+            std::string current = dir;
+            while (!current.empty()) {
+                const size_t slash = current.find_last_of('/');
+                if (current.compare(slash + 1, std::string::npos, ".git") == 0) return false; // Inside a git dir
+                if (git_detail::gitdir_of(current, gitdir)) {
+                    worktree = current;
+                    return true;
+                }
+                if (slash == std::string::npos || slash == 0) break;
+                current.resize(slash);
+            }
+            if (!git_detail::gitdir_of("", gitdir)) return false; // Repository at "/"
+            worktree.clear();
+            return true;
+        }
+
+        /// @brief The parsed index of `gitdir` (re-parsed if the file changed). nullptr if unreadable.
+        git_detail::Index* load_index(const std::string& gitdir) {
+            const std::string file = gitdir + "/index";
+            const git_detail::FileKey key = git_detail::FileKey::of(file);
+
+            auto it = indexes_.find(gitdir);
+            if (it != indexes_.end() && it->second->key == key) return it->second.get();
+            if (it != indexes_.end()) indexes_.erase(it);
+            if (indexes_.size() >= MAX_CACHED_INDEXES) indexes_.clear();
+
+            auto index = std::make_unique<git_detail::Index>();
+            index->key = key;
+            if (key.exists && key.size > 0) {
+                int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) return nullptr;
+                void* map = ::mmap(nullptr, key.size, PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd);
+                if (map == MAP_FAILED) return nullptr;
+                bool ok = git_detail::parse_index(static_cast<const unsigned char*>(map), key.size,
+                                                  limits_.max_index_entries, *index);
+                ::munmap(map, key.size);
+                if (!ok) return nullptr;
+            }
+            ++index_parses_;
+            return (indexes_[gitdir] = std::move(index)).get();
+        }
+
+        /// @brief Rules of one ignore file, re-read when it changes.
+        const std::vector<git_detail::IgnoreRule>& ignore_file(const std::string& path, const std::string& base) {
+            const git_detail::FileKey key = git_detail::FileKey::of(path);
+            IgnoreFile& cached = ignore_files_[path];
+            if (cached.loaded && cached.key == key) return cached.rules;
+            cached.loaded = true;
+            cached.key = key;
+            cached.rules.clear();
+            if (key.exists) git_detail::parse_ignore(git_detail::read_small_file(path), base, cached.rules);
+            return cached.rules;
+        }
+
+        /// @brief Every rule that applies below `rel` ("a/b/"), lowest precedence first.
+        std::vector<const git_detail::IgnoreRule*> ignore_rules(const std::string& worktree, const std::string& gitdir,
+                                                                const std::string& rel) {
+            std::vector<const git_detail::IgnoreRule*> rules;
+            auto add = [&](const std::vector<git_detail::IgnoreRule>& list) {
+                for (const auto& r : list) rules.push_back(&r);
+            };
+            std::string global;
+            if (const char* xdg = std::getenv("XDG_CONFIG_HOME"); xdg && *xdg) global = std::string(xdg) + "/git/ignore";
+            else if (const char* home = std::getenv("HOME"); home && *home) global = std::string(home) + "/.config/git/ignore";
+            if (!global.empty()) add(ignore_file(global, ""));
+            add(ignore_file(gitdir + "/info/exclude", ""));
+            add(ignore_file(worktree + "/.gitignore", ""));
+            for (size_t slash = rel.find('/'); slash != std::string::npos; slash = rel.find('/', slash + 1)) {
+                const std::string base = rel.substr(0, slash + 1);
+                add(ignore_file(worktree + "/" + base + ".gitignore", base));
+            }
+            return rules;
+        }
+
+        static bool is_ignored(const std::vector<const git_detail::IgnoreRule*>& rules, std::string_view rel_path,
+                               std::string_view name, bool is_dir) {
+            for (auto it = rules.rbegin(); it != rules.rend(); ++it) {
+                if ((*it)->matches(rel_path, name, is_dir)) return !(*it)->negate; // Last match wins
+            }
+            return false;
+        }
+
+        /// @brief Fills `listing` with markers. @return false if the deadline passed.
+        bool compute_marks(const git_detail::Index& index, const std::string& worktree, const std::string& gitdir,
+                           const std::string& rel, const std::vector<Query>& entries,
+                           std::chrono::steady_clock::time_point deadline, GitListing& listing) {
+            auto rules = ignore_rules(worktree, gitdir, rel);
+
+            // A directory below an ignored one is ignored as a whole (git cannot re-include inside it)
+            for (size_t slash = rel.find('/'); slash != std::string::npos; slash = rel.find('/', slash + 1)) {
+                std::string_view parent = std::string_view(rel).substr(0, slash);
+                std::string_view parent_name = parent.substr(parent.find_last_of('/') + 1);
+                const size_t first = index.lower_bound(std::string(parent) + "/");
+                const bool tracked_below = first < index.entries.size() &&
+                                           index.path(index.entries[first]).starts_with(std::string(parent) + "/");
+                if (!tracked_below && is_ignored(rules, parent, parent_name, true)) {
+                    for (const auto& q : entries) listing.at(q.name).mark = GitMark::Ignored;
+                    return true;
+                }
+            }
+
+            // Tracked children of rel, with their aggregated state
+            std::unordered_map<std::string_view, GitMark> tracked;
+            std::string path = worktree;
+            path += '/';
+            const size_t base_len = path.size();
+            size_t checks = 0;
+
+            size_t i = index.lower_bound(rel);
+            while (i < index.entries.size()) {
+                const std::string_view full = index.path(index.entries[i]);
+                if (!full.starts_with(rel)) break;
+                const std::string_view rest = full.substr(rel.size());
+                const size_t slash = rest.find('/');
+                const std::string_view child = rest.substr(0, slash);
+                GitMark& state = tracked.try_emplace(child, GitMark::None).first->second;
+
+                if (state == GitMark::Modified && slash != std::string_view::npos) {
+                    // Already modified: skip the rest of this subdirectory
+                    i = index.lower_bound(std::string(full.substr(0, rel.size() + slash)) + "0"); // '0' follows '/'
+                    continue;
+                }
+
+                const git_detail::IndexEntry& e = index.entries[i];
+                ++i;
+                if (e.skip_worktree || (e.mode & 0170000) == 0160000) continue; // Sparse / submodule
+                if (e.conflicted) {
+                    state = GitMark::Modified;
+                    continue;
+                }
+                if ((++checks & 63) == 0 && std::chrono::steady_clock::now() >= deadline) return false;
+
+                path.resize(base_len);
+                path += full;
+                struct stat st;
+                if (::lstat(path.c_str(), &st) != 0 || changed(e, st)) state = GitMark::Modified;
+            }
+
+            for (const auto& q : entries) {
+                if (q.name == ".git") continue;
+                auto it = tracked.find(q.name);
+                if (it != tracked.end()) {
+                    if (it->second != GitMark::None) listing.at(q.name).mark = it->second;
+                    continue;
+                }
+                const std::string rel_path = rel + std::string(q.name);
+                listing.at(q.name).mark = is_ignored(rules, rel_path, q.name, q.is_dir) ? GitMark::Ignored
+                                                                                        : GitMark::Untracked;
+            }
+            return true;
+        }
+
+        /// @brief Stat comparison of an index entry with its work tree file (git's ie_match_stat, first pass).
+        static bool changed(const git_detail::IndexEntry& e, const struct stat& st) {
+            const uint32_t type = e.mode & 0170000;
+            if (type == 0120000) {
+                if (!S_ISLNK(st.st_mode)) return true;
+            } else if (!S_ISREG(st.st_mode)) {
+                return true;
+            } else if (((e.mode & 0100) != 0) != ((st.st_mode & S_IXUSR) != 0)) {
+                return true; // Exec bit flipped
+            }
+            if (e.size != static_cast<uint32_t>(st.st_size)) return true;
+#if defined(__APPLE__)
+            const struct timespec mtime = st.st_mtimespec;
+#else
+            const struct timespec mtime = st.st_mtim;
+#endif
+            if (e.mtime_s != static_cast<uint32_t>(mtime.tv_sec)) return true;
+            return e.mtime_ns != 0 && e.mtime_ns != static_cast<uint32_t>(mtime.tv_nsec);
+        }
+
+        struct IgnoreFile {
+            git_detail::FileKey key;
+            bool loaded = false;
+            std::vector<git_detail::IgnoreRule> rules;
+        };
+
+        Limits limits_;
+        std::unordered_map<std::string, std::unique_ptr<git_detail::Index>> indexes_;   ///< gitdir -> parsed index
+        std::unordered_map<std::string, IgnoreFile> ignore_files_;                      ///< Path -> parsed rules
+        size_t index_parses_ = 0;
+    };
+}
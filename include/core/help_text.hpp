@@ -44,7 +44,10 @@ namespace dais::core {
         h += S + "  " + V + ":ls size desc" + S + "    " + T + "Sort by size, descending" + R + "\r\n";
         h += S + "  " + V + ":ls type asc" + S + "     " + T + "Sort by type, ascending" + R + "\r\n";
         h += S + "  " + V + ":ls true/false" + S + "   " + T + "Dirs first on/off" + R + "\r\n";
+        h += S + "  " + V + ":ls exact" + S + "        " + T + "Exact row counts (within budget)" + R + "\r\n";
+        h += S + "  " + V + ":ls estimate" + S + "     " + T + "Estimated row counts (32KB scan)" + R + "\r\n";
         h += S + "  " + V + ":ls d" + S + "            " + T + "Reset to defaults" + R + "\r\n";
+        h += S + "  " + V + "ls -R" + S + "            " + T + "Directory totals (size, rows, files)" + R + "\r\n";
         h += "\r\n";
         h += S + "  Options:" + R + "\r\n";
         h += S + "    Sort By: " + V + "name, size, type, rows, none" + R + "\r\n";
@@ -66,6 +69,11 @@ namespace dais::core {
         h += S + "  " + V + ":history" + S + "         " + T + "Show last 20 commands" + R + "\r\n";
         h += S + "  " + V + ":history N" + S + "       " + T + "Show last N commands" + R + "\r\n";
         h += S + "  " + V + ":history clear" + S + "   " + T + "Clear command history" + R + "\r\n";
+        h += S + "  " + V + ":history search" + S + "  " + T + "Show commands matching all terms" + R + "\r\n";
+        h += S + "  " + V + "Ctrl-R" + S + "           " + T + "Search history as you type" + R + "\r\n";
+        h += S + "  " + V + ":perf" + S + "            " + T + "Stage latencies, plugin hook times" + R + "\r\n";
+        h += S + "  " + V + ":perf reset" + S + "      " + T + "Start a new measurement window" + R + "\r\n";
+        h += S + "  " + V + ":perf json [f]" + S + "   " + T + "Print or save the counters as JSON" + R + "\r\n";
         h += S + "  " + V + ":help" + S + "            " + T + "Show this help" + R + "\r\n";
         h += S + "  " + V + ":q / :exit" + S + "       " + T + "Exit DAIS" + R + "\r\n";
         
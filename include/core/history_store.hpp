@@ -0,0 +1,422 @@
+/**
+ * @file history_store.hpp
+ * @brief DAIS command history: deduplicated, indexed, backed by an append-only file.
+ * * The history file is read in one block, which then serves as storage for the
+ *   loaded entries (no allocation per entry). Lines are taken newest first, so
+ *   duplicates and entries beyond the cap are skipped instead of inserted and
+ *   removed. New commands go to an arena and are appended to the file with one
+ *   write() on a descriptor kept open for the session.
+ * * Entries are unique: running a command again moves it to the newest position
+ *   (a hash map finds the old copy). Duplicates accumulate in the file until a
+ *   startup finds it at twice its live size and rewrites it.
+ * * Search splits the query into terms that must all occur in the entry, in any
+ *   order, case-insensitive. Terms of 3+ bytes use a trigram index (hashed into
+ *   64k buckets of ascending slots): the smallest bucket is walked newest first.
+ *   Shorter queries scan newest first, filtered by a 64-bit character mask per
+ *   entry. Either way a keystroke touches few entries, even at 100k.
+ *
+ * Entries are addressed by slot (insertion order). Superseded entries leave dead
+ * slots behind, skipped by prev() / next() / search(); add() compacts them once
+ * they outnumber live entries, which renumbers slots.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace dais::core::utils {
+
+    class HistoryStore {
+    public:
+        static constexpr size_t DEFAULT_MAX_ENTRIES = 100000;
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        HistoryStore() = default;
+        HistoryStore(const HistoryStore&) = delete;
+        HistoryStore& operator=(const HistoryStore&) = delete;
+        ~HistoryStore() { close(); }
+
+        /**
+         * @brief Loads `path` and keeps it open for appending.
+         * @param max_entries Oldest entries beyond this count are dropped.
+         * @return false if the file cannot be opened for appending (history stays in memory).
+         */
+        bool open(const std::string& path, size_t max_entries = DEFAULT_MAX_ENTRIES) {
+            close();
+            reset();
+            path_ = path;
+            max_entries_ = std::max<size_t>(max_entries, 1);
+
+            size_t lines = 0;
+            size_t size = 0;
+            std::unique_ptr<char[]> block = read_file(path, size);
+            if (block) {
+                // Newest first: the last copy of a command wins, the cap stops the walk
+                std::vector<std::pair<std::string_view, uint32_t*>> kept; // Text and its map value
+                slots_.reserve(std::min(max_entries_, size / 16 + 16));
+                const char* data = block.get();
+                size_t end = size;
+                while (end > 0) {
+                    size_t start = end;
+                    while (start > 0 && data[start - 1] != '\n') --start;
+                    std::string_view line(data + start, end - start);
+                    end = start > 0 ? start - 1 : 0;
+                    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                    if (line.empty()) continue;
+                    ++lines;
+                    if (kept.size() >= max_entries_) continue;
+                    auto [it, fresh] = slots_.emplace(line, 0);
+                    if (fresh) kept.emplace_back(line, &it->second);
+                }
+                blocks_.push_back(std::move(block));
+                block_used_ = block_cap_ = size; // Full: new commands start a fresh block
+
+                texts_.reserve(kept.size());
+                for (size_t i = kept.size(); i-- > 0;) {
+                    *kept[i].second = static_cast<uint32_t>(texts_.size());
+                    push_slot(kept[i].first, false);
+                }
+                index_all();
+            }
+
+            // Rewrite once duplicates / trimmed entries make up half the file
+            if (lines > live_ * 2 && lines - live_ >= REWRITE_MIN_STALE) rewrite();
+
+            fd_ = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+            return fd_ >= 0;
+        }
+
+        void close() {
+            if (fd_ >= 0) ::close(fd_);
+            fd_ = -1;
+        }
+
+        /**
+         * @brief Records a command as the newest entry (moving an older copy) and appends it to the file.
+         * @return false if nothing changed (empty, multi-line, or already the newest entry).
+         */
+        bool add(std::string_view cmd) {
+            if (cmd.empty() || cmd.find('\n') != std::string_view::npos) return false;
+            auto it = slots_.find(cmd);
+            if (it != slots_.end()) {
+                if (it->second + 1 == texts_.size()) return false;
+                size_t old = it->second;
+                slots_.erase(it);
+                kill(old);
+            }
+            push_slot(store(cmd), true);
+            index(texts_.size() - 1);
+            while (live_ > max_entries_) {
+                while (!live_flags_[oldest_]) ++oldest_;
+                slots_.erase(texts_[oldest_]);
+                kill(oldest_);
+            }
+            if (dead_ >= COMPACT_MIN_DEAD && dead_ > live_) compact();
+
+            if (fd_ >= 0) {
+                std::string line;
+                line.reserve(cmd.size() + 1);
+                line.append(cmd);
+                line += '\n';
+                ssize_t ignored = ::write(fd_, line.data(), line.size()); // One write: atomic with O_APPEND
+                (void)ignored;
+            }
+            return true;
+        }
+
+        /// @brief Drops every entry and truncates the file.
+        void clear() {
+            reset();
+            if (fd_ >= 0) {
+                int ignored = ::ftruncate(fd_, 0);
+                (void)ignored;
+            }
+        }
+
+        size_t size() const { return live_; }
+        bool empty() const { return live_ == 0; }
+
+        /// @brief One past the newest slot (the "current line" position for navigation).
+        size_t end() const { return texts_.size(); }
+
+        std::string_view at(size_t slot) const { return texts_[slot]; }
+
+        /// @brief Newest live slot before `slot`, or npos.
+        size_t prev(size_t slot) const {
+            for (size_t s = std::min(slot, end()); s-- > 0;) {
+                if (live_flags_[s]) return s;
+            }
+            return npos;
+        }
+
+        /// @brief Oldest live slot after `slot`, or end().
+        size_t next(size_t slot) const {
+            for (size_t s = slot + 1; s < end(); ++s) {
+                if (live_flags_[s]) return s;
+            }
+            return end();
+        }
+
+        /**
+         * @brief Newest live entry before `before` containing every term of `query`.
+         * An empty query matches everything.
+         * @return The matching slot, or npos.
+         */
+        size_t search(std::string_view query, size_t before) const {
+            std::vector<std::string> terms = split_terms(query);
+            before = std::min(before, end());
+            uint64_t mask = 0;
+            for (const std::string& term : terms) mask |= char_mask(term);
+
+            // Drive the scan with the smallest bucket among the query's trigrams
+            const std::vector<uint32_t>* driver = nullptr;
+            for (const std::string& term : terms) {
+                for (size_t i = 0; i + 3 <= term.size(); ++i) {
+                    const std::vector<uint32_t>& bucket = buckets_[bucket_at(term, i)];
+                    if (!driver || bucket.size() < driver->size()) driver = &bucket;
+                }
+            }
+
+            auto candidate = [&](size_t slot) {
+                return live_flags_[slot] && (masks_[slot] & mask) == mask && matches(texts_[slot], terms);
+            };
+            if (driver) {
+                auto it = std::lower_bound(driver->begin(), driver->end(), static_cast<uint32_t>(before));
+                while (it != driver->begin()) {
+                    uint32_t slot = *--it;
+                    if (candidate(slot)) return slot;
+                }
+                return npos;
+            }
+            for (size_t s = before; s-- > 0;) {
+                if (candidate(s)) return s;
+            }
+            return npos;
+        }
+
+    private:
+        static constexpr size_t BUCKETS = 1 << 16;
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+        static constexpr size_t COMPACT_MIN_DEAD = 4096;
+        static constexpr size_t REWRITE_MIN_STALE = 1000;
+
+        static std::unique_ptr<char[]> read_file(const std::string& path, size_t& size) {
+            size = 0;
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return nullptr;
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+                ::close(fd);
+                return nullptr;
+            }
+            const size_t want = static_cast<size_t>(st.st_size);
+            auto block = std::make_unique<char[]>(want);
+            while (size < want) {
+                ssize_t r = ::read(fd, block.get() + size, want - size);
+                if (r <= 0) break;
+                size += static_cast<size_t>(r);
+            }
+            ::close(fd);
+            return block;
+        }
+
+        void reset() {
+            blocks_.clear();
+            block_used_ = block_cap_ = 0;
+            texts_.clear();
+            live_flags_.clear();
+            masks_.clear();
+            slots_.clear();
+            buckets_.assign(BUCKETS, {});
+            bucket_last_.assign(BUCKETS, UINT32_MAX);
+            live_ = 0;
+            dead_ = 0;
+            oldest_ = 0;
+        }
+
+        /// @brief Copies a new command into the arena (blocks never move).
+        std::string_view store(std::string_view s) {
+            if (blocks_.empty() || block_cap_ - block_used_ < s.size()) {
+                block_cap_ = std::max(BLOCK_SIZE, s.size());
+                blocks_.push_back(std::make_unique<char[]>(block_cap_));
+                block_used_ = 0;
+            }
+            char* p = blocks_.back().get() + block_used_;
+            std::memcpy(p, s.data(), s.size());
+            block_used_ += s.size();
+            return {p, s.size()};
+        }
+
+        static char lower(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c; } // ASCII only
+
+        static uint32_t bucket_at(std::string_view s, size_t i) {
+            uint32_t g = (static_cast<uint32_t>(static_cast<unsigned char>(lower(s[i]))) << 16) |
+                         (static_cast<uint32_t>(static_cast<unsigned char>(lower(s[i + 1]))) << 8) |
+                         static_cast<uint32_t>(static_cast<unsigned char>(lower(s[i + 2])));
+            return (g * 2654435761u) >> 16; // Fibonacci hash to 16 bits
+        }
+
+        /// @brief Bit per byte class: a-z, 0-9 and common punctuation get their own bits, the rest share.
+        static int mask_bit(unsigned char c) {
+            if (c >= 'a' && c <= 'z') return c - 'a';
+            if (c >= '0' && c <= '9') return 26 + (c - '0');
+            if (c >= 0x80) return 63;
+            static constexpr std::string_view punct = " -_./~=:,;\"'|&$*<>()[]{}@#%+!?^`";
+            size_t i = punct.find(static_cast<char>(c));
+            return i == std::string_view::npos ? 62 : 36 + static_cast<int>(i % 26);
+        }
+
+        static uint64_t char_mask(std::string_view s) {
+            uint64_t mask = 0;
+            for (char c : s) mask |= 1ull << mask_bit(static_cast<unsigned char>(lower(c)));
+            return mask;
+        }
+
+        static std::vector<std::string> split_terms(std::string_view query) {
+            std::vector<std::string> terms;
+            size_t pos = 0;
+            while (pos < query.size()) {
+                size_t start = query.find_first_not_of(' ', pos);
+                if (start == std::string_view::npos) break;
+                size_t stop = query.find(' ', start);
+                if (stop == std::string_view::npos) stop = query.size();
+                std::string term(query.substr(start, stop - start));
+                for (char& c : term) c = lower(c);
+                terms.push_back(std::move(term));
+                pos = stop;
+            }
+            return terms;
+        }
+
+        /// @brief Case-insensitive substring test; `needle` is already lowercase.
+        static bool contains_ci(std::string_view haystack, std::string_view needle) {
+            if (needle.size() > haystack.size()) return false;
+            for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+                size_t k = 0;
+                while (k < needle.size() && lower(haystack[i + k]) == needle[k]) ++k;
+                if (k == needle.size()) return true;
+            }
+            return false;
+        }
+
+        static bool matches(std::string_view text, const std::vector<std::string>& terms) {
+            for (const std::string& term : terms) {
+                if (!contains_ci(text, term)) return false;
+            }
+            return true;
+        }
+
+        /// @brief Appends a live slot for `text` (already in storage); `map` also records it for dedupe.
+        void push_slot(std::string_view text, bool map) {
+            texts_.push_back(text);
+            live_flags_.push_back(1);
+            masks_.push_back(char_mask(text));
+            ++live_;
+            if (map) slots_.emplace(text, static_cast<uint32_t>(texts_.size() - 1));
+        }
+
+        /// @brief Adds one slot to the trigram buckets (each bucket at most once per entry).
+        void index(size_t slot) {
+            std::string_view text = texts_[slot];
+            for (size_t i = 0; i + 3 <= text.size(); ++i) {
+                uint32_t b = bucket_at(text, i);
+                if (bucket_last_[b] == slot) continue;
+                bucket_last_[b] = static_cast<uint32_t>(slot);
+                buckets_[b].push_back(static_cast<uint32_t>(slot));
+            }
+        }
+
+        /// @brief Indexes every slot into empty buckets: counts first, so each bucket is allocated once.
+        void index_all() {
+            std::vector<uint32_t> counts(BUCKETS, 0);
+            for (size_t slot = 0; slot < texts_.size(); ++slot) {
+                std::string_view text = texts_[slot];
+                for (size_t i = 0; i + 3 <= text.size(); ++i) {
+                    uint32_t b = bucket_at(text, i);
+                    if (bucket_last_[b] == slot) continue;
+                    bucket_last_[b] = static_cast<uint32_t>(slot);
+                    ++counts[b];
+                }
+            }
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                buckets_[b].reserve(counts[b]);
+                bucket_last_[b] = UINT32_MAX;
+            }
+            for (size_t slot = 0; slot < texts_.size(); ++slot) index(slot);
+        }
+
+        /// @brief Marks a slot dead (its map entry must already be gone).
+        void kill(size_t slot) {
+            live_flags_[slot] = 0;
+            texts_[slot] = {};
+            --live_;
+            ++dead_;
+        }
+
+        /// @brief Copies live entries into fresh storage, renumbered densely.
+        void compact() {
+            std::vector<std::string> live;
+            live.reserve(live_);
+            for (size_t s = 0; s < texts_.size(); ++s) {
+                if (live_flags_[s]) live.emplace_back(texts_[s]);
+            }
+            reset();
+            texts_.reserve(live.size());
+            slots_.reserve(live.size());
+            for (const std::string& text : live) push_slot(store(text), true);
+            index_all();
+        }
+
+        /// @brief Replaces the file with the live entries (temp file + rename).
+        void rewrite() {
+            std::string tmp = path_ + ".tmp";
+            int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            if (fd < 0) return;
+            std::string block;
+            bool ok = true;
+            for (size_t s = 0; s < texts_.size() && ok; ++s) {
+                if (!live_flags_[s]) continue;
+                block += texts_[s];
+                block += '\n';
+                if (block.size() >= BLOCK_SIZE) {
+                    ok = ::write(fd, block.data(), block.size()) == static_cast<ssize_t>(block.size());
+                    block.clear();
+                }
+            }
+            if (ok && !block.empty()) ok = ::write(fd, block.data(), block.size()) == static_cast<ssize_t>(block.size());
+            ok = ::close(fd) == 0 && ok;
+            if (ok) ok = ::rename(tmp.c_str(), path_.c_str()) == 0;
+            if (!ok) ::unlink(tmp.c_str());
+        }
+
+        std::string path_;
+        int fd_ = -1;                                   ///< O_APPEND descriptor of the history file
+        size_t max_entries_ = DEFAULT_MAX_ENTRIES;
+
+        // Storage: the loaded file block, then 64KB arena blocks for new commands
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        size_t block_used_ = 0, block_cap_ = 0;
+
+        // Per slot (insertion order)
+        std::vector<std::string_view> texts_;           ///< Command text (empty once dead)
+        std::vector<uint8_t> live_flags_;               ///< 1 = live
+        std::vector<uint64_t> masks_;                   ///< Byte classes present (see mask_bit)
+
+        std::unordered_map<std::string_view, uint32_t> slots_; ///< Live text -> slot (dedupe)
+        std::vector<std::vector<uint32_t>> buckets_ = std::vector<std::vector<uint32_t>>(BUCKETS); ///< Hashed trigram -> ascending slots
+        std::vector<uint32_t> bucket_last_ = std::vector<uint32_t>(BUCKETS, UINT32_MAX); ///< Last slot pushed per bucket
+        size_t live_ = 0;
+        size_t dead_ = 0;
+        size_t oldest_ = 0;                             ///< No live slot before this one
+    };
+}
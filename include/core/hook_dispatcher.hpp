@@ -0,0 +1,335 @@
+/**
+ * @file hook_dispatcher.hpp
+ * @brief Resolved per-hook tables for Python plugins, dispatched on the Python thread.
+ * * Hook callables are looked up once per plugin at load time, so an event costs
+ *   no attribute lookups and plugins without the hook are never touched.
+ * * Events are queued to the Python thread, which runs serve(). Each wakeup drains
+ *   the whole queue under one GIL acquisition, so a burst (pasted commands) costs
+ *   one GIL hand-off instead of one per event, and typing never waits on Python.
+ *   The same queue carries startup tasks (evaluating config.py, importing the
+ *   plugins), which therefore run before any event queued after them.
+ * * Hooks that must transform data opt in to running synchronously, listed in the
+ *   plugin's `DAIS_SYNC_HOOKS`. They run inline, in plugin order, and a `str`
+ *   return value replaces the data seen by later hooks and returned to the caller.
+ *   Until set_ready() (plugins still loading) events are only queued.
+ * * Every binding accounts its own call count and time. A call slower than
+ *   `slow` throttles that plugin's hook for `cooldown`: its events are skipped
+ *   (and counted) until then, so one slow plugin cannot back up the queue or,
+ *   for sync hooks, stall input. `:perf` shows the table.
+ *
+ * add_plugin(), set_ready() and clear() run on the Python thread with the GIL held;
+ * dispatch() and post() are called from the input thread without it.
+ */
+
+#pragma once
+
+#include "core/perf.hpp"
+#include "core/command_handlers.hpp"
+#include <pybind11/embed.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace dais::core::utils {
+
+    class HookDispatcher {
+    public:
+        /// @brief Hooks plugins can implement. Keep HOOK_NAMES in the same order.
+        enum class Hook : uint8_t {
+            ON_COMMAND,   ///< on_command(cmd_text): a command line was submitted
+            COUNT
+        };
+
+        static constexpr size_t HOOKS = static_cast<size_t>(Hook::COUNT);
+        static constexpr std::array<const char*, HOOKS> HOOK_NAMES = {"on_command"};
+
+        using Clock = std::chrono::steady_clock;
+
+        struct Limits {
+            std::chrono::milliseconds slow{250};        ///< A call this slow throttles the binding
+            std::chrono::milliseconds cooldown{10000};  ///< How long a throttled binding is skipped
+            size_t queue_limit = 1024;                  ///< Oldest events are dropped beyond this
+        };
+
+        HookDispatcher() = default;
+        HookDispatcher(const HookDispatcher&) = delete;
+        HookDispatcher& operator=(const HookDispatcher&) = delete;
+
+        /// @brief Takes effect for events queued after the next post() (set before loading plugins).
+        void set_limits(const Limits& limits) { limits_ = limits; }
+
+        /**
+         * @brief Resolves the hooks `module` implements (Python thread, before set_ready()).
+         * @return Number of hooks bound.
+         */
+        size_t add_plugin(const std::string& name, const py::module_& module) {
+            std::vector<std::string> sync_names;
+            if (py::hasattr(module, "DAIS_SYNC_HOOKS")) {
+                try {
+                    for (py::handle h : module.attr("DAIS_SYNC_HOOKS")) sync_names.push_back(py::str(h));
+                } catch (const std::exception& e) {
+                    std::cerr << "[" << handlers::Theme::WARNING << "-" << handlers::Theme::RESET
+                              << "] " << name << ": DAIS_SYNC_HOOKS must be a list of hook names\n";
+                }
+            }
+
+            size_t bound = 0;
+            for (size_t h = 0; h < HOOKS; ++h) {
+                if (!py::hasattr(module, HOOK_NAMES[h])) continue;
+                py::object fn = module.attr(HOOK_NAMES[h]);
+                if (!PyCallable_Check(fn.ptr())) continue;
+
+                auto binding = std::make_unique<Binding>();
+                binding->plugin = name;
+                binding->hook = static_cast<Hook>(h);
+                binding->fn = std::move(fn);
+                for (const auto& s : sync_names) binding->sync |= (s == HOOK_NAMES[h]);
+                (binding->sync ? has_sync_ : has_async_)[h] = true;
+                table_[h].push_back(std::move(binding));
+                ++bound;
+            }
+            return bound;
+        }
+
+        /// @brief Plugins are loaded: the tables are final and sync hooks can run.
+        void set_ready() { ready_.store(true, std::memory_order_release); }
+        bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+        /**
+         * @brief True if any plugin implements `hook` (no GIL needed).
+         * Also true until ready(): the plugins being loaded may implement it, so the
+         * event must reach dispatch() to be queued for them.
+         */
+        bool has(Hook hook) const {
+            if (!ready()) return true;
+            const size_t h = static_cast<size_t>(hook);
+            return has_sync_[h] || has_async_[h];
+        }
+
+        /**
+         * @brief Delivers an event: sync hooks inline, the rest queued to the Python thread.
+         * Before ready() the event is queued for the async hooks of the plugins being loaded.
+         * @return The data as rewritten by sync hooks, if any returned a string.
+         */
+        std::optional<std::string> dispatch(Hook hook, const std::string& data) {
+            if (!ready()) {
+                enqueue({hook, data, Clock::now(), {}});
+                return std::nullopt;
+            }
+            const size_t h = static_cast<size_t>(hook);
+            std::optional<std::string> rewritten;
+            if (has_sync_[h]) {
+                PerfTimer timer(PerfStage::HOOK_SYNC);
+                py::gil_scoped_acquire gil; // The input loop runs without the GIL
+                for (auto& b : table_[h]) {
+                    if (!b->sync) continue;
+                    py::object result = call(*b, rewritten ? *rewritten : data);
+                    if (result && PyUnicode_Check(result.ptr())) rewritten = result.cast<std::string>();
+                }
+            }
+            if (has_async_[h]) enqueue({hook, rewritten ? *rewritten : data, Clock::now(), {}});
+            return rewritten;
+        }
+
+        /// @brief Runs `task` on the Python thread with the GIL held, in queue order.
+        void post(std::function<void()> task) {
+            enqueue({Hook::COUNT, {}, Clock::now(), std::move(task)});
+        }
+
+        /**
+         * @brief Python thread loop: tasks and events until stop(). Call without the GIL.
+         * Whatever is still queued at stop() is delivered before returning.
+         */
+        void serve() {
+            std::vector<Item> batch;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                    if (queue_.empty()) return; // Stopping and drained
+                    batch.swap(queue_);
+                    events_ = 0;
+                }
+
+                auto& perf = PerfCounters::instance();
+                const auto start = Clock::now();
+                if (perf.enabled()) {
+                    for (const Item& it : batch) {
+                        if (!it.task) perf.record(PerfStage::HOOK_QUEUE, start - it.queued);
+                    }
+                }
+                {
+                    py::gil_scoped_acquire gil; // Once per batch
+                    for (Item& it : batch) {
+                        if (it.task) {
+                            it.task();
+                            continue;
+                        }
+                        if (!ready()) continue; // Plugins failed to load
+                        for (auto& b : table_[static_cast<size_t>(it.hook)]) {
+                            if (!b->sync) call(*b, it.data);
+                        }
+                    }
+                }
+                batch.clear();
+            }
+        }
+
+        /// @brief Makes serve() return once the queue is drained.
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_one();
+        }
+
+        /// @brief Releases every callable (Python thread, GIL held, before the interpreter goes).
+        void clear() {
+            ready_.store(false, std::memory_order_release);
+            for (auto& bindings : table_) bindings.clear();
+            has_sync_.fill(false);
+            has_async_.fill(false);
+        }
+
+        /// @brief Per-plugin timings for `:perf` (lines end with "\r\n"; empty without bindings).
+        std::string format_table() const {
+            std::string out;
+            if (!ready()) return out;
+            char line[200];
+            for (size_t h = 0; h < HOOKS; ++h) {
+                for (const auto& b : table_[h]) {
+                    if (out.empty()) {
+                        std::snprintf(line, sizeof(line), "Plugin hooks (%llu events dropped from a full queue):\r\n",
+                                      static_cast<unsigned long long>(dropped_.load(std::memory_order_relaxed)));
+                        out += line;
+                        std::snprintf(line, sizeof(line), "  %-18s %-12s %5s %9s %10s %10s %10s %8s %7s\r\n",
+                                      "plugin", "hook", "mode", "calls", "avg", "max", "total", "skipped", "errors");
+                        out += line;
+                    }
+                    const uint64_t calls = b->calls.load(std::memory_order_relaxed);
+                    const uint64_t total = b->total_ns.load(std::memory_order_relaxed);
+                    const bool throttled = Clock::now().time_since_epoch().count() <
+                                           b->throttled_until.load(std::memory_order_relaxed);
+                    std::snprintf(line, sizeof(line), "  %-18s %-12s %5s %9llu %10s %10s %10s %8llu %7llu%s\r\n",
+                                  b->plugin.c_str(), HOOK_NAMES[static_cast<size_t>(b->hook)],
+                                  b->sync ? "sync" : "async", static_cast<unsigned long long>(calls),
+                                  PerfCounters::fmt_ns(calls ? total / calls : 0).c_str(),
+                                  PerfCounters::fmt_ns(b->max_ns.load(std::memory_order_relaxed)).c_str(),
+                                  PerfCounters::fmt_ns(total).c_str(),
+                                  static_cast<unsigned long long>(b->skipped.load(std::memory_order_relaxed)),
+                                  static_cast<unsigned long long>(b->errors.load(std::memory_order_relaxed)),
+                                  throttled ? "  (throttled)" : "");
+                    out += line;
+                }
+            }
+            return out;
+        }
+
+        size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        /// @brief One plugin's callable for one hook. Stats have a single writer
+        /// (the input thread for sync bindings, the Python thread otherwise).
+        struct Binding {
+            std::string plugin;
+            Hook hook = Hook::ON_COMMAND;
+            py::object fn;
+            bool sync = false;
+            std::atomic<uint64_t> calls{0};
+            std::atomic<uint64_t> total_ns{0};
+            std::atomic<uint64_t> max_ns{0};
+            std::atomic<uint64_t> skipped{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<int64_t> throttled_until{0};    ///< steady_clock ticks
+        };
+
+        /// @brief Queued hook event, or a task when `task` is set.
+        struct Item {
+            Hook hook;
+            std::string data;
+            Clock::time_point queued;
+            std::function<void()> task;
+        };
+
+        void enqueue(Item item) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!item.task) {
+                    // Bounded: drop the oldest pending event (tasks are never dropped)
+                    if (++events_ > std::max<size_t>(limits_.queue_limit, 1)) {
+                        auto oldest = std::find_if(queue_.begin(), queue_.end(), [](const Item& it) { return !it.task; });
+                        if (oldest != queue_.end()) {
+                            queue_.erase(oldest);
+                            --events_;
+                            dropped_.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+                queue_.push_back(std::move(item));
+            }
+            cv_.notify_one();
+        }
+
+        /// @brief Calls one binding (GIL held), with accounting and throttling.
+        py::object call(Binding& b, const std::string& data) {
+            const auto now = Clock::now();
+            if (now.time_since_epoch().count() < b.throttled_until.load(std::memory_order_relaxed)) {
+                b.skipped.store(b.skipped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return py::object();
+            }
+
+            py::object result;
+            try {
+                result = b.fn(data);
+            } catch (const std::exception& e) {
+                b.errors.store(b.errors.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                std::cerr << "\r\n[" << handlers::Theme::ERROR << "-" << handlers::Theme::RESET
+                          << "] Error in plugin " << b.plugin << "." << HOOK_NAMES[static_cast<size_t>(b.hook)]
+                          << ": " << e.what() << "\r\n" << std::flush;
+            }
+
+            const auto elapsed = Clock::now() - now;
+            const uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            b.calls.store(b.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            b.total_ns.store(b.total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+            if (ns > b.max_ns.load(std::memory_order_relaxed)) b.max_ns.store(ns, std::memory_order_relaxed);
+
+            if (elapsed > limits_.slow) {
+                b.throttled_until.store((Clock::now() + limits_.cooldown).time_since_epoch().count(),
+                                        std::memory_order_relaxed);
+                std::cerr << "\r\n[" << handlers::Theme::WARNING << "-" << handlers::Theme::RESET << "] Plugin "
+                          << b.plugin << " took " << PerfCounters::fmt_ns(ns) << " in "
+                          << HOOK_NAMES[static_cast<size_t>(b.hook)] << "; skipping it for "
+                          << std::chrono::duration_cast<std::chrono::seconds>(limits_.cooldown).count()
+                          << "s (see :perf)\r\n" << std::flush;
+            }
+            return result;
+        }
+
+        Limits limits_;
+        std::array<std::vector<std::unique_ptr<Binding>>, HOOKS> table_;  ///< Plugin order per hook
+        std::array<bool, HOOKS> has_sync_{};
+        std::array<bool, HOOKS> has_async_{};
+
+        std::atomic<bool> ready_{false};
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<Item> queue_;           ///< Guarded by mutex_
+        size_t events_ = 0;                 ///< Events (not tasks) in queue_, guarded by mutex_
+        bool stopping_ = false;             ///< Guarded by mutex_
+        std::atomic<uint64_t> dropped_{0};
+    };
+}
@@ -0,0 +1,268 @@
+/**
+ * @file ls_listing.hpp
+ * @brief Contiguous storage, precomputed sort keys and rendering for one listing.
+ * * Names live in one arena buffer (NUL-terminated, so they can go straight to
+ *   fstatat()/openat()); entries refer to them by offset and are identified by
+ *   their insertion index.
+ * * The sort criterion is resolved once into an LSOrder. sort() then builds one
+ *   compact Row per entry (group, numeric key, first 8 name bytes) and sorts those:
+ *   most comparisons never touch the arena. Large listings are sorted in runs on the
+ *   thread pool and merged.
+ * * render() writes every display string into a few shared buffers in sorted order.
+ *
+ * All buffers are reused across sort()/render() calls, so a listing costs a fixed
+ * number of allocations (plus geometric growth) instead of a few per entry.
+ * Shared by native_ls, native_tree_ls and render_remote_ls.
+ */
+
+#pragma once
+
+#include "core/file_analyzer.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dais::core::utils {
+
+    /// @brief Sort criterion of LS_SORT_BY, resolved once per listing.
+    enum class LSSortKey : uint8_t { None, Name, Size, Type, Rows };
+
+    /// @brief Parsed LS_SORT_BY / LS_SORT_ORDER / LS_DIRS_FIRST.
+    struct LSOrder {
+        LSSortKey key = LSSortKey::Type;
+        bool descending = false;
+        bool dirs_first = true;
+
+        /// @brief Unknown criteria keep the enumeration order ("none").
+        static LSOrder parse(std::string_view by, std::string_view order, bool dirs_first) {
+            LSOrder o;
+            if (by == "name") o.key = LSSortKey::Name;
+            else if (by == "size") o.key = LSSortKey::Size;
+            else if (by == "type") o.key = LSSortKey::Type;
+            else if (by == "rows") o.key = LSSortKey::Rows;
+            else o.key = LSSortKey::None;
+            o.descending = order == "desc";
+            o.dirs_first = dirs_first;
+            return o;
+        }
+    };
+
+    class ListingCore {
+    public:
+        /// @brief Listings at least this large are sorted on the pool.
+        static constexpr size_t PARALLEL_SORT_MIN = 16384;
+
+        /// @brief Drops all entries; buffers keep their capacity.
+        void clear() {
+            names_.clear();
+            spans_.clear();
+            rows_.clear();
+            cells_.clear();
+        }
+
+        /// @brief Pre-sizes the arena for `entries` names of about `name_bytes` bytes in total.
+        void reserve(size_t entries, size_t name_bytes) {
+            spans_.reserve(entries);
+            names_.reserve(name_bytes + entries);
+        }
+
+        /// @return Index of the new entry.
+        uint32_t add(std::string_view name) {
+            return add_with([name](std::string& arena) { arena.append(name); });
+        }
+
+        /**
+         * @brief Adds an entry whose name `write(arena)` appends to the arena in place
+         * (e.g. wire_unescape), so decoded names need no temporary string.
+         */
+        template <class Write>
+        uint32_t add_with(Write&& write) {
+            const size_t offset = names_.size();
+            write(names_);
+            spans_.push_back({static_cast<uint32_t>(offset), static_cast<uint32_t>(names_.size() - offset)});
+            names_.push_back('\0');
+            return static_cast<uint32_t>(spans_.size() - 1);
+        }
+
+        size_t size() const { return spans_.size(); }
+        std::string_view name(uint32_t index) const {
+            return std::string_view(names_.data() + spans_[index].offset, spans_[index].length);
+        }
+        /// @brief NUL-terminated name; valid until the next add().
+        const char* c_name(uint32_t index) const { return names_.data() + spans_[index].offset; }
+
+        /**
+         * @brief Sorts the entries for which `stats_of(index)` is non-null; the rest are left out.
+         * Ties keep the insertion order, so the result does not depend on the pool.
+         * @param stats_of Callable `const FileStats*(uint32_t index)`.
+         * @param pool Optional: sorts listings of PARALLEL_SORT_MIN+ entries in runs on it.
+         */
+        template <class StatsOf>
+        void sort(const LSOrder& order, StatsOf&& stats_of, ThreadPool* pool = nullptr) {
+            rows_.clear();
+            rows_.reserve(spans_.size());
+            for (uint32_t i = 0; i < spans_.size(); ++i) {
+                const dais::utils::FileStats* stats = stats_of(i);
+                if (!stats) continue;
+                Row row;
+                row.group = (order.dirs_first && !stats->is_dir) ? 1 : 0;
+                switch (order.key) {
+                    case LSSortKey::Size: row.key = stats->size_bytes; break;
+                    case LSSortKey::Rows: row.key = stats->rows; break;
+                    case LSSortKey::Type: row.key = stats->is_dir ? 0 : (stats->is_text || stats->is_data) ? 1 : 2; break;
+                    default: row.key = 0; break;
+                }
+                row.prefix = name_prefix(name(i));
+                row.index = i;
+                rows_.push_back(row);
+            }
+
+            const bool by_name = order.key == LSSortKey::Name || order.key == LSSortKey::Type;
+            const bool by_key = order.key != LSSortKey::None && order.key != LSSortKey::Name;
+            auto less = [this, by_name, by_key, desc = order.descending](const Row& a, const Row& b) {
+                if (a.group != b.group) return a.group < b.group;
+                int cmp = 0;
+                if (by_key && a.key != b.key) cmp = a.key < b.key ? -1 : 1;
+                else if (by_name) cmp = compare_names(a, b);
+                if (cmp != 0) return desc ? cmp > 0 : cmp < 0;
+                return a.index < b.index;
+            };
+
+            const size_t workers = pool ? pool->size() : 0;
+            if (workers == 0 || rows_.size() < PARALLEL_SORT_MIN) {
+                std::sort(rows_.begin(), rows_.end(), less);
+                return;
+            }
+
+            // Sorted runs, one per thread, then pairwise merges (each round in parallel)
+            const size_t n = rows_.size();
+            const size_t runs = std::min(workers + 1, n / (PARALLEL_SORT_MIN / 4));
+            const size_t run_len = (n + runs - 1) / runs;
+            pool->parallel_for(0, runs, 1, [&](size_t lo, size_t hi) {
+                for (size_t r = lo; r < hi; ++r) {
+                    std::sort(rows_.begin() + std::min(n, r * run_len), rows_.begin() + std::min(n, (r + 1) * run_len), less);
+                }
+            });
+            merge_tmp_.resize(n);
+            for (size_t width = run_len; width < n; width *= 2) {
+                const size_t pairs = (n + 2 * width - 1) / (2 * width);
+                pool->parallel_for(0, pairs, 1, [&](size_t lo, size_t hi) {
+                    for (size_t p = lo; p < hi; ++p) {
+                        const size_t begin = p * 2 * width;
+                        const size_t mid = std::min(n, begin + width);
+                        const size_t end = std::min(n, begin + 2 * width);
+                        std::merge(rows_.begin() + begin, rows_.begin() + mid, rows_.begin() + mid, rows_.begin() + end,
+                                   merge_tmp_.begin() + begin, less);
+                    }
+                });
+                rows_.swap(merge_tmp_);
+            }
+        }
+
+        /// @brief Number of entries kept by the last sort().
+        size_t sorted_size() const { return rows_.size(); }
+        /// @brief Insertion index of the entry at sorted position `pos`.
+        uint32_t index_at(size_t pos) const { return rows_[pos].index; }
+
+        /**
+         * @brief Renders every sorted entry with `fn(std::string& out, uint32_t index)`, which
+         * appends the display string and returns its visible width.
+         * @param pool Optional: renders chunks of the listing in parallel.
+         */
+        template <class Render>
+        void render(Render&& fn, ThreadPool* pool = nullptr) {
+            const size_t n = rows_.size();
+            cells_.resize(n);
+            const size_t workers = pool ? pool->size() : 0;
+            size_t chunks = (workers == 0 || n < RENDER_CHUNK_MIN) ? 1 : std::min(workers * 4, n / (RENDER_CHUNK_MIN / 4));
+            if (chunks == 0) chunks = 1;
+            if (chunk_text_.size() < chunks) chunk_text_.resize(chunks);
+            const size_t per_chunk = (n + chunks - 1) / chunks;
+
+            auto render_chunk = [&](size_t c) {
+                std::string& text = chunk_text_[c];
+                text.clear();
+                const size_t lo = std::min(n, c * per_chunk), hi = std::min(n, (c + 1) * per_chunk);
+                for (size_t pos = lo; pos < hi; ++pos) {
+                    const size_t start = text.size();
+                    const size_t visible = fn(text, rows_[pos].index);
+                    cells_[pos] = {static_cast<uint32_t>(c), static_cast<uint32_t>(start),
+                                   static_cast<uint32_t>(text.size() - start), static_cast<uint32_t>(visible)};
+                }
+            };
+            if (chunks == 1) {
+                render_chunk(0);
+            } else {
+                pool->parallel_for(0, chunks, 1, [&](size_t lo, size_t hi) {
+                    for (size_t c = lo; c < hi; ++c) render_chunk(c);
+                });
+            }
+        }
+
+        /// @brief Display string of sorted position `pos` (after render()).
+        std::string_view display(size_t pos) const {
+            const Cell& cell = cells_[pos];
+            return std::string_view(chunk_text_[cell.chunk].data() + cell.offset, cell.length);
+        }
+        size_t visible_len(size_t pos) const { return cells_[pos].visible; }
+
+    private:
+        /// @brief Entries per render chunk below which rendering stays on the calling thread.
+        static constexpr size_t RENDER_CHUNK_MIN = 2048;
+
+        struct Span {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        /// @brief Sort record: everything the comparator needs before falling back to the arena.
+        struct Row {
+            uint64_t key = 0;       ///< Size, rows or type priority (per LSOrder::key)
+            uint64_t prefix = 0;    ///< First 8 name bytes, big-endian (orders like memcmp)
+            uint32_t index = 0;     ///< Insertion index; final tie-break
+            uint8_t group = 0;      ///< 0 = directory (or dirs_first off), 1 = file
+        };
+
+        struct Cell {
+            uint32_t chunk;
+            uint32_t offset;
+            uint32_t length;
+            uint32_t visible;
+        };
+
+        static uint64_t name_prefix(std::string_view name) {
+            uint64_t prefix = 0;
+            const size_t n = std::min<size_t>(8, name.size());
+            for (size_t i = 0; i < 8; ++i) {
+                prefix = (prefix << 8) | (i < n ? static_cast<unsigned char>(name[i]) : 0u);
+            }
+            return prefix;
+        }
+
+        /// @brief Three-way name comparison with std::string::compare semantics.
+        int compare_names(const Row& a, const Row& b) const {
+            if (a.prefix != b.prefix) return a.prefix < b.prefix ? -1 : 1;
+            const Span& sa = spans_[a.index];
+            const Span& sb = spans_[b.index];
+            if (sa.length <= 8 || sb.length <= 8) {
+                // Names contain no NUL, so equal prefixes of a short name mean equal names up to its end
+                return sa.length == sb.length ? 0 : (sa.length < sb.length ? -1 : 1);
+            }
+            const size_t common = std::min(sa.length, sb.length) - 8;
+            int cmp = std::memcmp(names_.data() + sa.offset + 8, names_.data() + sb.offset + 8, common);
+            if (cmp != 0) return cmp;
+            return sa.length == sb.length ? 0 : (sa.length < sb.length ? -1 : 1);
+        }
+
+        std::string names_;                     ///< NUL-terminated names, back to back
+        std::vector<Span> spans_;               ///< Per insertion index
+        std::vector<Row> rows_;                 ///< Sorted entries
+        std::vector<Row> merge_tmp_;            ///< Merge target of the parallel sort
+        std::vector<std::string> chunk_text_;   ///< Rendered display strings
+        std::vector<Cell> cells_;               ///< Per sorted position
+    };
+}
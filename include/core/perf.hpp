@@ -0,0 +1,343 @@
+/**
+ * @file perf.hpp
+ * @brief Always-on latency counters for the ls / :db / remote stages (`:perf`).
+ * * Each thread records into its own slot: a count, a sum, a max and a log-linear
+ *   histogram per stage (4 sub-buckets per power of two, ~12% resolution). Slots
+ *   have a single writer, so recording is two steady_clock reads plus a few plain
+ *   relaxed stores: no locks, no atomic read-modify-write, no shared cache lines.
+ * * Readers (`:perf`, the exit dump) sum all slots under the registry mutex, which
+ *   is only taken by readers and by threads registering or exiting.
+ * * Reset bumps a generation counter; each writer clears its own slot the next
+ *   time it records, and readers skip slots still on an older generation.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dais::core::utils {
+
+    /// @brief Instrumented stages. Keep STAGE_NAMES in the same order.
+    enum class PerfStage : uint8_t {
+        LS_ENUMERATE,      ///< Directory enumeration (getdents64 / getattrlistbulk)
+        LS_QUEUE,          ///< Analysis chunk waiting in the pool before it starts
+        LS_ANALYZE,        ///< Per entry: stat + analyze_path (cache hit or content scan)
+        LS_SORT,           ///< ListingCore::sort (ls_listing.hpp)
+        LS_LAYOUT,         ///< Grid layout of the sorted cells
+        LS_GIT,            ///< Git annotations: index lookup + work tree lstat()s
+        LS_TOTAL,          ///< Whole local ls, from interception to output written
+        REMOTE_ROUNDTRIP,  ///< Command sent over SSH until the capture sentinel arrived
+        REMOTE_RENDER,     ///< Parsing + rendering the agent payload
+        REMOTE_LS_TOTAL,   ///< Whole remote ls
+        DB_QUERY_COLD,     ///< :db query that opened a connection (first, new source, replaced, remote)
+        DB_QUERY_WARM,     ///< Local :db query served by a reused pooled connection
+        DB_RENDER,         ///< Streamed result to table / pager file
+        DB_TOTAL,          ///< Whole :db command
+        HOOK_QUEUE,        ///< Plugin event waiting for the Python worker
+        HOOK_SYNC,         ///< Synchronous plugin hooks run on the input thread
+        COUNT
+    };
+
+    inline constexpr std::array<const char*, static_cast<size_t>(PerfStage::COUNT)> STAGE_NAMES = {
+        "ls.enumerate", "ls.queue", "ls.analyze", "ls.sort", "ls.layout", "ls.git", "ls.total",
+        "remote.roundtrip", "remote.render", "remote.ls_total",
+        "db.query_cold", "db.query_warm", "db.render", "db.total",
+        "hook.queue", "hook.sync",
+    };
+
+    /// @brief Aggregated view of one stage.
+    struct PerfSummary {
+        const char* name = "";
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t p50_ns = 0, p90_ns = 0, p99_ns = 0;
+    };
+
+    class PerfCounters {
+    public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr size_t STAGES = static_cast<size_t>(PerfStage::COUNT);
+        static constexpr size_t BUCKETS = 168; ///< Up to 2^42 ns (~73 min)
+
+        /// @brief Process-wide registry (never destroyed, so late threads can still record).
+        static PerfCounters& instance() {
+            static PerfCounters* counters = new PerfCounters();
+            return *counters;
+        }
+
+        void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+        bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+        /// @brief Records one sample for `stage` on the calling thread's slot.
+        void record(PerfStage stage, Clock::duration elapsed) {
+            if (!enabled()) return;
+            Slot& slot = local_slot();
+            uint64_t gen = generation_.load(std::memory_order_acquire);
+            if (slot.generation.load(std::memory_order_relaxed) != gen) {
+                slot.clear();
+                slot.generation.store(gen, std::memory_order_release);
+            }
+            uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 0));
+            Counters& c = slot.stages[static_cast<size_t>(stage)];
+            bump(c.count, 1);
+            bump(c.total_ns, ns);
+            if (ns > c.max_ns.load(std::memory_order_relaxed)) c.max_ns.store(ns, std::memory_order_relaxed);
+            bump(c.buckets[bucket_of(ns)], 1);
+        }
+
+        /// @brief Sums every thread's slot. Stages without samples are omitted.
+        std::vector<PerfSummary> snapshot() const {
+            std::array<Totals, STAGES> totals{};
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                uint64_t gen = generation_.load(std::memory_order_acquire);
+                add_slot(totals, retired_, gen);
+                for (const Slot* slot : live_) add_slot(totals, *slot, gen);
+            }
+
+            std::vector<PerfSummary> out;
+            for (size_t s = 0; s < STAGES; ++s) {
+                const Totals& t = totals[s];
+                if (t.count == 0) continue;
+                PerfSummary sum;
+                sum.name = STAGE_NAMES[s];
+                sum.count = t.count;
+                sum.total_ns = t.total_ns;
+                sum.max_ns = t.max_ns;
+                sum.p50_ns = std::min(percentile(t, 0.50), t.max_ns);
+                sum.p90_ns = std::min(percentile(t, 0.90), t.max_ns);
+                sum.p99_ns = std::min(percentile(t, 0.99), t.max_ns);
+                out.push_back(sum);
+            }
+            return out;
+        }
+
+        /// @brief Starts a new measurement window (`:perf reset`).
+        void reset() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retired_.clear();
+            generation_.fetch_add(1, std::memory_order_acq_rel);
+            since_ = Clock::now();
+        }
+
+        /// @brief Seconds covered by the current window.
+        double window_seconds() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return std::chrono::duration<double>(Clock::now() - since_).count();
+        }
+
+        /// @brief Human-readable table for `:perf` (lines end with "\r\n").
+        std::string format_table() const {
+            std::vector<PerfSummary> rows = snapshot();
+            char line[160];
+            std::snprintf(line, sizeof(line), "Stage latencies over the last %.0fs:\r\n", window_seconds());
+            std::string out = line;
+            if (rows.empty()) return out + "  (no samples yet)\r\n";
+            std::snprintf(line, sizeof(line), "  %-18s %9s %10s %10s %10s %10s %10s\r\n",
+                          "stage", "count", "p50", "p90", "p99", "max", "total");
+            out += line;
+            for (const PerfSummary& r : rows) {
+                std::snprintf(line, sizeof(line), "  %-18s %9llu %10s %10s %10s %10s %10s\r\n", r.name,
+                              static_cast<unsigned long long>(r.count), fmt_ns(r.p50_ns).c_str(),
+                              fmt_ns(r.p90_ns).c_str(), fmt_ns(r.p99_ns).c_str(), fmt_ns(r.max_ns).c_str(),
+                              fmt_ns(r.total_ns).c_str());
+                out += line;
+            }
+            return out;
+        }
+
+        /**
+         * @brief Machine-readable dump:
+         * {"window_s": s, "stages": [{"name", "count", "total_ns", "max_ns", "p50_ns", "p90_ns", "p99_ns"}]}
+         */
+        std::string to_json() const {
+            std::vector<PerfSummary> rows = snapshot();
+            char buf[256];
+            std::snprintf(buf, sizeof(buf), "{\"window_s\": %.3f, \"stages\": [", window_seconds());
+            std::string out = buf;
+            for (size_t i = 0; i < rows.size(); ++i) {
+                const PerfSummary& r = rows[i];
+                std::snprintf(buf, sizeof(buf),
+                              "%s\n  {\"name\": \"%s\", \"count\": %llu, \"total_ns\": %llu, \"max_ns\": %llu, "
+                              "\"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu}",
+                              i ? "," : "", r.name, static_cast<unsigned long long>(r.count),
+                              static_cast<unsigned long long>(r.total_ns), static_cast<unsigned long long>(r.max_ns),
+                              static_cast<unsigned long long>(r.p50_ns), static_cast<unsigned long long>(r.p90_ns),
+                              static_cast<unsigned long long>(r.p99_ns));
+                out += buf;
+            }
+            out += "\n]}\n";
+            return out;
+        }
+
+        /// @brief Compact duration ("850ns", "12.3us", "4.5ms", "1.20s").
+        static std::string fmt_ns(uint64_t ns) {
+            char buf[32];
+            if (ns < 1000) std::snprintf(buf, sizeof(buf), "%lluns", static_cast<unsigned long long>(ns));
+            else if (ns < 1000000) std::snprintf(buf, sizeof(buf), "%.1fus", static_cast<double>(ns) / 1e3);
+            else if (ns < 1000000000) std::snprintf(buf, sizeof(buf), "%.1fms", static_cast<double>(ns) / 1e6);
+            else std::snprintf(buf, sizeof(buf), "%.2fs", static_cast<double>(ns) / 1e9);
+            return buf;
+        }
+
+        /// @brief Histogram bucket for a duration: exact below 4ns, then 4 per power of two.
+        static size_t bucket_of(uint64_t ns) {
+            if (ns < 4) return static_cast<size_t>(ns);
+            unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(ns));
+            size_t index = (msb - 1) * 4 + ((ns >> (msb - 2)) & 3);
+            return std::min(index, BUCKETS - 1);
+        }
+
+        /// @brief Midpoint of a bucket's range (the value reported for percentiles).
+        static uint64_t bucket_value(size_t index) {
+            if (index < 4) return index;
+            unsigned msb = static_cast<unsigned>(index / 4 + 1);
+            uint64_t width = 1ull << (msb - 2);
+            return (4 + index % 4) * width + width / 2;
+        }
+
+    private:
+        struct Counters {
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> total_ns{0};
+            std::atomic<uint64_t> max_ns{0};
+            std::array<std::atomic<uint32_t>, BUCKETS> buckets{};
+        };
+
+        struct Slot {
+            std::atomic<uint64_t> generation{0};
+            std::array<Counters, STAGES> stages{};
+
+            void clear() {
+                for (Counters& c : stages) {
+                    c.count.store(0, std::memory_order_relaxed);
+                    c.total_ns.store(0, std::memory_order_relaxed);
+                    c.max_ns.store(0, std::memory_order_relaxed);
+                    for (auto& b : c.buckets) b.store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        struct Totals {
+            uint64_t count = 0, total_ns = 0, max_ns = 0;
+            std::array<uint64_t, BUCKETS> buckets{};
+        };
+
+        /// @brief Owns the calling thread's slot; folds it into retired_ when the thread exits.
+        struct SlotHandle {
+            Slot* slot = nullptr;
+            ~SlotHandle() {
+                if (slot) PerfCounters::instance().retire(slot);
+            }
+        };
+
+        PerfCounters() = default;
+
+        /// @brief Single-writer increment: a relaxed load + store, no locked instruction.
+        template <class T, class V>
+        static void bump(std::atomic<T>& counter, V delta) {
+            counter.store(counter.load(std::memory_order_relaxed) + static_cast<T>(delta), std::memory_order_relaxed);
+        }
+
+        Slot& local_slot() {
+            thread_local SlotHandle handle;
+            if (!handle.slot) {
+                auto slot = std::make_unique<Slot>();
+                std::lock_guard<std::mutex> lock(mutex_);
+                slot->generation.store(generation_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                handle.slot = slot.get();
+                live_.push_back(slot.release());
+            }
+            return *handle.slot;
+        }
+
+        void retire(Slot* slot) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint64_t gen = generation_.load(std::memory_order_relaxed);
+            if (slot->generation.load(std::memory_order_relaxed) == gen) {
+                for (size_t s = 0; s < STAGES; ++s) {
+                    Counters& from = slot->stages[s];
+                    Counters& to = retired_.stages[s];
+                    bump(to.count, from.count.load(std::memory_order_relaxed));
+                    bump(to.total_ns, from.total_ns.load(std::memory_order_relaxed));
+                    uint64_t max = from.max_ns.load(std::memory_order_relaxed);
+                    if (max > to.max_ns.load(std::memory_order_relaxed)) to.max_ns.store(max, std::memory_order_relaxed);
+                    for (size_t b = 0; b < BUCKETS; ++b) bump(to.buckets[b], from.buckets[b].load(std::memory_order_relaxed));
+                }
+            }
+            live_.erase(std::remove(live_.begin(), live_.end(), slot), live_.end());
+            delete slot;
+        }
+
+        static void add_slot(std::array<Totals, STAGES>& totals, const Slot& slot, uint64_t gen) {
+            if (slot.generation.load(std::memory_order_acquire) != gen) return; // Not cleared since the reset
+            for (size_t s = 0; s < STAGES; ++s) {
+                const Counters& c = slot.stages[s];
+                Totals& t = totals[s];
+                t.count += c.count.load(std::memory_order_relaxed);
+                t.total_ns += c.total_ns.load(std::memory_order_relaxed);
+                t.max_ns = std::max(t.max_ns, c.max_ns.load(std::memory_order_relaxed));
+                for (size_t b = 0; b < BUCKETS; ++b) t.buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+
+        static uint64_t percentile(const Totals& t, double q) {
+            // Bucket counts are read one by one while writers keep going; rank against their own sum
+            uint64_t in_buckets = 0;
+            for (uint64_t n : t.buckets) in_buckets += n;
+            if (in_buckets == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(in_buckets - 1));
+            uint64_t seen = 0;
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                seen += t.buckets[b];
+                if (seen > rank) return bucket_value(b);
+            }
+            return bucket_value(BUCKETS - 1);
+        }
+
+        std::atomic<bool> enabled_{true};
+        std::atomic<uint64_t> generation_{0};
+        mutable std::mutex mutex_;            ///< Guards live_, retired_ and since_
+        std::vector<Slot*> live_;             ///< Slots of running threads (owned, freed on thread exit)
+        Slot retired_;                        ///< Samples of threads that have exited
+        Clock::time_point since_ = Clock::now();
+    };
+
+    /// @brief Records the lifetime of the scope into a stage.
+    class PerfTimer {
+    public:
+        explicit PerfTimer(PerfStage stage) : stage_(stage), stopped_(!PerfCounters::instance().enabled()) {
+            if (!stopped_) start_ = PerfCounters::Clock::now();
+        }
+        ~PerfTimer() { stop(); }
+
+        PerfTimer(const PerfTimer&) = delete;
+        PerfTimer& operator=(const PerfTimer&) = delete;
+
+        /// @brief Records now instead of at scope exit (once).
+        void stop() {
+            if (stopped_) return;
+            stopped_ = true;
+            PerfCounters::instance().record(stage_, PerfCounters::Clock::now() - start_);
+        }
+
+        /// @brief Re-targets the sample (e.g. cold vs warm) before it is recorded.
+        void set_stage(PerfStage stage) { stage_ = stage; }
+
+    private:
+        PerfStage stage_;
+        bool stopped_;                        ///< Also set when counters are disabled (no clock reads)
+        PerfCounters::Clock::time_point start_;
+    };
+}
@@ -0,0 +1,176 @@
+/**
+ * @file prompt_matcher.hpp
+ * @brief Aho-Corasick matcher for shell prompts and pager markers in PTY output.
+ * * All patterns are compiled once (at config load) into a DFA over byte classes.
+ * Scanning costs one table lookup per byte regardless of how many prompts are
+ * configured, and the automaton state is carried across reads, so a prompt split
+ * between two read() calls is still recognised.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dais::core::utils {
+
+    class PromptMatcher {
+    public:
+        /// @brief Pattern groups (bitmask).
+        enum Group : uint8_t {
+            PROMPT = 1,  ///< Shell prompt suffixes (SHELL_PROMPTS)
+            PAGER  = 2   ///< Pager markers such as "--More--"
+        };
+
+        /// @brief Per-chunk summary returned by scan().
+        struct Result {
+            uint8_t anywhere = 0;       ///< Groups matched anywhere in the chunk
+            uint8_t since_newline = 0;  ///< Groups matched after the chunk's last '\n' (whole chunk if none)
+            uint8_t at_end = 0;         ///< Groups with a match ending on the chunk's last byte
+            bool had_newline = false;   ///< Chunk contained a '\n'
+        };
+
+        PromptMatcher() { build({}, {}); }
+
+        /**
+         * @brief Compiles the automaton. Empty patterns are ignored.
+         * Resets the stream state.
+         */
+        void build(const std::vector<std::string>& prompts, const std::vector<std::string>& pagers) {
+            // --- 1. Byte classes: one per distinct pattern byte, 0 for everything else ---
+            classes_.fill(0);
+            num_classes_ = 1;
+            auto classify = [this](const std::string& p) {
+                for (unsigned char c : p) {
+                    if (classes_[c] == 0) classes_[c] = static_cast<uint16_t>(num_classes_++);
+                }
+            };
+            for (const auto& p : prompts) classify(p);
+            for (const auto& p : pagers) classify(p);
+
+            // --- 2. Trie ---
+            std::vector<std::map<uint16_t, uint32_t>> children(1);
+            groups_.assign(1, 0);
+            shortest_prompt_.assign(1, 0);
+            auto insert = [&](const std::string& p, uint8_t group) {
+                if (p.empty()) return;
+                uint32_t node = 0;
+                for (unsigned char c : p) {
+                    uint16_t cls = classes_[c];
+                    auto it = children[node].find(cls);
+                    if (it == children[node].end()) {
+                        uint32_t id = static_cast<uint32_t>(children.size());
+                        children[node][cls] = id;
+                        children.emplace_back();
+                        groups_.push_back(0);
+                        shortest_prompt_.push_back(0);
+                        node = id;
+                    } else {
+                        node = it->second;
+                    }
+                }
+                groups_[node] |= group;
+                if (group == PROMPT) {
+                    uint32_t len = static_cast<uint32_t>(p.size());
+                    if (shortest_prompt_[node] == 0 || len < shortest_prompt_[node]) shortest_prompt_[node] = len;
+                }
+            };
+            for (const auto& p : prompts) insert(p, PROMPT);
+            for (const auto& p : pagers) insert(p, PAGER);
+
+            // --- 3. Failure links folded into a full DFA (BFS order) ---
+            const size_t states = children.size();
+            next_.assign(states * num_classes_, 0);
+            std::vector<uint32_t> fail(states, 0);
+            std::deque<uint32_t> queue;
+            for (const auto& [cls, child] : children[0]) {
+                next_[cls] = child;
+                queue.push_back(child);
+            }
+            while (!queue.empty()) {
+                uint32_t node = queue.front();
+                queue.pop_front();
+                // Inherit outputs of the longest proper suffix that is also a trie node
+                groups_[node] |= groups_[fail[node]];
+                uint32_t inherited = shortest_prompt_[fail[node]];
+                if (inherited && (shortest_prompt_[node] == 0 || inherited < shortest_prompt_[node])) {
+                    shortest_prompt_[node] = inherited;
+                }
+                for (size_t cls = 0; cls < num_classes_; ++cls) {
+                    auto it = children[node].find(static_cast<uint16_t>(cls));
+                    if (it != children[node].end()) {
+                        fail[it->second] = next_[fail[node] * num_classes_ + cls];
+                        next_[node * num_classes_ + cls] = it->second;
+                        queue.push_back(it->second);
+                    } else {
+                        next_[node * num_classes_ + cls] = next_[fail[node] * num_classes_ + cls];
+                    }
+                }
+            }
+            state_ = 0;
+        }
+
+        /// @brief Forgets partial matches (e.g. after output was diverted elsewhere).
+        void reset() { state_ = 0; }
+
+        /**
+         * @brief Feeds one chunk of the output stream (state carries over to the next call).
+         * Single pass, one table lookup per byte.
+         */
+        Result scan(std::string_view chunk) {
+            Result r;
+            uint32_t s = state_;
+            const uint32_t* table = next_.data();
+            const size_t width = num_classes_;
+            for (unsigned char c : chunk) {
+                s = table[s * width + classes_[c]];
+                uint8_t g = groups_[s];
+                if (c == '\n') {
+                    r.had_newline = true;
+                    r.since_newline = 0;
+                }
+                r.anywhere |= g;
+                r.since_newline |= g;
+            }
+            if (!chunk.empty()) r.at_end = groups_[s];
+            state_ = s;
+            return r;
+        }
+
+        /**
+         * @brief Finds the rightmost-starting prompt occurrence in `text` (stateless).
+         * @param pos Receives the start offset of the prompt.
+         * @param len Receives the prompt length.
+         * @return false if no prompt occurs in text.
+         */
+        bool find_last_prompt(std::string_view text, size_t& pos, size_t& len) const {
+            bool found = false;
+            uint32_t s = 0;
+            for (size_t i = 0; i < text.size(); ++i) {
+                s = next_[s * num_classes_ + classes_[static_cast<unsigned char>(text[i])]];
+                uint32_t shortest = shortest_prompt_[s];
+                if (shortest == 0) continue;
+                size_t start = i + 1 - shortest;
+                if (!found || start > pos) {
+                    pos = start;
+                    len = shortest;
+                    found = true;
+                }
+            }
+            return found;
+        }
+
+    private:
+        std::array<uint16_t, 256> classes_{};    ///< Byte -> class (0 = not in any pattern)
+        size_t num_classes_ = 1;
+        std::vector<uint32_t> next_;             ///< DFA: next_[state * num_classes_ + class]
+        std::vector<uint8_t> groups_;            ///< Groups matched when entering a state
+        std::vector<uint32_t> shortest_prompt_;  ///< Shortest prompt ending at a state (0 = none)
+        uint32_t state_ = 0;                     ///< Stream position for scan()
+    };
+}
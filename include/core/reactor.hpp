@@ -0,0 +1,383 @@
+/**
+ * @file reactor.hpp
+ * @brief Header-only readiness event loop (epoll on Linux, kqueue on macOS/BSD, poll elsewhere).
+ * * A Reactor multiplexes file descriptors, one-shot timers and POSIX signals
+ * (delivered through a self-pipe, so handlers run in normal thread context, not
+ * in the signal handler). run_once() blocks until something is ready, so an idle
+ * session causes no wakeups at all.
+ * * Threading: watch/unwatch/add_timer/run_once belong to the thread that runs the
+ * loop; wake() may be called from any thread or from a signal handler.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define DAIS_REACTOR_EPOLL 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <sys/event.h>
+#include <sys/time.h>
+#define DAIS_REACTOR_KQUEUE 1
+#endif
+
+namespace dais::core::utils {
+
+    namespace detail {
+        /// @brief Creates a non-blocking, close-on-exec pipe.
+        inline bool make_pipe(int fds[2]) {
+            if (::pipe(fds) != 0) return false;
+            for (int i = 0; i < 2; ++i) {
+                ::fcntl(fds[i], F_SETFL, ::fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+                ::fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+            }
+            return true;
+        }
+
+        /// @brief Process-wide self-pipe carrying signal numbers (one byte per delivery).
+        inline int* signal_pipe() {
+            static int fds[2] = {-1, -1};
+            return fds;
+        }
+
+        inline void on_signal(int signo) {
+            int saved_errno = errno;
+            unsigned char byte = static_cast<unsigned char>(signo);
+            [[maybe_unused]] ssize_t r = ::write(signal_pipe()[1], &byte, 1);
+            errno = saved_errno;
+        }
+    }
+
+    class Reactor {
+    public:
+        /// @brief Readiness bits passed to watch() and reported to handlers.
+        enum Events : unsigned {
+            READABLE = 1,
+            WRITABLE = 2,
+            HANGUP   = 4,  ///< Peer closed (reported even if not requested)
+            ERROR    = 8   ///< fd error (reported even if not requested)
+        };
+
+        using Handler = std::function<void(unsigned events)>;
+        using TimerHandler = std::function<void()>;
+        using TimerId = uint64_t;
+
+        Reactor() {
+#if defined(DAIS_REACTOR_EPOLL)
+            backend_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+#elif defined(DAIS_REACTOR_KQUEUE)
+            backend_fd_ = ::kqueue();
+            if (backend_fd_ >= 0) ::fcntl(backend_fd_, F_SETFD, FD_CLOEXEC);
+#endif
+            if (detail::make_pipe(wake_pipe_)) {
+                watch(wake_pipe_[0], READABLE, [this](unsigned) { drain(wake_pipe_[0]); });
+            }
+        }
+
+        ~Reactor() {
+            if (backend_fd_ >= 0) ::close(backend_fd_);
+            for (int fd : wake_pipe_) if (fd >= 0) ::close(fd);
+        }
+
+        Reactor(const Reactor&) = delete;
+        Reactor& operator=(const Reactor&) = delete;
+
+        /**
+         * @brief Starts watching fd for the given readiness bits (replaces an existing watch).
+         * @return false if the backend rejected the fd.
+         */
+        bool watch(int fd, unsigned events, Handler handler) {
+            if (fd < 0) return false;
+            bool existing = watches_.count(fd) > 0;
+            if (!backend_add(fd, events, existing)) return false;
+            watches_[fd] = Watch{events, std::make_shared<Handler>(std::move(handler))};
+            return true;
+        }
+
+        void unwatch(int fd) {
+            auto it = watches_.find(fd);
+            if (it == watches_.end()) return;
+            backend_remove(fd, it->second.events);
+            watches_.erase(it);
+        }
+
+        /// @brief Runs handler once, `delay` from now (on the loop thread).
+        TimerId add_timer(std::chrono::milliseconds delay, TimerHandler handler) {
+            TimerId id = ++next_timer_id_;
+            auto due = std::chrono::steady_clock::now() + delay;
+            timers_.emplace(std::make_pair(due, id), std::move(handler));
+            timer_index_.emplace(id, due);
+            return id;
+        }
+
+        void cancel_timer(TimerId id) {
+            auto it = timer_index_.find(id);
+            if (it == timer_index_.end()) return;
+            timers_.erase(std::make_pair(it->second, id));
+            timer_index_.erase(it);
+        }
+
+        /**
+         * @brief Routes a POSIX signal into this loop (SA_RESTART, handler runs from run_once()).
+         * Only one Reactor per process should own signals.
+         */
+        bool watch_signal(int signo, std::function<void()> handler) {
+            int* sp = detail::signal_pipe();
+            if (sp[0] < 0) {
+                if (!detail::make_pipe(sp)) return false;
+            }
+            if (!watches_.count(sp[0])) {
+                watch(sp[0], READABLE, [this, sp](unsigned) {
+                    // Several deliveries of one signal between two loop turns run the handler once
+                    std::array<unsigned char, 64> buf;
+                    std::array<bool, 256> pending{};
+                    ssize_t n;
+                    while ((n = ::read(sp[0], buf.data(), buf.size())) > 0) {
+                        for (ssize_t i = 0; i < n; ++i) pending[buf[i]] = true;
+                    }
+                    for (auto& [signo, fn] : signal_handlers_) {
+                        if (pending[static_cast<unsigned char>(signo)]) fn();
+                    }
+                });
+            }
+            signal_handlers_[signo] = std::move(handler);
+
+            struct sigaction sa{};
+            sa.sa_handler = detail::on_signal;
+            sigemptyset(&sa.sa_mask);
+            sa.sa_flags = SA_RESTART;
+            return ::sigaction(signo, &sa, nullptr) == 0;
+        }
+
+        /// @brief Interrupts a blocked run_once() (thread- and async-signal-safe).
+        void wake() {
+            if (wake_pipe_[1] < 0) return;
+            unsigned char byte = 1;
+            [[maybe_unused]] ssize_t r = ::write(wake_pipe_[1], &byte, 1);
+        }
+
+        /**
+         * @brief Waits for readiness (or the next timer) and dispatches handlers.
+         * @param timeout_ms Maximum wait; -1 blocks until an event or timer fires.
+         * @return Number of fd events dispatched (0 on timeout/wake/timer only), -1 on error.
+         */
+        int run_once(int timeout_ms = -1) {
+            int wait_ms = timeout_until_next_timer(timeout_ms);
+            std::vector<std::pair<int, unsigned>>& ready = ready_;
+            ready.clear();
+            if (!backend_wait(wait_ms, ready)) return -1;
+
+            int dispatched = 0;
+            for (const auto& [fd, ev] : ready) {
+                auto it = watches_.find(fd);
+                if (it == watches_.end()) continue; // Unwatched by an earlier handler
+                auto handler = it->second.handler;  // Keep alive if the handler unwatches itself
+                (*handler)(ev);
+                if (fd != wake_pipe_[0]) ++dispatched;
+            }
+            run_due_timers();
+            return dispatched;
+        }
+
+        /**
+         * @brief One-shot readiness wait on a single fd (no Reactor needed).
+         * @return Ready bits (READABLE/WRITABLE/HANGUP/ERROR), 0 on timeout or error.
+         */
+        static unsigned wait_fd(int fd, unsigned events, int timeout_ms) {
+            struct pollfd pfd{};
+            pfd.fd = fd;
+            pfd.events = to_poll(events);
+            while (true) {
+                int ret = ::poll(&pfd, 1, timeout_ms);
+                if (ret < 0 && errno == EINTR) continue; // Retry (a resize signal, usually)
+                if (ret <= 0) return 0;
+                return from_poll(pfd.revents);
+            }
+        }
+
+    private:
+        struct Watch {
+            unsigned events = 0;
+            std::shared_ptr<Handler> handler;
+        };
+
+        static short to_poll(unsigned events) {
+            short out = 0;
+            if (events & READABLE) out |= POLLIN;
+            if (events & WRITABLE) out |= POLLOUT;
+            return out;
+        }
+
+        static unsigned from_poll(short revents) {
+            unsigned out = 0;
+            if (revents & POLLIN) out |= READABLE;
+            if (revents & POLLOUT) out |= WRITABLE;
+            if (revents & POLLHUP) out |= HANGUP;
+            if (revents & (POLLERR | POLLNVAL)) out |= ERROR;
+            return out;
+        }
+
+        static void drain(int fd) {
+            std::array<char, 64> buf;
+            while (::read(fd, buf.data(), buf.size()) > 0) {}
+        }
+
+        int timeout_until_next_timer(int timeout_ms) const {
+            if (timers_.empty()) return timeout_ms;
+            auto now = std::chrono::steady_clock::now();
+            auto due = timers_.begin()->first.first;
+            long long ms = 0;
+            if (due > now) {
+                // Round up so we never wake just before the deadline and spin
+                ms = std::chrono::duration_cast<std::chrono::milliseconds>(due - now + std::chrono::microseconds(999)).count();
+            }
+            if (timeout_ms < 0 || ms < timeout_ms) return static_cast<int>(ms);
+            return timeout_ms;
+        }
+
+        void run_due_timers() {
+            auto now = std::chrono::steady_clock::now();
+            while (!timers_.empty() && timers_.begin()->first.first <= now) {
+                auto node = timers_.extract(timers_.begin());
+                timer_index_.erase(node.key().second);
+                node.mapped()(); // May add or cancel timers
+            }
+        }
+
+        // --- BACKENDS ---
+
+#if defined(DAIS_REACTOR_EPOLL)
+        bool backend_add(int fd, unsigned events, bool existing) {
+            if (backend_fd_ < 0) return false;
+            struct epoll_event ev{};
+            ev.events = (events & READABLE ? EPOLLIN : 0u) | (events & WRITABLE ? EPOLLOUT : 0u);
+            ev.data.fd = fd;
+            if (::epoll_ctl(backend_fd_, existing ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) == 0) {
+                always_ready_.erase(fd);
+                return true;
+            }
+            // Regular files cannot be epolled (EPERM) but are always ready
+            if (errno == EPERM) {
+                always_ready_[fd] = events;
+                return true;
+            }
+            return false;
+        }
+
+        void backend_remove(int fd, unsigned) {
+            if (always_ready_.erase(fd)) return;
+            ::epoll_ctl(backend_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        }
+
+        bool backend_wait(int timeout_ms, std::vector<std::pair<int, unsigned>>& ready) {
+            if (!always_ready_.empty()) {
+                for (const auto& [fd, events] : always_ready_) ready.emplace_back(fd, events);
+                timeout_ms = 0;
+            }
+            std::array<struct epoll_event, 32> events;
+            int n = ::epoll_wait(backend_fd_, events.data(), static_cast<int>(events.size()), timeout_ms);
+            if (n < 0) return errno == EINTR;
+            for (int i = 0; i < n; ++i) {
+                unsigned ev = 0;
+                if (events[i].events & EPOLLIN) ev |= READABLE;
+                if (events[i].events & EPOLLOUT) ev |= WRITABLE;
+                if (events[i].events & (EPOLLHUP | EPOLLRDHUP)) ev |= HANGUP;
+                if (events[i].events & EPOLLERR) ev |= ERROR;
+                int fd = events[i].data.fd;
+                ready.emplace_back(fd, ev);
+            }
+            return true;
+        }
+
+        std::unordered_map<int, unsigned> always_ready_;
+#elif defined(DAIS_REACTOR_KQUEUE)
+        bool backend_add(int fd, unsigned events, bool existing) {
+            if (backend_fd_ < 0) return false;
+            if (existing) backend_remove(fd, watches_[fd].events);
+            struct kevent changes[2];
+            int n = 0;
+            if (events & READABLE) EV_SET(&changes[n++], fd, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+            if (events & WRITABLE) EV_SET(&changes[n++], fd, EVFILT_WRITE, EV_ADD, 0, 0, nullptr);
+            return ::kevent(backend_fd_, changes, n, nullptr, 0, nullptr) == 0;
+        }
+
+        void backend_remove(int fd, unsigned events) {
+            struct kevent changes[2];
+            int n = 0;
+            if (events & READABLE) EV_SET(&changes[n++], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+            if (events & WRITABLE) EV_SET(&changes[n++], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+            ::kevent(backend_fd_, changes, n, nullptr, 0, nullptr);
+        }
+
+        bool backend_wait(int timeout_ms, std::vector<std::pair<int, unsigned>>& ready) {
+            struct timespec ts{};
+            struct timespec* tsp = nullptr;
+            if (timeout_ms >= 0) {
+                ts.tv_sec = timeout_ms / 1000;
+                ts.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+                tsp = &ts;
+            }
+            std::array<struct kevent, 32> events;
+            int n = ::kevent(backend_fd_, nullptr, 0, events.data(), static_cast<int>(events.size()), tsp);
+            if (n < 0) return errno == EINTR;
+            for (int i = 0; i < n; ++i) {
+                int fd = static_cast<int>(events[i].ident);
+                unsigned ev = 0;
+                if (events[i].filter == EVFILT_READ) ev |= READABLE;
+                if (events[i].filter == EVFILT_WRITE) ev |= WRITABLE;
+                if (events[i].flags & EV_EOF) ev |= HANGUP;
+                if (events[i].flags & EV_ERROR) ev |= ERROR;
+                // Read and write filters report separately: merge per fd
+                auto it = std::find_if(ready.begin(), ready.end(), [fd](const auto& r) { return r.first == fd; });
+                if (it != ready.end()) it->second |= ev;
+                else ready.emplace_back(fd, ev);
+            }
+            return true;
+        }
+#else
+        bool backend_add(int, unsigned, bool) { return true; }
+        void backend_remove(int, unsigned) {}
+
+        bool backend_wait(int timeout_ms, std::vector<std::pair<int, unsigned>>& ready) {
+            std::vector<struct pollfd> pfds;
+            pfds.reserve(watches_.size());
+            for (const auto& [fd, w] : watches_) {
+                struct pollfd p{};
+                p.fd = fd;
+                p.events = to_poll(w.events);
+                pfds.push_back(p);
+            }
+            int n = ::poll(pfds.data(), pfds.size(), timeout_ms);
+            if (n < 0) return errno == EINTR;
+            for (const auto& p : pfds) {
+                if (p.revents) ready.emplace_back(p.fd, from_poll(p.revents));
+            }
+            return true;
+        }
+#endif
+
+        int backend_fd_ = -1;
+        int wake_pipe_[2] = {-1, -1};
+        std::unordered_map<int, Watch> watches_;
+        std::unordered_map<int, std::function<void()>> signal_handlers_;
+        std::map<std::pair<std::chrono::steady_clock::time_point, TimerId>, TimerHandler> timers_;
+        std::unordered_map<TimerId, std::chrono::steady_clock::time_point> timer_index_;
+        TimerId next_timer_id_ = 0;
+        std::vector<std::pair<int, unsigned>> ready_;  ///< Reused per run_once()
+    };
+}
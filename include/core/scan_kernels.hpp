@@ -0,0 +1,272 @@
+/**
+ * @file scan_kernels.hpp
+ * @brief Vectorized line/delimiter scanning kernels used by analyze_path().
+ * * Counts newlines, tracks the longest newline-terminated line and counts
+ * delimiters on the first line, a whole SIMD block at a time. Block-level
+ * compares produce a bitmask of newline positions; only set bits are visited,
+ * so the cost scales with the number of lines rather than the number of bytes.
+ * * Kernels: AVX2 / SSE2 on x86_64 (selected at runtime), NEON on aarch64 and
+ * armv7 builds with NEON enabled, and a portable scalar fallback. All kernels
+ * produce bit-identical results.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DAIS_SCAN_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DAIS_SCAN_NEON 1
+#endif
+
+namespace dais::utils::scan {
+
+    /**
+     * @brief Resumable scan state. Feed consecutive chunks of one file through scan().
+     * Width and delimiter results follow analyze_path() semantics:
+     * only newline-terminated lines count towards max_line, and delimiters
+     * are only counted before the first newline.
+     */
+    struct LineScan {
+        // --- Options (set before the first chunk) ---
+        char delimiter = ',';       ///< Column separator for data files
+        bool count_delims = false;  ///< Count delimiters on the first line (data files)
+        bool track_width = true;    ///< Track the longest line (text files)
+
+        // --- Results ---
+        size_t newlines = 0;        ///< Number of '\n' bytes seen
+        size_t max_line = 0;        ///< Longest '\n'-terminated line, in bytes
+        size_t first_delims = 0;    ///< Delimiters before the first '\n'
+        bool first_done = false;    ///< True once the first '\n' was seen
+
+        // --- Carry between chunks ---
+        size_t carry = 0;           ///< Length of the unterminated line in progress (track_width only)
+    };
+
+    /// @brief Function table for one kernel implementation.
+    struct KernelOps {
+        const char* name;
+        /// Counts newlines and updates max_line/carry over [p, p+n).
+        void (*lines)(const char* p, size_t n, LineScan& st);
+        /// Counts occurrences of byte c in [p, p+n).
+        size_t (*count)(const char* p, size_t n, char c);
+    };
+
+    namespace detail {
+        // Shared per-newline bookkeeping; plain inline so it inlines into target-specific kernels.
+        inline void on_newline(size_t pos, size_t& line_start, size_t& carry, size_t& max_line) {
+            size_t len = carry + (pos - line_start);
+            if (len > max_line) max_line = len;
+            carry = 0;
+            line_start = pos + 1;
+        }
+
+        inline void lines_tail(const char* p, size_t i, size_t n, size_t& line_start,
+                               size_t& carry, size_t& max_line, size_t& newlines) {
+            for (; i < n; ++i) {
+                if (p[i] == '\n') {
+                    on_newline(i, line_start, carry, max_line);
+                    ++newlines;
+                }
+            }
+        }
+
+        // --- Scalar (reference) ---
+        inline void lines_scalar(const char* p, size_t n, LineScan& st) {
+            size_t line_start = 0, carry = st.carry, max_line = st.max_line, newlines = 0;
+            lines_tail(p, 0, n, line_start, carry, max_line, newlines);
+            st.newlines += newlines;
+            st.max_line = max_line;
+            st.carry = carry + (n - line_start);
+        }
+
+        inline size_t count_scalar(const char* p, size_t n, char c) {
+            size_t count = 0;
+            for (size_t i = 0; i < n; ++i) count += (p[i] == c);
+            return count;
+        }
+
+#if defined(DAIS_SCAN_X86)
+        // --- SSE2 (baseline on x86_64) ---
+        __attribute__((target("sse2")))
+        inline void lines_sse2(const char* p, size_t n, LineScan& st) {
+            size_t line_start = 0, carry = st.carry, max_line = st.max_line, newlines = 0;
+            const __m128i nl = _mm_set1_epi8('\n');
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+                while (m) {
+                    on_newline(i + __builtin_ctz(m), line_start, carry, max_line);
+                    ++newlines;
+                    m &= m - 1;
+                }
+            }
+            lines_tail(p, i, n, line_start, carry, max_line, newlines);
+            st.newlines += newlines;
+            st.max_line = max_line;
+            st.carry = carry + (n - line_start);
+        }
+
+        __attribute__((target("sse2")))
+        inline size_t count_sse2(const char* p, size_t n, char c) {
+            const __m128i needle = _mm_set1_epi8(c);
+            size_t count = 0, i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                count += __builtin_popcount(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle))));
+            }
+            return count + count_scalar(p + i, n - i, c);
+        }
+
+        // --- AVX2 (runtime-detected) ---
+        __attribute__((target("avx2")))
+        inline void lines_avx2(const char* p, size_t n, LineScan& st) {
+            size_t line_start = 0, carry = st.carry, max_line = st.max_line, newlines = 0;
+            const __m256i nl = _mm256_set1_epi8('\n');
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+                while (m) {
+                    on_newline(i + __builtin_ctz(m), line_start, carry, max_line);
+                    ++newlines;
+                    m &= m - 1;
+                }
+            }
+            lines_tail(p, i, n, line_start, carry, max_line, newlines);
+            st.newlines += newlines;
+            st.max_line = max_line;
+            st.carry = carry + (n - line_start);
+        }
+
+        __attribute__((target("avx2")))
+        inline size_t count_avx2(const char* p, size_t n, char c) {
+            const __m256i needle = _mm256_set1_epi8(c);
+            size_t count = 0, i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                count += __builtin_popcount(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle))));
+            }
+            return count + count_scalar(p + i, n - i, c);
+        }
+#endif
+
+#if defined(DAIS_SCAN_NEON)
+        // --- NEON (aarch64 / armv7+neon) ---
+        // NEON has no movemask; narrowing the compare result by 4 bits yields a
+        // 64-bit mask with one nibble per byte. Keeping only the top bit of each
+        // nibble gives one set bit per match at position 4*i+3.
+        inline uint64_t neon_mask(const char* p, uint8x16_t needle) {
+            uint8x16_t eq = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(p)), needle);
+            uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+            return vget_lane_u64(vreinterpret_u64_u8(nib), 0) & 0x8888888888888888ULL;
+        }
+
+        inline void lines_neon(const char* p, size_t n, LineScan& st) {
+            size_t line_start = 0, carry = st.carry, max_line = st.max_line, newlines = 0;
+            const uint8x16_t nl = vdupq_n_u8('\n');
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                uint64_t m = neon_mask(p + i, nl);
+                while (m) {
+                    on_newline(i + (__builtin_ctzll(m) >> 2), line_start, carry, max_line);
+                    ++newlines;
+                    m &= m - 1;
+                }
+            }
+            lines_tail(p, i, n, line_start, carry, max_line, newlines);
+            st.newlines += newlines;
+            st.max_line = max_line;
+            st.carry = carry + (n - line_start);
+        }
+
+        inline size_t count_neon(const char* p, size_t n, char c) {
+            const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+            size_t count = 0, i = 0;
+            for (; i + 16 <= n; i += 16) count += __builtin_popcountll(neon_mask(p + i, needle));
+            return count + count_scalar(p + i, n - i, c);
+        }
+#endif
+
+        // Newline count only (data files don't need widths)
+        inline void count_lines(const KernelOps& ops, const char* p, size_t n, LineScan& st) {
+            st.newlines += ops.count(p, n, '\n');
+        }
+    }
+
+    inline constexpr KernelOps SCALAR_KERNEL{"scalar", detail::lines_scalar, detail::count_scalar};
+#if defined(DAIS_SCAN_X86)
+    inline constexpr KernelOps SSE2_KERNEL{"sse2", detail::lines_sse2, detail::count_sse2};
+    inline constexpr KernelOps AVX2_KERNEL{"avx2", detail::lines_avx2, detail::count_avx2};
+#endif
+#if defined(DAIS_SCAN_NEON)
+    inline constexpr KernelOps NEON_KERNEL{"neon", detail::lines_neon, detail::count_neon};
+#endif
+
+    /**
+     * @brief Picks the best kernel supported by the running CPU.
+     * DAIS_SCAN_KERNEL=scalar|sse2|avx2|neon forces a kernel (falls back if unsupported).
+     */
+    inline const KernelOps& select_kernel() {
+        std::string_view forced;
+        if (const char* env = std::getenv("DAIS_SCAN_KERNEL")) forced = env;
+        if (forced == "scalar") return SCALAR_KERNEL;
+
+#if defined(DAIS_SCAN_X86)
+        __builtin_cpu_init();
+        bool has_avx2 = __builtin_cpu_supports("avx2");
+        bool has_sse2 = __builtin_cpu_supports("sse2");
+        if (forced == "sse2" && has_sse2) return SSE2_KERNEL;
+        if (has_avx2) return AVX2_KERNEL;
+        if (has_sse2) return SSE2_KERNEL;
+#elif defined(DAIS_SCAN_NEON)
+        return NEON_KERNEL;
+#endif
+        return SCALAR_KERNEL;
+    }
+
+    /// @brief Kernel chosen for this process (resolved once, thread-safe).
+    inline const KernelOps& active_kernel() {
+        static const KernelOps& ops = select_kernel();
+        return ops;
+    }
+
+    /**
+     * @brief Scans one chunk of a file, updating the resumable state.
+     * @param p Chunk data.
+     * @param n Chunk length in bytes.
+     * @param st State carried across chunks of the same file.
+     * @param ops Kernel to use (defaults to the runtime-selected one).
+     */
+    inline void scan(const char* p, size_t n, LineScan& st, const KernelOps& ops = active_kernel()) {
+        size_t i = 0;
+
+        // First line: delimiters (data) and first width. memchr is already vectorized by libc.
+        if (!st.first_done) {
+            const void* hit = std::memchr(p, '\n', n);
+            size_t end = hit ? static_cast<size_t>(static_cast<const char*>(hit) - p) : n;
+            if (st.count_delims) st.first_delims += ops.count(p, end, st.delimiter);
+            if (!hit) {
+                st.carry += n;
+                return;
+            }
+            size_t first_len = st.carry + end;
+            if (first_len > st.max_line) st.max_line = first_len;
+            st.carry = 0;
+            st.newlines++;
+            st.first_done = true;
+            i = end + 1;
+        }
+
+        if (st.track_width) ops.lines(p + i, n - i, st);
+        else detail::count_lines(ops, p + i, n - i, st);
+    }
+}
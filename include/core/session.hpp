@@ -19,6 +19,13 @@ namespace dais::core {
         // Clean cleanup of file descriptors and processes
         void stop();
 
+        /**
+         * @brief Takes over an already-open PTY master instead of forking a shell.
+         * Used by the benchmarks to feed the output loop from a synthetic PTY.
+         * stop() closes the fd as usual; the caller owns the child process.
+         */
+        void adopt(int master_fd, pid_t child_pid);
+
         // Updates the PTY size (rows/cols) to match the physical window.
         // Handles "Safe Width" calculation for the logo injection.
         void resize(int rows, int cols, bool show_logo);
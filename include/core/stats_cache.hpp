@@ -0,0 +1,350 @@
+#pragma once
+
+#include "core/file_analyzer.hpp"
+#include <string>
+#include <filesystem>
+#include <unordered_map>
+#include <mutex>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string_view>
+#include <sys/stat.h>
+
+namespace dais::utils {
+
+    /**
+     * @brief Stat identity of a filesystem object (device + inode).
+     * Stable across renames, which is why it is used as the cache key instead of the path.
+     */
+    struct StatKey {
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+        bool operator==(const StatKey& o) const { return dev == o.dev && ino == o.ino; }
+    };
+
+    struct StatKeyHash {
+        size_t operator()(const StatKey& k) const noexcept {
+            // 64-bit mix (splitmix finalizer) so sequential inodes spread across buckets
+            uint64_t x = k.ino ^ (k.dev * 0x9E3779B97F4A7C15ULL);
+            x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ULL;
+            x ^= x >> 27; x *= 0x94D049BB133111EBULL;
+            x ^= x >> 31;
+            return static_cast<size_t>(x);
+        }
+    };
+
+    /// @brief Modification time of a stat result in nanoseconds (portable across Linux/macOS).
+    inline int64_t stat_mtime_ns(const struct stat& st) {
+#if defined(__APPLE__)
+        return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    }
+
+    /// @brief Status-change time of a stat result in nanoseconds (bumped by rename/chmod).
+    inline int64_t stat_ctime_ns(const struct stat& st) {
+#if defined(__APPLE__)
+        return static_cast<int64_t>(st.st_ctimespec.tv_sec) * 1000000000LL + st.st_ctimespec.tv_nsec;
+#else
+        return static_cast<int64_t>(st.st_ctim.tv_sec) * 1000000000LL + st.st_ctim.tv_nsec;
+#endif
+    }
+
+    /**
+     * @brief Thread-safe FileStats cache keyed on stat identity.
+     * * Entries are keyed by (dev, inode) and validated against mtime, ctime and size,
+     * so any write, truncate or rename of the file invalidates its entry. A listing of an
+     * unchanged directory then costs one stat() per entry and no content reads.
+     * * The cache is sharded to keep lock contention low when native_ls analyzes entries
+     * on the thread pool, and can optionally be persisted to a small binary file.
+     */
+    class StatsCache {
+    public:
+        static constexpr size_t SHARD_COUNT = 16;
+        static constexpr size_t DEFAULT_MAX_ENTRIES = 200000;
+
+        StatsCache() = default;
+        StatsCache(const StatsCache&) = delete;
+        StatsCache& operator=(const StatsCache&) = delete;
+
+        /**
+         * @brief Returns the cached analysis for a stat result, if still valid.
+         * @param st Fresh stat() of the path.
+         * @param out Receives the cached FileStats on a hit.
+         * @return true on a cache hit.
+         */
+        bool lookup(const struct stat& st, FileStats& out) const {
+            StatKey key = make_key(st);
+            const Shard& shard = shards_[shard_of(key)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.map.find(key);
+            if (it == shard.map.end() || !it->second.matches(st)) return false;
+            out = it->second.stats;
+            return true;
+        }
+
+        /**
+         * @brief Stores the analysis result for a stat result.
+         * Invalid results (e.g. permission errors) are not cached.
+         */
+        void store(const struct stat& st, const FileStats& stats) {
+            if (!stats.is_valid) return;
+            StatKey key = make_key(st);
+            Shard& shard = shards_[shard_of(key)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.map.size() >= max_entries_ / SHARD_COUNT + 1 && shard.map.find(key) == shard.map.end()) {
+                // Cheap bounded eviction: drop an arbitrary entry from this shard.
+                shard.map.erase(shard.map.begin());
+            }
+            shard.map[key] = Entry{stat_mtime_ns(st), stat_ctime_ns(st), static_cast<uint64_t>(st.st_size), stats};
+            dirty_.store(true, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Drop-in replacement for analyze_path() that consults the cache first.
+         * Performs exactly one stat(); content is only scanned on a miss.
+         * In exact mode an estimated entry counts as a miss, but only while the
+         * budget could afford a full scan (otherwise the estimate is reused as-is).
+         * Exact entries are served in either mode.
+         * Directory counts are reused until the directory's mtime changes; a count
+         * capped below the requested cap is treated as a miss.
+         */
+        FileStats analyze(const std::string& path, const AnalyzeOptions& opts = {}) {
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0) return FileStats{};
+            return analyze_at(AT_FDCWD, path.c_str(), st, opts);
+        }
+
+        /**
+         * @brief fd-relative variant used by directory listings (see dir_scan.hpp).
+         * @param st Metadata already obtained for the entry (e.g. by stat_at or getattrlistbulk).
+         */
+        FileStats analyze_at(int dirfd, const char* name, const struct stat& st, const AnalyzeOptions& opts = {}) {
+            FileStats stats;
+            if (lookup(st, stats)) {
+                bool refresh;
+                if (stats.is_dir) {
+                    // A count that stopped below the requested cap must be redone
+                    const size_t cap = opts.dir_count_cap;
+                    refresh = stats.count_capped && (cap == 0 || stats.item_count < cap);
+                    if (!refresh) apply_count_cap(stats, cap);
+                } else {
+                    refresh = opts.exact && stats.is_estimated &&
+                              (!opts.budget || opts.budget->affordable(stats.size_bytes));
+                }
+                if (!refresh) return stats;
+            }
+            stats = dais::utils::analyze_at(dirfd, name, st, opts);
+            store(st, stats);
+            return stats;
+        }
+
+        /// @brief Caps the number of entries kept in memory (and persisted).
+        void set_max_entries(size_t n) { max_entries_ = n > 0 ? n : DEFAULT_MAX_ENTRIES; }
+
+        size_t size() const {
+            size_t total = 0;
+            for (const auto& shard : shards_) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                total += shard.map.size();
+            }
+            return total;
+        }
+
+        void clear() {
+            for (auto& shard : shards_) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.map.clear();
+            }
+            dirty_.store(true, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Loads a cache file written by save().
+         * Files with a different format version or extension configuration are ignored,
+         * since the cached is_text/is_data flags would no longer be correct.
+         * @return true if entries were loaded.
+         */
+        bool load(const std::string& file) {
+            FILE* f = std::fopen(file.c_str(), "rb");
+            if (!f) return false;
+
+            DiskHeader header{};
+            bool ok = std::fread(&header, sizeof(header), 1, f) == 1 &&
+                      std::memcmp(header.magic, MAGIC, sizeof(header.magic)) == 0 &&
+                      header.version == FORMAT_VERSION &&
+                      header.fingerprint == config_fingerprint();
+            if (!ok) { std::fclose(f); return false; }
+
+            DiskRecord rec{};
+            uint64_t loaded = 0;
+            while (loaded < header.count && std::fread(&rec, sizeof(rec), 1, f) == 1) {
+                StatKey key{rec.dev, rec.ino};
+                FileStats stats;
+                stats.is_valid = true;
+                stats.is_dir = (rec.flags & FLAG_DIR) != 0;
+                stats.is_text = (rec.flags & FLAG_TEXT) != 0;
+                stats.is_data = (rec.flags & FLAG_DATA) != 0;
+                stats.is_estimated = (rec.flags & FLAG_ESTIMATED) != 0;
+                stats.count_capped = (rec.flags & FLAG_CAPPED) != 0;
+                stats.item_count = static_cast<size_t>(rec.item_count);
+                stats.size_bytes = static_cast<uintmax_t>(rec.size_bytes);
+                stats.rows = static_cast<size_t>(rec.rows);
+                stats.max_cols = static_cast<size_t>(rec.max_cols);
+
+                Shard& shard = shards_[shard_of(key)];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.map[key] = Entry{rec.mtime_ns, rec.ctime_ns, rec.size, stats};
+                ++loaded;
+            }
+            std::fclose(f);
+            dirty_.store(false, std::memory_order_relaxed);
+            return loaded > 0;
+        }
+
+        /**
+         * @brief Persists the cache atomically (write to temp file + rename).
+         * No-op if nothing changed since the last load/save.
+         * @return true on success (or if there was nothing to write).
+         */
+        bool save(const std::string& file) {
+            if (!dirty_.load(std::memory_order_relaxed)) return true;
+
+            std::error_code ec;
+            fs::path target(file);
+            if (target.has_parent_path()) fs::create_directories(target.parent_path(), ec);
+
+            std::string tmp = file + ".tmp";
+            FILE* f = std::fopen(tmp.c_str(), "wb");
+            if (!f) return false;
+
+            DiskHeader header{};
+            std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+            header.version = FORMAT_VERSION;
+            header.fingerprint = config_fingerprint();
+            header.count = size();
+            bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+
+            uint64_t written = 0;
+            for (const auto& shard : shards_) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (const auto& [key, entry] : shard.map) {
+                    if (!ok || written >= header.count) break;
+                    DiskRecord rec{};
+                    rec.dev = key.dev;
+                    rec.ino = key.ino;
+                    rec.mtime_ns = entry.mtime_ns;
+                    rec.ctime_ns = entry.ctime_ns;
+                    rec.size = entry.size;
+                    rec.item_count = entry.stats.item_count;
+                    rec.size_bytes = entry.stats.size_bytes;
+                    rec.rows = entry.stats.rows;
+                    rec.max_cols = entry.stats.max_cols;
+                    rec.flags = (entry.stats.is_dir ? FLAG_DIR : 0) |
+                                (entry.stats.is_text ? FLAG_TEXT : 0) |
+                                (entry.stats.is_data ? FLAG_DATA : 0) |
+                                (entry.stats.is_estimated ? FLAG_ESTIMATED : 0) |
+                                (entry.stats.count_capped ? FLAG_CAPPED : 0);
+                    ok = std::fwrite(&rec, sizeof(rec), 1, f) == 1;
+                    ++written;
+                }
+            }
+
+            // Entries may have been added concurrently; patch the header with the real count.
+            if (ok && written != header.count) {
+                header.count = written;
+                ok = std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, f) == 1;
+            }
+            ok = (std::fclose(f) == 0) && ok;
+
+            if (!ok || std::rename(tmp.c_str(), file.c_str()) != 0) {
+                std::remove(tmp.c_str());
+                return false;
+            }
+            dirty_.store(false, std::memory_order_relaxed);
+            return true;
+        }
+
+        /// @brief Default on-disk location: ~/.dais/stats_cache.bin (empty if HOME is unset).
+        static std::string default_path() {
+            const char* home = std::getenv("HOME");
+            if (!home || !*home) return "";
+            return std::string(home) + "/.dais/stats_cache.bin";
+        }
+
+    private:
+        struct Entry {
+            int64_t mtime_ns = 0;
+            int64_t ctime_ns = 0;
+            uint64_t size = 0;
+            FileStats stats;
+
+            bool matches(const struct stat& st) const {
+                return mtime_ns == stat_mtime_ns(st) &&
+                       ctime_ns == stat_ctime_ns(st) &&
+                       size == static_cast<uint64_t>(st.st_size);
+            }
+        };
+
+        struct Shard {
+            mutable std::mutex mutex;
+            std::unordered_map<StatKey, Entry, StatKeyHash> map;
+        };
+
+        // --- On-disk format (native endianness; the file is local to one machine) ---
+        static constexpr char MAGIC[8] = {'D', 'A', 'I', 'S', 'S', 'T', 'A', 'T'};
+        static constexpr uint32_t FORMAT_VERSION = 1;
+        static constexpr uint8_t FLAG_DIR = 1, FLAG_TEXT = 2, FLAG_DATA = 4, FLAG_ESTIMATED = 8,
+                                  FLAG_CAPPED = 16;
+
+        struct DiskHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t fingerprint;
+            uint64_t count;
+        };
+
+        struct DiskRecord {
+            uint64_t dev, ino;
+            int64_t mtime_ns, ctime_ns;
+            uint64_t size;
+            uint64_t item_count, size_bytes, rows, max_cols;
+            uint64_t flags;
+        };
+
+        static StatKey make_key(const struct stat& st) {
+            return StatKey{static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino)};
+        }
+
+        static size_t shard_of(const StatKey& key) {
+            return StatKeyHash{}(key) % SHARD_COUNT;
+        }
+
+        /**
+         * @brief Hash of everything that influences analysis results besides the file itself.
+         * Changing the extension lists or the scan limit invalidates a persisted cache.
+         */
+        static uint64_t config_fingerprint() {
+            uint64_t h = 1469598103934665603ULL; // FNV-1a
+            auto mix = [&h](std::string_view s) {
+                for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+                h ^= 0xff; h *= 1099511628211ULL;
+            };
+            for (const auto& e : FileExtensions::text) mix(e);
+            mix("|");
+            for (const auto& e : FileExtensions::data) mix(e);
+            mix(std::to_string(MAX_SCAN_BYTES));
+            return h;
+        }
+
+        std::array<Shard, SHARD_COUNT> shards_;
+        size_t max_entries_ = DEFAULT_MAX_ENTRIES;
+        std::atomic<bool> dirty_{false};
+    };
+}
@@ -0,0 +1,81 @@
+/**
+ * @file tail_buffer.hpp
+ * @brief Fixed-capacity ring buffer that keeps the last N bytes of a stream.
+ * * Used for the pass-through prompt tail: the output thread appends one whole
+ * read at a time (one lock per read instead of one per byte), and readers
+ * linearize it only when they actually need the text.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace dais::core::utils {
+
+    template <size_t N>
+    class TailBuffer {
+    public:
+        static constexpr size_t CAPACITY = N;
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        void clear() { start_ = 0; size_ = 0; }
+
+        /// @brief Appends bytes, dropping the oldest ones beyond CAPACITY.
+        void append(const char* data, size_t n) {
+            if (n >= N) {
+                // Only the last N bytes survive
+                std::memcpy(data_.data(), data + (n - N), N);
+                start_ = 0;
+                size_ = N;
+                return;
+            }
+            size_t overflow = (size_ + n > N) ? size_ + n - N : 0;
+            start_ = (start_ + overflow) % N;
+            size_ -= overflow;
+
+            size_t end = (start_ + size_) % N;
+            size_t first = std::min(n, N - end);
+            std::memcpy(data_.data() + end, data, first);
+            std::memcpy(data_.data(), data + first, n - first);
+            size_ += n;
+        }
+
+        void append(std::string_view s) { append(s.data(), s.size()); }
+
+        /// @brief Byte at logical position i (0 = oldest).
+        char operator[](size_t i) const { return data_[(start_ + i) % N]; }
+
+        /// @brief Copies the last `count` bytes (or everything) into a contiguous string.
+        std::string tail(size_t count) const {
+            count = std::min(count, size_);
+            std::string out;
+            out.resize(count);
+            size_t begin = (start_ + size_ - count) % N;
+            size_t first = std::min(count, N - begin);
+            std::memcpy(out.data(), data_.data() + begin, first);
+            std::memcpy(out.data() + first, data_.data(), count - first);
+            return out;
+        }
+
+        std::string str() const { return tail(size_); }
+
+        bool ends_with(std::string_view suffix) const {
+            if (suffix.size() > size_) return false;
+            size_t offset = size_ - suffix.size();
+            for (size_t i = 0; i < suffix.size(); ++i) {
+                if ((*this)[offset + i] != suffix[i]) return false;
+            }
+            return true;
+        }
+
+    private:
+        std::array<char, N> data_{};
+        size_t start_ = 0;  ///< Index of the oldest byte
+        size_t size_ = 0;
+    };
+}
@@ -1,14 +1,20 @@
 /**
  * @file thread_pool.hpp
- * @brief A robust, header-only Thread Pool implementation.
+ * @brief A header-only work-stealing Thread Pool implementation.
  * Allows queuing arbitrary tasks and processing them with a fixed set of worker threads.
  * Prevents system crashes caused by thread exhaustion (std::async spawning unlimited threads).
+ * * Each worker owns a deque: it pushes/pops at the back (LIFO, cache-warm) while idle
+ * workers steal from the front of other deques. Submissions from outside the pool go to
+ * a shared injection queue, so the common case never contends on a single global lock.
+ * * Tasks are stored in a small-buffer Task wrapper, so typical lambdas are queued without
+ * any heap allocation. Batched submission (enqueue_bulk) and a chunked parallel_for in
+ * which the calling thread participates keep per-item costs low for large listings.
  */
 
 #pragma once
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
@@ -17,84 +23,387 @@
 #include <functional>
 #include <stdexcept>
 #include <atomic>
+#include <exception>
+#include <type_traits>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
 
 namespace dais::core::utils {
 
+    /**
+     * @brief Move-only type-erased callable with small-buffer storage.
+     * Callables up to INLINE_SIZE bytes (that are nothrow-movable) live inside the
+     * Task itself; larger ones fall back to a single heap allocation.
+     */
+    class Task {
+    public:
+        static constexpr size_t INLINE_SIZE = 56;
+
+        Task() = default;
+
+        template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+        Task(F&& f) {
+            using Fn = std::decay_t<F>;
+            if constexpr (fits_inline<Fn>()) {
+                ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+                ops_ = &inline_ops<Fn>;
+            } else {
+                *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+                ops_ = &heap_ops<Fn>;
+            }
+        }
+
+        Task(Task&& other) noexcept { move_from(other); }
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                reset();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task() { reset(); }
+
+        explicit operator bool() const { return ops_ != nullptr; }
+
+        void operator()() { ops_->invoke(storage_); }
+
+    private:
+        struct Ops {
+            void (*invoke)(void*);
+            void (*move)(void* dst, void* src);   ///< Move-construct into dst, destroy src
+            void (*destroy)(void*);
+        };
+
+        template <class Fn>
+        static constexpr bool fits_inline() {
+            return sizeof(Fn) <= INLINE_SIZE &&
+                   alignof(Fn) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible_v<Fn>;
+        }
+
+        template <class Fn>
+        static inline const Ops inline_ops{
+            [](void* p) { (*static_cast<Fn*>(p))(); },
+            [](void* dst, void* src) {
+                ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            },
+            [](void* p) { static_cast<Fn*>(p)->~Fn(); }
+        };
+
+        template <class Fn>
+        static inline const Ops heap_ops{
+            [](void* p) { (**static_cast<Fn**>(p))(); },
+            [](void* dst, void* src) { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); },
+            [](void* p) { delete *static_cast<Fn**>(p); }
+        };
+
+        void move_from(Task& other) noexcept {
+            if (other.ops_) {
+                other.ops_->move(storage_, other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+
+        void reset() noexcept {
+            if (ops_) {
+                ops_->destroy(storage_);
+                ops_ = nullptr;
+            }
+        }
+
+        alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+        const Ops* ops_ = nullptr;
+    };
+
     class ThreadPool {
     public:
-        // Constructor: Launch a fixed number of workers
-        explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) 
-            : stop(false) 
-        {
+        // Constructor: Launch a fixed number of workers (defaults to one per core)
+        explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
             // If hardware_concurrency returns 0 (error), fallback to 4
             if (threads == 0) threads = 4;
 
-            for(size_t i = 0; i < threads; ++i)
-                workers.emplace_back([this] {
-                    while(true) {
-                        std::function<void()> task;
-
-                        {
-                            std::unique_lock<std::mutex> lock(this->queue_mutex);
-                            this->condition.wait(lock, [this]{ return this->stop || !this->tasks.empty(); });
-                            
-                            if(this->stop && this->tasks.empty())
-                                return;
-                            
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
-                        }
+            queues_.reserve(threads);
+            for (size_t i = 0; i < threads; ++i) queues_.push_back(std::make_unique<WorkQueue>());
 
-                        task();
-                    }
-                });
+            workers_.reserve(threads);
+            for (size_t i = 0; i < threads; ++i)
+                workers_.emplace_back([this, i] { worker_loop(i); });
         }
 
-        // Add new work item to the pool
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /// @brief Number of worker threads.
+        size_t size() const { return workers_.size(); }
+
+        // Add new work item to the pool and get a future for its result
         template<class F, class... Args>
-        auto enqueue(F&& f, Args&&... args) 
+        auto enqueue(F&& f, Args&&... args)
             -> std::future<typename std::invoke_result<F, Args...>::type>
         {
             using return_type = typename std::invoke_result<F, Args...>::type;
 
-            auto task = std::make_shared<std::packaged_task<return_type()>>(
-                std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-            );
-            
-            std::future<return_type> res = task->get_future();
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
+            // packaged_task owns the shared state; it is moved into the Task's inline storage
+            std::packaged_task<return_type()> task(
+                [fn = std::forward<F>(f), ...a = std::forward<Args>(args)]() mutable -> return_type {
+                    return std::invoke(std::move(fn), std::move(a)...);
+                });
+            std::future<return_type> res = task.get_future();
+            submit([t = std::move(task)]() mutable { t(); });
+            return res;
+        }
 
-                // Don't allow enqueueing after stopping
-                if(stop)
-                    throw std::runtime_error("enqueue on stopped ThreadPool");
+        /**
+         * @brief Fire-and-forget submission (no future, no allocation for small callables).
+         * Tasks submitted from a worker go to that worker's own deque.
+         */
+        template <class F>
+        void submit(F&& f) {
+            if (stop_.load(std::memory_order_acquire))
+                throw std::runtime_error("enqueue on stopped ThreadPool");
 
-                tasks.emplace([task](){ (*task)(); });
+            // Count first so a worker that finds the task never sees the counter underflow
+            queued_.fetch_add(1, std::memory_order_seq_cst);
+            size_t self = current_worker();
+            if (self != NO_WORKER) {
+                queues_[self]->push_back(Task(std::forward<F>(f)));
+            } else {
+                std::lock_guard<std::mutex> lock(inject_mutex_);
+                inject_.emplace_back(std::forward<F>(f));
             }
-            condition.notify_one();
-            return res;
+            wake(1);
         }
 
-        // Destructor: Join all threads
+        /**
+         * @brief Submits a batch of callables with one lock acquisition per worker deque.
+         * Tasks are spread round-robin across workers so they start stealing-free.
+         */
+        template <class It>
+        void enqueue_bulk(It first, It last) {
+            if (stop_.load(std::memory_order_acquire))
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+
+            std::vector<std::vector<Task>> per_worker(queues_.size());
+            size_t count = 0;
+            for (It it = first; it != last; ++it, ++count)
+                per_worker[count % queues_.size()].emplace_back(std::move(*it));
+            if (count == 0) return;
+
+            queued_.fetch_add(count, std::memory_order_seq_cst);
+            for (size_t i = 0; i < queues_.size(); ++i) {
+                if (!per_worker[i].empty()) queues_[i]->push_batch(per_worker[i]);
+            }
+            wake(count);
+        }
+
+        /**
+         * @brief Runs body(lo, hi) over [begin, end) in chunks of `grain` items.
+         * The calling thread participates, so this is safe to call from a worker and
+         * never deadlocks on a saturated pool. Returns once every chunk has finished;
+         * the first exception thrown by a chunk is rethrown here.
+         */
+        template <class F>
+        void parallel_for(size_t begin, size_t end, size_t grain, F&& body) {
+            if (end <= begin) return;
+            if (grain == 0) grain = 1;
+            const size_t chunks = (end - begin + grain - 1) / grain;
+
+            if (chunks == 1) {
+                body(begin, end);
+                return;
+            }
+
+            // Shared by helper tasks that may start after the caller has already returned
+            struct ForState {
+                std::atomic<size_t> next{0};
+                std::atomic<size_t> done{0};
+                std::mutex mutex;
+                std::condition_variable cv;
+                std::exception_ptr error;
+            };
+            auto state = std::make_shared<ForState>();
+            using Body = std::remove_reference_t<F>;
+            Body* fn = &body; // Valid until the caller returns; chunks are only claimed before that
+
+            auto run_chunks = [state, fn, begin, end, grain, chunks]() {
+                size_t c;
+                while ((c = state->next.fetch_add(1, std::memory_order_relaxed)) < chunks) {
+                    size_t lo = begin + c * grain;
+                    size_t hi = std::min(end, lo + grain);
+                    try {
+                        (*fn)(lo, hi);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        if (!state->error) state->error = std::current_exception();
+                    }
+                    if (state->done.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks) {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->cv.notify_all();
+                    }
+                }
+            };
+
+            size_t helpers = std::min(chunks - 1, queues_.size());
+            std::vector<Task> batch;
+            batch.reserve(helpers);
+            for (size_t i = 0; i < helpers; ++i) batch.emplace_back(run_chunks);
+            enqueue_bulk(batch.begin(), batch.end());
+
+            run_chunks();
+
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->cv.wait(lock, [&] { return state->done.load(std::memory_order_acquire) == chunks; });
+            if (state->error) std::rethrow_exception(state->error);
+        }
+
+        // Destructor: Drain remaining work and join all threads
         ~ThreadPool() {
             {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                stop = true;
+                std::lock_guard<std::mutex> lock(sleep_mutex_);
+                stop_.store(true, std::memory_order_release);
             }
-            condition.notify_all();
-            for(std::thread &worker: workers)
+            sleep_cv_.notify_all();
+            for (std::thread& worker : workers_)
                 worker.join();
         }
 
     private:
+        static constexpr size_t NO_WORKER = static_cast<size_t>(-1);
+
+        /// @brief Per-worker deque. Owner uses the back, thieves take from the front.
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+
+            void push_back(Task&& t) {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push_back(std::move(t));
+            }
+
+            void push_batch(std::vector<Task>& batch) {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& t : batch) tasks.push_back(std::move(t));
+            }
+
+            bool pop_back(Task& out) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (tasks.empty()) return false;
+                out = std::move(tasks.back());
+                tasks.pop_back();
+                return true;
+            }
+
+            bool steal_front(Task& out) {
+                std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+                if (!lock.owns_lock() || tasks.empty()) return false;
+                out = std::move(tasks.front());
+                tasks.pop_front();
+                return true;
+            }
+        };
+
+        // Identifies the pool/worker the current thread belongs to (for local pushes)
+        struct WorkerIdentity {
+            const ThreadPool* pool = nullptr;
+            size_t index = NO_WORKER;
+        };
+
+        static WorkerIdentity& identity() {
+            thread_local WorkerIdentity id;
+            return id;
+        }
+
+        size_t current_worker() const {
+            const WorkerIdentity& id = identity();
+            return id.pool == this ? id.index : NO_WORKER;
+        }
+
+        void wake(size_t count) {
+            if (sleepers_.load(std::memory_order_seq_cst) == 0) return;
+            // Taking the lock orders this wake-up after any in-progress predicate check
+            { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+            if (count == 1) sleep_cv_.notify_one();
+            else sleep_cv_.notify_all();
+        }
+
+        bool try_get(size_t self, Task& out) {
+            // 1. Own deque (LIFO)
+            if (queues_[self]->pop_back(out)) return true;
+
+            // 2. Injection queue (external submissions)
+            {
+                std::lock_guard<std::mutex> lock(inject_mutex_);
+                if (!inject_.empty()) {
+                    out = std::move(inject_.front());
+                    inject_.pop_front();
+                    return true;
+                }
+            }
+
+            // 3. Steal from siblings, starting after ourselves to spread contention
+            const size_t n = queues_.size();
+            for (size_t k = 1; k < n; ++k) {
+                if (queues_[(self + k) % n]->steal_front(out)) return true;
+            }
+            return false;
+        }
+
+        void worker_loop(size_t self) {
+            identity() = WorkerIdentity{this, self};
+            Task task;
+            while (true) {
+                if (try_get(self, task)) {
+                    queued_.fetch_sub(1, std::memory_order_relaxed);
+                    try {
+                        task();
+                    } catch (...) {
+                        // enqueue() reports errors through the future; keep the worker alive for submit()
+                    }
+                    task = Task();
+                    continue;
+                }
+
+                // Work may be in flight (counted but not yet pushed) or hidden behind a
+                // contended try_lock; retry until the count says the pool is empty
+                if (queued_.load(std::memory_order_seq_cst) > 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex_);
+                sleepers_.fetch_add(1, std::memory_order_seq_cst);
+                sleep_cv_.wait(lock, [this] {
+                    return stop_.load(std::memory_order_acquire) ||
+                           queued_.load(std::memory_order_seq_cst) > 0;
+                });
+                sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+                if (stop_.load(std::memory_order_acquire) && queued_.load(std::memory_order_seq_cst) == 0)
+                    return;
+            }
+        }
+
         // Need to keep track of threads so we can join them
-        std::vector<std::thread> workers;
-        // The task queue
-        std::queue<std::function<void()>> tasks;
-        
-        // Synchronization
-        std::mutex queue_mutex;
-        std::condition_variable condition;
-        bool stop;
+        std::vector<std::thread> workers_;
+        std::vector<std::unique_ptr<WorkQueue>> queues_;
+
+        // Submissions from non-worker threads
+        std::mutex inject_mutex_;
+        std::deque<Task> inject_;
+
+        // Sleep/wake coordination
+        std::atomic<size_t> queued_{0};
+        std::atomic<size_t> sleepers_{0};
+        std::mutex sleep_mutex_;
+        std::condition_variable sleep_cv_;
+        std::atomic<bool> stop_{false};
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,206 @@
+/**
+ * @file tree_scan.hpp
+ * @brief Parallel recursive walk for `ls -R`: per-directory totals of size, rows and files.
+ * * Directories are the unit of work: a worker takes one from a shared queue,
+ *   enumerates it (dir_scan.hpp), analyzes its files fd-relative and queues its
+ *   subdirectories. Totals are kept per directory while walking and folded into
+ *   the parents bottom-up once the walk has finished, so workers never contend
+ *   on shared counters.
+ * * The walk is bounded by depth and by the total number of entries visited;
+ *   directories cut off by either limit are marked (count_capped) so the grid can
+ *   show that the totals are lower bounds.
+ *
+ * Used by native tree listings and by the remote agent (--tree), so both report
+ * the same numbers.
+ */
+
+#pragma once
+
+#include "core/dir_scan.hpp"
+#include "core/file_analyzer.hpp"
+#include "core/stats_cache.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dais::utils {
+
+    /// @brief Limits and analysis settings for scan_tree().
+    struct TreeOptions {
+        size_t max_depth = 32;           ///< Deepest directory level descended into (1 = direct children only)
+        size_t max_entries = 200000;     ///< Stop after visiting this many entries in total (0 = unlimited)
+        bool show_hidden = false;        ///< Include dotfiles and dot-directories
+        AnalyzeOptions analyze;          ///< Per-file analysis (exact rows, budget)
+        StatsCache* cache = nullptr;     ///< Optional metadata cache for file analysis
+    };
+
+    /**
+     * @brief One entry directly below the scanned root.
+     * Files carry their own stats. Directories carry subtree totals: size_bytes and
+     * rows are summed over all files below, item_count is the number of files,
+     * is_estimated is set if any row count was estimated and count_capped if a
+     * limit cut the walk short.
+     */
+    struct TreeItem {
+        std::string name;
+        FileStats stats;
+    };
+
+    /// @brief Result of scan_tree().
+    struct TreeResult {
+        std::vector<TreeItem> items;
+        bool truncated = false;          ///< A limit cut the walk short somewhere (totals are lower bounds)
+    };
+
+    namespace tree_detail {
+        struct Node {
+            Node* parent = nullptr;
+            std::string path;
+            size_t depth = 0;
+            size_t top_index = 0;     ///< Index of the TreeItem this subtree belongs to
+            uintmax_t size = 0;
+            size_t rows = 0;
+            size_t files = 0;
+            bool estimated = false;
+            bool truncated = false;
+        };
+
+        /// @brief True for real directories (symlinks to directories are not followed).
+        inline bool is_dir_entry(const DirEntry& e, int dirfd) {
+            if (e.type == DT_DIR) return true;
+            if (e.type != DT_UNKNOWN) return false;
+            struct stat st;
+            return ::fstatat(dirfd, e.name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+        }
+    }
+
+    /**
+     * @brief Walks `root` recursively.
+     * @param run_workers Called once as run_workers(worker); must run `worker()` on
+     *        one or more threads concurrently and return when all calls returned.
+     * @return Entries directly below root (directories with subtree totals);
+     *         no items if root cannot be read.
+     */
+    template <class RunWorkers>
+    inline TreeResult scan_tree(const std::string& root, const TreeOptions& opts, RunWorkers&& run_workers) {
+        using tree_detail::Node;
+
+        TreeResult result;
+        std::vector<TreeItem>& top = result.items; // Only written while processing the root
+
+        std::deque<Node> nodes;           // Stable addresses; parents precede children
+        std::vector<Node*> queue;
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t active = 0;                // Directories taken but not yet finished
+        std::atomic<size_t> visited{0};
+        std::atomic<bool> stop{false};
+
+        nodes.push_back(Node{});
+        nodes.back().path = root;
+        queue.push_back(&nodes.back());
+
+        auto process = [&](Node& node) {
+            DirReader dir(node.path);
+            std::vector<DirEntry> entries;
+            if (!dir.read_all(opts.show_hidden, entries)) return; // Unreadable: contributes nothing
+
+            size_t seen = visited.fetch_add(entries.size(), std::memory_order_relaxed) + entries.size();
+            if (opts.max_entries > 0 && seen > opts.max_entries) {
+                node.truncated = true;
+                stop.store(true, std::memory_order_relaxed);
+                size_t over = std::min(entries.size(), seen - opts.max_entries);
+                entries.resize(entries.size() - over);
+            }
+
+            std::vector<Node> children;
+            for (const auto& e : entries) {
+                if (tree_detail::is_dir_entry(e, dir.fd())) {
+                    if (node.depth + 1 > opts.max_depth) {
+                        node.truncated = true; // Below the depth limit: not descended
+                        continue;
+                    }
+                    Node child;
+                    child.parent = &node;
+                    child.path = node.path + "/" + e.name;
+                    child.depth = node.depth + 1;
+                    child.top_index = node.top_index;
+                    if (node.depth == 0) {
+                        child.top_index = top.size();
+                        TreeItem& item = top.emplace_back();
+                        item.name = e.name;
+                        item.stats.is_valid = true;
+                        item.stats.is_dir = true;
+                    }
+                    children.push_back(std::move(child));
+                    continue;
+                }
+
+                struct stat st;
+                if (e.has_stat) st = e.st;
+                else if (stat_at(dir.fd(), e.name.c_str(), st) != 0) continue; // Broken symlink / vanished
+                if (S_ISDIR(st.st_mode)) continue; // Symlinked directory: not walked
+                FileStats fs = opts.cache ? opts.cache->analyze_at(dir.fd(), e.name.c_str(), st, opts.analyze)
+                                          : analyze_at(dir.fd(), e.name.c_str(), st, opts.analyze);
+                node.size += fs.size_bytes;
+                node.rows += fs.rows;
+                node.files += 1;
+                node.estimated |= fs.is_estimated;
+                if (node.depth == 0) top.push_back({e.name, fs});
+            }
+
+            if (children.empty()) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& child : children) {
+                nodes.push_back(std::move(child));
+                queue.push_back(&nodes.back());
+            }
+            cv.notify_all();
+        };
+
+        auto worker = [&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                cv.wait(lock, [&]() { return !queue.empty() || active == 0; });
+                if (queue.empty()) return; // Nothing queued and nobody can queue more
+                Node* node = queue.back(); // LIFO: depth-first keeps the queue short
+                queue.pop_back();
+                ++active;
+                lock.unlock();
+                if (stop.load(std::memory_order_relaxed)) node->truncated = true;
+                else process(*node);
+                lock.lock();
+                if (--active == 0 && queue.empty()) cv.notify_all();
+            }
+        };
+        run_workers(worker);
+
+        // Bottom-up fold: children always come after their parent in `nodes`
+        for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+            Node& node = *it;
+            if (node.depth == 0) {
+                result.truncated = node.truncated;
+                continue;
+            }
+            if (node.depth == 1) {
+                FileStats& s = top[node.top_index].stats;
+                s.size_bytes = node.size;
+                s.rows = node.rows;
+                s.item_count = node.files;
+                s.is_estimated = node.estimated;
+                s.count_capped = node.truncated;
+            }
+            Node& parent = *node.parent;
+            parent.size += node.size;
+            parent.rows += node.rows;
+            parent.files += node.files;
+            parent.estimated |= node.estimated;
+            parent.truncated |= node.truncated;
+        }
+        return result;
+    }
+}
@@ -12,32 +12,36 @@
 #include "core/engine.hpp"
 #include "core/command_handlers.hpp"
 #include "core/help_text.hpp"
+#include "core/db_result_sink.hpp"
 #include <cstdio>
 #include <thread>
+#include <future>
 #include <chrono>
 #include <array>
 #include <string>
 #include <iostream> // Needed for std::cout, std::cerr
 #include <fstream>  // Needed for std::ofstream, std::ifstream
 #include <limits>   // Needed for std::numeric_limits
-#include <poll.h>
 #include <csignal>
 #include <sys/wait.h>
 #include <filesystem>
 #include <atomic>
 #include <mutex>
+#include <unordered_set>
 #include <cerrno>      // errno
 #include <sys/ioctl.h> // TIOCGWINSZ
 #include <unistd.h>    // STDOUT_FILENO
-#include <format>
+#include <sys/uio.h>   // writev
+#include <climits>     // IOV_MAX
 
-// --- OS Specific Includes for CWD Sync ---
-// We need low-level OS headers to inspect the child process's state directly.
-#if defined(__APPLE__)
-#include <libproc.h>
-#include <sys/proc_info.h>
-#endif
-// -----------------------------------------
+/// @brief Receives streamed :db results (db_handler.py -> db_begin / db_rows).
+static dais::core::utils::DbResultSink& db_result_sink() {
+    static dais::core::utils::DbResultSink sink;
+    return sink;
+}
+
+/// @brief Rows printed inline before a :db result goes to the pager (50 lines incl. header).
+constexpr size_t DB_INLINE_ROWS = 48;
 
 // ==================================================================================
 // EMBEDDED MODULE DEFINITION
@@ -55,11 +59,72 @@ PYBIND11_EMBEDDED_MODULE(dais, m) {
                   << dais::core::handlers::Theme::RESET << "] " 
                   << msg << "\r\n" << std::flush;
     });
+
+    // Streamed query results: column names, row cap (0 = none), optional output file
+    m.def("db_begin", [](std::vector<std::string> headers, size_t row_limit, std::string output_path) {
+        db_result_sink().begin(std::move(headers), row_limit, DB_INLINE_ROWS, std::move(output_path));
+    });
+
+    // One fetchmany() batch: a sequence of row sequences. Cells are converted
+    // straight into the sink's column buffers (str() for non-strings, None -> NULL).
+    // Returns false once the row cap is reached, so Python stops fetching.
+    m.def("db_rows", [](py::handle batch) {
+        auto& sink = db_result_sink();
+        if (!sink.active()) throw std::runtime_error("db_rows() called before db_begin()");
+        bool more = true;
+        for (py::handle row : batch) {
+            for (py::handle cell : row) {
+                if (cell.is_none()) {
+                    sink.add_null();
+                    continue;
+                }
+                py::object text = PyUnicode_Check(cell.ptr()) ? py::reinterpret_borrow<py::object>(cell)
+                                                              : py::reinterpret_steal<py::object>(PyObject_Str(cell.ptr()));
+                if (!text) throw py::error_already_set();
+                Py_ssize_t len = 0;
+                const char* utf8 = PyUnicode_AsUTF8AndSize(text.ptr(), &len);
+                if (!utf8) throw py::error_already_set();
+                sink.add_cell(utf8, static_cast<size_t>(len));
+            }
+            if (!sink.end_row()) {
+                more = false;
+                break;
+            }
+        }
+        sink.end_batch();
+        return more;
+    });
 }
 
 namespace dais::core {
 
     constexpr size_t BUFFER_SIZE = 4096;
+    constexpr size_t PAYLOAD_CHUNK = 4096;      ///< Upload write size (agent / db_handler)
+    constexpr int PTY_WRITE_TIMEOUT_MS = 5000;  ///< Give up an upload if the PTY stays full this long
+    constexpr int RESIZE_COALESCE_MS = 16;      ///< Window drags apply one TIOCSWINSZ per frame
+
+    // Helper: writev() that retries partial writes and EINTR
+    static void write_all(int fd, std::vector<struct iovec>& spans) {
+        size_t index = 0;
+        while (index < spans.size()) {
+            int count = static_cast<int>(std::min<size_t>(spans.size() - index, IOV_MAX));
+            ssize_t written = ::writev(fd, spans.data() + index, count);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return; // Terminal gone; nothing sensible to do
+            }
+            // Skip fully written spans, trim a partially written one
+            size_t remaining = static_cast<size_t>(written);
+            while (index < spans.size() && remaining >= spans[index].iov_len) {
+                remaining -= spans[index].iov_len;
+                ++index;
+            }
+            if (index < spans.size() && remaining > 0) {
+                spans[index].iov_base = static_cast<char*>(spans[index].iov_base) + remaining;
+                spans[index].iov_len -= remaining;
+            }
+        }
+    }
 
     // Helper: Base64 Encoder for binary transfer
     static std::string base64_encode(const unsigned char* data, size_t len) {
@@ -98,28 +163,68 @@ namespace dais::core {
         }
         
         load_history();  // Load ~/.dais_history on startup
+
+        // The interpreter used to ignore SIGPIPE at construction; it now starts later
+        // (or not at all), and a pager closing its pipe early must not kill DAIS.
+        std::signal(SIGPIPE, SIG_IGN);
     }
     
     // Ensure we kill the child shell if the engine is destroyed while running
-    Engine::~Engine() { if (running_) kill(pty_.get_child_pid(), SIGTERM); }
+    Engine::~Engine() {
+        if (running_) kill(pty_.get_child_pid(), SIGTERM);
+        stop_python();
+    }
 
     // ==================================================================================
     // EXTENSION & CONFIGURATION MANAGEMENT
     // ==================================================================================
 
+    /**
+     * @brief Queues the plugin import on the Python thread.
+     * In lazy mode the thread is only started by run(), after the shell, and the
+     * first :db waits for it; otherwise this blocks until every plugin is loaded.
+     * @param path Absolute or relative path to the scripts folder.
+     */
+    void Engine::load_extensions(const std::string& path) {
+        const bool quiet = config_.lazy_python; // Shell already running: only report problems
+        hooks_.post([this, path, quiet] {
+            // db_handler imports config itself (DB_QUERIES, DB_POOL), also after a snapshot load
+            if (!config_dir_.empty()) {
+                try {
+                    py::list sys_path = py::module_::import("sys").attr("path");
+                    if (!sys_path.contains(config_dir_)) sys_path.append(config_dir_);
+                } catch (const std::exception&) {}
+            }
+            import_plugins(path, quiet); // Also binds db_handler
+            hooks_.set_ready();
+            {
+                std::lock_guard<std::mutex> lock(python_mutex_);
+                python_loaded_ = true;
+            }
+            python_cv_.notify_all();
+        });
+        python_requested_ = true;
+        if (!config_.lazy_python) {
+            start_python();
+            await_python();
+        }
+    }
+
     /**
      * @brief Scans a directory for Python scripts and loads them as modules.
      * Updates sys.path so imports work correctly within the plugins.
+     * Runs on the Python thread with the GIL held.
      * @param path Absolute or relative path to the scripts folder.
+     * @param quiet Skip the per-plugin "Loaded" lines (lazy startup).
      */
-    void Engine::load_extensions(const std::string& path) {
+    void Engine::import_plugins(const std::string& path, bool quiet) {
         namespace fs = std::filesystem;
         fs::path p(path);
         
         // Validation
         if (path.empty() || !fs::exists(p) || !fs::is_directory(p)) {
             std::cerr << "[" << handlers::Theme::WARNING << "-" << handlers::Theme::RESET 
-                      << "] Warning: Plugin path '" << path << "' invalid. Skipping Python extensions.\n";
+                      << "] Warning: Plugin path '" << path << "' invalid. Skipping Python extensions.\r\n";
             return;
         }
 
@@ -139,27 +244,32 @@ namespace dais::core {
                     // Import and store the module
                     py::module_ plugin = py::module_::import(module_name.c_str());
                     loaded_plugins_.push_back(plugin);
+                    hooks_.add_plugin(module_name, plugin); // Resolve its hooks once
                     
-                    std::cout << "[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET 
-                              << "] Loaded .py extension: " << module_name << "\n";
+                    if (!quiet) {
+                        std::cout << "[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET 
+                                  << "] Loaded .py extension: " << module_name << "\r\n";
+                    }
                 }
             }
         } catch (const std::exception& e) {
             std::cerr << "[" << handlers::Theme::ERROR << "-" << handlers::Theme::RESET 
-                      << "] Error, failed to load extensions: " << e.what() << "\n";
+                      << "] Error, failed to load extensions: " << e.what() << "\r\n";
         }
+
+        // Resolve the :db entry points now, so queries do not import anything
+        bind_db_handler();
     }
 
     /**
-     * @brief Loads the 'config.py' file to set runtime flags.
-     * @param path Directory containing the config file.
+     * @brief Evaluates config.py (Python thread, GIL held).
+     * Writes config_, the Theme colors and the extension lists; the caller waits.
+     * @return false if config.py is missing or raised (defaults are kept).
      */
-    void Engine::load_configuration(const std::string& path) {
-        namespace fs = std::filesystem;
-        fs::path p(path);
+    bool Engine::evaluate_config() {
         try {
             py::module_ sys = py::module_::import("sys");
-            sys.attr("path").attr("append")(fs::absolute(p).string());
+            sys.attr("path").attr("append")(config_dir_);
             py::module_ conf_module = py::module_::import("config");
 
             // --- SETTINGS LOADING ---
@@ -222,6 +332,7 @@ namespace dais::core {
                 load_fmt("data_file", config_.ls_fmt_data_file);
                 load_fmt("binary_file", config_.ls_fmt_binary_file);
                 load_fmt("error", config_.ls_fmt_error);
+                load_fmt("tree_directory", config_.ls_fmt_tree_directory);
             }
 
             // 5. FILE EXTENSION LISTS
@@ -249,7 +360,78 @@ namespace dais::core {
                 if (sort.contains("flow")) config_.ls_flow = sort["flow"].cast<std::string>();
             }
 
-            // 7. DB CONFIGURATION
+            // 7. LS METADATA CACHE
+            if (py::hasattr(conf_module, "LS_CACHE")) {
+                py::dict cache = conf_module.attr("LS_CACHE").cast<py::dict>();
+                if (cache.contains("enabled")) config_.ls_cache = cache["enabled"].cast<bool>();
+                if (cache.contains("persist")) config_.ls_cache_persist = cache["persist"].cast<bool>();
+                if (cache.contains("max_entries")) config_.ls_cache_max_entries = cache["max_entries"].cast<size_t>();
+            }
+
+            // 8. LS EXACT ROW COUNTS
+            if (py::hasattr(conf_module, "LS_EXACT")) {
+                py::dict exact = conf_module.attr("LS_EXACT").cast<py::dict>();
+                if (exact.contains("enabled")) config_.ls_exact = exact["enabled"].cast<bool>();
+                if (exact.contains("max_mb")) config_.ls_exact_max_mb = exact["max_mb"].cast<uint64_t>();
+                if (exact.contains("max_ms")) config_.ls_exact_max_ms = exact["max_ms"].cast<int>();
+            }
+
+            // 9. LS DIRECTORY ITEM COUNTS
+            if (py::hasattr(conf_module, "LS_DIR_COUNT")) {
+                py::dict count = conf_module.attr("LS_DIR_COUNT").cast<py::dict>();
+                if (count.contains("max_items")) config_.ls_dir_count_cap = count["max_items"].cast<size_t>();
+            }
+
+            // 10. LS PROGRESSIVE RENDERING
+            if (py::hasattr(conf_module, "LS_PROGRESSIVE")) {
+                py::dict prog = conf_module.attr("LS_PROGRESSIVE").cast<py::dict>();
+                if (prog.contains("enabled")) config_.ls_progressive = prog["enabled"].cast<bool>();
+                if (prog.contains("first_paint_ms")) config_.ls_first_paint_ms = prog["first_paint_ms"].cast<int>();
+                if (prog.contains("entry_timeout_ms")) config_.ls_entry_timeout_ms = prog["entry_timeout_ms"].cast<int>();
+            }
+
+            // 11. LS RECURSIVE TOTALS
+            if (py::hasattr(conf_module, "LS_TREE")) {
+                py::dict tree = conf_module.attr("LS_TREE").cast<py::dict>();
+                if (tree.contains("max_depth")) config_.ls_tree_max_depth = tree["max_depth"].cast<size_t>();
+                if (tree.contains("max_entries")) config_.ls_tree_max_entries = tree["max_entries"].cast<size_t>();
+            }
+
+            // 12. LS GIT ANNOTATIONS
+            if (py::hasattr(conf_module, "LS_GIT")) {
+                py::dict git = conf_module.attr("LS_GIT").cast<py::dict>();
+                if (git.contains("enabled")) config_.ls_git = git["enabled"].cast<bool>();
+                if (git.contains("budget_ms")) config_.ls_git_budget_ms = std::max(1, git["budget_ms"].cast<int>());
+                if (git.contains("max_index_entries")) config_.ls_git_max_index_entries = git["max_index_entries"].cast<size_t>();
+            }
+
+            // 13. REMOTE AGENT
+            if (py::hasattr(conf_module, "REMOTE_AGENT")) {
+                py::dict agent = conf_module.attr("REMOTE_AGENT").cast<py::dict>();
+                if (agent.contains("resident")) config_.remote_agent_resident = agent["resident"].cast<bool>();
+                if (agent.contains("idle_timeout_s")) config_.remote_agent_idle_s = agent["idle_timeout_s"].cast<int>();
+            }
+
+            // 14. PERF COUNTERS
+            if (py::hasattr(conf_module, "PERF")) {
+                py::dict perf = conf_module.attr("PERF").cast<py::dict>();
+                if (perf.contains("enabled")) config_.perf_enabled = perf["enabled"].cast<bool>();
+                if (perf.contains("dump_on_exit") && !perf["dump_on_exit"].is_none()) {
+                    config_.perf_dump_on_exit = perf["dump_on_exit"].cast<std::string>();
+                }
+            }
+
+            // 15. PLUGIN HOOKS
+            if (py::hasattr(conf_module, "PLUGIN_HOOKS")) {
+                py::dict hooks = conf_module.attr("PLUGIN_HOOKS").cast<py::dict>();
+                if (hooks.contains("slow_ms")) config_.hook_slow_ms = std::max(1, hooks["slow_ms"].cast<int>());
+                if (hooks.contains("cooldown_s")) config_.hook_cooldown_s = std::max(0, hooks["cooldown_s"].cast<int>());
+                if (hooks.contains("queue_limit")) {
+                    config_.hook_queue_limit = std::max<size_t>(1, hooks["queue_limit"].cast<size_t>());
+                }
+            }
+
+            // 16. DB CONFIGURATION
             if (py::hasattr(conf_module, "DB_TYPE")) {
                 config_.db_type = conf_module.attr("DB_TYPE").cast<std::string>();
             }
@@ -257,32 +439,211 @@ namespace dais::core {
                 config_.db_source = conf_module.attr("DB_SOURCE").cast<std::string>();
             }
 
+            // 17. STARTUP
+            if (py::hasattr(conf_module, "STARTUP")) {
+                py::dict startup = conf_module.attr("STARTUP").cast<py::dict>();
+                if (startup.contains("lazy_python")) config_.lazy_python = startup["lazy_python"].cast<bool>();
+                if (startup.contains("config_snapshot")) config_.config_snapshot = startup["config_snapshot"].cast<bool>();
+            }
+
             // Debug Print
             std::cout << "[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET 
                       << "] Config loaded successfully.\n";
+            return true;
 
         } catch (const std::exception& e) {
             // Safe fallback if config is missing
             std::cout << "[" << handlers::Theme::ERROR << "-" << handlers::Theme::RESET 
                       << "] No config.py found (or error reading it). Using defaults.\n";
+            return false;
         }
     }
 
+    /// @brief Theme colors in a fixed order (snapshot layout).
+    static std::array<std::string*, 12> theme_slots() {
+        using T = handlers::Theme;
+        return {&T::RESET, &T::STRUCTURE, &T::UNIT, &T::VALUE, &T::ESTIMATE, &T::TEXT,
+                &T::SYMLINK, &T::LOGO, &T::SUCCESS, &T::WARNING, &T::ERROR, &T::NOTICE};
+    }
+
     /**
-     * @brief Triggers a named function in all loaded Python plugins.
-     * @param hook_name The function name to call (e.g., "on_command").
-     * @param data String data to pass to the hook.
+     * @brief Everything config.py sets, in snapshot order.
+     * Bump ConfigSnapshot::FORMAT_VERSION when fields are added, removed or reordered.
      */
-    void Engine::trigger_python_hook(const std::string& hook_name, const std::string& data) {
-        for (auto& plugin : loaded_plugins_) {
-            if (py::hasattr(plugin, hook_name.c_str())) {
-                try {
-                    plugin.attr(hook_name.c_str())(data);
-                } catch (const std::exception& e) {
-                    std::cerr << "Error in plugin: " << e.what() << "\n";
+    template <class Io>
+    static void visit_config(Io& io, Config& c, std::vector<std::string>& theme,
+                             std::vector<std::string>& text_ext, std::vector<std::string>& data_ext) {
+        io.field(c.show_logo);
+        io.field(c.shell_prompts);
+        io.field(c.ls_fmt_directory);
+        io.field(c.ls_fmt_text_file);
+        io.field(c.ls_fmt_data_file);
+        io.field(c.ls_fmt_binary_file);
+        io.field(c.ls_fmt_error);
+        io.field(c.ls_fmt_tree_directory);
+        io.field(c.ls_sort_by);
+        io.field(c.ls_sort_order);
+        io.field(c.ls_dirs_first);
+        io.field(c.ls_flow);
+        io.field(c.ls_padding);
+        io.field(c.ls_cache);
+        io.field(c.ls_cache_persist);
+        io.field(c.ls_cache_max_entries);
+        io.field(c.ls_exact);
+        io.field(c.ls_exact_max_mb);
+        io.field(c.ls_exact_max_ms);
+        io.field(c.ls_dir_count_cap);
+        io.field(c.ls_progressive);
+        io.field(c.ls_first_paint_ms);
+        io.field(c.ls_entry_timeout_ms);
+        io.field(c.ls_tree_max_depth);
+        io.field(c.ls_tree_max_entries);
+        io.field(c.ls_git);
+        io.field(c.ls_git_budget_ms);
+        io.field(c.ls_git_max_index_entries);
+        io.field(c.remote_agent_resident);
+        io.field(c.remote_agent_idle_s);
+        io.field(c.perf_enabled);
+        io.field(c.perf_dump_on_exit);
+        io.field(c.hook_slow_ms);
+        io.field(c.hook_cooldown_s);
+        io.field(c.hook_queue_limit);
+        io.field(c.lazy_python);
+        io.field(c.config_snapshot);
+        io.field(c.db_type);
+        io.field(c.db_source);
+        io.field(theme);
+        io.field(text_ext);
+        io.field(data_ext);
+    }
+
+    /**
+     * @brief Loads the 'config.py' file to set runtime flags.
+     * While config.py is unchanged the evaluated values come from the binary
+     * snapshot and the interpreter is not needed; otherwise config.py is evaluated
+     * on the Python thread and the snapshot rewritten.
+     * @param path Directory containing the config file.
+     */
+    void Engine::load_configuration(const std::string& path) {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        config_dir_ = fs::absolute(fs::path(path), ec).string();
+        const std::string snapshot_file = utils::ConfigSnapshot::default_path();
+        utils::ConfigSnapshot::Key key;
+        const bool have_key = !snapshot_file.empty() && utils::ConfigSnapshot::key_of(fs::path(path) / "config.py", key);
+
+        bool from_snapshot = false;
+        std::string payload;
+        if (have_key && utils::ConfigSnapshot::load(snapshot_file, key, payload)) {
+            Config restored = config_;
+            std::vector<std::string> theme, text_ext, data_ext;
+            utils::SnapshotReader reader(payload);
+            visit_config(reader, restored, theme, text_ext, data_ext);
+            auto slots = theme_slots();
+            if (reader.complete() && theme.size() == slots.size()) {
+                config_ = std::move(restored);
+                for (size_t i = 0; i < slots.size(); ++i) *slots[i] = std::move(theme[i]);
+                dais::utils::FileExtensions::text = std::move(text_ext);
+                dais::utils::FileExtensions::data = std::move(data_ext);
+                from_snapshot = true;
+                std::cout << "[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
+                          << "] Config loaded successfully (snapshot).\n";
+            }
+        }
+
+        if (!from_snapshot) {
+            // The input loop is not running yet: wait for the Python thread to evaluate it
+            std::promise<bool> evaluated;
+            std::future<bool> result = evaluated.get_future();
+            hooks_.post([&] { evaluated.set_value(evaluate_config()); });
+            python_requested_ = true;
+            start_python();
+
+            if (result.get() && have_key) {
+                if (config_.config_snapshot) {
+                    std::vector<std::string> theme, text_ext = dais::utils::FileExtensions::text,
+                                                    data_ext = dais::utils::FileExtensions::data;
+                    for (std::string* slot : theme_slots()) theme.push_back(*slot);
+                    utils::SnapshotWriter writer;
+                    visit_config(writer, config_, theme, text_ext, data_ext);
+                    utils::ConfigSnapshot::save(snapshot_file, key, writer.data());
+                } else {
+                    std::remove(snapshot_file.c_str());
                 }
             }
         }
+
+        // Warm the metadata cache from the previous session.
+        // Must happen after the extension lists are loaded: the file is rejected
+        // if they changed, since cached text/data classification would be stale.
+        stats_cache_.set_max_entries(config_.ls_cache_max_entries);
+        if (config_.ls_cache && config_.ls_cache_persist) {
+            stats_cache_file_ = dais::utils::StatsCache::default_path();
+            if (!stats_cache_file_.empty()) stats_cache_.load(stats_cache_file_);
+        }
+
+        // Tokenize the ls templates once; every listing renders from these
+        ls_formats_.directory = config_.ls_fmt_directory;
+        ls_formats_.text_file = config_.ls_fmt_text_file;
+        ls_formats_.data_file = config_.ls_fmt_data_file;
+        ls_formats_.binary_file = config_.ls_fmt_binary_file;
+        ls_formats_.error = config_.ls_fmt_error;
+        ls_formats_.tree_directory = config_.ls_fmt_tree_directory;
+        ls_formats_.ensure_compiled();
+        git_status_.set_limits({std::chrono::milliseconds(config_.ls_git_budget_ms), config_.ls_git_max_index_entries});
+
+        // Compile prompts and pager markers into one automaton for the output thread
+        prompt_matcher_.build(config_.shell_prompts, {"--More--"});
+
+        utils::PerfCounters::instance().set_enabled(config_.perf_enabled);
+
+        // Before any plugin is loaded (see HookDispatcher::set_limits)
+        hooks_.set_limits({std::chrono::milliseconds(config_.hook_slow_ms),
+                           std::chrono::seconds(config_.hook_cooldown_s), config_.hook_queue_limit});
+    }
+
+    // ==================================================================================
+    // PYTHON THREAD
+    // ==================================================================================
+
+    void Engine::start_python() {
+        if (!python_thread_.joinable()) python_thread_ = std::thread(&Engine::python_main, this);
+    }
+
+    /**
+     * @brief Owns the interpreter: initialized here, finalized here.
+     * Serves startup tasks (config.py, plugin import) and then hook events; all
+     * other threads only borrow the GIL.
+     */
+    void Engine::python_main() {
+        py::scoped_interpreter interpreter{};
+        {
+            py::gil_scoped_release nogil;
+            hooks_.serve();
+        }
+        // Drop every reference while the interpreter is still alive
+        hooks_.clear();
+        loaded_plugins_.clear();
+        db_handle_command_ = py::object();
+        json_loads_ = py::object();
+        db_pool_ = py::object();
+    }
+
+    void Engine::stop_python() {
+        if (!python_thread_.joinable()) return;
+        hooks_.stop();
+        python_thread_.join();
+    }
+
+    bool Engine::await_python() {
+        if (!python_thread_.joinable()) return false;
+        std::unique_lock<std::mutex> lock(python_mutex_);
+        if (!python_loaded_) {
+            std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
+                      << "] Loading Python plugins..." << std::flush;
+            python_cv_.wait(lock, [this] { return python_loaded_; });
+        }
+        return true;
     }
 
     // ==================================================================================
@@ -295,30 +656,15 @@ namespace dais::core {
      * Attempting to track 'cd' commands by parsing user input (stdin) is fragile because:
      * 1. Users use aliases (e.g., '..', 'gohome').
      * 2. Users use TAB completion, which the wrapper doesn't see fully resolved.
-     * * Instead, we use OS-specific system calls to inspect the child process directly.
-     * This provides almost 100% accuracy regardless of how the directory was changed.
+     * * Instead, we use OS-specific system calls to inspect the child process directly
+     * (/proc/{pid}/cwd on Linux, libproc on macOS), via CwdTracker. The cwd can only
+     * change while the shell runs a command, so the lookup (and the directory fd that
+     * listings use) is only renewed once a prompt returns after one; otherwise this is free.
      */
     void Engine::sync_child_cwd() {
-        pid_t pid = pty_.get_child_pid();
-        if (pid <= 0) return;
-
-#if defined(__APPLE__)
-        // macOS: Use libproc to query the vnode path info of the process
-        struct proc_vnodepathinfo vpi;
-        if (proc_pidinfo(pid, PROC_PIDVNODEPATHINFO, 0, &vpi, sizeof(vpi)) > 0) {
-            shell_cwd_ = std::filesystem::path(vpi.pvi_cdir.vip_path);
+        if (cwd_.refresh(pty_.get_child_pid())) {
+            shell_cwd_ = cwd_.path();
         }
-#elif defined(__linux__)
-        // Linux: Read the magic symlink at /proc/{pid}/cwd
-        try {
-            auto link_path = std::format("/proc/{}/cwd", pid);
-            if (std::filesystem::exists(link_path)) {
-                shell_cwd_ = std::filesystem::read_symlink(link_path);
-            }
-        } catch (...) {
-            // Permission denied or process gone; ignore.
-        }
-#endif
     }
 
     /**
@@ -330,6 +676,10 @@ namespace dais::core {
      * 
      * Example: "/mndwin" -> tries "/m" in /, then "ndwin" in /mnt -> finds /mnt/d/wincplusplus
      * 
+     * Directory listings come from dir_index_ (LRU, validated by mtime), where each
+     * prefix probe is a binary search. Failed (directory, offset) sub-problems are
+     * remembered for the call, so pathological inputs stay polynomial.
+     * 
      * @param partial The incomplete/concatenated path from the accumulator
      * @param cwd Current working directory for relative path resolution
      * @return Resolved path if successful, empty path if resolution failed
@@ -342,87 +692,79 @@ namespace dais::core {
         
         if (partial.empty()) return cwd;
         
-        // Helper lambda for case-insensitive prefix matching
-        auto starts_with_ci = [](const std::string& str, const std::string& prefix) -> bool {
-            if (str.size() < prefix.size()) return false;
-            for (size_t i = 0; i < prefix.size(); ++i) {
-                if (std::tolower(str[i]) != std::tolower(prefix[i])) return false;
-            }
-            return true;
-        };
+        // Determine starting point and clean the path string
+        std::string path_str = partial;
+        fs::path start_dir;
+        
+        if (!path_str.empty() && (path_str[0] == '/' || path_str[0] == '\\')) {
+            // Absolute path - start from root
+            start_dir = "/";
+            path_str = path_str.substr(1); // Remove leading slash
+        } else {
+            // Relative path - start from CWD
+            start_dir = cwd;
+        }
         
-        // Recursive helper to find path from current directory and remaining string
-        std::function<fs::path(const fs::path&, const std::string&, int)> find_path;
-        find_path = [&](const fs::path& current, const std::string& remaining, int depth) -> fs::path {
+        // Remove trailing slashes
+        while (!path_str.empty() && (path_str.back() == '/' || path_str.back() == '\\')) {
+            path_str.pop_back();
+        }
+        
+        // Remaining input is always a suffix of path_str, so a sub-problem is (directory, offset)
+        const std::string lowered = utils::DirIndexCache::to_lower(path_str);
+        std::unordered_set<std::string> failed;
+        std::unordered_map<std::string, std::shared_ptr<const utils::DirIndexCache::Listing>> seen; // One stat per dir per call
+        
+        std::function<fs::path(const fs::path&, size_t, int)> find_path;
+        find_path = [&](const fs::path& current, size_t offset, int depth) -> fs::path {
             // Base case: nothing left to match
-            if (remaining.empty()) {
+            if (offset == lowered.size()) {
                 return current;
             }
             
             // Depth limit to prevent infinite recursion
             if (depth > 50) return {};
             
-            // Must be at a valid directory
-            if (!fs::exists(current) || !fs::is_directory(current)) {
-                return {};
-            }
+            const std::string dir = current.string();
+            std::string key = dir;
+            key += '\0';
+            key += std::to_string(offset);
+            if (failed.contains(key)) return {};
             
-            // Collect directory entries
-            std::vector<std::pair<std::string, fs::path>> entries;
-            try {
-                for (const auto& entry : fs::directory_iterator(current)) {
-                    entries.push_back({entry.path().filename().string(), entry.path()});
-                }
-            } catch (...) {
-                return {}; // Permission error
+            // Must be a readable directory
+            auto [slot, fresh] = seen.try_emplace(dir);
+            if (fresh) slot->second = dir_index_.get(dir);
+            const auto listing = slot->second;
+            if (!listing) {
+                failed.insert(std::move(key));
+                return {};
             }
             
-            // Try matching increasingly long prefixes of 'remaining' against entries
+            // Try matching increasingly long prefixes of the remaining input against entries
             // Start with longer prefixes (more specific matches first)
-            for (size_t len = std::min(remaining.size(), static_cast<size_t>(256)); len >= 1; --len) {
-                std::string prefix = remaining.substr(0, len);
+            const size_t remaining = lowered.size() - offset;
+            for (size_t len = std::min(remaining, static_cast<size_t>(256)); len >= 1; --len) {
+                auto [first, last] = listing->prefix_range(std::string_view(lowered).substr(offset, len));
                 
-                for (const auto& [name, path] : entries) {
-                    if (starts_with_ci(name, prefix)) {
-                        // Found a potential match - try to resolve the rest
-                        std::string rest = remaining.substr(len);
-                        
-                        // If entry is a directory, recurse into it
-                        if (fs::is_directory(path)) {
-                            auto result = find_path(path, rest, depth + 1);
-                            if (!result.empty()) {
-                                return result;
-                            }
-                        } else if (rest.empty()) {
-                            // It's a file and we've consumed all input
-                            return path;
+                for (const auto* entry = first; entry != last; ++entry) {
+                    // If entry is a directory, recurse into it
+                    if (entry->is_dir) {
+                        auto result = find_path(current / entry->name, offset + len, depth + 1);
+                        if (!result.empty()) {
+                            return result;
                         }
+                    } else if (len == remaining) {
+                        // It's a file and we've consumed all input
+                        return current / entry->name;
                     }
                 }
             }
             
+            failed.insert(std::move(key));
             return {}; // No match found
         };
         
-        // Determine starting point and clean the path string
-        std::string path_str = partial;
-        fs::path start_dir;
-        
-        if (!path_str.empty() && (path_str[0] == '/' || path_str[0] == '\\')) {
-            // Absolute path - start from root
-            start_dir = "/";
-            path_str = path_str.substr(1); // Remove leading slash
-        } else {
-            // Relative path - start from CWD
-            start_dir = cwd;
-        }
-        
-        // Remove trailing slashes
-        while (!path_str.empty() && (path_str.back() == '/' || path_str.back() == '\\')) {
-            path_str.pop_back();
-        }
-        
-        return find_path(start_dir, path_str, 0);
+        return find_path(start_dir, 0, 0);
     }
 
     // ==================================================================================
@@ -432,6 +774,9 @@ namespace dais::core {
     void Engine::run() {
         if (!pty_.start()) return;
 
+        // Lazy startup: plugins and db_handler import while the shell starts
+        if (python_requested_) start_python();
+
         // We must sync the window size AFTER the PTY has started (so master_fd is valid),
         // but BEFORE we start forwarding output, otherwise text wraps weirdly.
         struct winsize w;
@@ -440,6 +785,19 @@ namespace dais::core {
         }
 
         running_ = true;
+
+        // Event sources for the main loop (process_user_input)
+        reactor_.watch(STDIN_FILENO, utils::Reactor::READABLE, [this](unsigned) { stdin_ready_ = true; });
+        reactor_.watch_signal(SIGWINCH, [this]() {
+            // Resize storms (window drags) collapse into one update per frame
+            if (resize_pending_) return;
+            resize_pending_ = true;
+            reactor_.add_timer(std::chrono::milliseconds(RESIZE_COALESCE_MS), [this]() {
+                resize_pending_ = false;
+                struct winsize ws;
+                if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != -1) resize_window(ws.ws_row, ws.ws_col);
+            });
+        });
         
         // Rebranded Startup Message with Configured Theme
         std::cout << "\r[" 
@@ -450,14 +808,25 @@ namespace dais::core {
         // Spawn the output reader thread (Child -> Screen)
         std::thread output_thread(&Engine::forward_shell_output, this);
 
-        // Run the input processing loop (Keyboard -> Child) in the main thread
+        // Run the input processing loop (Keyboard -> Child) in the main thread.
+        // Python lives on its own thread; the input loop only takes the GIL around
+        // sync hooks and :db.
         process_user_input();
+        stop_python(); // Deliver pending hook events, then finalize the interpreter
 
         // Cleanup
         if (output_thread.joinable()) output_thread.join();
         
         waitpid(pty_.get_child_pid(), nullptr, 0);
         pty_.stop();
+
+        // Persist metadata cache for the next session (no-op if unchanged)
+        if (!stats_cache_file_.empty()) stats_cache_.save(stats_cache_file_);
+
+        if (!config_.perf_dump_on_exit.empty() && !dump_perf(config_.perf_dump_on_exit)) {
+            std::cerr << "[" << handlers::Theme::WARNING << "-" << handlers::Theme::RESET
+                      << "] Could not write perf counters to " << config_.perf_dump_on_exit << "\n";
+        }
         
         std::cout << "\r[" 
                   << dais::core::handlers::Theme::ERROR << "-" 
@@ -472,59 +841,74 @@ namespace dais::core {
      */
     void Engine::forward_shell_output() {
         std::array<char, BUFFER_SIZE> buffer;
-        struct pollfd pfd{};
-        pfd.fd = pty_.get_master_fd();
-        pfd.events = POLLIN;
+        std::vector<struct iovec> out_spans; // Reused across reads
+        const int master_fd = pty_.get_master_fd();
 
         while (true) {
-            int ret = poll(&pfd, 1, 100);
-
-            if (ret < 0) {
-                if (errno == EINTR) continue; // Resize signal received, just continue
-                break; // Real error, exit loop
+            // Blocks without a timeout: an idle shell costs no wakeups
+            unsigned ready = utils::Reactor::wait_fd(master_fd, utils::Reactor::READABLE, -1);
+            if (ready == 0) break; // poll() failed
+            if ((ready & (utils::Reactor::HANGUP | utils::Reactor::ERROR)) && !(ready & utils::Reactor::READABLE)) {
+                break; // Shell gone and nothing left to read
             }
 
-            // Poll timeout - no data available, continue polling
-            if (ret == 0) continue;
-
-            if (pfd.revents & (POLLERR | POLLHUP)) break;
-
-            if (pfd.revents & POLLIN) {
+            if (ready & utils::Reactor::READABLE) {
                 ssize_t bytes_read = read(pty_.get_master_fd(), buffer.data(), buffer.size());
                 if (bytes_read <= 0) break;
 
                 // --- VISUALIZATION SAFETY ---
                 // If the main thread is running a silent command (capture_mode_),
-                // we consume the output into a buffer and DO NOT print it.
+                // we consume the output into the capture sink and DO NOT print it.
                 if (capture_mode_) {
                     std::lock_guard<std::mutex> lock(capture_mutex_);
-                    capture_buffer_.append(buffer.data(), bytes_read);
-                    capture_cv_.notify_one();
+                    if (!capture_sink_.done() && capture_sink_.feed(buffer.data(), bytes_read)) {
+                        capture_cv_.notify_one(); // Sentinel arrived
+                    }
+                    prompt_matcher_.reset(); // Partial matches do not span diverted output
                     continue; // Skip printing
                 }
 
                 // --- PASS-THROUGH MODE ---
                 // Forward shell output to terminal with optional logo injection.
                 // Uses class members prompt_buffer_ and pass_through_esc_state_ for state.
-                
+                // Each read is scanned once; bytes go out as contiguous spans with a
+                // single writev(), split only where a logo is injected.
+                const char* data = buffer.data();
+                const size_t n = static_cast<size_t>(bytes_read);
+                const std::string_view chunk(data, n);
+
                 // --- LOOK-AHEAD PROMPT DETECTION ---
-                // Check if this buffer contains a prompt BEFORE processing characters.
-                // This allows shell_state_ to be IDLE when we reach the line start.
-                std::string buffer_str(buffer.data(), bytes_read);
-                for (const auto& prompt : config_.shell_prompts) {
-                    if (buffer_str.size() >= prompt.size() &&
-                        buffer_str.find(prompt) != std::string::npos) {
-                        // Buffer contains a prompt - mark as IDLE
-                        // Also check that shell process is actually foreground
-                        if (pty_.is_shell_idle()) {
-                            shell_state_ = ShellState::IDLE;
-                        }
-                        break;
-                    }
+                // One automaton pass finds every prompt and pager marker in this read
+                // (including ones that started in the previous read) BEFORE processing
+                // characters, so shell_state_ is IDLE when we reach the line start.
+                const auto match = prompt_matcher_.scan(chunk);
+                if ((match.anywhere & utils::PromptMatcher::PROMPT) && pty_.is_shell_idle()) {
+                    // Buffer contains a prompt and the shell process is actually foreground
+                    shell_state_ = ShellState::IDLE;
+                    cwd_.prompt_returned();
                 }
+
+                // Injection preconditions cannot change within one read: evaluate once
+                // (the foreground check is a syscall, so only when a line start needs it).
+                const bool logo_enabled = config_.show_logo && shell_state_ == ShellState::IDLE;
+                int shell_idle = -1; // -1 = not queried yet
+                auto shell_idle_now = [&]() {
+                    if (shell_idle < 0) shell_idle = pty_.is_shell_idle() ? 1 : 0;
+                    return shell_idle == 1;
+                };
+                std::string logo_str;
+                if (logo_enabled) {
+                    logo_str = handlers::Theme::RESET + "[" + handlers::Theme::LOGO + "-" + handlers::Theme::RESET + "] ";
+                }
+
+                out_spans.clear();
+                size_t span_start = 0;
+                size_t last_newline = std::string_view::npos;
+                bool line_start = at_line_start_;
                 
-                for (ssize_t i = 0; i < bytes_read; ++i) {
-                    char c = buffer[i];
+                for (size_t i = 0; i < n; ++i) {
+                    char c = data[i];
+                    bool inject = false;
                     
                     // Shell-Specific Logo Injection Strategy:
                     //
@@ -553,73 +937,73 @@ namespace dais::core {
                             pass_through_esc_state_ = 0;
                         } else if (c == kEsc) {
                             pass_through_esc_state_ = 1;
-                        } else if (at_line_start_ && config_.show_logo && shell_state_ == ShellState::IDLE && pty_.is_shell_idle()) {
+                        } else if (line_start && logo_enabled && shell_idle_now()) {
                             // Inject logo at line start when shell is idle
                             // Note: Don't skip spaces - they may be part of multi-line prompt formatting
-                            if (c >= 33 && c < 127) {
-                                std::string logo_str = handlers::Theme::RESET + "[" + handlers::Theme::LOGO + "-" + handlers::Theme::RESET + "] ";
-                                write(STDOUT_FILENO, logo_str.c_str(), logo_str.size());
-                                at_line_start_ = false;
-                            }
+                            inject = (c >= 33 && c < 127);
                         }
                     } else if (!is_complex_shell_) {
                         // Simple shells: inject immediately
-                        if (at_line_start_) {
-                            if (c != '\n' && c != '\r' && config_.show_logo && shell_state_ == ShellState::IDLE && pty_.is_shell_idle()) {
-                                std::string logo_str = handlers::Theme::RESET + "[" + handlers::Theme::LOGO + "-" + handlers::Theme::RESET + "] ";
-                                write(STDOUT_FILENO, logo_str.c_str(), logo_str.size());
-                                at_line_start_ = false;
-                            }
-                        }
+                        inject = line_start && c != '\n' && c != '\r' && logo_enabled && shell_idle_now();
+                    }
+
+                    if (inject) {
+                        if (i > span_start) out_spans.push_back({const_cast<char*>(data + span_start), i - span_start});
+                        out_spans.push_back({logo_str.data(), logo_str.size()});
+                        span_start = i;
+                        line_start = false;
                     }
-                    
-                    write(STDOUT_FILENO, &c, 1);
                     
                     if (c == '\n') {
-                        at_line_start_ = true;
-                        in_more_pager_ = false;  // Pager exits on newline (user scrolled)
-                        std::lock_guard<std::mutex> lock(prompt_mutex_);
-                        prompt_buffer_.clear();
+                        line_start = true;
+                        last_newline = i;
                     } else if (c == '\r') {
                         // For complex shells, \r means "back to line start"
                         // For simple shells, \r often means new prompt line
                         if (!is_complex_shell_) {
-                            at_line_start_ = true;
-                        }
-                    }
-                    
-                    // ALWAYS capture to prompt_buffer_ (printable AND control chars)
-                    // This is critical for the recovery logic to see Esc, Backspace, etc.
-                    if (true) { 
-                        std::lock_guard<std::mutex> lock(prompt_mutex_);
-                        prompt_buffer_ += c;
-                        if (prompt_buffer_.size() > 1024) {
-                            prompt_buffer_ = prompt_buffer_.substr(prompt_buffer_.size() - 1024);
-                        }
-                        
-                        // PAGER DETECTION: Set flag when "--More--" appears in buffer
-                        // This is more reliable than checking in process_user_input
-                        // because it's set synchronously as output is processed.
-                        if (prompt_buffer_.find("--More--") != std::string::npos) {
-                            in_more_pager_ = true;
+                            line_start = true;
                         }
                     }
                 }
-                
-                // --- PROMPT DETECTION: Set state to IDLE ---
-                // Check if output ends with a known shell prompt
+                if (span_start < n) out_spans.push_back({const_cast<char*>(data + span_start), n - span_start});
+                write_all(STDOUT_FILENO, out_spans);
+                at_line_start_ = line_start;
+
+                // --- PROMPT TAIL (one lock per read) ---
+                // prompt_buffer_ holds the current line (from the last \n, inclusive),
+                // capped to its capacity. ALWAYS captures printable AND control chars:
+                // the recovery logic needs to see Esc, Backspace, etc.
                 {
                     std::lock_guard<std::mutex> lock(prompt_mutex_);
-                    for (const auto& prompt : config_.shell_prompts) {
-                        if (prompt_buffer_.size() >= prompt.size() &&
-                            prompt_buffer_.substr(prompt_buffer_.size() - prompt.size()) == prompt) {
-                            shell_state_ = ShellState::IDLE;
-                            break;
-                        }
+                    size_t fresh = n;
+                    if (last_newline != std::string_view::npos) {
+                        prompt_buffer_.clear();
+                        in_more_pager_ = false;  // Pager exits on newline (user scrolled)
+                        fresh = n - last_newline;
                     }
+
+                    // PAGER DETECTION: Set flag when "--More--" appears in the current line.
+                    // Set synchronously with output processing, which is more reliable than
+                    // checking in process_user_input. Matches may straddle two reads.
+                    if (match.since_newline & utils::PromptMatcher::PAGER) {
+                        in_more_pager_ = true;
+                    }
+
+                    prompt_buffer_.append(data + n - fresh, fresh);
+                }
+
+                // --- PROMPT DETECTION: Set state to IDLE ---
+                // Output ends with a known shell prompt
+                if (match.at_end & utils::PromptMatcher::PROMPT) {
+                    shell_state_ = ShellState::IDLE;
+                    cwd_.prompt_returned();
                 }
             }
         }
+
+        // Shell is gone: let the input loop finish instead of waiting for a keypress
+        running_ = false;
+        reactor_.wake();
     }
 
     /**
@@ -629,21 +1013,14 @@ namespace dais::core {
      */
     void Engine::process_user_input() {
         std::array<char, BUFFER_SIZE> buffer;
-        struct pollfd pfd{};
-        pfd.fd = STDIN_FILENO;
-        pfd.events = POLLIN;
-
         std::string cmd_accumulator;
 
         while (running_) {
-            int ret = poll(&pfd, 1, -1);
-
-            if (ret < 0) {
-                if (errno == EINTR) continue; // Signal interrupted, keep going
-                break;
-            }
+            // Dispatches stdin readiness, resize signals and timers
+            stdin_ready_ = false;
+            if (reactor_.run_once() < 0) break;
 
-            if (pfd.revents & POLLIN) {
+            if (stdin_ready_) {
                 ssize_t n = read(STDIN_FILENO, buffer.data(), buffer.size());
                 if (n <= 0) break;
 
@@ -667,6 +1044,20 @@ namespace dais::core {
                         continue; // Swallow this character
                     }
 
+                    // --- REVERSE HISTORY SEARCH (Ctrl-R) ---
+                    // Local prompt only, and only while the shell's own line is empty
+                    // (otherwise Ctrl-R goes to the shell's search). Keys that accept
+                    // the match (Enter, arrows) continue below as usual.
+                    if (history_search_.active) {
+                        if (handle_history_search_key(buffer.data(), n, i, cmd_accumulator)) continue;
+                    } else if (c == '\x12' && pty_.is_shell_idle() &&
+                               (cmd_accumulator.empty() || history_navigated_ || cmd_accumulator[0] == ':') &&
+                               std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - last_command_time_).count() > 200) {
+                        begin_history_search(cmd_accumulator);
+                        continue;
+                    }
+
                     // --- ESCAPE SEQUENCE HANDLING ---
                     // Arrow keys navigate DAIS history when shell is IDLE (at prompt).
                     // Uses prompt detection state + debounce to ensure safety.
@@ -833,7 +1224,7 @@ namespace dais::core {
                             std::string recovered;
                             {
                                 std::lock_guard<std::mutex> lock(prompt_mutex_);
-                                recovered = recover_cmd_from_buffer(prompt_buffer_);
+                                recovered = recover_cmd_from_buffer(prompt_buffer_.str());
                             }
                             
                             // Use recovered if available and:
@@ -862,7 +1253,7 @@ namespace dais::core {
                                 // For remote sessions, we inject into remote shell history instead
                                 if (!is_remote_session_) {
                                     save_history_entry(clean);
-                                    history_index_ = command_history_.size();
+                                    history_index_ = history_.end();
                                 }
 
                                 std::string query = clean.length() > 3 ? clean.substr(4) : "";
@@ -895,7 +1286,7 @@ namespace dais::core {
                             else if (clean == ":help") {
                                 // Save to local history immediately
                                 save_history_entry(clean);
-                                history_index_ = command_history_.size();
+                                history_index_ = history_.end();
 
                                 // CLEAR REMOTE LINE
                                 const char kill_line = kCtrlU; 
@@ -915,11 +1306,25 @@ namespace dais::core {
 
                                 intercept = true;
                             }
+                            // Check for Perf command (remote stages are the interesting ones over SSH)
+                            else if (clean.starts_with(":perf")) {
+                                save_history_entry(clean);
+                                history_index_ = history_.end();
+
+                                // CLEAR REMOTE LINE
+                                const char kill_line = kCtrlU;
+                                write(pty_.get_master_fd(), &kill_line, 1);
+
+                                show_perf(clean.length() > 5 ? clean.substr(6) : "");
+                                write(pty_.get_master_fd(), "\n", 1); // Fresh remote prompt
+
+                                intercept = true;
+                            }
                             // Check for LS customization command
                             else if (clean.starts_with(":ls")) {
                                 // Save to local history immediately
                                 save_history_entry(clean);
-                                history_index_ = command_history_.size();
+                                history_index_ = history_.end();
 
                                 std::string args = clean.length() > 3 ? clean.substr(4) : "";
                                 
@@ -932,7 +1337,8 @@ namespace dais::core {
                                     msg += "Sort By: " + config_.ls_sort_by + "\r\n";
                                     msg += "Order: " + config_.ls_sort_order + "\r\n";
                                     msg += "Dirs First: " + std::to_string(config_.ls_dirs_first) + "\r\n";
-                                    msg += "[USAGE] :ls [name|size|type|rows] [asc|desc]\r\n";
+                                    msg += std::string("Rows: ") + (config_.ls_exact ? "exact" : "estimate") + "\r\n";
+                                    msg += "[USAGE] :ls [name|size|type|rows] [asc|desc] [exact|estimate]\r\n";
                                     write(STDOUT_FILENO, msg.c_str(), msg.size());
                                 } else {
                                     std::stringstream ss(args);
@@ -949,9 +1355,12 @@ namespace dais::core {
                                         else if (segment == "rows") config_.ls_sort_by = "rows";
                                         else if (segment == "asc") config_.ls_sort_order = "asc";
                                         else if (segment == "desc") config_.ls_sort_order = "desc";
+                                        else if (segment == "exact") config_.ls_exact = true;
+                                        else if (segment == "estimate") config_.ls_exact = false;
                                     }
                                     
-                                    std::string confirm = "\r\nUpdated: Sort=" + config_.ls_sort_by + " Order=" + config_.ls_sort_order + "\r\n";
+                                    std::string confirm = "\r\nUpdated: Sort=" + config_.ls_sort_by + " Order=" + config_.ls_sort_order +
+                                                          " Rows=" + (config_.ls_exact ? "exact" : "estimate") + "\r\n";
                                     write(STDOUT_FILENO, confirm.c_str(), confirm.size());
                                 }
 
@@ -1021,7 +1430,7 @@ namespace dais::core {
                             // Save to DAIS history file (~/.dais_history)
                             if (!cmd_accumulator.empty()) {
                                 save_history_entry(cmd_accumulator);
-                                history_index_ = command_history_.size();
+                                history_index_ = history_.end();
                                 history_stash_.clear();
                             }
                         }
@@ -1070,11 +1479,7 @@ namespace dais::core {
                                         
                                         if (!json_out.empty() && json_out.starts_with("[")) {
                                             // Render
-                                            handlers::LSFormats formats;
-                                            formats.directory = config_.ls_fmt_directory;
-                                            formats.text_file = config_.ls_fmt_text_file;
-                                            formats.data_file = config_.ls_fmt_data_file;
-                                            formats.binary_file = config_.ls_fmt_binary_file;
+                                            const handlers::LSFormats& formats = ls_formats_; // Compiled at config load
                                             
                                             handlers::LSSortConfig sort_cfg;
                                             sort_cfg.by = config_.ls_sort_by;
@@ -1082,7 +1487,9 @@ namespace dais::core {
                                             sort_cfg.dirs_first = config_.ls_dirs_first;
                                             sort_cfg.flow = config_.ls_flow;
                                             
+                                            utils::PerfTimer render_timer(utils::PerfStage::REMOTE_RENDER);
                                             std::string rendered = handlers::render_remote_ls(json_out, formats, sort_cfg, config_.ls_padding);
+                                            render_timer.stop();
                                             
                                             if (!rendered.empty()) {
                                                 // Clear line and print grid
@@ -1122,11 +1529,12 @@ namespace dais::core {
                                             // Reconstruct command for history
                                             resolved_cmd = "ls";
                                             if (ls_args.show_hidden) resolved_cmd += " -a";
+                                            if (ls_args.recursive) resolved_cmd += " -R";
                                             resolved_cmd += " " + resolved.string();
                                             
                                             // Save resolved command to history
                                             save_history_entry(resolved_cmd);
-                                            history_index_ = command_history_.size();
+                                            history_index_ = history_.end();
                                             history_stash_.clear();
                                         } else {
                                             // Resolution failed - let shell handle it
@@ -1137,11 +1545,7 @@ namespace dais::core {
                                 
                                     if (ls_args.supported) {
                                     // Build format/sort config from current settings
-                                    handlers::LSFormats formats;
-                                    formats.directory = config_.ls_fmt_directory;
-                                    formats.text_file = config_.ls_fmt_text_file;
-                                    formats.data_file = config_.ls_fmt_data_file;
-                                    formats.binary_file = config_.ls_fmt_binary_file;
+                                    const handlers::LSFormats& formats = ls_formats_; // Compiled at config load
                                     
                                     handlers::LSSortConfig sort_cfg;
                                     sort_cfg.by = config_.ls_sort_by;
@@ -1150,15 +1554,48 @@ namespace dais::core {
                                     sort_cfg.flow = config_.ls_flow;
                                     
                                     // Execute native ls
-                                    std::string output = handlers::native_ls(
-                                        ls_args, shell_cwd_, formats, sort_cfg, thread_pool_
-                                    );
-                                    
+                                    // Exact mode: one byte/time budget shared by the whole listing
+                                    dais::utils::ScanBudget budget(config_.ls_exact_max_mb * 1024 * 1024,
+                                                                   std::chrono::milliseconds(config_.ls_exact_max_ms));
+                                    dais::utils::AnalyzeOptions analyze_opts{config_.ls_exact, &budget, config_.ls_dir_count_cap};
+
+                                    // Slow listings paint a preliminary grid first (redrawn in place)
+                                    handlers::LSProgressive progressive;
+                                    if (config_.ls_progressive) {
+                                        progressive.emit = [](std::string_view chunk) {
+                                            write(STDOUT_FILENO, chunk.data(), chunk.size());
+                                        };
+                                        progressive.first_paint = std::chrono::milliseconds(config_.ls_first_paint_ms);
+                                        progressive.entry_timeout = std::chrono::milliseconds(config_.ls_entry_timeout_ms);
+                                    }
+
                                     // Write output directly to terminal
+                                    utils::PerfTimer ls_timer(utils::PerfStage::LS_TOTAL);
                                     write(STDOUT_FILENO, "\r\n", 2);
+
+                                    std::string output;
+                                    if (ls_args.recursive) {
+                                        // ls -R: subtree totals per directory (walk limits from LS_TREE)
+                                        dais::utils::TreeOptions limits;
+                                        limits.max_depth = config_.ls_tree_max_depth;
+                                        limits.max_entries = config_.ls_tree_max_entries;
+                                        output = handlers::native_tree_ls(
+                                            ls_args, handlers::LSCwd(shell_cwd_, cwd_.fd()), formats, sort_cfg, io_pool_,
+                                            config_.ls_cache ? &stats_cache_ : nullptr, analyze_opts, limits,
+                                            config_.ls_git ? &git_status_ : nullptr, &thread_pool_
+                                        );
+                                    } else {
+                                        output = handlers::native_ls(
+                                            ls_args, handlers::LSCwd(shell_cwd_, cwd_.fd()), formats, sort_cfg, io_pool_,
+                                            config_.ls_cache ? &stats_cache_ : nullptr, analyze_opts, progressive,
+                                            config_.ls_git ? &git_status_ : nullptr, &thread_pool_
+                                        );
+                                    }
+                                    
                                     if (!output.empty()) {
                                         write(STDOUT_FILENO, output.c_str(), output.size());
                                     }
+                                    ls_timer.stop();
                                     
                                     // Cancel the shell's pending input and trigger new prompt
                                     // The user typed "ls" which was forwarded to shell as they typed.
@@ -1196,14 +1633,16 @@ namespace dais::core {
                                     msg = "ls: by=" + config_.ls_sort_by + 
                                           ", order=" + config_.ls_sort_order + 
                                           ", dirs_first=" + (config_.ls_dirs_first ? "true" : "false") +
-                                          ", flow=" + config_.ls_flow;
+                                          ", flow=" + config_.ls_flow +
+                                          ", rows=" + (config_.ls_exact ? "exact" : "estimate");
                                 } else if (args == "d") {
                                     // Reset to defaults
                                     config_.ls_sort_by = "type";
                                     config_.ls_sort_order = "asc";
                                     config_.ls_dirs_first = true;
                                     config_.ls_flow = "h";
-                                    msg = "ls: by=type, order=asc, dirs_first=true, flow=h (defaults)";
+                                    config_.ls_exact = false;
+                                    msg = "ls: by=type, order=asc, dirs_first=true, flow=h, rows=estimate (defaults)";
                                 } else {
                                     // Flexible parsing: iterate over all parts and match keywords
                                     std::vector<std::string> parts;
@@ -1240,12 +1679,20 @@ namespace dais::core {
                                         else if (p == "v" || p == "vertical") {
                                             config_.ls_flow = "v";
                                         }
+                                        // 5. Row Counting Mode
+                                        else if (p == "exact") {
+                                            config_.ls_exact = true;
+                                        }
+                                        else if (p == "estimate") {
+                                            config_.ls_exact = false;
+                                        }
                                     }
                                     
                                     msg = "ls: by=" + config_.ls_sort_by + 
                                           ", order=" + config_.ls_sort_order + 
                                           ", dirs_first=" + (config_.ls_dirs_first ? "true" : "false") +
-                                          ", flow=" + config_.ls_flow;
+                                          ", flow=" + config_.ls_flow +
+                                          ", rows=" + (config_.ls_exact ? "exact" : "estimate");
                                 }
                                 
                                 // Print feedback and new prompt
@@ -1261,6 +1708,7 @@ namespace dais::core {
                             // 4. History Command
                             // :history       - Show last 20 commands
                             // :history N     - Show last N commands
+                            // :history search <terms> - Newest matches
                             // :history clear - Clear all history
                             if (cmd_accumulator.starts_with(":history")) {
                                 std::string args = cmd_accumulator.length() > 8 
@@ -1275,7 +1723,20 @@ namespace dais::core {
                                 continue;
                             }
                             
-                            // 5. Help Command
+                            // 5. Perf Command
+                            // :perf [reset | json [file]] - Stage latency histograms
+                            if (cmd_accumulator.starts_with(":perf")) {
+                                std::string args = cmd_accumulator.length() > 5
+                                    ? cmd_accumulator.substr(6) : "";
+
+                                show_perf(args);
+
+                                cmd_accumulator.clear();
+                                write(pty_.get_master_fd(), "\n", 1);
+                                continue;
+                            }
+
+                            // 6. Help Command
                             // :help - Show all available DAIS commands
                             if (cmd_accumulator == ":help") {
                                 std::cout << "\r\n" << get_help_text() << std::flush;
@@ -1285,7 +1746,7 @@ namespace dais::core {
                                 continue;
                             }
 
-                            // 6. DB Command
+                            // 7. DB Command
                             // :db <query> or :db <saved_query_key>
                             if (cmd_accumulator.starts_with(":db")) {
                                 std::string query = cmd_accumulator.length() > 3 
@@ -1321,9 +1782,19 @@ namespace dais::core {
                             }
                         }
 
-                        trigger_python_hook("on_command", cmd_accumulator);
+                        // Async hooks are queued; sync ones may rewrite the command before it runs
+                        if (hooks_.has(utils::HookDispatcher::Hook::ON_COMMAND)) {
+                            auto rewritten = hooks_.dispatch(utils::HookDispatcher::Hook::ON_COMMAND, cmd_accumulator);
+                            if (rewritten && *rewritten != cmd_accumulator && !tab_used_ && pty_.is_shell_idle()) {
+                                // Queued behind this read's keystrokes still in data_to_write (a paste
+                                // carries the whole line), so the kill erases them before the Enter
+                                data_to_write += kCtrlU;
+                                data_to_write += *rewritten;
+                            }
+                        }
                         cmd_accumulator.clear();
                         tab_used_ = false;  // Reset for next command
+                        cwd_.command_forwarded(); // The shell runs it: cwd may change
                         data_to_write += c;
                     }
                     // Handle Backspace
@@ -1333,7 +1804,7 @@ namespace dais::core {
                         // We try to recover it so we can keep edits within DAIS.
                         if (cmd_accumulator.empty()) {
                             std::lock_guard<std::mutex> lock(prompt_mutex_);
-                            std::string recovered = recover_cmd_from_buffer(prompt_buffer_);
+                            std::string recovered = recover_cmd_from_buffer(prompt_buffer_.str());
                             if (recovered.starts_with(":")) {
                                 cmd_accumulator = recovered;
                             }
@@ -1379,7 +1850,7 @@ namespace dais::core {
                         // before the first new character "leaks" to the shell.
                         if (cmd_accumulator.empty()) {
                             std::lock_guard<std::mutex> lock(prompt_mutex_);
-                            std::string recovered = recover_cmd_from_buffer(prompt_buffer_);
+                            std::string recovered = recover_cmd_from_buffer(prompt_buffer_.str());
                             if (recovered.starts_with(":")) {
                                 cmd_accumulator = recovered;
                             }
@@ -1448,6 +1919,7 @@ namespace dais::core {
     // =========================================================================
 
     void Engine::handle_remote_ls(const handlers::LSArgs& ls_args, const std::string& original_cmd) {
+        utils::PerfTimer total_timer(utils::PerfStage::REMOTE_LS_TOTAL); // First call includes the deploy
         // 1. Cancel the user's "ls" characters that are sitting on the remote prompt
         // Ctrl-C (\x03) can be unreliable if the shell is laggy.
         // Safer: Ctrl-A (Start of Line) + Ctrl-K (Kill Line)
@@ -1456,6 +1928,13 @@ namespace dais::core {
                 
         // 2. Deployment Check
         deploy_remote_agent(); 
+
+        // The Python tier has no tree walk: let the remote shell run the real ls -R
+        if (ls_args.recursive && !remote_agent_deployed_) {
+            std::string restore = original_cmd + "\n";
+            write(pty_.get_master_fd(), restore.c_str(), restore.size());
+            return;
+        }
         
         std::string json_out;
         
@@ -1484,14 +1963,51 @@ namespace dais::core {
         if (remote_agent_deployed_) {
             // A. Binary Agent (Preferred / Fast)
             // \x15 is now handled in execute_remote_command
-            std::string agent_cmd = "./.dais/bin/agent_" + (remote_arch_.empty() ? "x86_64" : remote_arch_);
-            agent_cmd += (ls_args.show_hidden ? " -a" : "");
-            agent_cmd += paths_arg;
-            
-            // Chain: History Inject -> Agent
-            std::string full_cmd = history_inject + "; " + agent_cmd;
-            
-            json_out = execute_remote_command(full_cmd, 5000);
+            std::vector<std::string> agent_args;
+            if (ls_args.show_hidden) agent_args.push_back("-a");
+            if (config_.ls_cache) agent_args.push_back("--cache"); // Agent keeps its own ~/.dais cache
+            if (config_.ls_exact) {
+                agent_args.push_back("--exact=" + std::to_string(config_.ls_exact_max_mb) + "," +
+                                     std::to_string(config_.ls_exact_max_ms));
+            }
+            if (config_.ls_dir_count_cap > 0) {
+                agent_args.push_back("--count-cap=" + std::to_string(config_.ls_dir_count_cap));
+            }
+            if (remote_agent_wire_ > 0) {
+                agent_args.push_back("--wire=" + std::to_string(remote_agent_wire_)); // Compact records, no JSON
+            }
+            if (ls_args.recursive) {
+                // The agent walks and sums on the remote side; only the top-level rows come back
+                agent_args.push_back("--tree=" + std::to_string(config_.ls_tree_max_depth) + "," +
+                                     std::to_string(config_.ls_tree_max_entries));
+            }
+
+            // A1. Resident agent: one shell builtin per listing, warm cache
+            bool history_done = false;
+            if (!remote_agent_fifo_.empty()) {
+                std::vector<std::string> request_args = agent_args;
+                for (const auto& p : ls_args.paths) {
+                    if (!p.empty()) request_args.push_back("\"" + p + "\"");
+                }
+                json_out = request_resident_agent(history_inject, request_args, 5000);
+                history_done = true;
+                if (!dais::utils::WireDecoder(json_out).valid()) {
+                    // Agent exited (idle timeout, killed): stop asking it, use the binary directly
+                    remote_agent_fifo_.clear();
+                    json_out.clear();
+                }
+            }
+
+            if (json_out.empty()) {
+                std::string agent_cmd = "./.dais/bin/agent_" + (remote_arch_.empty() ? "x86_64" : remote_arch_);
+                for (const auto& arg : agent_args) agent_cmd += " " + arg;
+                agent_cmd += paths_arg;
+
+                // Chain: History Inject -> Agent
+                std::string full_cmd = history_done ? agent_cmd : history_inject + "; " + agent_cmd;
+
+                json_out = execute_remote_command(full_cmd, 5000);
+            }
         } else {
             // B. Python Fallback (Tier 2 - Slower but Universal)
             // Enhanced with file analysis logic (counts items, rows, cols)
@@ -1566,11 +2082,16 @@ namespace dais::core {
         }
         
         // 5. Validation Check
-        size_t bracket = json_out.find('[');
-        bool valid_json = !json_out.empty() && bracket != std::string::npos;
-        
-        if (valid_json) {
-            json_out = json_out.substr(bracket);
+        bool valid_json = false;
+        if (remote_agent_deployed_ && remote_agent_wire_ > 0) {
+            // Wire payload: the decoder locates its own header line
+            valid_json = dais::utils::WireDecoder(json_out).valid();
+        } else {
+            size_t bracket = json_out.find('[');
+            valid_json = !json_out.empty() && bracket != std::string::npos;
+            if (valid_json) {
+                json_out.erase(0, bracket);
+            }
         }
         
         // 6. Fallback Behavior
@@ -1583,11 +2104,7 @@ namespace dais::core {
         
         // 7. Render
         if (valid_json) {
-            handlers::LSFormats formats;
-            formats.directory = config_.ls_fmt_directory;
-            formats.text_file = config_.ls_fmt_text_file;
-            formats.data_file = config_.ls_fmt_data_file;
-            formats.binary_file = config_.ls_fmt_binary_file;
+            const handlers::LSFormats& formats = ls_formats_; // Compiled at config load
             
             handlers::LSSortConfig sort_cfg;
             sort_cfg.by = config_.ls_sort_by;
@@ -1595,7 +2112,10 @@ namespace dais::core {
             sort_cfg.dirs_first = config_.ls_dirs_first;
             sort_cfg.flow = config_.ls_flow;
             
-            std::string output = handlers::render_remote_ls(json_out, formats, sort_cfg, config_.ls_padding);
+            utils::PerfTimer render_timer(utils::PerfStage::REMOTE_RENDER);
+            std::string output = handlers::render_remote_ls(json_out, formats, sort_cfg, config_.ls_padding,
+                                                            ls_args.recursive);
+            render_timer.stop();
             
             if (!output.empty()) {
                 write(STDOUT_FILENO, "\r\n", 2);
@@ -1748,18 +2268,11 @@ namespace dais::core {
         }
         
         // 2. Find the last prompt in clean buffer
+        // (same automaton as the output thread; picks the rightmost prompt found)
         size_t best_pos = std::string::npos;
         size_t prompt_len = 0;
-        
-        for (const auto& prompt : config_.shell_prompts) {
-            size_t pos = clean_line.rfind(prompt);
-            // Pick the rightmost prompt found
-            if (pos != std::string::npos) {
-                if (best_pos == std::string::npos || pos > best_pos) {
-                    best_pos = pos;
-                    prompt_len = prompt.size();
-                }
-            }
+        if (!prompt_matcher_.find_last_prompt(clean_line, best_pos, prompt_len)) {
+            best_pos = std::string::npos;
         }
         
         // 3. Extract command
@@ -1800,6 +2313,9 @@ namespace dais::core {
         if (is_remote_session_ && !was) {
              // New session detected - reset deployment state
              remote_agent_deployed_ = false;
+             remote_agent_wire_ = 0;
+             remote_agent_fifo_.clear();
+             remote_agent_pid_.clear();
              remote_db_deployed_ = false; // Reset DB handler too
              remote_arch_ = "";
              
@@ -1811,41 +2327,51 @@ namespace dais::core {
         }
     }
 
-    std::string Engine::execute_remote_command(const std::string& cmd, int timeout_ms) {
-        // Only run if legitimate
-        if (!pty_.is_shell_idle() && !is_remote_session_) return "";
-
-        // 1. Prepare Capture
-        {
-            std::lock_guard<std::mutex> lock(capture_mutex_);
-            capture_buffer_.clear();
-            capture_mode_ = true;
-        }
-
-        // 2. Send Command with Sentinel
+    Engine::CaptureSentinel Engine::make_capture_sentinel() const {
         // We use arithmetic expansion to ensure the command echo is totally different from the result
         // Echo: "echo $(( A + B ))"
         // Result: "Sum"
         auto now = std::chrono::system_clock::now().time_since_epoch().count() % 1000000000; // shorter
         long long part_a = now / 2;
         long long part_b = now - part_a;
-        
-        std::string sentinel = "DAIS_END_" + std::to_string(now);
-        
+        return {"DAIS_END_" + std::to_string(now),
+                "$(( " + std::to_string(part_a) + " + " + std::to_string(part_b) + " ))"};
+    }
+
+    std::string Engine::execute_remote_command(const std::string& cmd, int timeout_ms) {
+        // Only run if legitimate
+        if (!pty_.is_shell_idle() && !is_remote_session_) return "";
+
         // Command format: "\x15 cmd; echo DAIS_END_$(( A + B ))\n"
         // 1. \x15 (Ctrl+U): Clears the current line (e.g. "ls path/")
         // 2. " " (Space): Prevents command from being saved to history (HISTCONTROL=ignorespace)
         // 3. Command & Sentinel
+        CaptureSentinel sentinel = make_capture_sentinel();
         std::string full_cmd;
         full_cmd += kCtrlU;
-        full_cmd += " " + cmd + "; echo DAIS_END_$(( " + std::to_string(part_a) + " + " + std::to_string(part_b) + " ))\n";
-        
-        write(pty_.get_master_fd(), full_cmd.c_str(), full_cmd.size());
+        full_cmd += " " + cmd + "; echo DAIS_END_" + sentinel.expr + "\n";
+        return capture_remote(full_cmd, sentinel.text, timeout_ms);
+    }
+
+    std::string Engine::capture_remote(const std::string& line, const std::string& sentinel, int timeout_ms) {
+        utils::PerfTimer roundtrip_timer(utils::PerfStage::REMOTE_ROUNDTRIP); // Timeouts included
+        // 1. Prepare Capture
+        // The sink parses output as the output thread feeds it: sentinel matching,
+        // echo-line removal (the echo OF THE COMMAND contains "DAIS_END_" too),
+        // whitespace trimming and ANSI stripping all happen while streaming.
+        {
+            std::lock_guard<std::mutex> lock(capture_mutex_);
+            capture_sink_.reset(sentinel, "DAIS_END_");
+            capture_mode_ = true;
+        }
+
+        // 2. Send Command Line
+        write(pty_.get_master_fd(), line.c_str(), line.size());
 
-        // 3. Wait for Sentinel
+        // 3. Wait for Sentinel (the output thread notifies once, when it arrives)
         std::unique_lock<std::mutex> lock(capture_mutex_);
         bool finished = capture_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]{
-            return capture_buffer_.find(sentinel) != std::string::npos;
+            return capture_sink_.done();
         });
 
         // 4. Disable Capture
@@ -1854,78 +2380,62 @@ namespace dais::core {
         if (!finished) {
             return ""; // Timeout
         }
-        
-        // 5. Clean Buffer (Strip Echo and Sentinel)
-        // Captured buffer looks like: " cmd; echo DAIS_END_...\r\nOUTPUT\r\nDAIS_END_...\r\n"
-        // We want just "OUTPUT"
-        
-        std::string clean = capture_buffer_;
-        
-        // Remove the Sentinel line at the end
-        size_t sent_pos = clean.find(sentinel);
-        if (sent_pos != std::string::npos) {
-            clean = clean.substr(0, sent_pos);
-        }
-        
-        // Remove the Command Echo at the start
-        // The shell might echo the command we sent. 
-        // We look for the FIRST newline, assuming the command echo is on the first line.
-        // BUT, strictly speaking, we can just look for the last occurrence of the command string?
-        // No, that's risky.
-        // Better heuristic:
-        // Remote commands are sent as " cmd; echo ...".
-        // The echo might contain that full string.
-        // We also know the *previous* command output ended with a prompt.
-        // Actually, we can just look for the first line that is NOT the command echo?
-        // Let's just strip the first line if it contains "DAIS_END_".
-        // Because the echo OF THE COMMAND contains the sentinel string too (in the echo part)!
-        
-        size_t first_newline = clean.find('\n');
-        if (first_newline != std::string::npos) {
-             std::string first_line = clean.substr(0, first_newline);
-             if (first_line.find("DAIS_END_") != std::string::npos) {
-                 clean = clean.substr(first_newline + 1);
-             }
+
+        // 5. Hand over the cleaned output (moved, not copied)
+        return capture_sink_.take();
+    }
+
+    std::string Engine::request_resident_agent(const std::string& prefix, const std::vector<std::string>& args,
+                                               int timeout_ms) {
+        if (remote_agent_fifo_.empty()) return "";
+        if (!pty_.is_shell_idle() && !is_remote_session_) return "";
+
+        // The request is a builtin printf into the agent's FIFO (no fork/exec on the remote);
+        // the agent answers on this terminal, ending with the sentinel like any captured
+        // command. If the agent is gone, the shell prints the bare sentinel instead (empty result).
+        // Fields are 0x1f-separated: sentinel, verb, cwd, args (see agent.cpp serve()).
+        CaptureSentinel sentinel = make_capture_sentinel();
+        std::string format = "DAIS_END_%s\\037ls\\037%s";
+        std::string words;
+        for (const auto& arg : args) {
+            format += "\\037%s";
+            words += " " + arg;
         }
-        
-        // Trim whitespace
-        const char* ws = " \t\n\r\x0b\x0c";
-        clean.erase(0, clean.find_first_not_of(ws));
-        clean.erase(clean.find_last_not_of(ws) + 1);
-        
-        // 6. Strip ANSI Escape Codes (Crucial for remote shell hygiene)
-        // Simple state machine to remove \x1b[...] and \x1b(...) sequences
-        std::string final_clean;
-        final_clean.reserve(clean.size());
-        bool in_esc = false;
-        
-        for (size_t i = 0; i < clean.size(); ++i) {
-            char c = clean[i];
-            if (c == kEsc) {
-                in_esc = true;
-                // Look ahead for [ or (
-                if (i + 1 < clean.size() && (clean[i+1] == '[' || clean[i+1] == '(')) {
-                    i++; // Skip the bracket too, let the loop eat the rest
-                } else {
-                    // Not a CSI sequence we know? just skip ESC
-                    in_esc = false; // Actually, solitary ESC might be valid, but here we assume garbage.
-                }
-                continue;
-            }
-            
-            if (in_esc) {
-                // End of ANSI sequence is usually a letter
-                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
-                    in_esc = false;
-                }
-                // Continue skipping
-                continue;
-            }
-            
-            final_clean += c;
+        format += "\\n";
+
+        std::string line;
+        line += kCtrlU;
+        line += " ";
+        if (!prefix.empty()) line += prefix + "; ";
+        line += "[ -p " + remote_agent_fifo_ + " ] && kill -0 " + remote_agent_pid_ + " 2>/dev/null && "
+                "printf '" + format + "' " + sentinel.expr + " \"$PWD\"" + words + " > " + remote_agent_fifo_ +
+                " || echo DAIS_END_" + sentinel.expr + "\n";
+        return capture_remote(line, sentinel.text, timeout_ms);
+    }
+
+    void Engine::start_resident_agent(const std::string& agent_path) {
+        remote_agent_fifo_.clear();
+        remote_agent_pid_.clear();
+        if (!config_.remote_agent_resident || remote_agent_wire_ <= 0) return;
+
+        // Prints "DAIS_SERVE_READY <pid> <fifo>" and detaches; older agents print nothing useful
+        std::string out = execute_remote_command(
+            "./" + agent_path + " --serve --idle=" + std::to_string(config_.remote_agent_idle_s), 2000);
+        size_t pos = out.find("DAIS_SERVE_READY ");
+        if (pos == std::string::npos) return;
+
+        std::string_view rest = std::string_view(out).substr(pos + 17);
+        size_t space = rest.find(' ');
+        if (space == std::string_view::npos) return;
+        std::string pid(rest.substr(0, space));
+        std::string fifo(rest.substr(space + 1, rest.find_first_of("\r\n", space + 1) - space - 1));
+        // Both end up unquoted in a shell command: only accept plain values
+        bool pid_ok = !pid.empty() && pid.find_first_not_of("0123456789") == std::string::npos;
+        bool fifo_ok = !fifo.empty() && fifo.find_first_of(" \t\"'`$\\;&|<>()*?[]{}") == std::string::npos;
+        if (pid_ok && fifo_ok) {
+            remote_agent_pid_ = pid;
+            remote_agent_fifo_ = fifo;
         }
-        
-        return final_clean;
     }
 
     void Engine::deploy_remote_agent() {
@@ -1965,59 +2475,124 @@ namespace dais::core {
              return; 
         }
 
-        // 3. Inject Binary (Silent Streaming Upload)
-        // 1. Disable Echo (stty -echo) to prevent 1.5MB of base64 from spamming the user's terminal
-        // 2. Stream Heredoc
-        // 3. Re-enable Echo (stty echo)
-        
-        std::string b64 = base64_encode(agent.data, agent.size);
-        std::string temp_b64 = ".dais/bin/agent_" + remote_arch_ + ".b64";
+        // 3. Probe the Remote (one round trip)
+        // - Cached: an agent with the same SHA-256 is already in .dais/bin (no upload at all)
+        // - Gzip: the compressed payload can be decoded there
+        // - Part: bytes of an interrupted upload of this exact binary (resume point)
+        // The hash is printed by sha256sum or shasum; with neither, it is empty and never matches.
         std::string target_path = ".dais/bin/agent_" + remote_arch_;
-        
-        // Ensure directory exists
-        execute_remote_command("mkdir -p .dais/bin", 2000);
-        execute_remote_command("rm -f " + temp_b64, 2000); 
+        auto remote_hash = [](const std::string& file) {
+            return "{ sha256sum " + file + " || shasum -a 256 " + file + "; } 2>/dev/null | cut -c1-64";
+        };
 
-        // Disable Echo
-        execute_remote_command("stty -echo", 2000);
+        // The hash in the name keeps a stale partial upload of another build from being resumed
+        std::string part_base = ".dais/bin/agent_" + remote_arch_ + "." + agent.sha256.substr(0, 12);
 
-        // Start Heredoc - use single quotes 'DAIS_EOF' to prevent shell expansion
-        std::string start_heredoc = "cat > " + temp_b64 + " << 'DAIS_EOF'\n";
-        write(pty_.get_master_fd(), start_heredoc.c_str(), start_heredoc.size());
-        
-        // Stream Data
-        constexpr size_t PAYLOAD_CHUNK = 4096;
-        size_t sent = 0;
-        
-        while (sent < b64.size()) {
-            size_t n = std::min(PAYLOAD_CHUNK, b64.size() - sent);
-            write(pty_.get_master_fd(), b64.data() + sent, n);
-            sent += n;
-            // Tiny sleep to prevent kernel/remote buffer overflow on fast local systems
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
-        
-        // End Heredoc - ensure it's on a clean new line
-        std::string end_heredoc = "\nDAIS_EOF\n";
-        write(pty_.get_master_fd(), end_heredoc.c_str(), end_heredoc.size());
-        
-        // Wait a moment for shell to finalize the file write
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        execute_remote_command("mkdir -p .dais/bin", 2000);
+        std::string probe = execute_remote_command(
+            "[ \"$(" + remote_hash(target_path) + ")\" = " + agent.sha256 + " ] && echo DAIS_AGENT_CACHED; "
+            "command -v gzip >/dev/null 2>&1 && echo DAIS_HAVE_GZIP; "
+            "echo DAIS_PART_GZ=$(cat " + part_base + ".gz.b64 2>/dev/null | wc -c) "
+            "DAIS_PART_RAW=$(cat " + part_base + ".raw.b64 2>/dev/null | wc -c)",
+            5000);
+
+        bool cached = !agent.sha256.empty() && probe.find("DAIS_AGENT_CACHED") != std::string::npos;
+        std::string result;
+        if (cached) {
+            result = "DAIS_DEPLOY_OK";
+        } else {
+            // 4. Choose the Payload
+            // gzip is part of every coreutils/busybox install we have seen, but fall back to raw bytes
+            bool use_gz = agent.gz_size > 0 && probe.find("DAIS_HAVE_GZIP") != std::string::npos;
+            std::string b64 = use_gz ? base64_encode(agent.gz_data, agent.gz_size) : base64_encode(agent.data, agent.size);
+            std::string temp_b64 = part_base + (use_gz ? ".gz.b64" : ".raw.b64");
+
+            // 5. Split into Chunks
+            // Lines stay well below the terminal's canonical line limit; each chunk is one heredoc
+            // appended to temp_b64, so the remote file size tells exactly how many chunks arrived.
+            constexpr size_t LINE_LEN = 76;
+            constexpr size_t CHUNK_LINES = 1024; // ~77KB per chunk
+            std::vector<std::string> chunks;
+            std::vector<size_t> chunk_end; // Remote file size after each chunk
+            for (size_t pos = 0; pos < b64.size();) {
+                std::string chunk;
+                for (size_t line = 0; line < CHUNK_LINES && pos < b64.size(); ++line, pos += LINE_LEN) {
+                    chunk.append(b64, pos, LINE_LEN);
+                    chunk.push_back('\n');
+                }
+                chunk_end.push_back((chunk_end.empty() ? 0 : chunk_end.back()) + chunk.size());
+                chunks.push_back(std::move(chunk));
+            }
 
-        // Re-enable Echo
-        execute_remote_command("stty echo", 2000);
+            // 6. Resume Point
+            std::string part_key = use_gz ? "DAIS_PART_GZ=" : "DAIS_PART_RAW=";
+            size_t part_pos = probe.find(part_key);
+            size_t part_size = (part_pos != std::string::npos)
+                             ? std::strtoull(probe.c_str() + part_pos + part_key.size(), nullptr, 10) : 0;
+            size_t first_chunk = 0;
+            while (first_chunk < chunks.size() && chunk_end[first_chunk] <= part_size) ++first_chunk;
+            size_t keep = first_chunk ? chunk_end[first_chunk - 1] : 0;
+            if (keep == 0) {
+                execute_remote_command("rm -f .dais/bin/agent_" + remote_arch_ + ".*.b64", 2000);
+            } else if (keep != part_size) {
+                // Drop the torn tail of the chunk that was being written when the upload stopped
+                execute_remote_command("head -c " + std::to_string(keep) + " " + temp_b64 + " > " + temp_b64 +
+                                       ".cut && mv " + temp_b64 + ".cut " + temp_b64, 5000);
+            }
 
-        // Decode and Finalize
-        std::string deploy_cmd = 
-            "base64 -d " + temp_b64 + " > " + target_path + " && "
-            "chmod +x " + target_path + " && "
-            "rm " + temp_b64 + " && "
-            "echo DAIS_DEPLOY_OK";
+            // 7. Upload the Missing Chunks (Silent Streaming Upload)
+            // Echo is disabled so the base64 does not spam the user's terminal; writes are
+            // paced by PTY writability (stream_to_pty), not by fixed sleeps.
+            bool uploaded = true;
+            if (first_chunk < chunks.size()) {
+                execute_remote_command("stty -echo", 2000);
+                for (size_t i = first_chunk; i < chunks.size() && uploaded; ++i) {
+                    // Quoted 'DAIS_EOF' prevents shell expansion
+                    std::string start_heredoc = "cat >> " + temp_b64 + " << 'DAIS_EOF'\n";
+                    write(pty_.get_master_fd(), start_heredoc.c_str(), start_heredoc.size());
+                    uploaded = stream_to_pty(chunks[i]);
+                    std::string end_heredoc = "DAIS_EOF\n";
+                    write(pty_.get_master_fd(), end_heredoc.c_str(), end_heredoc.size());
+                }
+                // Re-enable Echo. The shell runs this only after the last heredoc is written out,
+                // so its sentinel doubles as the "file finalized" barrier (no fixed sleep).
+                uploaded = !execute_remote_command("stty echo; echo DAIS_UPLOADED", 30000).empty() && uploaded;
+            }
 
-        std::string result = execute_remote_command(deploy_cmd, 10000);
+            // 8. Decode, Verify and Install
+            // Decoded to a temporary name and renamed into place: a resident agent from another
+            // session may still be running the old binary (writing over it would fail with ETXTBSY).
+            // It is checked against the SHA-256, or on hosts with neither sha256sum nor shasum
+            // against the POSIX cksum (CRC and size); a mismatch discards the upload so the
+            // next attempt starts clean.
+            std::string staged = target_path + ".new";
+            std::string decode = use_gz ? "base64 -d " + temp_b64 + " | gzip -dc > " + staged
+                                        : "base64 -d " + temp_b64 + " > " + staged;
+            std::string deploy_cmd =
+                decode + " && chmod +x " + staged + " && "
+                "if [ -n \"$(" + remote_hash(staged) + ")\" ]; "
+                "then [ \"$(" + remote_hash(staged) + ")\" = " + agent.sha256 + " ]; "
+                "else [ \"$(cksum < " + staged + " | cut -d' ' -f1-2)\" = \"" + agent.cksum + "\" ]; fi && "
+                "mv " + staged + " " + target_path + " && "
+                "rm -f " + temp_b64 + " && "
+                "echo DAIS_DEPLOY_OK || { rm -f " + staged + " " + temp_b64 + "; echo DAIS_DEPLOY_BAD; }";
+
+            if (uploaded) result = execute_remote_command(deploy_cmd, 10000);
+        }
         
         if (result.find("DAIS_DEPLOY_OK") != std::string::npos) {
             remote_agent_deployed_ = true;
+
+            // Negotiate the output format: agents without --caps print no caps line (JSON)
+            std::string caps = execute_remote_command("./" + target_path + " --caps", 2000);
+            size_t wire_pos = caps.find("DAIS_AGENT_CAPS wire=");
+            if (wire_pos != std::string::npos) {
+                int version = std::atoi(caps.c_str() + wire_pos + 21);
+                remote_agent_wire_ = std::min(version, dais::utils::AGENT_WIRE_VERSION);
+            }
+            if (caps.find(" serve=1") != std::string::npos) {
+                start_resident_agent(target_path);
+            }
         } else {
             // Failed
             if (config_.show_logo) {
@@ -2029,77 +2604,85 @@ namespace dais::core {
 
     }
     
+    bool Engine::stream_to_pty(std::string_view payload) {
+        const int fd = pty_.get_master_fd();
+        size_t sent = 0;
+        while (sent < payload.size()) {
+            // Write only when the master has room: uploads run as fast as the
+            // remote side drains them, without sleeping between chunks
+            unsigned ready = utils::Reactor::wait_fd(fd, utils::Reactor::WRITABLE, PTY_WRITE_TIMEOUT_MS);
+            if (!(ready & utils::Reactor::WRITABLE)) return false;
+
+            size_t n = std::min(PAYLOAD_CHUNK, payload.size() - sent);
+            ssize_t written = write(fd, payload.data() + sent, n);
+            if (written < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                return false;
+            }
+            sent += static_cast<size_t>(written);
+        }
+        return true;
+    }
+    
     /**
      * @brief Loads command history from ~/.dais_history on startup.
+     * The file stays open for appending; duplicates are folded into their newest copy.
      */
     void Engine::load_history() {
         const char* home = getenv("HOME");
         if (!home) return;
         
-        history_file_ = std::filesystem::path(home) / ".dais_history";
-        
-        std::ifstream file(history_file_);
-        if (!file.is_open()) return;
-        
-        std::string line;
-        while (std::getline(file, line)) {
-            if (!line.empty()) {
-                command_history_.push_back(line);
-            }
-        }
-        
-        // Trim to MAX_HISTORY if file was larger
-        while (command_history_.size() > MAX_HISTORY) {
-            command_history_.pop_front();
-        }
+        history_.open((std::filesystem::path(home) / ".dais_history").string(), MAX_HISTORY);
         
         // Initialize index to end so UP goes to newest first
-        history_index_ = command_history_.size();
+        history_index_ = history_.end();
     }
     
     /**
      * @brief Appends a command to history (in-memory and file).
-     * Skips empty commands and duplicates of the last command.
+     * Skips empty commands; a repeated command moves to the newest position.
      */
     void Engine::save_history_entry(const std::string& cmd) {
-        if (cmd.empty()) return;
-        
-        // Skip duplicates
-        if (!command_history_.empty() && command_history_.back() == cmd) {
-            return;
-        }
-        
-        // Add to in-memory buffer
-        command_history_.push_back(cmd);
-        if (command_history_.size() > MAX_HISTORY) {
-            command_history_.pop_front();
-        }
-        
-        // Append to file
-        if (!history_file_.empty()) {
-            std::ofstream file(history_file_, std::ios::app);
-            if (file.is_open()) {
-                file << cmd << "\n";
-            }
-        }
+        history_.add(cmd);
     }
     
     /**
      * @brief Handles :history command.
-     * :history       - Show last 20 commands
-     * :history N     - Show last N commands
-     * :history clear - Clear all history
+     * :history                - Show last 20 commands
+     * :history N              - Show last N commands
+     * :history search <terms> - Show the newest commands containing every term
+     * :history clear          - Clear all history
      */
     void Engine::show_history(const std::string& args) {
         if (args == "clear") {
-            command_history_.clear();
-            if (!history_file_.empty()) {
-                std::ofstream file(history_file_, std::ios::trunc);
-            }
+            history_.clear();
+            history_index_ = history_.end();
             std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
                       << "] History cleared.\r\n" << std::flush;
             return;
         }
+
+        if (args.starts_with("search")) {
+            std::string query = args.size() > 6 ? args.substr(7) : "";
+            std::vector<size_t> found;
+            for (size_t slot = history_.search(query, history_.end());
+                 slot != utils::HistoryStore::npos && found.size() < 20;
+                 slot = history_.search(query, slot)) {
+                found.push_back(slot);
+            }
+            if (found.empty()) {
+                std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
+                          << "] No history matches.\r\n" << std::flush;
+                return;
+            }
+            // Oldest first, like :history
+            std::cout << "\r\n";
+            for (auto it = found.rbegin(); it != found.rend(); ++it) {
+                std::cout << "  " << history_.at(*it) << "\r\n";
+            }
+            std::cout << std::flush;
+            return;
+        }
         
         // Parse count (default 20)
         size_t count = 20;
@@ -2111,22 +2694,92 @@ namespace dais::core {
             }
         }
         
-        if (command_history_.empty()) {
+        if (history_.empty()) {
             std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
                       << "] History is empty.\r\n" << std::flush;
             return;
         }
         
-        // Show last N commands
+        // Show last N commands, numbered 1 = oldest
+        count = std::min(count, history_.size());
+        std::vector<size_t> slots;
+        slots.reserve(count);
+        for (size_t slot = history_.prev(history_.end());
+             slot != utils::HistoryStore::npos && slots.size() < count;
+             slot = history_.prev(slot)) {
+            slots.push_back(slot);
+        }
         std::cout << "\r\n";
-        size_t start = command_history_.size() > count ? command_history_.size() - count : 0;
-        for (size_t i = start; i < command_history_.size(); i++) {
-            std::cout << "[" << handlers::Theme::VALUE << (i + 1) << handlers::Theme::RESET
-                      << "] " << command_history_[i] << "\r\n";
+        size_t number = history_.size() - slots.size() + 1;
+        for (auto it = slots.rbegin(); it != slots.rend(); ++it, ++number) {
+            std::cout << "[" << handlers::Theme::VALUE << number << handlers::Theme::RESET
+                      << "] " << history_.at(*it) << "\r\n";
         }
         std::cout << std::flush;
     }
     
+    /**
+     * @brief Handles :perf command.
+     * :perf             - Show per-stage latencies since start (or the last reset)
+     * :perf reset       - Start a new measurement window
+     * :perf json [file] - Print the counters as JSON, or write them to a file
+     */
+    void Engine::show_perf(const std::string& args) {
+        auto& perf = utils::PerfCounters::instance();
+        if (args == "reset") {
+            perf.reset();
+            std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
+                      << "] Perf counters reset.\r\n" << std::flush;
+            return;
+        }
+        if (args.starts_with("json")) {
+            std::string path = args.size() > 4 ? args.substr(5) : "";
+            if (path.empty()) {
+                std::string json = perf.to_json();
+                size_t pos = 0;
+                while ((pos = json.find('\n', pos)) != std::string::npos) {
+                    json.replace(pos, 1, "\r\n");
+                    pos += 2;
+                }
+                std::cout << "\r\n" << json << std::flush;
+            } else if (dump_perf(path)) {
+                std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
+                          << "] Perf counters saved to " << path << "\r\n" << std::flush;
+            } else {
+                std::cout << "\r\n[" << handlers::Theme::ERROR << "-" << handlers::Theme::RESET
+                          << "] Cannot write " << path << "\r\n" << std::flush;
+            }
+            return;
+        }
+        if (!args.empty()) {
+            std::cout << "\r\n[" << handlers::Theme::WARNING << "-" << handlers::Theme::RESET
+                      << "] Usage: :perf [reset | json [file]]\r\n" << std::flush;
+            return;
+        }
+        if (!perf.enabled()) {
+            std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
+                      << "] Perf counters are disabled (PERF[\"enabled\"] in config.py).\r\n" << std::flush;
+            return;
+        }
+        std::cout << "\r\n[" << handlers::Theme::NOTICE << "-" << handlers::Theme::RESET
+                  << "] " << perf.format_table() << hooks_.format_table() << std::flush;
+    }
+
+    bool Engine::dump_perf(const std::string& path) {
+        std::filesystem::path target = path;
+        if (path.starts_with("~/")) {
+            const char* home = getenv("HOME");
+            if (!home || !*home) return false;
+            target = std::filesystem::path(home) / path.substr(2);
+        }
+        std::error_code ec;
+        if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), ec);
+        std::ofstream file(target, std::ios::trunc);
+        if (!file) return false;
+        file << utils::PerfCounters::instance().to_json();
+        return static_cast<bool>(file);
+    }
+
     /**
      * @brief Navigates through DAIS command history via UP/DOWN arrows.
      * 
@@ -2142,19 +2795,20 @@ namespace dais::core {
         // This check is belt-and-suspenders with the caller's check
         if (!pty_.is_shell_idle()) return;
         
-        if (command_history_.empty()) return;
+        if (history_.empty()) return;
         
         // Stash current line when first navigating up from the end
-        if (history_index_ == command_history_.size() && direction < 0) {
+        if (history_index_ >= history_.end() && direction < 0) {
             history_stash_ = current_line;
         }
         
-        // Calculate new index with boundary checks
+        // Calculate new index with boundary checks (dead slots are skipped)
         size_t new_index = history_index_;
-        if (direction < 0 && history_index_ > 0) {
-            new_index = history_index_ - 1;
-        } else if (direction > 0 && history_index_ < command_history_.size()) {
-            new_index = history_index_ + 1;
+        if (direction < 0) {
+            new_index = history_.prev(history_index_);
+            if (new_index == utils::HistoryStore::npos) return;  // Already at oldest
+        } else if (direction > 0 && history_index_ < history_.end()) {
+            new_index = history_.next(history_index_);
         } else {
             return;  // Already at boundary
         }
@@ -2163,10 +2817,10 @@ namespace dais::core {
         
         // Determine new content
         std::string new_content;
-        if (history_index_ == command_history_.size()) {
+        if (history_index_ >= history_.end()) {
             new_content = history_stash_;  // Restore stashed line
         } else {
-            new_content = command_history_[history_index_];
+            new_content = history_.at(history_index_);
         }
         
         // --- VISUAL UPDATE ONLY ---
@@ -2193,6 +2847,113 @@ namespace dais::core {
         current_line = new_content;
     }
 
+    /**
+     * @brief Starts Ctrl-R reverse history search.
+     *
+     * Like arrow navigation, the search is VISUAL-ONLY: the caller only enters it
+     * while the shell's own line is empty (nothing typed, or a recalled/':' line
+     * that only DAIS has), so the shell never needs to be told. The cursor is
+     * saved at the prompt (DECSC) and every keystroke redraws from there.
+     */
+    void Engine::begin_history_search(std::string& current_line) {
+        history_search_ = HistorySearch{};
+        history_search_.active = true;
+        history_search_.original = current_line;
+
+        std::string out;
+        if (!current_line.empty()) out += "\x1b[" + std::to_string(current_line.size()) + "D\x1b[K";
+        out += "\x1b" "7"; // DECSC: remember the prompt position
+        write(STDOUT_FILENO, out.c_str(), out.size());
+        update_history_search(history_.end());
+    }
+
+    bool Engine::handle_history_search_key(const char* buf, ssize_t n, ssize_t& i, std::string& current_line) {
+        auto& search = history_search_;
+        const char c = buf[i];
+
+        if (c == '\x12') { // Ctrl-R: next older match
+            update_history_search(search.match == utils::HistoryStore::npos ? history_.end() : search.match);
+            return true;
+        }
+        if (c == 127 || c == '\b') {
+            // Drop the last UTF-8 character, then search again from the newest entry
+            while (!search.query.empty() && (static_cast<unsigned char>(search.query.back()) & 0xC0) == 0x80) {
+                search.query.pop_back();
+            }
+            if (!search.query.empty()) search.query.pop_back();
+            search.match = utils::HistoryStore::npos;
+            update_history_search(history_.end());
+            return true;
+        }
+        if (c == '\x07' || (c == kEsc && i + 1 >= n)) { // Ctrl-G / lone Esc: cancel
+            end_history_search(current_line, search.original);
+            return true;
+        }
+        if (c == kCtrlC) { // Cancel with an empty line; Ctrl-C then reaches the shell
+            end_history_search(current_line, "");
+            return false;
+        }
+        if (std::isprint(static_cast<unsigned char>(c)) || (static_cast<unsigned char>(c) & 0x80)) {
+            // Incremental: the current match is still a candidate for the longer query
+            search.query += c;
+            update_history_search(search.match == utils::HistoryStore::npos ? history_.end() : search.match + 1);
+            return true;
+        }
+
+        // Anything else accepts the match. Enter and escape sequences (arrows) then
+        // run as usual on the recalled line; other control keys are consumed.
+        size_t match = search.match;
+        end_history_search(current_line, match == utils::HistoryStore::npos
+                                             ? search.original : std::string(history_.at(match)));
+        if (match != utils::HistoryStore::npos) history_index_ = match;
+        return !(c == '\r' || c == '\n' || c == kEsc);
+    }
+
+    void Engine::update_history_search(size_t before) {
+        auto& search = history_search_;
+        size_t slot = history_.search(search.query, before);
+        search.failed = (slot == utils::HistoryStore::npos);
+        if (!search.failed) search.match = slot;
+
+        std::string label = search.failed ? "(failed history-search)`" : "(history-search)`";
+        label += search.query;
+        label += "': ";
+        if (search.match != utils::HistoryStore::npos) label += history_.at(search.match);
+
+        // Keep it on the prompt line: truncate to the columns left after the prompt
+        size_t prompt_cols = 0;
+        {
+            std::lock_guard<std::mutex> lock(prompt_mutex_);
+            std::string tail = prompt_buffer_.str();
+            size_t nl = tail.find_last_of("\r\n");
+            prompt_cols = handlers::get_visible_length(nl == std::string::npos ? tail : tail.substr(nl + 1));
+        }
+        size_t width = static_cast<size_t>(std::max(handlers::get_terminal_width(), 1));
+        size_t room = width > prompt_cols + 1 ? width - prompt_cols - 1 : width / 2;
+        size_t cols = 0;
+        for (size_t b = 0; b < label.size(); ++b) {
+            if ((static_cast<unsigned char>(label[b]) & 0xC0) == 0x80) continue; // UTF-8 continuation
+            if (++cols > room) {
+                label.resize(b);
+                break;
+            }
+        }
+
+        std::string out = "\x1b" "8\x1b[J" + label; // DECRC + clear to end of screen
+        write(STDOUT_FILENO, out.c_str(), out.size());
+    }
+
+    void Engine::end_history_search(std::string& current_line, const std::string& line) {
+        history_search_.active = false;
+        std::string out = "\x1b" "8\x1b[J" + line;
+        write(STDOUT_FILENO, out.c_str(), out.size());
+
+        // Recalled line is visual-only until Enter / editing syncs it (as with arrows)
+        current_line = line;
+        history_navigated_ = !line.empty();
+        history_index_ = history_.end();
+    }
+
     /**
      * @brief Handles the execution of the :db command module.
      * 
@@ -2200,9 +2961,14 @@ namespace dais::core {
      * 'db_handler' script. It avoids reinventing DB drivers in C++ by
      * leveraging the embedded Python environment.
      * 
-     * Rationale for JSON & Pager Strategy:
-     * - We return JSON from Python because it is structured and easy to parse
-     *   via the same Python interpreter (using json.loads).
+     * Rationale for Reply & Pager Strategy:
+     * - Locally, db_handler.handle_command (bound once in bind_db_handler)
+     *   returns a plain dict that is copied into a DbReply; no JSON round trip.
+     *   Table views stream their row batches into db_result_sink() via the
+     *   embedded module and only return {"action": "stream"}.
+     * - Over SSH the script prints the same dict as JSON, decoded with the
+     *   cached json.loads.
+     * - The GIL is held only for those Python calls.
      * - For large results, we use a "pager" strategy where Python writes to
      *   a temp file and C++ injects a 'less' command. This keeps DAIS's
      *   render loop simple and leverages the robust, native 'less' pager
@@ -2215,9 +2981,12 @@ namespace dais::core {
             return;
         }
 
+        utils::PerfTimer total_timer(utils::PerfStage::DB_TOTAL);
         try {
-            std::string json_result;
+            DbReply reply;
 
+            // Cold unless the reply shows a pooled connection was reused (decided below)
+            utils::PerfTimer query_timer(utils::PerfStage::DB_QUERY_COLD);
             if (is_remote_session_) {
                 // --- REMOTE EXECUTION ---
                 check_remote_session(); // Sync state
@@ -2233,34 +3002,25 @@ namespace dais::core {
                     pos += 2;
                 }
                 
-                
-                
-                
                 std::string remote_cmd = "python3 ~/.dais/bin/db_handler.py \"" + escaped_query + "\"";
-                json_result = execute_remote_command(remote_cmd, 10000); // 10s timeout for DB query
+                std::string json_result = execute_remote_command(remote_cmd, 10000); // 10s timeout for DB query
+                reply = parse_remote_db_reply(json_result);
                 
             } else {
                 // --- LOCAL EXECUTION ---
-                // 1. Invoke Python Handler
-                // We use the embedded interpreter to import and run the script.
-                py::module_ handler = py::module_::import("db_handler");
-                
-                // Pass CWD to Python so it can find local .env and config files
-                std::string cwd_str = shell_cwd_.string();
-                json_result = handler.attr("handle_command")(query, cwd_str).cast<std::string>();
+                reply = run_local_db_query(query);
             }
+            // Remote queries start a fresh db_handler.py each time: always cold
+            if (reply.reused) query_timer.set_stage(utils::PerfStage::DB_QUERY_WARM);
+            query_timer.stop();
             
-            // 2. Parse Result
-            
-            // 2. Parse Result
-            py::module_ json = py::module_::import("json");
-            py::object result_obj = json.attr("loads")(json_result);
-            
-            std::string status = result_obj["status"].cast<std::string>();
+            const std::string& status = reply.status;
+            std::string action = reply.action;
+            if (action != "stream") db_result_sink().reset(); // Drop rows of a query that failed mid-stream
             
             // --- HANDLING MISSING PACKAGES (Interactive Install) ---
             if (status == "missing_pkg") {
-                std::string pkg = result_obj["package"].cast<std::string>();
+                const std::string& pkg = reply.package;
                 
                 std::string location = is_remote_session_ ? ("REMOTE: " + pty_.get_foreground_process_name()) : "LOCAL";
                 // Heuristic cleanup of process name if it's just "ssh"
@@ -2270,14 +3030,11 @@ namespace dais::core {
                           << "] Missing package '" << pkg << "' on " << location << ". Install now"
                           << (is_remote_session_ ? " (user-scope)" : "") << "? (y/N) " << std::flush;
                 
-                // Read single char response (assuming raw mode)
+                // Read single char response (assuming raw mode); block until a key arrives
                 char c = 0;
-                // Wait for input loop
-                while (true) {
-                    if (read(STDIN_FILENO, &c, 1) > 0) {
-                        break;
-                    }
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                if (!(utils::Reactor::wait_fd(STDIN_FILENO, utils::Reactor::READABLE, -1) & utils::Reactor::READABLE) ||
+                    read(STDIN_FILENO, &c, 1) <= 0) {
+                    c = 0; // Input closed: treat as "No"
                 }
 
                 if (c == 'y' || c == 'Y') {
@@ -2305,16 +3062,47 @@ namespace dais::core {
                 return;
             }
 
-            if (status == "error") {
-                std::string msg = result_obj["message"].cast<std::string>();
+            if (status != "success") {
                 std::cout << "\r\n[" << handlers::Theme::ERROR << "DB" << handlers::Theme::RESET 
-                          << "] " << msg << "\r\n" << std::flush;
+                          << "] " << (reply.message.empty() ? "Unexpected reply from db_handler" : reply.message)
+                          << "\r\n" << std::flush;
                 return;
             }
 
             // 3. Handle Actions
-            std::string action = result_obj["action"].cast<std::string>();
-            std::string data = result_obj["data"].cast<std::string>();
+            std::string data;
+            std::string pager_cmd = "less -S"; 
+
+            if (action == "stream") {
+                // Rows were streamed into the sink; lay them out now
+                const char* tmp = std::getenv("TMPDIR");
+                utils::PerfTimer render_timer(utils::PerfStage::DB_RENDER);
+                auto rendered = db_result_sink().finish((tmp && *tmp) ? tmp : "/tmp");
+                render_timer.stop();
+                using Outcome = utils::DbResultSink::Outcome;
+                switch (rendered.kind) {
+                    case Outcome::PRINT:
+                        action = "print";
+                        data = std::move(rendered.data);
+                        break;
+                    case Outcome::SAVED:
+                        action = "print";
+                        data = "Saved table to: " + rendered.data;
+                        break;
+                    case Outcome::PAGE:
+                        action = "page";
+                        data = std::move(rendered.data);
+                        if (const char* pager = std::getenv("PAGER"); pager && *pager) pager_cmd = pager;
+                        break;
+                    case Outcome::FAILED:
+                        std::cout << "\r\n[" << handlers::Theme::ERROR << "DB" << handlers::Theme::RESET 
+                                  << "] " << rendered.data << "\r\n" << std::flush;
+                        return;
+                }
+            } else {
+                data = std::move(reply.data);
+                if (!reply.pager.empty()) pager_cmd = reply.pager;
+            }
             
             if (action == "print") {
                 // ACTION: Print directly to terminal
@@ -2330,11 +3118,6 @@ namespace dais::core {
                 
             } else if (action == "page") {
                 // ACTION: Open in Pager (less)
-                std::string pager_cmd = "less -S"; 
-                if (result_obj.contains("pager")) {
-                    pager_cmd = result_obj["pager"].cast<std::string>();
-                }
-                
                 std::string file_arg = "\"" + data + "\"";
                 std::string cmd;
                 
@@ -2377,11 +3160,111 @@ namespace dais::core {
         }
     }
 
+    /**
+     * @brief Resolves the :db entry points once.
+     * db_handler is already imported as an extension; only the callables are looked
+     * up here, so handle_db_command goes straight to the call. Retried lazily by
+     * run_local_db_query if it fails (e.g. db_handler.py had a syntax error).
+     */
+    bool Engine::bind_db_handler() {
+        try {
+            py::gil_scoped_acquire gil;
+            if (!db_handle_command_ || db_handle_command_.is_none()) {
+                py::module_ db_handler = py::module_::import("db_handler");
+                db_handle_command_ = db_handler.attr("handle_command");
+                db_pool_ = py::getattr(db_handler, "_POOL", py::object());
+            }
+            if (!json_loads_ || json_loads_.is_none()) {
+                json_loads_ = py::module_::import("json").attr("loads");
+            }
+            return true;
+        } catch (const std::exception& e) {
+            std::cerr << "[" << handlers::Theme::WARNING << "-" << handlers::Theme::RESET 
+                      << "] Warning: :db unavailable: " << e.what() << "\r\n";
+            return false;
+        }
+    }
+
+    Engine::DbReply Engine::db_reply_from(const py::handle& obj) {
+        DbReply r;
+        if (!py::isinstance<py::dict>(obj)) {
+            r.status = "error";
+            r.message = "Unexpected reply from db_handler";
+            return r;
+        }
+        py::dict d = py::reinterpret_borrow<py::dict>(obj);
+        auto field = [&](const char* key, std::string& out) {
+            if (d.contains(key)) out = py::str(d[key]).cast<std::string>();
+        };
+        field("status", r.status);
+        field("action", r.action);
+        field("data", r.data);
+        field("pager", r.pager);
+        field("message", r.message);
+        field("package", r.package);
+        return r;
+    }
+
+    Engine::DbReply Engine::run_local_db_query(const std::string& query) {
+        DbReply reply;
+        // Pass CWD to Python so it can find local .env and config files
+        std::string cwd_str = shell_cwd_.string();
+        if (!await_python()) {
+            reply.status = "error";
+            reply.message = "Python is not available";
+            return reply;
+        }
+        try {
+            if ((!db_handle_command_ || db_handle_command_.is_none()) && !bind_db_handler()) {
+                reply.status = "error";
+                reply.message = "db_handler could not be loaded";
+                return reply;
+            }
+            py::gil_scoped_acquire gil;
+            // Connects performed by AdapterPool; unchanged across a successful query = reused
+            auto connects = [this]() -> long long {
+                if (!db_pool_ || db_pool_.is_none() || !py::hasattr(db_pool_, "connects")) return -1;
+                return db_pool_.attr("connects").cast<long long>();
+            };
+            const long long before = connects();
+            reply = db_reply_from(db_handle_command_(query, cwd_str));
+            reply.reused = reply.status == "success" && before >= 0 && connects() == before;
+        } catch (const std::exception& e) {
+            reply.status = "error";
+            reply.message = std::string("Python/Engine Error: ") + e.what();
+        }
+        return reply;
+    }
+
+    Engine::DbReply Engine::parse_remote_db_reply(const std::string& json_text) {
+        DbReply reply;
+        if (!await_python()) {
+            reply.status = "error";
+            reply.message = "Python is not available";
+            return reply;
+        }
+        try {
+            if ((!json_loads_ || json_loads_.is_none()) && !bind_db_handler()) {
+                reply.status = "error";
+                reply.message = "db_handler could not be loaded";
+                return reply;
+            }
+            py::gil_scoped_acquire gil;
+            reply = db_reply_from(json_loads_(json_text));
+        } catch (const std::exception& e) {
+            reply.status = "error";
+            reply.message = "Invalid reply from remote db_handler: " + std::string(e.what());
+        }
+        return reply;
+    }
+
     void Engine::deploy_remote_db_handler() {
         if (remote_db_deployed_ || !is_remote_session_) return;
         // Note: For remote sessions, is_shell_idle() is false (SSH is running).        
         std::string script_content;
+        if (!await_python()) return;
         try {
+            py::gil_scoped_acquire gil;
             py::module_ inspect = py::module_::import("inspect");
             py::module_ handler = py::module_::import("db_handler");
             script_content = inspect.attr("getsource")(handler).cast<std::string>();
@@ -2406,20 +3289,13 @@ namespace dais::core {
         std::string start_heredoc = "cat > " + temp_b64 + " << 'DAIS_EOF'\n";
         write(pty_.get_master_fd(), start_heredoc.c_str(), start_heredoc.size());
 
-        constexpr size_t PAYLOAD_CHUNK = 4096;
-        size_t sent = 0;
-        while (sent < b64.size()) {
-            size_t n = std::min(PAYLOAD_CHUNK, b64.size() - sent);
-            write(pty_.get_master_fd(), b64.data() + sent, n);
-            sent += n;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
+        stream_to_pty(b64);
 
         std::string end_heredoc = "\nDAIS_EOF\n";
         write(pty_.get_master_fd(), end_heredoc.c_str(), end_heredoc.size());
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
 
-        execute_remote_command("stty echo", 2000);
+        // Sentinel of the next command marks the heredoc as finished
+        execute_remote_command("stty echo", 10000);
 
         // 4. Decode
         std::string deploy_cmd = 
@@ -95,6 +95,17 @@ namespace dais::core {
         return true;
     }
 
+    /**
+     * @brief Takes over an already-open PTY master instead of forking a shell.
+     */
+    void PTYSession::adopt(int master_fd, pid_t child_pid) {
+        stop();
+        // Terminal is left as is: stop() restores exactly what is current now
+        tcgetattr(STDIN_FILENO, &orig_term_);
+        master_fd_ = master_fd;
+        child_pid_ = child_pid;
+    }
+
     /**
      * @brief Terminates the PTY session and cleans up resources.
      * Restores the terminal to canonical mode and closes the file descriptor.
@@ -15,6 +15,7 @@ import csv
 import tempfile
 import sqlite3
 import abc
+import time
 from typing import Dict, Any, Optional
 
 # =============================================================================
@@ -88,6 +89,51 @@ class DBAdapter(abc.ABC):
         """Closes the connection."""
         pass
 
+    def ping(self):
+        """Health check before a pooled connection is reused. Returns False if it is dead."""
+        try:
+            self.execute("SELECT 1").fetchall()
+            return True
+        except Exception:
+            return False
+
+    def execute_saved(self, query):
+        """
+        Executes a saved query (DB_QUERIES), reusing a prepared statement where the
+        driver supports it. Default: plain execute.
+        """
+        return self.execute(query)
+
+    def reset(self):
+        """Discards unread rows of the last query before the connection goes back to the pool."""
+        pass
+
+class PreparedCache:
+    """
+    Per-connection map of statement text -> prepared handle, least recently used
+    evicted first. Statements the server refused to prepare map to None so they
+    are not retried.
+    """
+    def __init__(self, capacity=32):
+        self.capacity = capacity
+        self.entries = {}
+
+    def get(self, query):
+        if query not in self.entries:
+            return False, None
+        handle = self.entries.pop(query)
+        self.entries[query] = handle # Move to most recent
+        return True, handle
+
+    def put(self, query, handle):
+        """Stores a handle; returns the evicted (query, handle) pair or None."""
+        evicted = None
+        if query not in self.entries and len(self.entries) >= self.capacity:
+            oldest = next(iter(self.entries))
+            evicted = (oldest, self.entries.pop(oldest))
+        self.entries[query] = handle
+        return evicted
+
 # =============================================================================
 # ADAPTER IMPLEMENTATIONS
 # =============================================================================
@@ -98,7 +144,11 @@ class SqliteAdapter(DBAdapter):
         self.cursor = None
 
     def connect(self, source, **kwargs):
-        self.conn = sqlite3.connect(source, isolation_level=None)
+        # Pooled connections keep sqlite3's own statement cache warm, so saved
+        # queries skip re-parsing without an explicit prepare step.
+        # The pool hands a connection to one caller at a time, which makes
+        # sharing it across threads safe.
+        self.conn = sqlite3.connect(source, isolation_level=None, check_same_thread=False)
         self.cursor = self.conn.cursor()
 
     def execute(self, query):
@@ -157,11 +207,34 @@ class PostgresAdapter(DBAdapter):
              self.conn = psycopg2.connect(**connect_args)
         self.conn.autocommit = True
         self.cursor = self.conn.cursor()
+        self.prepared = PreparedCache()
+        self.prepared_seq = 0
 
     def execute(self, query):
         self.cursor.execute(query)
         return self.cursor
 
+    def execute_saved(self, query):
+        # Server-side PREPARE once per connection, EXECUTE afterwards.
+        # Statements PREPARE does not accept (DDL, utility commands) run directly.
+        text = query.strip().rstrip(";")
+        found, name = self.prepared.get(text)
+        if not found:
+            self.prepared_seq += 1
+            name = f"dais_q{self.prepared_seq}"
+            try:
+                self.cursor.execute(f"PREPARE {name} AS {text}")
+            except Exception:
+                name = None
+            evicted = self.prepared.put(text, name)
+            if evicted and evicted[1]:
+                try: self.cursor.execute(f"DEALLOCATE {evicted[1]}")
+                except Exception: pass
+        if name is None:
+            return self.execute(query)
+        self.cursor.execute(f"EXECUTE {name}")
+        return self.cursor
+
     def close(self):
         if self.conn: self.conn.close()
 
@@ -186,11 +259,41 @@ class MySqlAdapter(DBAdapter):
         self.conn = mysql.connector.connect(**connect_args)
         self.conn.autocommit = True
         self.cursor = self.conn.cursor()
+        self.prepared = PreparedCache()
 
     def execute(self, query):
         self.cursor.execute(query)
         return self.cursor
 
+    def ping(self):
+        try:
+            self.conn.ping(reconnect=False)
+            return True
+        except Exception:
+            return False
+
+    def reset(self):
+        # mysql.connector refuses the next query while rows are still unread
+        # (a table view stops fetching at its row limit)
+        self.conn.consume_results()
+
+    def execute_saved(self, query):
+        # One prepared cursor per saved statement (binary protocol, parsed once)
+        found, cursor = self.prepared.get(query)
+        if not found:
+            try:
+                cursor = self.conn.cursor(prepared=True)
+            except Exception:
+                cursor = None
+            evicted = self.prepared.put(query, cursor)
+            if evicted and evicted[1]:
+                try: evicted[1].close()
+                except Exception: pass
+        if cursor is None:
+            return self.execute(query)
+        cursor.execute(query)
+        return cursor
+
     def close(self):
         if self.conn: self.conn.close()
 
@@ -218,13 +321,213 @@ class TestAutoInstallAdapter(DBAdapter):
     def execute(self, query): pass
     def close(self): pass
 
+# =============================================================================
+# CONNECTION POOL
+# =============================================================================
+
+class AdapterPool:
+    """
+    Keeps connected adapters alive between :db calls, keyed by the resolved
+    connection config, so repeated queries skip the connect / TLS / auth handshake.
+    The embedded interpreter keeps this module loaded for the whole DAIS session.
+    The standalone SSH script starts fresh on every call and simply never reuses.
+
+    - Connections idle longer than idle_timeout_s are closed on the next acquire
+      (this also releases DuckDB's file lock).
+    - A connection idle longer than ping_after_s, or whose last query failed, is
+      health-checked before reuse and replaced if dead.
+    - At most max_connections distinct databases are kept; least recently used goes first.
+    """
+    DEFAULTS = {
+        "enabled": True,
+        "idle_timeout_s": 300,
+        "ping_after_s": 30,
+        "max_connections": 4,
+        "prepared_statements": 32,
+    }
+
+    def __init__(self):
+        self.settings = dict(self.DEFAULTS)
+        self.idle = {}     # key -> (adapter, last_used, suspect); least recently used first
+        self.connects = 0  # Handshakes performed so far
+
+    def configure(self, settings):
+        """Applies the DB_POOL config dict (missing keys keep their defaults)."""
+        merged = dict(self.DEFAULTS)
+        if isinstance(settings, dict):
+            merged.update(settings)
+        self.settings = merged
+        if not merged["enabled"]:
+            self.close_all()
+
+    @staticmethod
+    def key(db_type, db_source, adapter_kwargs):
+        return (db_type, db_source, tuple(sorted((k, str(v)) for k, v in adapter_kwargs.items())))
+
+    def acquire(self, db_type, db_source, adapter_kwargs):
+        """Returns (key, adapter): a healthy pooled connection, or a new one."""
+        self.close_idle()
+        key = self.key(db_type, db_source, adapter_kwargs)
+        entry = self.idle.pop(key, None)
+        if entry:
+            adapter, last_used, suspect = entry
+            fresh = time.monotonic() - last_used < self.settings["ping_after_s"]
+            if (fresh and not suspect) or adapter.ping():
+                return key, adapter
+            self._close(adapter)
+
+        adapter = get_adapter(db_type)
+        adapter.connect(db_source, **adapter_kwargs)
+        self.connects += 1
+        prepared = getattr(adapter, "prepared", None)
+        if isinstance(prepared, PreparedCache):
+            prepared.capacity = max(int(self.settings["prepared_statements"]), 1)
+        return key, adapter
+
+    def release(self, key, adapter, failed=False):
+        """Hands an adapter back after use. failed=True forces a health check before reuse."""
+        if not self.settings["enabled"]:
+            self._close(adapter)
+            return
+        try:
+            adapter.reset()
+        except Exception:
+            failed = True
+        previous = self.idle.pop(key, None)
+        if previous and previous[0] is not adapter:
+            self._close(previous[0])
+        self.idle[key] = (adapter, time.monotonic(), failed)
+        while len(self.idle) > max(int(self.settings["max_connections"]), 0):
+            self._close(self.idle.pop(next(iter(self.idle)))[0])
+
+    def close_idle(self):
+        now = time.monotonic()
+        limit = self.settings["idle_timeout_s"]
+        for key in [k for k, (_, last_used, _) in self.idle.items() if now - last_used > limit]:
+            self._close(self.idle.pop(key)[0])
+
+    def close_all(self):
+        while self.idle:
+            self._close(self.idle.popitem()[1][0])
+
+    @staticmethod
+    def _close(adapter):
+        try:
+            adapter.close()
+        except Exception:
+            pass
+
+_POOL = AdapterPool()
+
+# =============================================================================
+# RESULT DELIVERY
+# =============================================================================
+
+# Rows per fetchmany() round trip; also the batch size handed to the engine
+FETCH_BATCH = 1000
+# Table view row cap unless --no-limit is given
+PREVIEW_ROWS = 1000
+# Tables longer than this (including header and separator) open in the pager
+INLINE_LINES = 50
+
+def _iter_batches(cursor, first=None):
+    """
+    Yields row batches until the cursor is exhausted.
+    A batch shorter than requested is the last one, which saves the final empty round trip.
+    """
+    if first is not None:
+        if not first:
+            return
+        yield first
+        if len(first) < FETCH_BATCH:
+            return
+    while True:
+        batch = cursor.fetchmany(FETCH_BATCH)
+        if not batch:
+            return
+        yield batch
+        if len(batch) < FETCH_BATCH:
+            return
+
+def _result_sink():
+    """
+    Returns the embedded `dais` module when it accepts streamed rows (running inside DAIS).
+    The standalone script used over SSH has no engine to stream to and returns None.
+    """
+    try:
+        import dais
+    except ImportError:
+        return None
+    return dais if hasattr(dais, "db_rows") else None
+
+def _output_target(path):
+    """Expands an --output path; returns (path, None) or (None, error_reply) if it is not writable."""
+    target_path = os.path.expanduser(path)
+    dir_name = os.path.dirname(os.path.abspath(target_path))
+    if not os.access(dir_name, os.W_OK):
+        return None, {
+            "status": "error", 
+            "message": f"Permission denied: Cannot write to '{dir_name}'. Try using a path in /tmp/ or your home directory."
+        }
+    return target_path, None
+
+def _write_json(f, headers, batches):
+    """Writes rows as a JSON array of objects, one batch at a time."""
+    f.write("[\n")
+    first = True
+    for batch in batches:
+        for row in batch:
+            if not first: f.write(",\n")
+            f.write(json.dumps(dict(zip(headers, row)), default=str))
+            first = False
+    f.write("\n]")
+
+def _write_csv(f, headers, batches):
+    """Writes a header line and the rows as CSV, one batch at a time."""
+    writer = csv.writer(f)
+    writer.writerow(headers)
+    for batch in batches:
+        writer.writerows(batch)
+
+def _format_table(headers, rows):
+    """
+    Lays out rows as an aligned text table: header, separator, rows.
+    Same layout as the engine's streamed table view (DbResultSink).
+    """
+    if not rows:
+        # Show headers even if no data
+        head = " | ".join(f"{h:<{len(h)}}" for h in headers)
+        sep = "-+-".join("-" * len(h) for h in headers)
+        return [head, sep, "(0 rows returned)"]
+
+    widths = [len(h) for h in headers]
+    str_rows = []
+    for row in rows:
+        s_row = [str(cell) if cell is not None else "NULL" for cell in row]
+        str_rows.append(s_row)
+        for i, cell in enumerate(s_row[:len(widths)]):
+            widths[i] = max(widths[i], len(cell))
+
+    def format_line(r, w_list):
+        return " | ".join(f"{c:<{w}}" for c, w in zip(r, w_list))
+
+    output_lines = [format_line(headers, widths), "-+-".join("-" * w for w in widths)]
+    for row in str_rows:
+        output_lines.append(format_line(row, widths))
+    return output_lines
+
 # =============================================================================
 # CORE LOGIC
 # =============================================================================
 
-def run_query(query, db_type, db_source, adapter_kwargs={}):
+def run_query(query, db_type, db_source, adapter_kwargs={}, saved=False, _retried=False):
     """
     Executes the query and formats the result.
+    saved=True marks an expanded DB_QUERIES alias, which may run as a prepared statement.
+
+    Returns a reply dict: {"status": "success", "action": "print" | "page" | "stream", "data": ..., ["pager": ...]},
+    {"status": "error", "message": ...} or {"status": "missing_pkg", "package": ...}.
+    The engine reads it directly; the SSH entry point prints it as JSON.
     """
     flags = {
         "json": False,
@@ -270,221 +573,164 @@ def run_query(query, db_type, db_source, adapter_kwargs={}):
 
     # 3. Execution
     adapter = None
+    pool_key = None
     try:
-        adapter = get_adapter(db_type)
-        adapter.connect(db_source, **adapter_kwargs)
-        cursor = adapter.execute(clean_query)
+        pool_key, adapter = _POOL.acquire(db_type, db_source, adapter_kwargs)
+        cursor = adapter.execute_saved(clean_query) if saved else adapter.execute(clean_query)
         
         # Extract headers
         headers = [d[0] for d in cursor.description] if cursor.description else []
 
-        # Consolidate results for small queries to avoid temp files
-        all_rows = []
-        if flags["json"] or flags["csv"] or cursor.description:
-            # For JSON/CSV without output, or for the Table view, we need the rows.
-            # We'll fetch up to 1001 to see if it's "large"
-            all_rows = cursor.fetchmany(1001)
-            is_large = len(all_rows) > 1000
-        
+        target_path = None
+        if flags.get("output"):
+            target_path, error = _output_target(flags["output"])
+            if error:
+                _POOL.release(pool_key, adapter)
+                return error
+
         # --- EXPORT ACTIONS ---
+        # Exports are written batch by batch, so --output and large results run at
+        # constant memory. Without --output, the first batch decides between
+        # printing inline and paging a temp file.
         if flags["json"]:
-            if flags.get("output"):
-                target_path = os.path.expanduser(flags["output"])
-                # Permission Check
-                dir_name = os.path.dirname(os.path.abspath(target_path))
-                if not os.access(dir_name, os.W_OK):
-                    return json.dumps({
-                        "status": "error", 
-                        "message": f"Permission denied: Cannot write to '{dir_name}'. Try using a path in /tmp/ or your home directory."
-                    })
-                
+            if target_path:
                 with open(target_path, 'w', encoding='utf-8') as f:
-                    f.write("[\n")
-                    # Write already fetched rows
-                    for i, row in enumerate(all_rows):
-                        if i > 0: f.write(",\n")
-                        f.write(json.dumps(dict(zip(headers, row)), default=str))
-                    # Write remaining if any
-                    first = len(all_rows) == 0
-                    while True:
-                        batch = cursor.fetchmany(1000)
-                        if not batch: break
-                        for row in batch:
-                            if not first: f.write(",\n")
-                            f.write(json.dumps(dict(zip(headers, row)), default=str))
-                            first = False
-                    f.write("\n]")
-                adapter.close()
-                return json.dumps({"status": "success", "action": "print", "data": f"Saved JSON to: {target_path}"})
-            else:
-                if is_large:
-                    fd, target_path = tempfile.mkstemp(prefix="dais_db_", suffix=".json", text=True)
-                    os.close(fd)
-                    with open(target_path, 'w', encoding='utf-8') as f:
-                        f.write("[\n")
-                        for i, row in enumerate(all_rows):
-                            if i > 0: f.write(",\n")
-                            f.write(json.dumps(dict(zip(headers, row)), default=str))
-                        while True:
-                            batch = cursor.fetchmany(1000)
-                            if not batch: break
-                            for row in batch:
-                                f.write(",\n")
-                                f.write(json.dumps(dict(zip(headers, row)), default=str))
-                        f.write("\n]")
-                    adapter.close()
-                    return json.dumps({"status": "success", "action": "page", "data": target_path, "pager": "cat"})
-                else:
-                    # Small result: print directly
-                    data = [dict(zip(headers, r)) for r in all_rows]
-                    adapter.close()
-                    return json.dumps({"status": "success", "action": "print", "data": json.dumps(data, default=str, indent=2)})
+                    _write_json(f, headers, _iter_batches(cursor))
+                _POOL.release(pool_key, adapter)
+                return {"status": "success", "action": "print", "data": f"Saved JSON to: {target_path}"}
+
+            first = cursor.fetchmany(FETCH_BATCH + 1)
+            if len(first) > FETCH_BATCH:
+                fd, target_path = tempfile.mkstemp(prefix="dais_db_", suffix=".json", text=True)
+                with os.fdopen(fd, 'w', encoding='utf-8') as f:
+                    _write_json(f, headers, _iter_batches(cursor, first))
+                _POOL.release(pool_key, adapter)
+                return {"status": "success", "action": "page", "data": target_path, "pager": "cat"}
+
+            # Small result: print directly
+            data = [dict(zip(headers, r)) for r in first]
+            _POOL.release(pool_key, adapter)
+            return {"status": "success", "action": "print", "data": json.dumps(data, default=str, indent=2)}
 
         if flags["csv"]:
-            import io, csv
-            if flags.get("output"):
-                target_path = os.path.expanduser(flags["output"])
+            import io
+            if target_path:
                 with open(target_path, 'w', encoding='utf-8', newline='') as f:
-                    writer = csv.writer(f)
-                    writer.writerow(headers)
-                    writer.writerows(all_rows)
-                    while True:
-                        batch = cursor.fetchmany(1000)
-                        if not batch: break
-                        writer.writerows(batch)
-                adapter.close()
-                return json.dumps({"status": "success", "action": "print", "data": f"Saved CSV to: {target_path}"})
-            else:
-                if is_large:
-                    fd, target_path = tempfile.mkstemp(prefix="dais_db_", suffix=".csv", text=True)
-                    os.close(fd)
-                    with open(target_path, 'w', encoding='utf-8', newline='') as f:
-                        writer = csv.writer(f)
-                        writer.writerow(headers)
-                        writer.writerows(all_rows)
-                        while True:
-                            batch = cursor.fetchmany(1000)
-                            if not batch: break
-                            writer.writerows(batch)
-                    adapter.close()
-                    return json.dumps({"status": "success", "action": "page", "data": target_path, "pager": "cat"})
-                else:
-                    # Small result: print directly
-                    output = io.StringIO()
-                    writer = csv.writer(output)
-                    writer.writerow(headers)
-                    writer.writerows(all_rows)
-                    adapter.close()
-                    return json.dumps({"status": "success", "action": "print", "data": output.getvalue()})
+                    _write_csv(f, headers, _iter_batches(cursor))
+                _POOL.release(pool_key, adapter)
+                return {"status": "success", "action": "print", "data": f"Saved CSV to: {target_path}"}
+
+            first = cursor.fetchmany(FETCH_BATCH + 1)
+            if len(first) > FETCH_BATCH:
+                fd, target_path = tempfile.mkstemp(prefix="dais_db_", suffix=".csv", text=True)
+                with os.fdopen(fd, 'w', encoding='utf-8', newline='') as f:
+                    _write_csv(f, headers, _iter_batches(cursor, first))
+                _POOL.release(pool_key, adapter)
+                return {"status": "success", "action": "page", "data": target_path, "pager": "cat"}
+
+            # Small result: print directly
+            output = io.StringIO()
+            _write_csv(output, headers, [first])
+            _POOL.release(pool_key, adapter)
+            return {"status": "success", "action": "print", "data": output.getvalue()}
 
         # --- VIEW ACTION ---
         # If cursor.description is None, this was a DDL/DML statement (INSERT, UPDATE, CREATE)
         # that returns no rows. We should report success instead of trying to fetch.
         if not cursor.description:
-            adapter.close()
-            return json.dumps({"status": "success", "action": "print", "data": "Command executed successfully."})
-
-        # Use already fetched rows plus any remaining
-        rows = all_rows
-        if is_large:
-            if flags["no_limit"]:
-                # User wants ALL rows - fetch the rest
-                while True:
-                    batch = cursor.fetchmany(1000)
-                    if not batch:
-                        break
-                    rows.extend(batch)
-            # else: We already fetched 1001, just use those for the preview
-        adapter.close()
-
-        # Calculate widths
-        widths = [len(h) for h in headers]
-        if not rows:
-            if not headers:
-                return json.dumps({"status": "success", "action": "print", "data": "Command executed (no results)."})
-            
-            # Show headers even if no data
-            head = " | ".join(f"{h:<{len(h)}}" for h in headers)
-            sep = "-+-".join("-" * len(h) for h in headers)
-            return json.dumps({"status": "success", "action": "print", "data": f"{head}\n{sep}\n(0 rows returned)"})
-
-        # Calculate widths
-        widths = [len(h) for h in headers]
-        str_rows = []
-        for row in rows:
-            s_row = [str(cell) if cell is not None else "NULL" for cell in row]
-            str_rows.append(s_row)
-            for i, cell in enumerate(s_row):
-                widths[i] = max(widths[i], len(cell))
-
-        def format_line(r, w_list):
-            return " | ".join(f"{c:<{w}}" for c, w in zip(r, w_list))
-
-        separator = "-+-".join("-" * w for w in widths)
-        header_line = format_line(headers, widths)
-
-        output_lines = [header_line, separator]
-        for row in str_rows:
-            output_lines.append(format_line(row, widths))
+            _POOL.release(pool_key, adapter)
+            return {"status": "success", "action": "print", "data": "Command executed successfully."}
+
+        row_limit = 0 if flags["no_limit"] else PREVIEW_ROWS
+
+        # Inside DAIS: hand the batches to the engine, which lays out and renders
+        # the table itself (spilling large results to disk instead of holding them)
+        sink = _result_sink()
+        if sink is not None:
+            sink.db_begin(headers, row_limit, target_path or "")
+            for batch in _iter_batches(cursor):
+                if not sink.db_rows(batch):
+                    break
+            _POOL.release(pool_key, adapter)
+            return {"status": "success", "action": "stream"}
+
+        # Standalone (SSH): format here and return the text
+        rows = []
+        for batch in _iter_batches(cursor):
+            rows.extend(batch)
+            if row_limit and len(rows) >= row_limit:
+                del rows[row_limit:]
+                break
+        _POOL.release(pool_key, adapter)
+
+        if not headers:
+            return {"status": "success", "action": "print", "data": "Command executed (no results)."}
+
+        output_lines = _format_table(headers, rows)
+
+        if target_path:
+            with open(target_path, 'w', encoding='utf-8') as f:
+                f.write("\n".join(output_lines))
+                f.write("\n")
+            return {"status": "success", "action": "print", "data": f"Saved table to: {target_path}"}
 
         full_output = "\n".join(output_lines)
         
-        if len(output_lines) > 50:
+        if len(output_lines) > INLINE_LINES:
             fd, path = tempfile.mkstemp(prefix="dais_db_", suffix=".txt", text=True)
             with os.fdopen(fd, 'w', encoding='utf-8') as f:
                 f.write(full_output)
                 f.write("\n")  # Ensure prompt appears on new line after output
             user_pager = os.environ.get("PAGER", "less -S")
-            return json.dumps({"status": "success", "action": "page", "data": path, "pager": user_pager})
+            return {"status": "success", "action": "page", "data": path, "pager": user_pager}
         else:
-            return json.dumps({"status": "success", "action": "print", "data": full_output})
+            return {"status": "success", "action": "print", "data": full_output}
 
     except ImportError as e:
         # Catch our custom missing package error or others
         msg = str(e)
         
         # RETRY MECHANISM: 
-        # If import failed, it might be because the package is in the shell's python (e.g. Conda/Venv)
-        # but not in our embedded python's path.
-        if "MISSING_PKG" in msg and not getattr(sys, "_dais_path_synced", False):
-            try:
-                import subprocess
-                # Ask the active shell python for its sys.path
-                # We use the current shell's 'python3' command
-                output = subprocess.check_output(
-                    ["python3", "-c", "import sys; print(chr(10).join(sys.path))"], 
-                    text=True, 
-                    stderr=subprocess.DEVNULL
-                )
-                
-                added_something = False
-                for p in output.splitlines():
-                    p = p.strip()
-                    if p and os.path.isdir(p) and p not in sys.path:
-                        sys.path.append(p)
-                        added_something = True
-                
-                if added_something:
-                    import importlib
+        # The package may have been installed since the last call (pip install from
+        # the shell), or it is in the shell's python (e.g. Conda/Venv) but not in our
+        # embedded python's path. Rescan once; successful calls skip this entirely.
+        if "MISSING_PKG" in msg and not _retried:
+            import importlib
+            sys.path_importer_cache.clear()
+            importlib.invalidate_caches()
+
+            if not getattr(sys, "_dais_path_synced", False):
+                try:
+                    import subprocess
+                    # Ask the active shell python for its sys.path
+                    # We use the current shell's 'python3' command
+                    output = subprocess.check_output(
+                        ["python3", "-c", "import sys; print(chr(10).join(sys.path))"], 
+                        text=True, 
+                        stderr=subprocess.DEVNULL
+                    )
+                    
+                    for p in output.splitlines():
+                        p = p.strip()
+                        if p and os.path.isdir(p) and p not in sys.path:
+                            sys.path.append(p)
                     importlib.invalidate_caches()
-                
-                # Mark as synced to prevent infinite recursion
+                except Exception:
+                    # If sync fails (e.g. no python3), just retry with the rescanned caches
+                    pass
+                # Mark as synced: the shell's path is only merged once per session
                 sys._dais_path_synced = True
-                
-                # RECURSIVE RETRY
-                return run_query(query, db_type, db_source, adapter_kwargs)
-                
-            except Exception:
-                # If sync fails (e.g. no python3), just proceed to error
-                pass
+            
+            # RECURSIVE RETRY
+            return run_query(query, db_type, db_source, adapter_kwargs, saved, _retried=True)
 
         if "MISSING_PKG" in msg:
             pkg = msg.split(":")[1]
-            return json.dumps({"status": "missing_pkg", "package": pkg})
-        return json.dumps({"status": "error", "message": msg})
+            return {"status": "missing_pkg", "package": pkg}
+        return {"status": "error", "message": msg}
     except Exception as e:
-        if adapter: adapter.close()
-        return json.dumps({"status": "error", "message": str(e)})
+        if adapter: _POOL.release(pool_key, adapter, failed=True)
+        return {"status": "error", "message": str(e)}
 
 
 def _resolve_connection_config(env_vars: Dict[str, str], config: Optional[Any] = None) -> Dict[str, str]:
@@ -552,16 +798,13 @@ def handle_command(cmd_input, cwd):
     Args:
         cmd_input (str): The query string.
         cwd (str): Current working directory of the shell.
+
+    Returns:
+        dict: Reply dict (see run_query).
     """
     try:
-        # Ensure we can see newly installed packages (pip install from shell)
-        import importlib
-        import sys
-        
-        # Nuclear option: Clear the importer cache completely
-        # This forces Python to re-scan directories for new packages
-        sys.path_importer_cache.clear() 
-        importlib.invalidate_caches()
+        # Newly installed packages (pip install from the shell) are picked up by
+        # run_query's MISSING_PKG retry, which rescans the import caches on demand
 
         # Load .env from CWD if present
         env_vars = load_env_file(cwd)
@@ -597,15 +840,25 @@ def handle_command(cmd_input, cwd):
 
         query = cmd_input.strip()
 
-        # 1. Expand Saved Queries
+        # 1. Expand Saved Queries: exact key first (keys may contain spaces), then an
+        # alias followed by runtime flags (":db users --json")
+        saved = False
         if config and hasattr(config, "DB_QUERIES") and isinstance(config.DB_QUERIES, dict):
             if query in config.DB_QUERIES:
                 query = config.DB_QUERIES[query]
+                saved = True
+            else:
+                alias, _, flags = query.partition(" ")
+                if alias in config.DB_QUERIES:
+                    query = config.DB_QUERIES[alias] + (" " + flags if flags else "")
+                    saved = True
+
+        _POOL.configure(getattr(config, "DB_POOL", None))
 
-        return run_query(query, db_type, db_source.replace("_PROJECT_ROOT", cwd) if "_PROJECT_ROOT" in db_source else db_source, adapter_kwargs)
+        return run_query(query, db_type, db_source.replace("_PROJECT_ROOT", cwd) if "_PROJECT_ROOT" in db_source else db_source, adapter_kwargs, saved)
 
     except Exception as e:
-         return json.dumps({"status": "error", "message": f"Unexpected Handler Error: {str(e)}"})
+         return {"status": "error", "message": f"Unexpected Handler Error: {str(e)}"}
 
 # =============================================================================
 # CLI ENTRY POINT (For SSH usage)
@@ -617,4 +870,4 @@ if __name__ == "__main__":
         
     query = sys.argv[1]
     cwd = os.getcwd() # In SSH, we run in the user's directory directly
-    print(handle_command(query, cwd))
+    print(json.dumps(handle_command(query, cwd)))
@@ -4,17 +4,41 @@
  * 
  * * This minimal binary is designed to be statically linked and injected into remote servers.
  * * It performs the exact same high-performance file analysis as the local DAIS engine (using file_analyzer.hpp).
- * * Outputs a compressed JSON stream to stdout for the local DAIS instance to parse and render.
+ * * Outputs a compressed JSON stream to stdout for the local DAIS instance to parse and render,
+ *   or with --wire=1 the compact line format from agent_wire.hpp (negotiated via --caps).
+ * * With --serve it stays resident for the SSH session: requests arrive on a FIFO
+ *   (written by a shell builtin, so no fork/exec per listing), responses are written
+ *   straight to the session's terminal, and the metadata cache stays warm in memory.
+ * * Path arguments and directory entries are analyzed on a bounded pool (thread_pool.hpp,
+ *   one thread per core up to MAX_AGENT_THREADS, --jobs=N to override); rows are
+ *   serialized in argument order afterwards and written with a single buffered write.
  * 
  * @note This file MUST be compilable on Linux (x86_64, aarch64, armv7) with minimal dependencies (libc/libstdc++).
  */
 
 #include "core/file_analyzer.hpp"
+#include "core/stats_cache.hpp"
+#include "core/dir_scan.hpp"
+#include "core/agent_wire.hpp"
+#include "core/tree_scan.hpp"
+#include "core/thread_pool.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <algorithm>
 #include <string_view>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 /**
  * @brief Escapes a string for valid JSON output.
@@ -43,82 +67,440 @@ std::string escape_json(std::string_view s) {
     return out;
 }
 
-int main(int argc, char* argv[]) {
-    // Pure JSON mode
-     
+/**
+ * @brief One listing request: parsed from argv (one-shot) or from a FIFO line (resident).
+ */
+struct Request {
     std::vector<std::string> paths;
     bool show_hidden = false;
+    std::string cache_file; // Empty = no metadata cache
+    bool exact = false;
+    uint64_t exact_max_mb = 256;
+    long exact_max_ms = 500;
+    size_t count_cap = 0;   // 0 = count every directory entry
+    int wire = 0;           // 0 = JSON, otherwise the agent_wire.hpp format version
+    bool expand_dirs = true; // false = "stat": report the paths themselves
+    bool tree = false;       // Directories below each path carry subtree totals (ls -R)
+    size_t tree_max_depth = 32;
+    size_t tree_max_entries = 200000;
+    bool caps = false;
+    bool serve = false;
+    long idle_timeout_s = 1800;
+    size_t jobs = 0;         // Analysis threads including the caller (0 = one per core, capped)
+};
 
-    // VERY basic arg parsing
-    for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
+/// @brief VERY basic arg parsing (shared by the command line and resident requests)
+static void parse_args(const std::vector<std::string>& args, Request& req) {
+    for (const auto& arg : args) {
         if (arg == "-a" || arg == "--all") {
-            show_hidden = true;
+            req.show_hidden = true;
+        } else if (arg == "--cache") {
+            req.cache_file = dais::utils::StatsCache::default_path();
+        } else if (arg.rfind("--cache=", 0) == 0) {
+            req.cache_file = arg.substr(8);
+        } else if (arg == "--exact") {
+            req.exact = true;
+        } else if (arg.rfind("--exact=", 0) == 0) {
+            // --exact=<max_mb>,<max_ms>
+            req.exact = true;
+            unsigned long long mb = req.exact_max_mb;
+            std::sscanf(arg.c_str() + 8, "%llu,%ld", &mb, &req.exact_max_ms);
+            req.exact_max_mb = mb;
+        } else if (arg.rfind("--count-cap=", 0) == 0) {
+            req.count_cap = std::strtoull(arg.c_str() + 12, nullptr, 10);
+        } else if (arg.rfind("--wire=", 0) == 0) {
+            // Unknown versions fall back to JSON, which every DAIS understands
+            req.wire = (std::atoi(arg.c_str() + 7) == dais::utils::AGENT_WIRE_VERSION) ? dais::utils::AGENT_WIRE_VERSION : 0;
+        } else if (arg == "--tree") {
+            req.tree = true;
+        } else if (arg.rfind("--tree=", 0) == 0) {
+            // --tree=<max_depth>,<max_entries>
+            req.tree = true;
+            unsigned long long depth = req.tree_max_depth, entries = req.tree_max_entries;
+            std::sscanf(arg.c_str() + 7, "%llu,%llu", &depth, &entries);
+            req.tree_max_depth = depth;
+            req.tree_max_entries = entries;
+        } else if (arg == "--caps") {
+            req.caps = true;
+        } else if (arg == "--serve") {
+            req.serve = true;
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            req.jobs = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        } else if (arg.rfind("--idle=", 0) == 0) {
+            req.idle_timeout_s = std::strtol(arg.c_str() + 7, nullptr, 10);
         } else {
-            paths.push_back(arg);
+            req.paths.push_back(arg);
         }
     }
 
-    if (paths.empty()) {
-        paths.push_back(".");
+    if (req.paths.empty()) {
+        req.paths.push_back(".");
     }
+}
 
-    std::cout << "["; // Start JSON array
+/// @brief Worker cap: the remote may have many cores, but listings are I/O bound and short-lived.
+static constexpr size_t MAX_AGENT_THREADS = 64;
 
-    bool first_item = true;
+/**
+ * @brief Bounded pool for one invocation (or one resident agent).
+ * @return nullptr when a single thread was requested: everything runs inline.
+ */
+static std::unique_ptr<dais::core::utils::ThreadPool> make_pool(const Request& req) {
+    size_t threads = req.jobs ? req.jobs : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, MAX_AGENT_THREADS);
+    if (threads <= 1) return nullptr;
+    // The caller takes part in every parallel_for, so it counts as one of the threads
+    return std::make_unique<dais::core::utils::ThreadPool>(threads - 1);
+}
 
-    for (const auto& target : paths) {
+static bool write_all(int fd, const char* data, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, data, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+/**
+ * @brief Analyzes the requested paths and appends the JSON array or wire payload to out.
+ * Path arguments and the entries of each directory are analyzed in parallel on `pool`;
+ * results are collected per argument and serialized afterwards in argument and
+ * directory order, so the payload is identical to a serial run.
+ * @param cache Metadata cache to use, or nullptr.
+ * @param pool Worker pool, or nullptr to run serially.
+ */
+static void run_listing(const Request& req, dais::utils::StatsCache* cache,
+                        dais::core::utils::ThreadPool* pool, std::string& out) {
+    // Exact row counting shares one byte/time budget across the whole invocation
+    dais::utils::ScanBudget budget(req.exact_max_mb * 1024 * 1024, std::chrono::milliseconds(req.exact_max_ms));
+    dais::utils::AnalyzeOptions opts{req.exact, &budget, req.count_cap};
+
+    auto analyze = [&](const std::string& path) {
+        return cache ? cache->analyze(path, opts) : dais::utils::analyze_path(path, opts);
+    };
+    // Directory entries: one fd-relative stat, no path re-resolution (see dir_scan.hpp)
+    auto analyze_entry = [&](int dirfd, const dais::utils::DirEntry& e) {
+        struct stat st;
+        if (e.has_stat) st = e.st;
+        else if (dais::utils::stat_at(dirfd, e.name.c_str(), st) != 0) return dais::utils::FileStats{};
+        return cache ? cache->analyze_at(dirfd, e.name.c_str(), st, opts)
+                     : dais::utils::analyze_at(dirfd, e.name.c_str(), st, opts);
+    };
+    // body(lo, hi) over [0, n), on the pool if there is one (nested calls are safe)
+    auto for_range = [pool](size_t n, size_t grain, auto&& body) {
+        if (pool) pool->parallel_for(0, n, grain, body);
+        else if (n > 0) body(0, n);
+    };
+    // One walker per pool thread plus the caller, like the local ls -R
+    auto run_workers = [pool](auto& worker) {
+        if (pool) pool->parallel_for(0, pool->size() + 1, 1, [&worker](size_t, size_t) { worker(); });
+        else worker();
+    };
+
+    // Rows of one path argument, in output order
+    std::vector<std::vector<dais::utils::TreeItem>> results(req.paths.size());
+
+    auto list_target = [&](size_t index) {
+        const std::string& target = req.paths[index];
+        auto& rows = results[index];
         try {
             std::filesystem::path p(target);
-            if (!std::filesystem::exists(p)) continue; // Skip bad paths
-
-            if (std::filesystem::is_directory(p)) {
-                for (const auto& entry : std::filesystem::directory_iterator(p)) {
-                    std::string name = entry.path().filename().string();
-                    if (!show_hidden && name.size() > 0 && name[0] == '.') continue;
-                    if (name == "." || name == "..") continue;
-
-                    auto stats = dais::utils::analyze_path(entry.path().string());
-                    
-                    if (!first_item) std::cout << ",";
-                    first_item = false;
-
-                    std::cout << "{"
-                              << "\"name\":\"" << escape_json(name) << "\","
-                              << "\"is_dir\":" << (stats.is_dir ? "true" : "false") << ","
-                              << "\"size\":" << stats.size_bytes << ","
-                              << "\"rows\":" << stats.rows << ","
-                              << "\"cols\":" << stats.max_cols << ","
-                              << "\"count\":" << stats.item_count << ","
-                              << "\"is_text\":" << (stats.is_text ? "true" : "false") << ","
-                              << "\"is_data\":" << (stats.is_data ? "true" : "false") << "," 
-                              << "\"is_estimated\":" << (stats.is_estimated ? "true" : "false")
-                              << "}";
-                }
+            if (!std::filesystem::exists(p)) return; // Skip bad paths
+
+            if (req.tree && req.expand_dirs && std::filesystem::is_directory(p)) {
+                // Walk and sum here: only the rows of the top level travel back
+                dais::utils::TreeOptions topts;
+                topts.max_depth = req.tree_max_depth;
+                topts.max_entries = req.tree_max_entries;
+                topts.show_hidden = req.show_hidden;
+                topts.analyze = opts;
+                topts.cache = cache;
+                rows = std::move(dais::utils::scan_tree(target, topts, run_workers).items);
+            } else if (req.expand_dirs && std::filesystem::is_directory(p)) {
+                dais::utils::DirReader dir(target);
+                std::vector<dais::utils::DirEntry> entries;
+                if (!dir.read_all(req.show_hidden, entries)) return; // Unreadable directory
+
+                rows.resize(entries.size());
+                const size_t workers = pool ? pool->size() + 1 : 1;
+                const size_t grain = std::clamp<size_t>(entries.size() / (workers * 4), 4, 256);
+                for_range(entries.size(), grain, [&](size_t lo, size_t hi) {
+                    for (size_t i = lo; i < hi; ++i) {
+                        rows[i].stats = analyze_entry(dir.fd(), entries[i]);
+                        rows[i].name = std::move(entries[i].name);
+                    }
+                });
             } else {
-                // Single file
-                auto stats = dais::utils::analyze_path(target);
-                if (!first_item) std::cout << ",";
-                first_item = false;
-
-                std::cout << "{"
-                            << "\"name\":\"" << escape_json(std::filesystem::path(target).filename().string()) << "\","
-                            << "\"is_dir\":" << (stats.is_dir ? "true" : "false") << ","
-                            << "\"size\":" << stats.size_bytes << ","
-                            << "\"rows\":" << stats.rows << ","
-                            << "\"cols\":" << stats.max_cols << ","
-                            << "\"count\":" << stats.item_count << ","
-                            << "\"is_text\":" << (stats.is_text ? "true" : "false") << ","
-                            << "\"is_data\":" << (stats.is_data ? "true" : "false") << "," 
-                            << "\"is_estimated\":" << (stats.is_estimated ? "true" : "false")
-                            << "}";
+                // Single file (or "stat" request)
+                rows.push_back({std::filesystem::path(target).filename().string(), analyze(target)});
             }
         } catch (...) {
             // Ignore access errors
+            rows.clear();
+        }
+    };
+    for_range(req.paths.size(), 1, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) list_target(i);
+    });
+
+    bool first_item = true;
+    auto emit = [&](std::string_view name, const dais::utils::FileStats& stats) {
+        if (req.wire) {
+            dais::utils::append_wire_record(out, name, stats);
+            return;
+        }
+        if (!first_item) out += ",";
+        first_item = false;
+
+        out += "{\"name\":\"";
+        out += escape_json(name);
+        out += "\",\"is_dir\":";
+        out += stats.is_dir ? "true" : "false";
+        out += ",\"size\":" + std::to_string(stats.size_bytes);
+        out += ",\"rows\":" + std::to_string(stats.rows);
+        out += ",\"cols\":" + std::to_string(stats.max_cols);
+        out += ",\"count\":" + std::to_string(stats.item_count);
+        out += ",\"is_text\":";
+        out += stats.is_text ? "true" : "false";
+        out += ",\"is_data\":";
+        out += stats.is_data ? "true" : "false";
+        out += ",\"is_estimated\":";
+        out += stats.is_estimated ? "true" : "false";
+        out += ",\"count_capped\":";
+        out += stats.count_capped ? "true" : "false";
+        out += "}";
+    };
+
+    size_t total = 0;
+    for (const auto& rows : results) total += rows.size();
+    out.reserve(out.size() + total * (req.wire ? 48 : 192) + 64);
+
+    if (req.wire) {
+        out.append(dais::utils::AGENT_WIRE_MAGIC);
+        out.push_back('\n');
+    } else {
+        out += "["; // Start JSON array
+    }
+
+    for (const auto& rows : results) {
+        for (const auto& row : rows) emit(row.name, row.stats);
+    }
+
+    if (!req.wire) {
+        out += "]"; // End JSON array
+        out += "\n"; // Clean line termination
+    }
+}
+
+// ==================================================================================
+// RESIDENT MODE (--serve)
+// ==================================================================================
+
+static volatile std::sig_atomic_t g_stop = 0;
+static void on_stop_signal(int) { g_stop = 1; }
+
+/**
+ * @brief Runs the resident agent for the terminal on stdin.
+ *
+ * Protocol: one request per line on the FIFO, fields separated by 0x1f:
+ *   <sentinel> 0x1f <verb> 0x1f <cwd> [0x1f <arg>]...
+ * verb is "ls" (same arguments as the command line), "stat" (report the paths
+ * themselves) or "ping". The response is written to the terminal as
+ *   "\n" <payload> <sentinel> "\n"
+ * so DAIS's capture (which waits for the sentinel) receives it like the output of
+ * a normal remote command. Answering on the terminal means the shell never has
+ * to relay the payload, and the request itself is a builtin printf.
+ *
+ * Prints "DAIS_SERVE_READY <pid> <fifo>" and detaches. Exits when the terminal
+ * goes away, after idle_timeout_s without requests, or when another instance
+ * replaced its FIFO.
+ */
+static int serve(const Request& opts) {
+    const char* tty = ::ttyname(STDIN_FILENO);
+    const char* home = std::getenv("HOME");
+    if (!tty || !home || !*home) {
+        std::cout << "DAIS_SERVE_FAIL\n";
+        return 1;
+    }
+
+    // One FIFO per terminal, so concurrent SSH sessions each get their own agent
+    std::string run_dir = std::string(home) + "/.dais/run";
+    std::error_code ec;
+    std::filesystem::create_directories(run_dir, ec);
+    std::string tty_id = tty;
+    for (char& c : tty_id) if (c == '/') c = '_';
+    std::string fifo = run_dir + "/agent" + tty_id + ".fifo";
+
+    ::unlink(fifo.c_str()); // Replaces (and thereby retires) an older instance
+    if (::mkfifo(fifo.c_str(), 0600) != 0) {
+        std::cout << "DAIS_SERVE_FAIL\n";
+        return 1;
+    }
+    // O_RDWR keeps a writer open ourselves: no EOF between requests
+    int req_fd = ::open(fifo.c_str(), O_RDWR | O_CLOEXEC | O_NONBLOCK);
+    int tty_fd = ::open(tty, O_WRONLY | O_NOCTTY | O_CLOEXEC);
+    struct stat fifo_st{};
+    if (req_fd < 0 || tty_fd < 0 || ::fstat(req_fd, &fifo_st) != 0) {
+        ::unlink(fifo.c_str());
+        std::cout << "DAIS_SERVE_FAIL\n";
+        return 1;
+    }
+
+    std::cout.flush();
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::unlink(fifo.c_str());
+        std::cout << "DAIS_SERVE_FAIL\n";
+        return 1;
+    }
+    if (pid > 0) {
+        std::cout << "DAIS_SERVE_READY " << pid << " " << fifo << "\n";
+        std::cout.flush();
+        return 0;
+    }
+
+    // --- Daemon ---
+    ::setsid(); // No controlling terminal: writes to tty_fd are never job-control stopped
+    int devnull = ::open("/dev/null", O_RDWR);
+    if (devnull >= 0) {
+        ::dup2(devnull, STDIN_FILENO);
+        ::dup2(devnull, STDOUT_FILENO);
+        ::dup2(devnull, STDERR_FILENO);
+        if (devnull > STDERR_FILENO) ::close(devnull);
+    }
+    ::chdir("/");
+
+    // SIGTERM/SIGHUP: leave the loop so the FIFO is removed and the cache saved
+    struct sigaction sa{};
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    ::sigaction(SIGTERM, &sa, nullptr);
+    ::sigaction(SIGHUP, &sa, nullptr);
+    ::signal(SIGPIPE, SIG_IGN);
+
+    // Created after the fork: threads do not survive it
+    auto pool = make_pool(opts);
+
+    // Warm cache, kept across requests; persisted at most every SAVE_INTERVAL
+    std::unique_ptr<dais::utils::StatsCache> cache;
+    std::string cache_file;
+    constexpr auto SAVE_INTERVAL = std::chrono::seconds(30);
+    auto last_save = std::chrono::steady_clock::now();
+
+    constexpr int TICK_MS = 60 * 1000;
+    long idle_ms = 0;
+    std::string pending;
+    std::string response;
+
+    auto handle = [&](std::string_view line) {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (start <= line.size()) {
+            size_t sep = line.find('\x1f', start);
+            if (sep == std::string_view::npos) sep = line.size();
+            fields.emplace_back(line.substr(start, sep - start));
+            start = sep + 1;
+        }
+        if (fields.size() < 3 || fields[0].empty()) return;
+        const std::string& sentinel = fields[0];
+        const std::string& verb = fields[1];
+        const std::string& cwd = fields[2];
+
+        response.assign("\n");
+        if (verb == "ping") {
+            response += "DAIS_PONG\n";
+        } else if (verb == "ls" || verb == "stat") {
+            Request req;
+            parse_args(std::vector<std::string>(fields.begin() + 3, fields.end()), req);
+            req.expand_dirs = (verb == "ls");
+            // Paths are relative to the shell's cwd, not ours
+            for (auto& p : req.paths) {
+                if (!p.empty() && p[0] != '/') p = cwd + "/" + p;
+            }
+            if (!req.cache_file.empty() && (!cache || cache_file != req.cache_file)) {
+                cache = std::make_unique<dais::utils::StatsCache>();
+                cache_file = req.cache_file;
+                cache->load(cache_file);
+            }
+            run_listing(req, req.cache_file.empty() ? nullptr : cache.get(), pool.get(), response);
+            if (response.back() != '\n') response.push_back('\n');
+        }
+        response += sentinel;
+        response.push_back('\n');
+        write_all(tty_fd, response.data(), response.size());
+
+        if (cache && std::chrono::steady_clock::now() - last_save >= SAVE_INTERVAL) {
+            cache->save(cache_file);
+            last_save = std::chrono::steady_clock::now();
+        }
+    };
+
+    while (!g_stop) {
+        struct pollfd pfds[2] = {{req_fd, POLLIN, 0}, {tty_fd, 0, 0}};
+        int ret = ::poll(pfds, 2, TICK_MS);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfds[1].revents & (POLLHUP | POLLERR | POLLNVAL)) break; // Session closed
+
+        if (ret == 0) {
+            idle_ms += TICK_MS;
+            if (opts.idle_timeout_s > 0 && idle_ms >= opts.idle_timeout_s * 1000L) break;
+            // Retire if a newer instance took over the FIFO path
+            struct stat now_st{};
+            if (::stat(fifo.c_str(), &now_st) != 0 || now_st.st_ino != fifo_st.st_ino) break;
+            continue;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            idle_ms = 0;
+            char buf[4096];
+            ssize_t n;
+            while ((n = ::read(req_fd, buf, sizeof(buf))) > 0) pending.append(buf, static_cast<size_t>(n));
+            size_t nl;
+            while ((nl = pending.find('\n')) != std::string::npos) {
+                handle(std::string_view(pending).substr(0, nl));
+                pending.erase(0, nl + 1);
+            }
         }
     }
 
-    std::cout << "]"; // End JSON array
-    std::cout << "\n"; // Clean line termination
+    // Only remove the FIFO if it is still ours
+    struct stat now_st{};
+    if (::stat(fifo.c_str(), &now_st) == 0 && now_st.st_ino == fifo_st.st_ino) ::unlink(fifo.c_str());
+    if (cache) cache->save(cache_file);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    Request req;
+    parse_args(std::vector<std::string>(argv + 1, argv + argc), req);
+
+    if (req.caps) {
+        // Capability line read by DAIS at deploy time to pick the output format
+        std::cout << "DAIS_AGENT_CAPS wire=" << dais::utils::AGENT_WIRE_VERSION << " serve=1\n";
+        return 0;
+    }
+    if (req.serve) return serve(req);
+
+    // Persistent metadata cache: repeated listings of unchanged files skip content reads
+    dais::utils::StatsCache cache;
+    if (!req.cache_file.empty()) cache.load(req.cache_file);
+
+    auto pool = make_pool(req);
+
+    // The whole payload is built in one buffer and written with as few write(2)s as possible
+    std::string out;
+    run_listing(req, req.cache_file.empty() ? nullptr : &cache, pool.get(), out);
+    write_all(STDOUT_FILENO, out.data(), out.size());
+
+    // Save after output is flushed so the cache write never delays the listing
+    if (!req.cache_file.empty()) cache.save(req.cache_file);
     return 0;
 }
@@ -56,7 +56,7 @@ if [ "$goto_generate" != "true" ]; then
             STATIC_FLAG=""
         fi
 
-        g++ -std=c++20 $STATIC_FLAG -O3 -I"$SCRIPT_DIR/../../include" "$SRC_FILE" -o "$OUT_DIR/agent_x86_64"
+        g++ -std=c++20 $STATIC_FLAG -O3 -I"$SCRIPT_DIR/../../include" "$SRC_FILE" -o "$OUT_DIR/agent_x86_64" -pthread
         strip -s "$OUT_DIR/agent_x86_64" 2>/dev/null || true
     else
         echo "  [x86_64] g++ not found! Skipping."
@@ -65,7 +65,7 @@ if [ "$goto_generate" != "true" ]; then
     # 3. AArch64 (ARM64)
     if command -v aarch64-linux-gnu-g++ >/dev/null 2>&1; then
         echo "  [aarch64] Compiling..."
-        aarch64-linux-gnu-g++ -std=c++20 -static -O3 -I"$SCRIPT_DIR/../../include" "$SRC_FILE" -o "$OUT_DIR/agent_aarch64"
+        aarch64-linux-gnu-g++ -std=c++20 -static -O3 -I"$SCRIPT_DIR/../../include" "$SRC_FILE" -o "$OUT_DIR/agent_aarch64" -pthread
         aarch64-linux-gnu-strip -s "$OUT_DIR/agent_aarch64" 2>/dev/null || true
     else
         echo "  [aarch64] Cross-compiler not found. Skipping."
@@ -74,7 +74,8 @@ if [ "$goto_generate" != "true" ]; then
     # 4. ARMv7 (RPi 3/4 32-bit)
     if command -v arm-linux-gnueabihf-g++ >/dev/null 2>&1; then
         echo "  [armv7l] Compiling..."
-        arm-linux-gnueabihf-g++ -std=c++20 -static -O3 -I"$SCRIPT_DIR/../../include" "$SRC_FILE" -o "$OUT_DIR/agent_armv7"
+        # NEON enables the vectorized scan kernel (scan_kernels.hpp); x86_64 picks SSE2/AVX2 at runtime
+        arm-linux-gnueabihf-g++ -std=c++20 -static -O3 -march=armv7-a -mfpu=neon -I"$SCRIPT_DIR/../../include" "$SRC_FILE" -o "$OUT_DIR/agent_armv7" -pthread
         arm-linux-gnueabihf-strip -s "$OUT_DIR/agent_armv7" 2>/dev/null || true
     else
         echo "  [armv7l] Cross-compiler not found. Skipping."
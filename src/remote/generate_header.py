@@ -1,30 +1,96 @@
 """
 Script to generate C++ headers from binary files.
 Used to embed the remote agent binaries directly into the DAIS engine execution.
+Each agent is embedded raw and gzip-compressed, together with its SHA-256, so
+deploy_remote_agent can upload the smaller form and skip agents already cached
+on the remote host. The POSIX cksum of the raw bytes verifies uploads on hosts
+that have neither sha256sum nor shasum.
 """
 import sys
 import os
+import gzip
+import hashlib
+
+def bytes_to_hex(data, var_name, size_name):
+    """
+    Converts bytes into a C++ byte array definition.
+
+    Args:
+        data (bytes): Content to embed.
+        var_name (str): Name of the C++ array.
+        size_name (str): Name of the C++ size constant.
+
+    Returns:
+        str: A string containing the C++ code for the byte array and its size.
+    """
+    if not data:
+        return f"    inline const unsigned char {var_name}[] = {{ 0x00 }};\n    inline const size_t {size_name} = 0;"
+    hex_str = ", ".join(f"0x{b:02x}" for b in data)
+    return f"    inline const unsigned char {var_name}[] = {{ {hex_str} }};\n    inline const size_t {size_name} = {len(data)};"
+
+def _cksum_table():
+    table = []
+    for i in range(256):
+        crc = i << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+        table.append(crc & 0xFFFFFFFF)
+    return table
+
+_CKSUM_TABLE = _cksum_table()
+
+def posix_cksum(data):
+    """
+    Computes what POSIX `cksum` prints for the given content.
+
+    Args:
+        data (bytes): Content to checksum.
+
+    Returns:
+        str: "<crc> <size>", the output of `cksum < file`.
+    """
+    crc = 0
+    length = len(data)
+    tail = bytearray()
+    n = length
+    while n:
+        tail.append(n & 0xFF)
+        n >>= 8
+    for b in data + bytes(tail):
+        crc = ((crc << 8) & 0xFFFFFFFF) ^ _CKSUM_TABLE[(crc >> 24) ^ b]
+    return f"{~crc & 0xFFFFFFFF} {length}"
 
 def file_to_hex(path, var_name):
     """
-    Reads a binary file and converts it into a C++ byte array definition.
-    
+    Reads a binary file and converts it into C++ definitions: raw bytes,
+    gzip-compressed bytes, and the SHA-256 and POSIX cksum of the raw bytes.
+
     Args:
         path (str): Path to the binary file.
         var_name (str): Name of the C++ variable to generate.
-        
+
     Returns:
-        str: A string containing the C++ code for the byte array and its size.
+        str: A string containing the C++ code for the byte arrays, sizes and checksums.
     """
-    if not os.path.exists(path):
+    suffix = var_name.replace('AGENT_', '')
+    data = b""
+    if os.path.exists(path):
+        with open(path, 'rb') as f:
+            data = f.read()
+    else:
         print(f"Warning: {path} not found. Using empty placeholder.")
-        return f"    inline const unsigned char {var_name}[] = {{ 0x00 }};\n    inline const size_t SIZE_{var_name.replace('AGENT_', '')} = 0;"
-    
-    with open(path, 'rb') as f:
-        data = f.read()
-    
-    hex_str = ", ".join(f"0x{b:02x}" for b in data)
-    return f"    inline const unsigned char {var_name}[] = {{ {hex_str} }};\n    inline const size_t SIZE_{var_name.replace('AGENT_', '')} = {len(data)};"
+
+    # mtime=0 keeps the output reproducible across builds
+    gz = gzip.compress(data, compresslevel=9, mtime=0) if data else b""
+    digest = hashlib.sha256(data).hexdigest() if data else ""
+    cksum = posix_cksum(data) if data else ""
+
+    return "\n".join([
+        bytes_to_hex(data, var_name, f"SIZE_{suffix}"),
+        bytes_to_hex(gz, f"{var_name}_GZ", f"SIZE_{suffix}_GZ"),
+        f"    inline const char SHA256_{suffix}[] = \"{digest}\";",
+        f"    inline const char CKSUM_{suffix}[] = \"{cksum}\";",
+    ])
 
 def generate_header(output_path, binary_dir):
     header = """#pragma once
@@ -40,6 +106,10 @@ namespace dais::core::agents {
         const unsigned char* data;
         size_t size;
         std::string arch;
+        const unsigned char* gz_data;  // gzip-compressed copy of data
+        size_t gz_size;
+        std::string sha256;            // Hex SHA-256 of data (remote cache key)
+        std::string cksum;             // POSIX cksum of data, "<crc> <size>" (fallback upload check)
     };
 
 """
@@ -56,10 +126,16 @@ namespace dais::core::agents {
 
     header += """    // Helper to get agent by architecture
     inline AgentBinary get_agent_for_arch(const std::string& arch) {
-        if (arch == "x86_64") return {AGENT_LINUX_AMD64, SIZE_LINUX_AMD64, "x86_64"};
-        if (arch == "aarch64") return {AGENT_LINUX_ARM64, SIZE_LINUX_ARM64, "aarch64"};
-        if (arch == "armv7l") return {AGENT_LINUX_ARMV7, SIZE_LINUX_ARMV7, "armv7l"};
-        return {nullptr, 0, ""};
+        if (arch == "x86_64") return {AGENT_LINUX_AMD64, SIZE_LINUX_AMD64, "x86_64",
+                                      AGENT_LINUX_AMD64_GZ, SIZE_LINUX_AMD64_GZ, SHA256_LINUX_AMD64,
+                                      CKSUM_LINUX_AMD64};
+        if (arch == "aarch64") return {AGENT_LINUX_ARM64, SIZE_LINUX_ARM64, "aarch64",
+                                       AGENT_LINUX_ARM64_GZ, SIZE_LINUX_ARM64_GZ, SHA256_LINUX_ARM64,
+                                       CKSUM_LINUX_ARM64};
+        if (arch == "armv7l") return {AGENT_LINUX_ARMV7, SIZE_LINUX_ARMV7, "armv7l",
+                                      AGENT_LINUX_ARMV7_GZ, SIZE_LINUX_ARMV7_GZ, SHA256_LINUX_ARMV7,
+                                      CKSUM_LINUX_ARMV7};
+        return {nullptr, 0, "", nullptr, 0, "", ""};
     }
 }
 """
@@ -0,0 +1,137 @@
+/**
+ * @file bench.hpp
+ * @brief Minimal benchmark harness for dais_bench (no external dependencies).
+ * * A benchmark is a callable run(iterations). The harness calibrates the batch
+ *   size so one sample takes roughly a millisecond, then collects samples until
+ *   the time allowance is used up and reports min / p50 / p99 nanoseconds per
+ *   operation.
+ * * Results print as a table, or as JSON (--json) so releases can be compared
+ *   by a script: {"benchmarks": [{"name", "samples", "iterations", "ns_min",
+ *   "ns_p50", "ns_p99", "mb_per_s"}]}.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dais::bench {
+
+    /// @brief Prevents the optimizer from discarding a computed value.
+    template <class T>
+    inline void keep(const T& value) {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    struct Result {
+        std::string name;
+        size_t samples = 0;
+        uint64_t iterations = 0;       ///< Operations per sample
+        double ns_min = 0, ns_p50 = 0, ns_p99 = 0;
+        double bytes_per_op = 0;       ///< For throughput (0 = not reported)
+    };
+
+    class Runner {
+    public:
+        /// @param min_ms Time spent per benchmark (after calibration).
+        explicit Runner(double min_ms = 300, std::string filter = {})
+            : min_ms_(min_ms), filter_(std::move(filter)) {}
+
+        /// @brief True if `name` passes the --filter substring.
+        bool enabled(const std::string& name) const {
+            return filter_.empty() || name.find(filter_) != std::string::npos;
+        }
+
+        /**
+         * @brief Times `run(n)`, which must perform n operations.
+         * @param bytes_per_op Bytes processed per operation (adds MB/s to the report).
+         */
+        void run(const std::string& name, const std::function<void(uint64_t)>& run, double bytes_per_op = 0) {
+            if (!enabled(name)) return;
+            using clock = std::chrono::steady_clock;
+            auto time_ns = [&](uint64_t n) {
+                auto start = clock::now();
+                run(n);
+                return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            };
+
+            // Calibrate: grow the batch until one sample takes ~1ms
+            uint64_t batch = 1;
+            double elapsed = time_ns(batch);
+            while (elapsed < 1e6 && batch < (1ull << 30)) {
+                batch *= (elapsed < 1e5) ? 10 : 2;
+                elapsed = time_ns(batch);
+            }
+
+            std::vector<double> per_op;
+            double total = 0;
+            while ((total < min_ms_ * 1e6 || per_op.size() < 5) && per_op.size() < 100000) {
+                double ns = time_ns(batch);
+                total += ns;
+                per_op.push_back(ns / static_cast<double>(batch));
+            }
+            record(name, std::move(per_op), batch, bytes_per_op);
+        }
+
+        /// @brief Adds externally measured samples (ns per operation each).
+        void record(const std::string& name, std::vector<double> per_op, uint64_t iterations, double bytes_per_op = 0) {
+            if (per_op.empty()) return;
+            std::sort(per_op.begin(), per_op.end());
+            Result r;
+            r.name = name;
+            r.samples = per_op.size();
+            r.iterations = iterations;
+            r.ns_min = per_op.front();
+            r.ns_p50 = percentile(per_op, 0.50);
+            r.ns_p99 = percentile(per_op, 0.99);
+            r.bytes_per_op = bytes_per_op;
+            results_.push_back(r);
+            if (!quiet_) print_row(stderr, r);
+        }
+
+        /// @brief Suppresses the per-benchmark table rows (JSON mode).
+        void set_quiet(bool quiet) { quiet_ = quiet; }
+
+        void print_json(FILE* out) const {
+            std::fprintf(out, "{\"benchmarks\": [");
+            for (size_t i = 0; i < results_.size(); ++i) {
+                const Result& r = results_[i];
+                std::fprintf(out, "%s\n  {\"name\": \"%s\", \"samples\": %zu, \"iterations\": %llu, "
+                                  "\"ns_min\": %.2f, \"ns_p50\": %.2f, \"ns_p99\": %.2f, \"mb_per_s\": %.2f}",
+                             i ? "," : "", r.name.c_str(), r.samples, static_cast<unsigned long long>(r.iterations),
+                             r.ns_min, r.ns_p50, r.ns_p99, throughput(r));
+            }
+            std::fprintf(out, "\n]}\n");
+        }
+
+        static void print_header(FILE* out) {
+            std::fprintf(out, "%-36s %12s %12s %12s %10s\n", "benchmark", "min ns/op", "p50 ns/op", "p99 ns/op", "MB/s");
+        }
+
+    private:
+        static double percentile(const std::vector<double>& sorted, double q) {
+            size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+            return sorted[std::min(index, sorted.size() - 1)];
+        }
+
+        static double throughput(const Result& r) {
+            return (r.bytes_per_op > 0 && r.ns_p50 > 0) ? r.bytes_per_op / r.ns_p50 * 1e3 : 0;
+        }
+
+        static void print_row(FILE* out, const Result& r) {
+            std::fprintf(out, "%-36s %12.1f %12.1f %12.1f", r.name.c_str(), r.ns_min, r.ns_p50, r.ns_p99);
+            if (r.bytes_per_op > 0) std::fprintf(out, " %10.1f", throughput(r));
+            std::fprintf(out, "\n");
+        }
+
+        double min_ms_;
+        std::string filter_;
+        bool quiet_ = false;
+        std::vector<Result> results_;
+    };
+}
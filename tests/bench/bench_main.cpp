@@ -0,0 +1,523 @@
+/**
+ * @file bench_main.cpp
+ * @brief dais_bench: microbenchmarks for the hot paths of ls and the output loop.
+ * * analyze/...     analyze_path() on text, CSV, TSV and large files (estimated and exact)
+ * * template/...    append_ls_entry() with the compiled default templates
+ * * layout/...      layout_ls_grid() on precomputed cells
+ * * listing/...     ListingCore sort + render (serial and on the pool past PARALLEL_SORT_MIN)
+ * * native_ls/...   native_ls() end to end over a generated directory (warm page cache)
+ * * remote_ls/...   render_remote_ls() parsing agent JSON and wire payloads
+ * * passthrough/... Engine::forward_shell_output() fed by a synthetic PTY
+ * * history/...     HistoryStore load and Ctrl-R search over 100k entries
+ * * resolve/...     Engine::resolve_partial_path() on tab-completion concatenations
+ * * git/...         GitStatusCache over a generated repository (skipped without git)
+ *
+ * Usage: dais_bench [--json] [--filter <substring>] [--min-ms <ms>]
+ * Fixtures are generated under $TMPDIR and removed on exit.
+ */
+
+#include "bench.hpp"
+#include "core/agent_wire.hpp"
+#include "core/command_handlers.hpp"
+#include "core/engine.hpp"
+#include "core/file_analyzer.hpp"
+#include "core/history_store.hpp"
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+namespace fs = std::filesystem;
+using dais::bench::keep;
+using dais::bench::Runner;
+
+namespace dais::core {
+
+    /// @brief Benchmark access to Engine internals (declared a friend in engine.hpp).
+    struct EngineBench {
+        /**
+         * @brief Streams `payload` `repeat` times through the pass-through loop.
+         * A child process makes the PTY slave its controlling terminal, so the
+         * "shell is idle" check passes and logo injection runs as in a session.
+         * @return Seconds spent in forward_shell_output (stdout goes to /dev/null).
+         */
+        static double pass_through(const std::string& payload, int repeat) {
+            int master = -1, slave = -1;
+            if (::openpty(&master, &slave, nullptr, nullptr, nullptr) != 0) return -1;
+
+            pid_t child = ::fork();
+            if (child == 0) {
+                ::setsid();
+                ::ioctl(slave, TIOCSCTTY, 0);
+                ::close(master);
+                ::close(slave);
+                ::pause();
+                ::_exit(0);
+            }
+
+            double seconds = -1;
+            {
+                Engine engine;
+                engine.pty_.adopt(master, child);
+                engine.prompt_matcher_.build(engine.config_.shell_prompts, {"--More--"});
+
+                // Wait until the child owns the terminal (idle check needs it)
+                for (int i = 0; i < 1000 && ::tcgetpgrp(master) != child; ++i) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+
+                int saved_stdout = ::dup(STDOUT_FILENO);
+                int devnull = ::open("/dev/null", O_WRONLY);
+                ::dup2(devnull, STDOUT_FILENO);
+
+                std::thread writer([&]() {
+                    for (int i = 0; i < repeat; ++i) {
+                        const char* p = payload.data();
+                        size_t left = payload.size();
+                        while (left > 0) {
+                            ssize_t n = ::write(slave, p, left);
+                            if (n <= 0) {
+                                if (n < 0 && errno == EINTR) continue;
+                                break;
+                            }
+                            p += n;
+                            left -= static_cast<size_t>(n);
+                        }
+                    }
+                    ::close(slave); // Master reads EIO once drained: the loop ends
+                });
+
+                auto start = std::chrono::steady_clock::now();
+                engine.forward_shell_output();
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                writer.join();
+
+                ::dup2(saved_stdout, STDOUT_FILENO);
+                ::close(saved_stdout);
+                ::close(devnull);
+            } // Engine closes the master
+
+            ::kill(child, SIGKILL);
+            ::waitpid(child, nullptr, 0);
+            return seconds;
+        }
+
+        static fs::path resolve(Engine& engine, const std::string& partial, const fs::path& cwd) {
+            return engine.resolve_partial_path(partial, cwd);
+        }
+    };
+}
+
+namespace {
+
+    // -------------------------------------------------------------------------
+    // Fixtures
+    // -------------------------------------------------------------------------
+
+    struct Fixtures {
+        fs::path root;
+
+        Fixtures() {
+            const char* tmp = std::getenv("TMPDIR");
+            std::string tmpl = std::string((tmp && *tmp) ? tmp : "/tmp") + "/dais_bench_XXXXXX";
+            root = ::mkdtemp(tmpl.data());
+        }
+        ~Fixtures() {
+            std::error_code ec;
+            fs::remove_all(root, ec);
+        }
+
+        /// @brief Writes `rows` lines of a `cols`-column table separated by `sep`.
+        fs::path table(const std::string& name, size_t rows, size_t cols, char sep) const {
+            fs::path p = root / name;
+            std::ofstream out(p, std::ios::binary);
+            std::string line;
+            for (size_t r = 0; r < rows; ++r) {
+                line.clear();
+                for (size_t c = 0; c < cols; ++c) {
+                    if (c) line += sep;
+                    line += "value_" + std::to_string(r * cols + c);
+                }
+                line += '\n';
+                out << line;
+            }
+            return p;
+        }
+
+        fs::path text(const std::string& name, size_t lines) const {
+            fs::path p = root / name;
+            std::ofstream out(p, std::ios::binary);
+            for (size_t i = 0; i < lines; ++i) out << "The quick brown fox jumps over the lazy dog " << i << "\n";
+            return p;
+        }
+
+        /// @brief Directory with `n` small files of mixed types.
+        fs::path listing(const std::string& name, size_t n) const {
+            fs::path dir = root / name;
+            fs::create_directories(dir);
+            static const char* exts[] = {".txt", ".csv", ".bin", ".py", ".log"};
+            for (size_t i = 0; i < n; ++i) {
+                std::ofstream out(dir / ("file_" + std::to_string(i) + exts[i % 5]), std::ios::binary);
+                for (size_t l = 0; l < (i % 20) + 1; ++l) out << "a,b,c," << l << "\n";
+            }
+            for (size_t i = 0; i < n / 20; ++i) fs::create_directories(dir / ("dir_" + std::to_string(i)));
+            return dir;
+        }
+    };
+
+    /// @brief Stats as a typical listing would produce them.
+    dais::utils::FileStats sample_stats(size_t i) {
+        dais::utils::FileStats s;
+        s.is_valid = true;
+        s.is_dir = (i % 10 == 0);
+        s.is_text = !s.is_dir && (i % 3 == 0);
+        s.is_data = !s.is_dir && !s.is_text && (i % 3 == 1);
+        s.size_bytes = 1000 + i * 37;
+        s.rows = i * 3;
+        s.max_cols = 40 + i % 80;
+        s.item_count = s.is_dir ? i % 50 : 0;
+        s.is_estimated = (i % 7 == 0);
+        return s;
+    }
+
+    std::string agent_json(size_t n) {
+        std::string out = "[";
+        for (size_t i = 0; i < n; ++i) {
+            auto s = sample_stats(i);
+            if (i) out += ',';
+            out += "{\"name\":\"entry_" + std::to_string(i) + "\",\"is_dir\":" + (s.is_dir ? "true" : "false") +
+                   ",\"size\":" + std::to_string(s.size_bytes) + ",\"rows\":" + std::to_string(s.rows) +
+                   ",\"cols\":" + std::to_string(s.max_cols) + ",\"count\":" + std::to_string(s.item_count) +
+                   ",\"is_text\":" + (s.is_text ? "true" : "false") + ",\"is_data\":" + (s.is_data ? "true" : "false") +
+                   ",\"is_estimated\":" + (s.is_estimated ? "true" : "false") + "}";
+        }
+        return out + "]";
+    }
+
+    std::string agent_wire(size_t n) {
+        std::string out(dais::utils::AGENT_WIRE_MAGIC);
+        out += '\n';
+        for (size_t i = 0; i < n; ++i) dais::utils::append_wire_record(out, "entry_" + std::to_string(i), sample_stats(i));
+        return out;
+    }
+
+    /// @brief Shell-like output: plain lines, colored ls lines and a prompt every 40 lines.
+    std::string shell_output(size_t bytes) {
+        std::string out;
+        size_t i = 0;
+        while (out.size() < bytes) {
+            if (i % 40 == 39) out += "user@host:~/project$ ";
+            if (i % 3 == 0) out += "\x1b[01;34mdirectory_" + std::to_string(i) + "\x1b[0m  \x1b[01;32mscript.sh\x1b[0m\n";
+            else out += "drwxr-xr-x  5 user staff   160 Oct 14 12:00 some_file_name_" + std::to_string(i) + ".txt\n";
+            ++i;
+        }
+        return out;
+    }
+
+    // -------------------------------------------------------------------------
+    // Benchmarks
+    // -------------------------------------------------------------------------
+
+    void bench_analyze(Runner& runner, const Fixtures& fx) {
+        struct Case { std::string name; fs::path path; dais::utils::AnalyzeOptions opts; };
+        dais::utils::AnalyzeOptions exact;
+        exact.exact = true;
+        std::vector<Case> cases = {
+            {"analyze/text_200_lines", fx.text("small.txt", 200), {}},
+            {"analyze/csv_10k_rows", fx.table("table.csv", 10000, 8, ','), {}},
+            {"analyze/tsv_10k_rows", fx.table("table.tsv", 10000, 8, '\t'), {}},
+            {"analyze/large_csv_estimated", fx.table("large.csv", 400000, 8, ','), {}},
+            {"analyze/large_csv_exact", fx.root / "large.csv", exact},
+        };
+        for (const auto& c : cases) {
+            if (!runner.enabled(c.name)) continue;
+            std::string path = c.path.string();
+            double bytes = static_cast<double>(fs::file_size(c.path));
+            runner.run(c.name, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) keep(dais::utils::analyze_path(path, c.opts));
+            }, c.opts.exact ? bytes : 0);
+        }
+    }
+
+    void bench_template(Runner& runner) {
+        dais::core::handlers::LSFormats formats;
+        formats.ensure_compiled();
+        auto text = sample_stats(3);
+        auto dir = sample_stats(10);
+        std::string out;
+        runner.run("template/text_file", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                out.clear();
+                dais::core::handlers::append_ls_entry(out, formats, "report_2024.csv", text);
+                keep(out);
+            }
+        });
+        runner.run("template/directory", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                out.clear();
+                dais::core::handlers::append_ls_entry(out, formats, "src", dir);
+                keep(out);
+            }
+        });
+    }
+
+    void bench_layout(Runner& runner) {
+        using dais::core::handlers::LSCell;
+        for (size_t count : {100, 1000, 10000}) {
+            std::string name = "layout/grid_" + std::to_string(count);
+            if (!runner.enabled(name)) continue;
+            std::vector<std::string> names, displays;
+            std::vector<dais::utils::FileStats> stats;
+            dais::core::handlers::LSFormats formats;
+            formats.ensure_compiled();
+            for (size_t i = 0; i < count; ++i) {
+                names.push_back("entry_" + std::to_string(i));
+                stats.push_back(sample_stats(i));
+            }
+            for (size_t i = 0; i < count; ++i) {
+                std::string d;
+                dais::core::handlers::append_ls_entry(d, formats, names[i], stats[i]);
+                displays.push_back(std::move(d));
+            }
+            std::vector<LSCell> cells;
+            for (size_t i = 0; i < count; ++i) {
+                cells.push_back({names[i], &stats[i], displays[i], dais::core::handlers::get_visible_length(displays[i])});
+            }
+            runner.run(name, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) keep(dais::core::handlers::layout_ls_grid(cells, 4, "h", 160));
+            });
+        }
+    }
+
+    void bench_listing(Runner& runner) {
+        dais::core::utils::ThreadPool pool;
+        dais::core::handlers::LSFormats formats;
+        formats.ensure_compiled();
+        for (size_t count : {1000, 100000}) {
+            const std::string suffix = std::to_string(count);
+            if (!runner.enabled("listing/sort_name_" + suffix) && !runner.enabled("listing/sort_render_" + suffix)) continue;
+            dais::core::utils::ListingCore core;
+            std::vector<dais::utils::FileStats> stats;
+            for (size_t i = 0; i < count; ++i) {
+                // Shared prefixes, so comparisons also reach the arena
+                core.add("entry_" + std::to_string((i * 7919) % count));
+                stats.push_back(sample_stats(i));
+            }
+            auto stats_of = [&](uint32_t i) { return &stats[i]; };
+            const auto by_name = dais::core::utils::LSOrder::parse("name", "asc", true);
+            runner.run("listing/sort_name_" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    core.sort(by_name, stats_of, &pool);
+                    keep(core.index_at(0));
+                }
+            });
+            auto render = [&](std::string& out, uint32_t i) {
+                const size_t start = out.size();
+                dais::core::handlers::append_ls_entry(out, formats, core.name(i), stats[i]);
+                return dais::core::handlers::get_visible_length(std::string_view(out).substr(start));
+            };
+            const auto by_type = dais::core::utils::LSOrder::parse("type", "asc", true);
+            runner.run("listing/sort_render_" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    core.sort(by_type, stats_of, &pool);
+                    core.render(render, &pool);
+                    keep(core.display(0));
+                }
+            });
+        }
+    }
+
+    void bench_native_ls(Runner& runner, const Fixtures& fx) {
+        dais::core::utils::ThreadPool pool;
+        dais::core::handlers::LSFormats formats;
+        formats.ensure_compiled();
+        dais::core::handlers::LSSortConfig sort_cfg;
+        for (size_t count : {100, 1000}) {
+            std::string name = "native_ls/files_" + std::to_string(count);
+            if (!runner.enabled(name)) continue;
+            fs::path dir = fx.listing("ls_" + std::to_string(count), count);
+            auto args = dais::core::handlers::parse_ls_args("ls");
+            runner.run(name, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) keep(dais::core::handlers::native_ls(args, dir, formats, sort_cfg, pool));
+            });
+        }
+    }
+
+    void bench_remote_ls(Runner& runner) {
+        dais::core::handlers::LSFormats formats;
+        formats.ensure_compiled();
+        dais::core::handlers::LSSortConfig sort_cfg;
+        for (size_t count : {100, 1000}) {
+            std::string json = agent_json(count);
+            std::string wire = agent_wire(count);
+            runner.run("remote_ls/json_" + std::to_string(count), [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) keep(dais::core::handlers::render_remote_ls(json, formats, sort_cfg, 4));
+            }, static_cast<double>(json.size()));
+            runner.run("remote_ls/wire_" + std::to_string(count), [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) keep(dais::core::handlers::render_remote_ls(wire, formats, sort_cfg, 4));
+            }, static_cast<double>(wire.size()));
+        }
+    }
+
+    void bench_pass_through(Runner& runner) {
+        const std::string name = "passthrough/shell_output_16MiB";
+        if (!runner.enabled(name)) return;
+        const std::string payload = shell_output(1 << 20);
+        const int repeat = 16;
+        std::vector<double> per_byte;
+        for (int run = 0; run < 7; ++run) {
+            double seconds = dais::core::EngineBench::pass_through(payload, repeat);
+            if (seconds <= 0) return; // No PTY available
+            per_byte.push_back(seconds * 1e9 / (static_cast<double>(payload.size()) * repeat));
+        }
+        // Reported per byte, so MB/s is bytes_per_op (1) / ns
+        runner.record(name, std::move(per_byte), static_cast<uint64_t>(payload.size()) * repeat, 1);
+    }
+
+    void bench_history(Runner& runner, const Fixtures& fx) {
+        using dais::core::utils::HistoryStore;
+        const fs::path path = fx.root / "history";
+        {
+            static const char* words[] = {"git", "docker", "kubectl", "ls", "cd", "python3", "make",
+                                          "grep", "ssh", "vim", "rsync", "curl", "cmake", "cat"};
+            std::ofstream out(path);
+            uint32_t seed = 1;
+            for (int i = 0; i < 100000; ++i) {
+                seed = seed * 1103515245u + 12345u;
+                out << words[(seed >> 8) % 14] << ' ' << words[(seed >> 16) % 14] << '-' << i << " --flag" << i % 7 << '\n';
+            }
+        }
+        runner.run("history/load_100k", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                HistoryStore store;
+                store.open(path.string());
+                keep(store.size());
+            }
+        });
+
+        HistoryStore store;
+        store.open(path.string());
+        // One op = typing the whole query, one incremental search per keystroke
+        const std::string typed = "docker kubectl-4999";
+        runner.run("history/search_typing_19_keys", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::string query;
+                size_t match = HistoryStore::npos;
+                for (char c : typed) {
+                    query += c;
+                    size_t found = store.search(query, match == HistoryStore::npos ? store.end() : match + 1);
+                    if (found != HistoryStore::npos) match = found;
+                }
+                keep(match);
+            }
+        });
+        runner.run("history/search_miss_short_terms", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) keep(store.search("s q", store.end()));
+        });
+    }
+
+    void bench_resolve(Runner& runner, const Fixtures& fx) {
+        if (!runner.enabled("resolve/concatenated_warm") && !runner.enabled("resolve/pathological_miss")) return;
+        // Wide level of look-alike names, then a chain of nested project dirs
+        const fs::path root = fx.root / "resolve";
+        for (int i = 0; i < 300; ++i) fs::create_directories(root / ("data_" + std::to_string(i)));
+        fs::create_directories(root / "mnt" / "d" / "wincplusplus" / "src");
+        // Every split of "aaaa...z" is a candidate: exponential without memoization
+        std::function<void(const fs::path&, int)> nest = [&](const fs::path& dir, int depth) {
+            if (depth == 0) return;
+            for (const char* name : {"a", "aa", "aaa"}) {
+                fs::create_directories(dir / name);
+                nest(dir / name, depth - 1);
+            }
+        };
+        nest(root / "deep", 5);
+
+        dais::core::Engine engine;
+        runner.run("resolve/concatenated_warm", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) keep(dais::core::EngineBench::resolve(engine, "mndwincsrc", root));
+        });
+        const std::string miss = std::string(14, 'a') + "z";
+        runner.run("resolve/pathological_miss", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) keep(dais::core::EngineBench::resolve(engine, miss, root / "deep"));
+        });
+    }
+
+    void bench_git(Runner& runner, const Fixtures& fx) {
+        using dais::core::utils::GitStatusCache;
+        if (!runner.enabled("git/root_listing_2000_tracked") && !runner.enabled("git/index_parse_2000")) return;
+        // 2000 tracked files in 100 directories, 1% of them modified afterwards
+        const fs::path repo = fx.root / "git_repo";
+        for (int d = 0; d < 100; ++d) {
+            fs::create_directories(repo / ("dir_" + std::to_string(d)));
+            for (int f = 0; f < 20; ++f) std::ofstream(repo / ("dir_" + std::to_string(d)) / ("f" + std::to_string(f) + ".txt")) << f << "\n";
+        }
+        const std::string git = "git -C '" + repo.string() + "' -c user.email=bench@dais -c user.name=bench ";
+        if (std::system((git + "init -q >/dev/null 2>&1 && " + git + "add -A && " + git + "commit -qm fixture >/dev/null").c_str()) != 0) {
+            return; // No git on this machine
+        }
+        for (int d = 0; d < 100; d += 5) std::ofstream(repo / ("dir_" + std::to_string(d)) / "f0.txt", std::ios::app) << "changed\n";
+
+        std::vector<GitStatusCache::Query> entries;
+        std::vector<std::string> names;
+        for (int d = 0; d < 100; ++d) names.push_back("dir_" + std::to_string(d));
+        for (const auto& n : names) entries.push_back({n, true});
+
+        GitStatusCache cache;
+        cache.set_limits({std::chrono::milliseconds(10000), 0});
+        runner.run("git/root_listing_2000_tracked", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) keep(cache.list(repo.string(), entries, true, false).has_marks());
+        });
+        runner.run("git/index_parse_2000", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                cache.clear();
+                keep(cache.list(repo.string() + "/dir_0", {}, true, false).has_marks());
+            }
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    std::string filter;
+    double min_ms = 300;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") json = true;
+        else if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--min-ms" && i + 1 < argc) min_ms = std::atof(argv[++i]);
+        else {
+            std::fprintf(stderr, "Usage: %s [--json] [--filter <substring>] [--min-ms <ms>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Runner runner(min_ms, filter);
+    runner.set_quiet(json);
+    if (!json) Runner::print_header(stderr);
+
+    Fixtures fx;
+    bench_analyze(runner, fx);
+    bench_template(runner);
+    bench_layout(runner);
+    bench_listing(runner);
+    bench_native_ls(runner, fx);
+    bench_remote_ls(runner);
+    bench_pass_through(runner);
+    bench_history(runner, fx);
+    bench_resolve(runner, fx);
+    bench_git(runner, fx);
+
+    if (json) runner.print_json(stdout);
+    return 0;
+}
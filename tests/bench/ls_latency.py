@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+DAIS End-to-End ls Latency Benchmark.
+
+Generates directories of 1k / 10k / 100k files, runs `ls` in each through a real
+DAIS session and reports p50 / p99 latency from Enter to the next prompt.
+`command ls` (the shell's own ls, not intercepted) is measured alongside as a
+baseline.
+
+Usage:
+    python3 tests/bench/ls_latency.py [--sizes 1000,10000,100000] [--runs 30] [--json out.json]
+
+The JSON report ({"benchmarks": [{"name", "files", "runs", "p50_ms", "p99_ms",
+"mean_ms"}]}) is meant to be kept per release and compared between them.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import statistics
+import sys
+import tempfile
+import time
+
+try:
+    import pexpect
+except ImportError:
+    print("ERROR: pexpect not installed. Run: pip install pexpect")
+    sys.exit(1)
+
+STARTUP_TIMEOUT = 10
+SHELL_INIT_DELAY = 2
+PROMPT = "DAIS_BENCH$ "
+
+def find_binary():
+    candidates = [
+        './build/DAIS',
+        '../build/DAIS',
+        os.path.join(os.path.dirname(__file__), '..', '..', 'build', 'DAIS'),
+    ]
+    for path in candidates:
+        if os.path.exists(path):
+            return os.path.abspath(path)
+    return None
+
+def generate_tree(root, count):
+    """Creates `count` small files of mixed types (and a few directories) under root."""
+    path = os.path.join(root, f"files_{count}")
+    os.makedirs(path)
+    exts = [".txt", ".csv", ".py", ".log", ".bin"]
+    body = "id,name,value\n" + "".join(f"{i},row{i},{i * 3}\n" for i in range(20))
+    for i in range(count):
+        with open(os.path.join(path, f"file_{i:06d}{exts[i % len(exts)]}"), "w") as f:
+            f.write(body[: 20 + (i % 200)])
+    for i in range(max(count // 100, 1)):
+        os.makedirs(os.path.join(path, f"dir_{i:04d}"))
+    return path
+
+def percentile(sorted_values, q):
+    index = int(round(q * (len(sorted_values) - 1)))
+    return sorted_values[min(index, len(sorted_values) - 1)]
+
+def time_command(child, command, runs, timeout):
+    """Runs `command` `runs` times; returns the latencies in milliseconds."""
+    # Warm-up run (page cache, metadata cache)
+    child.sendline(command)
+    child.expect_exact(PROMPT, timeout=timeout)
+    samples = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        child.sendline(command)
+        child.expect_exact(PROMPT, timeout=timeout)
+        samples.append((time.perf_counter() - start) * 1000.0)
+    return samples
+
+def main():
+    parser = argparse.ArgumentParser(description="End-to-end ls latency through DAIS")
+    parser.add_argument("--sizes", default="1000,10000,100000", help="Comma-separated file counts")
+    parser.add_argument("--runs", type=int, default=30, help="Measured runs per directory")
+    parser.add_argument("--json", metavar="FILE", help="Write the report as JSON ('-' for stdout)")
+    parser.add_argument("--binary", help="Path to the DAIS binary (default: build/DAIS)")
+    args = parser.parse_args()
+
+    binary = args.binary or find_binary()
+    if not binary:
+        print("ERROR: DAIS binary not found. Build first (cmake --build build).")
+        return 1
+
+    sizes = [int(s) for s in args.sizes.split(",") if s.strip()]
+    root = tempfile.mkdtemp(prefix="dais_ls_bench_")
+    results = []
+    child = None
+    try:
+        print(f"Generating fixtures in {root} ...", file=sys.stderr)
+        dirs = {count: generate_tree(root, count) for count in sizes}
+
+        env = dict(os.environ, SHELL="/bin/bash")
+        child = pexpect.spawn(binary, env=env, timeout=60, encoding='utf-8', dimensions=(50, 200))
+        child.expect('DAIS has been started', timeout=STARTUP_TIMEOUT)
+        time.sleep(SHELL_INIT_DELAY)
+        child.sendline(f"export PS1='{PROMPT}'")
+        child.expect_exact(PROMPT, timeout=STARTUP_TIMEOUT)
+
+        for count in sizes:
+            child.sendline(f"cd {dirs[count]}")
+            child.expect_exact(PROMPT, timeout=STARTUP_TIMEOUT)
+            timeout = max(30, count / 1000)
+            for name, command in (("ls", "ls"), ("command_ls", "command ls")):
+                samples = sorted(time_command(child, command, args.runs, timeout))
+                result = {
+                    "name": f"{name}/files_{count}",
+                    "files": count,
+                    "runs": len(samples),
+                    "p50_ms": round(percentile(samples, 0.50), 3),
+                    "p99_ms": round(percentile(samples, 0.99), 3),
+                    "mean_ms": round(statistics.fmean(samples), 3),
+                }
+                results.append(result)
+                print(f"{result['name']:<28} p50 {result['p50_ms']:>9.2f} ms   p99 {result['p99_ms']:>9.2f} ms",
+                      file=sys.stderr)
+    finally:
+        if child is not None:
+            try:
+                child.sendline(':exit')
+                child.expect(pexpect.EOF, timeout=10)
+            except Exception:
+                child.terminate(force=True)
+            child.close()
+        shutil.rmtree(root, ignore_errors=True)
+
+    report = {"benchmarks": results}
+    if args.json == "-":
+        print(json.dumps(report, indent=2))
+    elif args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -19,7 +19,9 @@ Exit Codes:
 """
 
 import os
+import re
 import shutil
+import subprocess
 import sys
 import tempfile
 import time
@@ -292,7 +294,8 @@ def test_history_commands():
     """
     Test History command functionality.
 
-    Verifies :history shows commands and :history clear removes them.
+    Verifies :history shows commands, :history search and Ctrl-R find them,
+    and :history clear removes them.
 
     Returns:
         bool: True if history operations work, False on error.
@@ -330,6 +333,31 @@ def test_history_commands():
             cleanup_child(child)
             return False
 
+        # Search: case-insensitive terms
+        child.sendline(':history search COMMAND2')
+        try:
+            child.expect_exact('echo command2', timeout=COMMAND_TIMEOUT)
+            print("  PASS: History search verified")
+        except pexpect.TIMEOUT:
+            print("  FAIL: History search found nothing")
+            cleanup_child(child)
+            return False
+        time.sleep(0.5)
+
+        # Ctrl-R: incremental search, Enter runs the match
+        child.sendcontrol('r')
+        child.send('mand1')
+        try:
+            child.expect_exact("(history-search)`mand1': echo command1", timeout=COMMAND_TIMEOUT)
+            child.send('\r')
+            child.expect(r'(?<!echo )command1\r\n', timeout=COMMAND_TIMEOUT)  # The output, not the echoed line
+            print("  PASS: Ctrl-R search verified")
+        except pexpect.TIMEOUT:
+            print("  FAIL: Ctrl-R search did not recall the command")
+            cleanup_child(child)
+            return False
+        time.sleep(0.5)
+
         # Clear history
         child.sendline(':history clear')
         time.sleep(0.5)
@@ -358,6 +386,181 @@ def test_history_commands():
             del os.environ['HOME']
 
 
+# =============================================================================
+# Test Cases: Perf Counters
+# =============================================================================
+
+def test_perf_command():
+    """
+    Test the :perf command.
+
+    Runs an ls so the ls stages have samples, then checks that :perf lists them,
+    that :perf json prints the JSON dump and that :perf reset empties the window.
+
+    Returns:
+        bool: True if the perf counters work, False on error.
+    """
+    print("[TEST] Perf Command...")
+
+    binary = find_binary()
+    if not binary:
+        print("  SKIP: Binary not found")
+        return None
+
+    try:
+        child = spawn_dais_ready(binary)
+        child.sendline('ls')
+        time.sleep(1)
+
+        child.sendline(':perf')
+        try:
+            child.expect('ls.enumerate', timeout=COMMAND_TIMEOUT)
+            child.expect('ls.total', timeout=COMMAND_TIMEOUT)
+            print("  PASS: :perf lists ls stages")
+        except pexpect.TIMEOUT:
+            print("  FAIL: ls stages missing from :perf")
+            cleanup_child(child)
+            return False
+
+        child.sendline(':perf json')
+        try:
+            child.expect('"stages"', timeout=COMMAND_TIMEOUT)
+            print("  PASS: :perf json prints the dump")
+        except pexpect.TIMEOUT:
+            print("  FAIL: :perf json output missing")
+            cleanup_child(child)
+            return False
+
+        child.sendline(':perf reset')
+        child.expect('reset', timeout=COMMAND_TIMEOUT)
+        child.sendline(':perf')
+        try:
+            child.expect('no samples yet', timeout=COMMAND_TIMEOUT)
+            print("  PASS: :perf reset clears the window")
+        except pexpect.TIMEOUT:
+            print("  FAIL: counters not reset")
+            cleanup_child(child)
+            return False
+
+        cleanup_child(child)
+        return True
+
+    except Exception as e:
+        print(f"  FAIL: Exception - {e}")
+        return False
+
+
+def test_plugin_hooks():
+    """
+    Test Python plugin hook dispatch.
+
+    The bundled tester.py logs a line from on_command("status"), which now runs
+    on the hook thread; :perf then lists the plugin with its call count.
+
+    Returns:
+        bool: True if the hook ran and was accounted, False on error.
+    """
+    print("[TEST] Plugin Hooks...")
+
+    binary = find_binary()
+    if not binary:
+        print("  SKIP: Binary not found")
+        return None
+
+    try:
+        child = spawn_dais_ready(binary)
+        child.send('status\r')  # Enter is \r at the DAIS input loop
+        try:
+            child.expect('Plugin seems to operate', timeout=COMMAND_TIMEOUT)
+            print("  PASS: on_command ran off the input thread")
+        except pexpect.TIMEOUT:
+            print("  FAIL: tester.on_command output missing")
+            cleanup_child(child)
+            return False
+
+        time.sleep(0.5)
+        child.send('\x15:perf\r')
+        try:
+            child.expect('Plugin hooks', timeout=COMMAND_TIMEOUT)
+            child.expect(r'tester\s+on_command\s+async', timeout=COMMAND_TIMEOUT)
+            print("  PASS: :perf shows per-plugin hook times")
+        except pexpect.TIMEOUT:
+            print("  FAIL: plugin hook table missing from :perf")
+            cleanup_child(child)
+            return False
+
+        cleanup_child(child)
+        return True
+
+    except Exception as e:
+        print(f"  FAIL: Exception - {e}")
+        return False
+
+
+REWRITE_PLUGIN = """DAIS_SYNC_HOOKS = ["on_command"]
+
+def on_command(cmd_text):
+    if cmd_text == "echo DAIS_REWRITE_ME":
+        return "echo DAIS_REWRITTEN_OK"
+"""
+
+
+def test_plugin_sync_rewrite():
+    """
+    Test a rewriting sync hook on a pasted command line.
+
+    A temporary plugin in src/py_scripts rewrites one command. The whole line,
+    Enter included, arrives in a single read, so the original characters are
+    still unsent when the rewrite happens; only the rewritten command may run.
+
+    Returns:
+        bool: True if exactly the rewritten command ran, False on error.
+    """
+    print("[TEST] Plugin Sync Rewrite (pasted line)...")
+
+    binary = find_binary()
+    if not binary:
+        print("  SKIP: Binary not found")
+        return None
+
+    scripts_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'src', 'py_scripts')
+    plugin_path = os.path.join(scripts_dir, 'dais_test_rewrite.py')
+    child = None
+    try:
+        with open(plugin_path, 'w') as f:
+            f.write(REWRITE_PLUGIN)
+
+        child = spawn_dais_ready(binary)
+        # tester.py answers once the plugins are loaded (events before that are async only)
+        child.send('status\r')
+        child.expect('Plugin seems to operate', timeout=COMMAND_TIMEOUT)
+        time.sleep(0.5)
+
+        child.send('echo DAIS_REWRITE_ME\r')  # One write: a paste
+        try:
+            # The echoed line, then the command's output: neither may carry the original
+            # (with the kill sent too early the shell runs "echo DAIS_REWRITTEN_OKecho DAIS_REWRITE_ME")
+            for _ in range(2):
+                child.expect(r'DAIS_REWRITTEN_OK([^\r\n]*)\r?\n', timeout=COMMAND_TIMEOUT)
+                if 'DAIS_REWRITE_ME' in child.match.group(1):
+                    print(f"  FAIL: original command ran glued to the rewrite: {child.match.group(0)!r}")
+                    return False
+            print("  PASS: pasted command was replaced by the rewrite")
+        except pexpect.TIMEOUT:
+            print(f"  FAIL: rewritten command did not run. Output: {child.before!r}")
+            return False
+        return True
+
+    except Exception as e:
+        print(f"  FAIL: Exception - {e}")
+        return False
+    finally:
+        if child is not None:
+            cleanup_child(child)
+        if os.path.exists(plugin_path):
+            os.remove(plugin_path)
+
+
 # =============================================================================
 # Test Cases: Special Filenames
 # =============================================================================
@@ -412,6 +615,69 @@ def test_special_filenames():
         shutil.rmtree(temp_dir, ignore_errors=True)
 
 
+def test_git_annotations():
+    """
+    Test {git} markers in native ls output.
+
+    A committed then modified file must show "*", a new file "?" and a file
+    matched by .gitignore "!", without running git from DAIS.
+
+    Returns:
+        bool: True if all three markers are shown, False on error.
+    """
+    print("[TEST] Git Annotations...")
+
+    binary = find_binary()
+    if not binary:
+        print("  SKIP: Binary not found")
+        return None
+    if not shutil.which("git"):
+        print("  SKIP: git not installed")
+        return None
+
+    repo = tempfile.mkdtemp()
+    try:
+        git = ["git", "-C", repo, "-c", "user.email=test@dais", "-c", "user.name=dais"]
+        subprocess.run(["git", "init", "-q", repo], check=True)
+        with open(os.path.join(repo, "tracked.txt"), 'w') as f: f.write("one\n")
+        with open(os.path.join(repo, ".gitignore"), 'w') as f: f.write("*.log\n")
+        subprocess.run(git + ["add", "-A"], check=True)
+        subprocess.run(git + ["commit", "-q", "-m", "init"], check=True)
+        with open(os.path.join(repo, "tracked.txt"), 'a') as f: f.write("two\n")
+        with open(os.path.join(repo, "fresh.txt"), 'w') as f: f.write("new\n")
+        with open(os.path.join(repo, "debug.log"), 'w') as f: f.write("noise\n")
+
+        child = spawn_dais_ready(binary)
+        child.send(f'ls {repo}\r')  # Enter is \r at the DAIS input loop
+        marker = r'\x1b\[[0-9;]*m'
+        try:
+            child.expect(r'\| ', timeout=COMMAND_TIMEOUT)  # Grid started
+            child.expect(r'[\#\$] ', timeout=COMMAND_TIMEOUT)
+            out = child.before
+        except pexpect.TIMEOUT:
+            print("  FAIL: ls output missing")
+            cleanup_child(child)
+            return False
+        cleanup_child(child)
+
+        checks = [("modified", r'tracked\.txt' + marker + r'\*'),
+                  ("untracked", r'fresh\.txt' + marker + r'\?'),
+                  ("ignored", r'debug\.log' + marker + r'!')]
+        for label, pattern in checks:
+            if not re.search(pattern, out):
+                print(f"  FAIL: {label} marker missing")
+                return False
+        print("  PASS: modified / untracked / ignored markers shown")
+        return True
+
+    except Exception as e:
+        print(f"  FAIL: Exception - {e}")
+        return False
+
+    finally:
+        shutil.rmtree(repo, ignore_errors=True)
+
+
 def test_ls_flow_control():
     """
     Test LS horizontal vs vertical flow control.
@@ -642,8 +908,21 @@ def main():
     results.append(('history', test_history_commands()))
     time.sleep(1)
 
+    # Perf counters
+    results.append(('perf', test_perf_command()))
+    time.sleep(1)
+
+    # Plugin hooks
+    results.append(('plugin_hooks', test_plugin_hooks()))
+    time.sleep(1)
+    results.append(('plugin_rewrite', test_plugin_sync_rewrite()))
+    time.sleep(1)
+
     # Special filenames
     results.append(('special_files', test_special_filenames()))
+
+    # Git annotations
+    results.append(('git_annotations', test_git_annotations()))
     
     # DB Auto-Install Prompt
     results.append(('db_autoinstall', test_db_autoinstall()))
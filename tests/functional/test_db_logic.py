@@ -2,6 +2,7 @@ import os
 import sys
 import shutil
 import tempfile
+import types
 import unittest
 from unittest.mock import patch, MagicMock
 
@@ -247,6 +248,84 @@ class TestDBFailures(unittest.TestCase):
             
         print("  Auto-Limit Logic: PASS")
 
+class TestAdapterPool(unittest.TestCase):
+    """Connection reuse across run_query() calls."""
+
+    def setUp(self):
+        self.test_dir = tempfile.mkdtemp()
+        self.db_path = os.path.join(self.test_dir, "pool.db")
+        self.pool = db_handler.AdapterPool()
+        self.patcher = patch.object(db_handler, "_POOL", self.pool)
+        self.patcher.start()
+
+    def tearDown(self):
+        self.patcher.stop()
+        self.pool.close_all()
+        shutil.rmtree(self.test_dir)
+
+    def test_reuses_connection(self):
+        """Ten queries in a row cost one connect."""
+        db_handler.run_query("CREATE TABLE t (id INTEGER)", "sqlite", self.db_path)
+        for _ in range(9):
+            db_handler.run_query("SELECT * FROM t", "sqlite", self.db_path)
+        self.assertEqual(self.pool.connects, 1)
+        print("  Pool Reuse: PASS")
+
+    def test_dead_connection_replaced(self):
+        """A connection that fails its health check is replaced transparently."""
+        db_handler.run_query("CREATE TABLE t (id INTEGER)", "sqlite", self.db_path)
+        adapter = next(iter(self.pool.idle.values()))[0]
+        adapter.conn.close() # Simulate a server-side disconnect
+        self.pool.settings["ping_after_s"] = 0
+        result = db_handler.run_query("SELECT * FROM t", "sqlite", self.db_path)
+        self.assertEqual(result["status"], "success")
+        self.assertEqual(self.pool.connects, 2)
+        print("  Pool Health Check: PASS")
+
+    def test_idle_timeout_and_limit(self):
+        """Idle connections are closed; at most max_connections stay open."""
+        self.pool.configure({"max_connections": 1})
+        other = os.path.join(self.test_dir, "other.db")
+        db_handler.run_query("SELECT 1", "sqlite", self.db_path)
+        db_handler.run_query("SELECT 1", "sqlite", other)
+        self.assertEqual(len(self.pool.idle), 1)
+        self.pool.settings["idle_timeout_s"] = -1
+        self.pool.close_idle()
+        self.assertEqual(len(self.pool.idle), 0)
+        print("  Pool Idle Timeout: PASS")
+
+    def test_saved_query_prepared(self):
+        """Saved queries go through execute_saved()."""
+        with patch("db_handler.get_adapter") as mock_get:
+            mock_adapter = MagicMock()
+            mock_get.return_value = mock_adapter
+            db_handler.run_query("SELECT * FROM t LIMIT 5", "postgres", "", saved=True)
+            mock_adapter.execute_saved.assert_called_once()
+            mock_adapter.execute.assert_not_called()
+
+        cache = db_handler.PreparedCache(capacity=2)
+        cache.put("a", "q1")
+        cache.put("b", "q2")
+        cache.get("a")
+        self.assertEqual(cache.put("c", "q3"), ("b", "q2")) # Least recently used goes first
+        print("  Prepared Statement Cache: PASS")
+
+    def test_saved_query_multi_word_key(self):
+        """A saved key containing spaces expands as a whole; a one-word alias still takes flags."""
+        queries = {"active users": "SELECT * FROM users WHERE active = 1", "users": "SELECT * FROM users"}
+        mock_config = types.SimpleNamespace(DB_QUERIES=queries, DB_POOL=None)
+        with patch.dict(sys.modules, {"config": mock_config}), patch("db_handler.run_query") as mock_run:
+            db_handler.handle_command("active users", self.test_dir)
+            args, _ = mock_run.call_args
+            self.assertEqual(args[0], queries["active users"])
+            self.assertTrue(args[4]) # saved
+
+            db_handler.handle_command("users --json", self.test_dir)
+            args, _ = mock_run.call_args
+            self.assertEqual(args[0], "SELECT * FROM users --json")
+            self.assertTrue(args[4])
+        print("  Multi-Word Saved Query: PASS")
+
 if __name__ == '__main__':
     unittest.main()
 
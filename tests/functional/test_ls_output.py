@@ -25,6 +25,9 @@ Exit Codes:
 
 import sys
 import os
+import re
+import shutil
+import tempfile
 import time
 
 try:
@@ -120,6 +123,30 @@ def spawn_dais_ready(binary):
     return child
 
 
+def read_ls_output(child, marker):
+    """
+    Wait for a marker in the output and return everything that follows, ANSI-stripped.
+
+    Args:
+        child: The pexpect child process.
+        marker: Text that must appear in the ls output.
+
+    Returns:
+        str: Plain-text output from the marker onward ('' on timeout).
+    """
+    try:
+        child.expect(re.escape(marker), timeout=COMMAND_TIMEOUT)
+    except pexpect.TIMEOUT:
+        return ''
+    time.sleep(0.5)
+    rest = ''
+    try:
+        rest = child.read_nonblocking(65536, timeout=1)
+    except (pexpect.TIMEOUT, pexpect.EOF):
+        pass
+    return marker + re.sub(r'\x1b\[[0-9;?]*[A-Za-z]', '', rest)
+
+
 def cleanup_child(child):
     """
     Safely terminate and close a pexpect child process.
@@ -294,6 +321,97 @@ def test_ls_with_path(binary, fixtures_dir):
         return False
 
 
+def test_ls_recursive_totals(binary, fixtures_dir):
+    """
+    Verify ls -R shows subtree totals and a summary line.
+
+    The fixtures/subdir contains 3 nested files, so its tree row must report
+    "3 files", followed by the "Total:" footer of the recursive listing.
+
+    Args:
+        binary: Path to the DAIS binary.
+        fixtures_dir: Path to the test fixtures directory.
+
+    Returns:
+        bool: True if the totals were rendered, False on failure.
+    """
+    print(f"[TEST] ls -R subtree totals (shell: {get_current_shell()})...")
+
+    try:
+        child = spawn_dais_ready(binary)
+
+        child.sendline(f'ls -R {fixtures_dir}')
+
+        try:
+            # Colors sit between the number and the label
+            child.expect(r'subdir\S*/.*?3\S* \S*files', timeout=COMMAND_TIMEOUT)
+            child.expect('Total:', timeout=COMMAND_TIMEOUT)
+            print("  PASS: ls -R rendered subtree totals")
+            cleanup_child(child)
+            return True
+        except pexpect.TIMEOUT:
+            print("  FAIL: ls -R did not show subtree totals")
+            cleanup_child(child)
+            return False
+
+    except Exception as e:
+        print(f"  FAIL: Exception - {e}")
+        return False
+
+
+def test_ls_cache_invalidation(binary):
+    """
+    Verify cached metadata is refreshed when a file changes.
+
+    Lists a scratch directory twice with the metadata cache warm in between,
+    appending lines to the file before the second listing. The row count
+    must reflect the new content (cache entries are keyed on inode, mtime
+    and size, so the append must invalidate the entry).
+
+    Args:
+        binary: Path to the DAIS binary.
+
+    Returns:
+        bool: True if the second listing shows the updated row count.
+    """
+    print(f"[TEST] ls cache invalidation (shell: {get_current_shell()})...")
+
+    scratch = tempfile.mkdtemp(prefix='dais_cache_')
+    probe = os.path.join(scratch, 'cache_probe.txt')
+    try:
+        with open(probe, 'w') as f:
+            f.write('a\nb\nc\n')
+
+        child = spawn_dais_ready(binary)
+
+        child.sendline(f'ls {scratch}')
+        first = read_ls_output(child, 'cache_probe.txt')
+
+        with open(probe, 'a') as f:
+            f.write('d\ne\n')
+
+        child.sendline(f'ls {scratch}')
+        second = read_ls_output(child, 'cache_probe.txt')
+        cleanup_child(child)
+
+        m1 = re.search(r'cache_probe\.txt.*?(\d+) R', first)
+        m2 = re.search(r'cache_probe\.txt.*?(\d+) R', second)
+        if not m1 or not m2:
+            print("  FAIL: Could not find row counts in ls output")
+            return False
+        if m1.group(1) == '3' and m2.group(1) == '5':
+            print("  PASS: Row count updated after file change")
+            return True
+        print(f"  FAIL: Expected 3 then 5 rows, got {m1.group(1)} then {m2.group(1)}")
+        return False
+
+    except Exception as e:
+        print(f"  FAIL: Exception - {e}")
+        return False
+    finally:
+        shutil.rmtree(scratch, ignore_errors=True)
+
+
 # =============================================================================
 # Main Entry Point
 # =============================================================================
@@ -339,6 +457,12 @@ def main():
     results.append(('ls_with_path', test_ls_with_path(binary, fixtures)))
     time.sleep(1)
 
+    results.append(('ls_cache_invalidation', test_ls_cache_invalidation(binary)))
+    time.sleep(1)
+
+    results.append(('ls_recursive_totals', test_ls_recursive_totals(binary, fixtures)))
+    time.sleep(1)
+
     # Print summary
     print()
     print("=" * 50)